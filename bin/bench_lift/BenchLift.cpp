@@ -0,0 +1,193 @@
+/*
+ * Copyright (c) 2026 Trail of Bits, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+#include <llvm/IR/Function.h>
+#include <llvm/IR/LLVMContext.h>
+#include <llvm/IR/Module.h>
+#include <remill/Arch/Arch.h>
+#include <remill/Arch/Name.h>
+#include <remill/BC/Lifter.h>
+#include <remill/BC/Util.h>
+#include <remill/OS/OS.h>
+
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+DEFINE_string(os, REMILL_OS,
+              "Operating system name of the code being lifted. Valid OSes: "
+              "linux, macos, windows, solaris.");
+DEFINE_string(arch, REMILL_ARCH,
+              "Architecture of the code being lifted. Valid architectures: "
+              "x86, amd64 (with or without `_avx` or `_avx512` appended), "
+              "aarch64");
+
+DEFINE_uint64(address, 0x1000,
+              "Address at which the generated code is located.");
+
+DEFINE_uint64(min_insts, 1024,
+              "Number of instructions in the smallest generated trace.");
+DEFINE_uint64(max_insts, 1024 * 1024,
+              "Number of instructions in the largest generated trace.");
+
+namespace {
+
+// A two-instruction unit of code. The first instruction conditionally
+// branches to the next unit, and the second falls through into it, so that
+// every instruction begins a new basic block, and every block is both a
+// branch target and a fall-through.
+struct CodeUnit {
+  std::string bytes;
+  std::string ret_bytes;
+};
+
+// Return the unit of code to repeat for `arch`.
+static bool GetCodeUnit(const remill::Arch *arch, CodeUnit &unit) {
+  if (arch->IsX86() || arch->IsAMD64()) {
+    unit.bytes = {'\x74', '\x02', '\xff', '\xc0'};  // je +2; inc eax
+    unit.ret_bytes = {'\xc3'};  // ret
+    return true;
+
+  } else if (arch->IsAArch64()) {
+    unit.bytes = {'\x40', '\x00', '\x00', '\x54',  // b.eq +8
+                  '\x00', '\x04', '\x00', '\x91'};  // add x0, x0, #1
+    unit.ret_bytes = {'\xc0', '\x03', '\x5f', '\xd6'};  // ret
+    return true;
+
+  } else {
+    return false;
+  }
+}
+
+// Serves generated code to the trace lifter, and keeps track of the traces
+// it lifts.
+class BenchTraceManager : public remill::TraceManager {
+ public:
+  virtual ~BenchTraceManager(void) = default;
+
+  BenchTraceManager(uint64_t base_, const std::string &code_)
+      : base(base_),
+        code(code_) {}
+
+ protected:
+  void SetLiftedTraceDefinition(uint64_t addr,
+                                llvm::Function *lifted_func) override {
+    traces[addr] = lifted_func;
+  }
+
+  llvm::Function *GetLiftedTraceDeclaration(uint64_t addr) override {
+    auto trace_it = traces.find(addr);
+    if (trace_it != traces.end()) {
+      return trace_it->second;
+    } else {
+      return nullptr;
+    }
+  }
+
+  llvm::Function *GetLiftedTraceDefinition(uint64_t addr) override {
+    return GetLiftedTraceDeclaration(addr);
+  }
+
+  bool TryReadExecutableByte(uint64_t addr, uint8_t *byte) override {
+    if (addr < base || (addr - base) >= code.size()) {
+      return false;
+    }
+    *byte = static_cast<uint8_t>(code[addr - base]);
+    return true;
+  }
+
+ public:
+  const uint64_t base;
+  const std::string &code;
+  std::unordered_map<uint64_t, llvm::Function *> traces;
+};
+
+}  // namespace
+
+int main(int argc, char *argv[]) {
+  google::ParseCommandLineFlags(&argc, &argv, true);
+  google::InitGoogleLogging(argv[0]);
+
+  if (!FLAGS_min_insts || FLAGS_min_insts > FLAGS_max_insts) {
+    std::cerr << "Please specify a non-zero --min_insts that is no larger "
+              << "than --max_insts." << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  llvm::LLVMContext context;
+  auto arch = remill::Arch::Get(context, FLAGS_os, FLAGS_arch);
+  if (!arch) {
+    std::cerr << "Unsupported --os/--arch combination." << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  CodeUnit unit;
+  if (!GetCodeUnit(arch.get(), unit)) {
+    std::cerr << "No code generator for architecture " << FLAGS_arch
+              << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  std::unique_ptr<llvm::Module> module(remill::LoadArchSemantics(arch.get()));
+
+  std::cout << std::setw(12) << "insts" << std::setw(12) << "blocks"
+            << std::setw(12) << "seconds" << std::setw(12) << "ns/inst"
+            << std::endl;
+
+  // Lift one ever larger trace per round. If lifting is linear in the number
+  // of instructions, then the time per instruction stays flat.
+  for (auto num_insts = FLAGS_min_insts; num_insts <= FLAGS_max_insts;
+       num_insts *= 2) {
+    std::string code;
+    code.reserve(num_insts * unit.bytes.size() / 2 + unit.ret_bytes.size());
+    for (uint64_t i = 0; i < num_insts; i += 2) {
+      code += unit.bytes;
+    }
+    code += unit.ret_bytes;
+
+    BenchTraceManager manager(FLAGS_address, code);
+    remill::TraceLifter trace_lifter(arch.get(), manager);
+
+    const auto start = std::chrono::steady_clock::now();
+    if (!trace_lifter.Lift(FLAGS_address)) {
+      LOG(ERROR) << "Unable to lift trace of " << num_insts << " instructions";
+      return EXIT_FAILURE;
+    }
+    const std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+
+    size_t num_blocks = 0;
+    for (auto [addr, trace] : manager.traces) {
+      num_blocks += trace->size();
+      trace->eraseFromParent();
+    }
+
+    std::cout << std::setw(12) << num_insts << std::setw(12) << num_blocks
+              << std::setw(12) << std::fixed << std::setprecision(3)
+              << elapsed.count() << std::setw(12) << std::setprecision(1)
+              << (elapsed.count() * 1e9 / static_cast<double>(num_insts))
+              << std::endl;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -40,9 +40,11 @@
 #include <remill/OS/OS.h>
 #include <test_runner/TestRunner.h>
 
+#include <algorithm>
 #include <functional>
 #include <random>
 
+#include "PassCache.h"
 #include "Whitelist.h"
 #include "gtest/gtest.h"
 
@@ -53,8 +55,27 @@ DEFINE_string(repro_file, "", "File to output failing test cases");
 DEFINE_string(whitelist, "", "File listing instruction states not to check");
 DEFINE_bool(should_dump_functions, false, "Dump each function version");
 DEFINE_bool(stop_on_fail, false, "Stop on first failure");
+DEFINE_string(pass_cache, "",
+              "File recording the test cases that are known to pass, which "
+              "are skipped on later runs");
+DEFINE_bool(force_rerun, false,
+            "Re-run test cases even if --pass_cache says they pass");
+DEFINE_uint64(lift_batch_size, 256,
+              "Number of test cases to lift at once. The semantics module is "
+              "cloned and optimized once per batch");
 
 
+struct TestCase {
+  uint64_t addr;
+  std::string bytes;
+};
+
+std::string test_case_name(std::string_view prefix, uint64_t test_cast_ctr) {
+  std::stringstream ss;
+  ss << prefix << "comp_func" << test_cast_ctr;
+  return ss.str();
+}
+
 struct InstructionFunction {
   llvm::Function *llvm_function;
   std::string isel_name;
@@ -121,48 +142,57 @@ class DifferentialModuleBuilder {
   }
 
  public:
-  std::optional<DiffModule> build(std::string_view fname_f1,
-                                  std::string_view fname_f2,
-                                  std::string_view bytes, uint64_t address) {
-    auto module = std::make_unique<llvm::Module>("", *this->context);
-    auto maybe_f1 = this->l1.LiftInstructionFunction(fname_f1, bytes, address);
-    auto maybe_f2 = this->l2.LiftInstructionFunction(fname_f2, bytes, address);
-
-    if (!maybe_f1.has_value() || !maybe_f2.has_value()) {
-      return std::nullopt;
+  // Lift every test case in `testcases` with both lifters. Each lifter lifts
+  // all of the test cases at once, so that the semantics module is only
+  // cloned and optimized once per batch rather than once per test case. The
+  // functions of the test case numbered `ctr` are named `f1comp_func<ctr>`
+  // and `f2comp_func<ctr>`, where the first test case is numbered
+  // `first_ctr`.
+  std::vector<std::optional<DiffModule>>
+  build(const std::vector<TestCase> &testcases, uint64_t first_ctr) {
+    std::vector<test_runner::LiftRequest> requests1;
+    std::vector<test_runner::LiftRequest> requests2;
+    auto ctr = first_ctr;
+    for (const auto &tc : testcases) {
+      requests1.push_back({test_case_name("f1", ctr), tc.bytes, tc.addr,
+                           this->l1.GetArch()->CreateInitialContext()});
+      requests2.push_back({test_case_name("f2", ctr), tc.bytes, tc.addr,
+                           this->l2.GetArch()->CreateInitialContext()});
+      ++ctr;
     }
 
-    auto f1_and_name = *maybe_f1;
-    auto f2_and_name = *maybe_f2;
-
-    auto f1 = f1_and_name.first;
-    auto f2 = f2_and_name.first;
+    auto batch1 = this->l1.LiftInstructionFunctions(requests1);
+    auto batch2 = this->l2.LiftInstructionFunctions(requests2);
 
-    for (auto x : {f1, f2}) {
-      CHECK(remill::VerifyFunction(x));
+    for (auto batch_module : {batch1.module.get(), batch2.module.get()}) {
+      if (auto maybe_message = remill::VerifyModuleMsg(batch_module)) {
+        LOG(FATAL) << *maybe_message;
+      }
     }
 
+    std::vector<std::optional<DiffModule>> diff_mods;
+    for (auto i = 0u; i < testcases.size(); ++i) {
+      const auto &maybe_f1 = batch1.functions[i];
+      const auto &maybe_f2 = batch2.functions[i];
+      if (!maybe_f1.has_value() || !maybe_f2.has_value()) {
+        diff_mods.emplace_back(std::nullopt);
+        continue;
+      }
 
-    auto tst = f1->getParent();
-
-    CHECK(remill::VerifyModule(tst));
-
-    auto cloned = llvm::CloneModule(*tst);
-
-    if (auto maybe_message = remill::VerifyModuleMsg(cloned.get())) {
-      LOG(FATAL) << *maybe_message;
+      // Give each test case its own module, so that only its own functions
+      // are JIT compiled when it runs.
+      auto module = std::make_unique<llvm::Module>("", *this->context);
+      auto new_f1 = test_runner::CopyFunctionIntoNewModule(
+          module.get(), maybe_f1->first, batch1.module);
+      auto new_f2 = test_runner::CopyFunctionIntoNewModule(
+          module.get(), maybe_f2->first, batch2.module);
+
+      diff_mods.emplace_back(DiffModule(std::move(module), new_f1, new_f2,
+                                        maybe_f1->second.function,
+                                        maybe_f2->second.function));
     }
 
-    remill::OptimizeBareModule(cloned);
-
-    auto new_f1 =
-        test_runner::CopyFunctionIntoNewModule(module.get(), f1, cloned);
-    auto new_f2 =
-        test_runner::CopyFunctionIntoNewModule(module.get(), f2, cloned);
-
-
-    return DiffModule(std::move(module), new_f1, new_f2,
-                      f1_and_name.second.function, f2_and_name.second.function);
+    return diff_mods;
   }
 };
 
@@ -299,11 +329,6 @@ class ComparisonRunner {
   }
 };
 
-struct TestCase {
-  uint64_t addr;
-  std::string bytes;
-};
-
 namespace llvm::json {
 bool fromJSON(const Value &E, TestCase &Out, Path P) {
   auto byte_string = E.getAsString();
@@ -322,19 +347,11 @@ bool fromJSON(const Value &E, TestCase &Out, Path P) {
 };  // namespace llvm::json
 
 
-std::string test_case_name(std::string_view prefix, uint64_t test_cast_ctr) {
-  std::stringstream ss;
-  ss << prefix << "comp_func" << test_cast_ctr;
-  return ss.str();
-}
-
 // Returns true when test case succeeds
-bool runTestCase(const TestCase &tc, DifferentialModuleBuilder &diffbuilder,
+bool runTestCase(const TestCase &tc, std::optional<DiffModule> &diff_mod,
                  const std::vector<WhiteListInstruction> &whitelist,
-                 uint64_t ctr) {
+                 std::string_view whitelist_text, PassCache &pass_cache) {
   LOG(INFO) << "Starting testcase: " << llvm::toHex(tc.bytes);
-  auto diff_mod = diffbuilder.build(
-      test_case_name("f1", ctr), test_case_name("f2", ctr), tc.bytes, tc.addr);
 
   if (!diff_mod.has_value()) {
     LOG(ERROR) << "Failed to lift " << std::hex << tc.addr << ": "
@@ -349,6 +366,16 @@ bool runTestCase(const TestCase &tc, DifferentialModuleBuilder &diffbuilder,
   auto end = diff_mod->GetModule()->getDataLayout().isBigEndian()
                  ? llvm::support::endianness::big
                  : llvm::support::endianness::little;
+  const auto cache_key = PassCache::Key(
+      tc.bytes, diff_mod->GetF<0>().isel_name,
+      diff_mod->GetF<0>().llvm_function, diff_mod->GetF<1>().isel_name,
+      diff_mod->GetF<1>().llvm_function, diff_mod->GetModule(),
+      whitelist_text, FLAGS_num_iterations);
+  if (!FLAGS_force_rerun && pass_cache.Contains(cache_key)) {
+    LOG(INFO) << "Skipping cached passing testcase: " << llvm::toHex(tc.bytes);
+    return true;
+  }
+
   ComparisonRunner comp_runner(end);
 
   if (FLAGS_should_dump_functions) {
@@ -372,6 +399,7 @@ bool runTestCase(const TestCase &tc, DifferentialModuleBuilder &diffbuilder,
     }
   }
 
+  pass_cache.Insert(cache_key);
   return true;
 }
 
@@ -407,6 +435,7 @@ int main(int argc, char **argv) {
   }
 
   std::vector<WhiteListInstruction> whitelist;
+  std::string whitelist_text;
 
   if (!FLAGS_whitelist.empty()) {
     LOG(INFO) << "Reading whitelist";
@@ -426,6 +455,7 @@ int main(int argc, char **argv) {
     }
 
     whitelist = maybe_whitelist_json.get();
+    whitelist_text = maybe_whitelist_buff.get()->getBuffer().str();
   } else {
     LOG(ERROR) << "Not using a whitelist";
   }
@@ -435,35 +465,61 @@ int main(int argc, char **argv) {
       remill::OSName::kOSLinux, remill::ArchName::kArchX86_SLEIGH);
   uint64_t ctr = 0;
 
-  std::vector<TestCase> failed_testcases;
-  auto succeeded_tot = true;
-  for (auto tc : testcases) {
-    auto tc_succeeded = runTestCase(tc, diffbuilder, whitelist, ++ctr);
-    if (!tc_succeeded) {
-      succeeded_tot = false;
-      failed_testcases.push_back(tc);
+  PassCache pass_cache;
+  if (!FLAGS_pass_cache.empty() && !pass_cache.Load(FLAGS_pass_cache)) {
+    LOG(FATAL) << "Failed to load pass cache";
+  }
+
+  // Record the new passes even if we stop early.
+  auto save_pass_cache = [&pass_cache](void) {
+    if (!FLAGS_pass_cache.empty()) {
+      pass_cache.Save(FLAGS_pass_cache);
     }
+  };
 
-    if (!FLAGS_repro_file.empty() && !tc_succeeded) {
-      std::error_code ec;
-      llvm::raw_fd_ostream o(FLAGS_repro_file, ec);
-      if (ec) {
-        LOG(FATAL) << ec.message();
-      }
+  const auto batch_size = std::max<uint64_t>(FLAGS_lift_batch_size, 1);
 
-      llvm::json::Array arr;
-      for (auto tc : failed_testcases) {
-        arr.push_back(llvm::toHex(tc.bytes));
+  std::vector<TestCase> failed_testcases;
+  auto succeeded_tot = true;
+  for (size_t begin = 0; begin < testcases.size(); begin += batch_size) {
+    const auto end = std::min<size_t>(begin + batch_size, testcases.size());
+    const std::vector<TestCase> batch(testcases.begin() + begin,
+                                      testcases.begin() + end);
+    auto diff_mods = diffbuilder.build(batch, ctr + 1);
+    ctr += batch.size();
+
+    for (auto i = 0u; i < batch.size(); ++i) {
+      const auto &tc = batch[i];
+      auto tc_succeeded = runTestCase(tc, diff_mods[i], whitelist,
+                                      whitelist_text, pass_cache);
+      if (!tc_succeeded) {
+        succeeded_tot = false;
+        failed_testcases.push_back(tc);
       }
 
-      llvm::json::operator<<(o, llvm::json::Value(std::move(arr)));
-    }
+      if (!FLAGS_repro_file.empty() && !tc_succeeded) {
+        std::error_code ec;
+        llvm::raw_fd_ostream o(FLAGS_repro_file, ec);
+        if (ec) {
+          LOG(FATAL) << ec.message();
+        }
+
+        llvm::json::Array arr;
+        for (auto tc : failed_testcases) {
+          arr.push_back(llvm::toHex(tc.bytes));
+        }
 
-    if (!succeeded_tot && FLAGS_stop_on_fail) {
-      return 2;
+        llvm::json::operator<<(o, llvm::json::Value(std::move(arr)));
+      }
+
+      if (!succeeded_tot && FLAGS_stop_on_fail) {
+        save_pass_cache();
+        return 2;
+      }
     }
   }
 
+  save_pass_cache();
 
   return succeeded_tot ? 0 : 2;
 }
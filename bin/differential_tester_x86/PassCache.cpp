@@ -0,0 +1,115 @@
+/*
+ * Copyright (c) 2026 Trail of Bits, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "PassCache.h"
+
+#include <glog/logging.h>
+#include <llvm/ADT/StringExtras.h>
+#include <llvm/IR/Function.h>
+#include <llvm/IR/Module.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/JSON.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/raw_ostream.h>
+#include <llvm/Support/xxhash.h>
+
+#include <sstream>
+
+namespace {
+
+// Hash the IR of `module`. The lifted functions `f1` and `f2` are named after
+// the test case counter, so they're given fixed names while it's printed.
+static uint64_t HashModuleIR(llvm::Module *module, llvm::Function *f1,
+                             llvm::Function *f2) {
+  const auto f1_name = f1->getName().str();
+  const auto f2_name = f2->getName().str();
+  f1->setName("f1");
+  f2->setName("f2");
+  std::string ir;
+  llvm::raw_string_ostream os(ir);
+  module->print(os, nullptr);
+  const auto hash = llvm::xxHash64(os.str());
+  f1->setName(f1_name);
+  f2->setName(f2_name);
+  return hash;
+}
+
+}  // namespace
+
+std::string PassCache::Key(std::string_view bytes, std::string_view isel1,
+                           llvm::Function *f1, std::string_view isel2,
+                           llvm::Function *f2, llvm::Module *module,
+                           std::string_view whitelist,
+                           uint64_t num_iterations) {
+  std::stringstream ss;
+  ss << llvm::toHex(llvm::StringRef(bytes.data(), bytes.size())) << ':'
+     << isel1 << ':' << isel2 << ':' << std::hex
+     << HashModuleIR(module, f1, f2) << ':'
+     << llvm::xxHash64(llvm::StringRef(whitelist.data(), whitelist.size()))
+     << ':' << std::dec << num_iterations;
+  return ss.str();
+}
+
+bool PassCache::Load(const std::string &path) {
+  if (!llvm::sys::fs::exists(path)) {
+    return true;
+  }
+
+  auto maybe_buff = llvm::MemoryBuffer::getFile(path);
+  if (maybe_buff.getError()) {
+    LOG(ERROR) << "Failed to read pass cache " << path << ": "
+               << maybe_buff.getError().message();
+    return false;
+  }
+
+  auto maybe_keys = llvm::json::parse<std::vector<std::string>>(
+      maybe_buff.get()->getBuffer());
+  if (auto E = maybe_keys.takeError()) {
+    LOG(ERROR) << "Failed to parse pass cache " << path << ": "
+               << llvm::toString(std::move(E));
+    return false;
+  }
+
+  keys.insert(maybe_keys->begin(), maybe_keys->end());
+  return true;
+}
+
+bool PassCache::Save(const std::string &path) const {
+  std::error_code ec;
+  llvm::raw_fd_ostream o(path, ec);
+  if (ec) {
+    LOG(ERROR) << "Failed to write pass cache " << path << ": "
+               << ec.message();
+    return false;
+  }
+
+  llvm::json::Array arr;
+  for (const auto &key : keys) {
+    arr.push_back(key);
+  }
+
+  llvm::json::operator<<(o, llvm::json::Value(std::move(arr)));
+  return true;
+}
+
+bool PassCache::Contains(const std::string &key) const {
+  return keys.count(key) != 0;
+}
+
+void PassCache::Insert(std::string key) {
+  keys.insert(std::move(key));
+}
@@ -0,0 +1,60 @@
+/*
+ * Copyright (c) 2026 Trail of Bits, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#pragma once
+
+#include <cstdint>
+#include <set>
+#include <string>
+#include <string_view>
+
+namespace llvm {
+class Function;
+class Module;
+}  // namespace llvm
+
+// An on-disk record of the differential test cases that are known to pass.
+// A test case is identified by its instruction bytes, the ISEL names chosen by
+// both lifters, a hash of the module holding both optimized lifted functions
+// and everything they call, the whitelist, and the number of iterations, so
+// any change to the decoder, to the semantics, to the SLEIGH spec, or to the
+// options of the run that could affect its outcome invalidates its cached
+// result.
+class PassCache {
+ public:
+  // Return the key identifying a test case. `module` holds the lifted
+  // functions `f1` and `f2` of the test case, which are named after the test
+  // case counter, and so are renamed while `module` is hashed. `whitelist` is
+  // the contents of the whitelist file.
+  static std::string Key(std::string_view bytes, std::string_view isel1,
+                         llvm::Function *f1, std::string_view isel2,
+                         llvm::Function *f2, llvm::Module *module,
+                         std::string_view whitelist, uint64_t num_iterations);
+
+  // Read the cached keys from `path`. A missing file is an empty cache.
+  bool Load(const std::string &path);
+
+  // Write the cached keys to `path`.
+  bool Save(const std::string &path) const;
+
+  bool Contains(const std::string &key) const;
+
+  void Insert(std::string key);
+
+ private:
+  std::set<std::string> keys;
+};
@@ -32,11 +32,14 @@
 #include <remill/Arch/Instruction.h>
 #include <remill/Arch/Name.h>
 #include <remill/BC/ABI.h>
+#include <remill/BC/ElfTraceManager.h>
 #include <remill/BC/IntrinsicTable.h>
 #include <remill/BC/Lifter.h>
 #include <remill/BC/Optimizer.h>
+#include <remill/BC/TraceIndex.h>
 #include <remill/BC/Util.h>
 #include <remill/BC/Version.h>
+#include <remill/OS/ElfLoader.h>
 #include <remill/OS/OS.h>
 #include <remill/Version/Version.h>
 
@@ -70,11 +73,47 @@ DEFINE_uint64(entry_address, 0,
 
 DEFINE_string(bytes, "", "Hex-encoded byte string to lift.");
 
+DEFINE_string(binary, "",
+              "Path to an ELF file whose code should be lifted, instead of "
+              "--bytes. Unless specified, --arch and --entry_address default "
+              "to the architecture and entry point of the file.");
+
 DEFINE_string(ir_out, "", "Path to file where the LLVM IR should be saved.");
 DEFINE_string(bc_out, "",
               "Path to file where the LLVM bitcode should be "
               "saved.");
 
+DEFINE_bool(bc_index, false,
+            "Embed a guest PC to lifted trace index into the bitcode saved "
+            "to --bc_out, so that consumers can lazily load individual "
+            "traces.");
+
+DEFINE_bool(guarded_direct_calls, false,
+            "Lift direct calls to lifted traces as plain calls guarded by a "
+            "return address check, and function returns as plain returns, "
+            "so that callees can be inlined into their callers. Guest "
+            "recursion becomes recursion on the host stack.");
+
+DEFINE_bool(shadow_return_stack, false,
+            "Maintain a shadow return stack in lifted code, so that function "
+            "returns tail-call the trace at the return address directly.");
+
+DEFINE_bool(fold_read_only_memory, false,
+            "Fold reads of constant addresses in the read-only segments of "
+            "--binary into constants.");
+
+DEFINE_bool(promote_guest_stack, false,
+            "Promote accesses to the guest stack frame of each lifted trace "
+            "to LLVM stack variables.");
+
+DEFINE_bool(lower_linux_syscalls, false,
+            "Give the system calls of the lifted code a fast path that calls "
+            "the Linux system call emulator of the runtime.");
+
+DEFINE_bool(infer_attributes, false,
+            "Infer function attributes, e.g. `nosync` and `argmemonly`, of "
+            "the lifted code, semantics and intrinsics before optimizing.");
+
 DEFINE_string(slice_inputs, "",
               "Comma-separated list of registers to treat as inputs.");
 DEFINE_string(slice_outputs, "",
@@ -158,6 +197,13 @@ class SimpleTraceManager : public remill::TraceManager {
     return GetLiftedTraceDeclaration(addr);
   }
 
+  // Called when the trace at `addr` has been invalidated, and needs to be
+  // re-lifted.
+  void InvalidateLiftedTraceDefinition(uint64_t addr,
+                                       llvm::Function *) override {
+    traces.erase(addr);
+  }
+
   // Try to read an executable byte of memory. Returns `true` of the byte
   // at address `addr` is executable and readable, and updates the byte
   // pointed to by `byte` with the read value.
@@ -225,13 +271,39 @@ int main(int argc, char *argv[]) {
   google::InitGoogleLogging(argv[0]);
 
 
-  if (FLAGS_bytes.empty()) {
-    std::cerr << "Please specify a sequence of hex bytes to --bytes."
+  if (FLAGS_guarded_direct_calls && FLAGS_shadow_return_stack) {
+    std::cerr << "Cannot use --guarded_direct_calls with --shadow_return_stack."
               << std::endl;
     return EXIT_FAILURE;
   }
 
-  if (FLAGS_bytes.size() % 2) {
+  std::unique_ptr<remill::ElfImage> image;
+  if (!FLAGS_binary.empty()) {
+    if (!FLAGS_bytes.empty()) {
+      std::cerr << "Cannot use --bytes with --binary." << std::endl;
+      return EXIT_FAILURE;
+    }
+
+    image = remill::ElfImage::Load(FLAGS_binary);
+    if (!image) {
+      std::cerr << "Unable to load ELF file " << FLAGS_binary << std::endl;
+      return EXIT_FAILURE;
+    }
+
+    if (google::GetCommandLineFlagInfoOrDie("arch").is_default) {
+      FLAGS_arch = remill::GetArchName(image->Architecture());
+    }
+
+    if (!FLAGS_entry_address && !FLAGS_address) {
+      FLAGS_entry_address = image->EntryPoint();
+    }
+
+  } else if (FLAGS_bytes.empty()) {
+    std::cerr << "Please specify a sequence of hex bytes to --bytes."
+              << std::endl;
+    return EXIT_FAILURE;
+
+  } else if (FLAGS_bytes.size() % 2) {
     std::cerr << "Please specify an even number of nibbles to --bytes."
               << std::endl;
     return EXIT_FAILURE;
@@ -241,6 +313,15 @@ int main(int argc, char *argv[]) {
     FLAGS_entry_address = FLAGS_address;
   }
 
+  // Slicing inlines the lifted traces into the `slice` function, so there
+  // would be nothing left to index.
+  if (FLAGS_bc_index &&
+      (!FLAGS_slice_inputs.empty() || !FLAGS_slice_outputs.empty())) {
+    std::cerr << "Cannot use --bc_index with --slice_inputs or --slice_outputs."
+              << std::endl;
+    return EXIT_FAILURE;
+  }
+
   // Make sure `--address` and `--entry_address` are in-bounds for the target
   // architecture's address size.
   llvm::LLVMContext context;
@@ -265,14 +346,29 @@ int main(int argc, char *argv[]) {
 
   const auto mem_ptr_type = arch->MemoryPointerType();
 
-  Memory memory = UnhexlifyInputBytes(addr_mask);
-  SimpleTraceManager manager(memory);
+  // Read the code straight out of the loaded ELF file, if there is one.
+  Memory memory;
+  std::unique_ptr<remill::TraceManager> manager;
+  remill::TraceMap *traces = nullptr;
+  if (image) {
+    auto elf_manager = std::make_unique<remill::ElfTraceManager>(*image);
+    traces = &(elf_manager->traces);
+    manager = std::move(elf_manager);
+  } else {
+    memory = UnhexlifyInputBytes(addr_mask);
+    auto simple_manager = std::make_unique<SimpleTraceManager>(memory);
+    traces = &(simple_manager->traces);
+    manager = std::move(simple_manager);
+  }
+
   remill::IntrinsicTable intrinsics(module.get());
 
 
   auto inst_lifter = arch->DefaultLifter(intrinsics);
 
-  remill::TraceLifter trace_lifter(arch.get(), manager);
+  remill::TraceLifter trace_lifter(arch.get(), *manager);
+  trace_lifter.SetGuardedDirectCalls(FLAGS_guarded_direct_calls);
+  trace_lifter.SetShadowReturnStack(FLAGS_shadow_return_stack);
 
   // Lift all discoverable traces starting from `--entry_address` into
   // `module`.
@@ -281,7 +377,15 @@ int main(int argc, char *argv[]) {
   // Optimize the module, but with a particular focus on only the functions
   // that we actually lifted.
   remill::OptimizationGuide guide = {};
-  remill::OptimizeModule(arch, module, manager.traces, guide);
+  guide.infer_attributes = FLAGS_infer_attributes;
+  guide.promote_guest_stack = FLAGS_promote_guest_stack;
+  guide.lower_linux_syscalls = FLAGS_lower_linux_syscalls;
+  if (FLAGS_fold_read_only_memory) {
+    guide.read_only_memory = [&manager](uint64_t addr, uint8_t *byte) {
+      return manager->TryReadReadOnlyByte(addr, byte);
+    };
+  }
+  remill::OptimizeModule(arch, module, *traces, guide);
 
   // Create a new module in which we will move all the lifted functions. Prepare
   // the module for code of this architecture, i.e. set the data layout, triple,
@@ -297,7 +401,7 @@ int main(int argc, char *argv[]) {
   // because it won't be bogged down with all of the semantics definitions.
   // This is a good JITing strategy: optimize the lifted code in the semantics
   // module, move it to a new module, instrument it there, then JIT compile it.
-  for (auto &lifted_entry : manager.traces) {
+  for (auto &lifted_entry : *traces) {
     if (lifted_entry.first == FLAGS_entry_address) {
       entry_trace = lifted_entry.second;
     }
@@ -448,7 +552,14 @@ int main(int argc, char *argv[]) {
     }
   }
   if (!FLAGS_bc_out.empty()) {
-    if (!remill::StoreModuleToFile(&dest_module, FLAGS_bc_out, true)) {
+    if (FLAGS_bc_index) {
+      if (!remill::StoreIndexedModuleToFile(&dest_module, *traces,
+                                            FLAGS_bc_out, true)) {
+        LOG(ERROR) << "Could not save indexed LLVM bitcode to "
+                   << FLAGS_bc_out;
+        ret = EXIT_FAILURE;
+      }
+    } else if (!remill::StoreModuleToFile(&dest_module, FLAGS_bc_out, true)) {
       LOG(ERROR) << "Could not save LLVM bitcode to " << FLAGS_bc_out;
       ret = EXIT_FAILURE;
     }
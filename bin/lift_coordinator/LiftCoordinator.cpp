@@ -0,0 +1,507 @@
+/*
+ * Copyright (c) 2026 Trail of Bits, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <fcntl.h>
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+#include <llvm/IR/Function.h>
+#include <llvm/IR/LLVMContext.h>
+#include <llvm/IR/Module.h>
+#include <llvm/Linker/Linker.h>
+#include <llvm/Support/FileSystem.h>
+#include <remill/Arch/Arch.h>
+#include <remill/Arch/Name.h>
+#include <remill/BC/ElfTraceManager.h>
+#include <remill/BC/Lifter.h>
+#include <remill/BC/Optimizer.h>
+#include <remill/BC/TraceIndex.h>
+#include <remill/BC/Util.h>
+#include <remill/OS/ElfLoader.h>
+#include <remill/OS/OS.h>
+#include <spawn.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+extern char **environ;
+
+DEFINE_string(os, REMILL_OS,
+              "Operating system name of the code being lifted. Valid OSes: "
+              "linux, macos, windows, solaris.");
+DEFINE_string(arch, REMILL_ARCH,
+              "Architecture of the code being lifted. Defaults to the "
+              "architecture of the ELF file.");
+
+DEFINE_string(binary, "", "Path to the ELF file whose code should be lifted.");
+
+DEFINE_string(entry_addresses, "",
+              "Comma-separated list of hex addresses of the code to lift. "
+              "Defaults to the entry point and the function symbols of the "
+              "ELF file.");
+
+DEFINE_uint32(jobs, 0,
+              "Number of worker processes to lift with. Defaults to the "
+              "number of hardware threads.");
+
+DEFINE_string(work_dir, "",
+              "Directory for the entry lists and bitcode files of the shards. "
+              "Defaults to a new temporary directory, which is removed once "
+              "the shards have been merged.");
+
+DEFINE_bool(keep_work_dir, false,
+            "Keep the default --work_dir after merging the shards.");
+
+DEFINE_string(ir_out, "", "Path to file where the LLVM IR should be saved.");
+DEFINE_string(bc_out, "",
+              "Path to file where the LLVM bitcode should be saved.");
+
+DEFINE_bool(bc_index, false,
+            "Embed a guest PC to lifted trace index into the bitcode saved "
+            "to --bc_out, so that consumers can lazily load individual "
+            "traces.");
+
+DEFINE_bool(infer_attributes, false,
+            "Infer function attributes, e.g. `nosync` and `argmemonly`, of "
+            "the lifted code, semantics and intrinsics before optimizing.");
+
+DEFINE_int32(shard, -1,
+             "Internal: lift the entries of this shard of --work_dir, as a "
+             "worker process of the coordinator.");
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+using Millis = std::chrono::duration<double, std::milli>;
+
+// Return the path of a file of shard `index` in the work directory.
+static std::string ShardPath(unsigned index, const char *extension) {
+  std::stringstream ss;
+  ss << "shard" << index << extension;
+  return (std::filesystem::path(FLAGS_work_dir) / ss.str()).string();
+}
+
+// Lift the entries of `--shard` into a bitcode file in the work directory.
+//
+// The worker reports back to the coordinator on its standard output, with
+// one `trace <hex address> <name>` line per lifted trace, followed by one
+// `time <load> <lift> <optimize> <store>` line, in milliseconds.
+static int RunWorker(const remill::ElfImage &image) {
+  const auto shard = static_cast<unsigned>(FLAGS_shard);
+  const auto begin = Clock::now();
+
+  std::vector<uint64_t> entries;
+  std::ifstream entries_file(ShardPath(shard, ".entries"));
+  for (std::string line; std::getline(entries_file, line);) {
+    entries.push_back(std::stoull(line, nullptr, 16));
+  }
+
+  llvm::LLVMContext context;
+  auto arch = remill::Arch::Get(context, FLAGS_os, FLAGS_arch);
+  CHECK(arch) << "Invalid --os or --arch in shard " << shard;
+
+  std::unique_ptr<llvm::Module> module(remill::LoadArchSemantics(arch.get()));
+  const auto loaded = Clock::now();
+
+  remill::ElfTraceManager manager(image);
+  remill::TraceLifter trace_lifter(arch.get(), manager);
+  for (auto entry : entries) {
+    trace_lifter.Lift(entry);
+  }
+  const auto lifted = Clock::now();
+
+  remill::OptimizationGuide guide = {};
+  guide.infer_attributes = FLAGS_infer_attributes;
+  remill::OptimizeModule(arch, module, manager.traces, guide);
+  const auto optimized = Clock::now();
+
+  // Only the lifted code goes into the shard's bitcode, so that the
+  // coordinator doesn't need to link N copies of the semantics.
+  llvm::Module dest_module("lifted_code", context);
+  arch->PrepareModuleDataLayout(&dest_module);
+  for (auto &[addr, func] : manager.traces) {
+    remill::MoveFunctionIntoModule(func, &dest_module);
+    std::cout << "trace " << std::hex << addr << std::dec << ' '
+              << func->getName().str() << '\n';
+  }
+
+  if (!remill::StoreModuleToFile(&dest_module, ShardPath(shard, ".bc"),
+                                 true)) {
+    LOG(ERROR) << "Could not save the bitcode of shard " << shard;
+    return EXIT_FAILURE;
+  }
+  const auto stored = Clock::now();
+
+  std::cout << "time " << Millis(loaded - begin).count() << ' '
+            << Millis(lifted - loaded).count() << ' '
+            << Millis(optimized - lifted).count() << ' '
+            << Millis(stored - optimized).count() << std::endl;
+  return EXIT_SUCCESS;
+}
+
+// A worker process of the coordinator, and what it reported back.
+struct Shard {
+  unsigned index{0};
+  std::vector<uint64_t> entries;
+
+  pid_t pid{-1};
+  int output_fd{-1};
+  std::string output;
+
+  // Lifted traces, as `(address, name)` pairs.
+  std::vector<std::pair<uint64_t, std::string>> traces;
+
+  double load_ms{0};
+  double lift_ms{0};
+  double optimize_ms{0};
+  double store_ms{0};
+};
+
+// Return the entries to lift, sorted by address, so that each shard gets a
+// contiguous range of code, and lifts fewer of the traces of other shards.
+static std::vector<uint64_t> GetEntries(const remill::ElfImage &image) {
+  std::vector<uint64_t> entries;
+  if (!FLAGS_entry_addresses.empty()) {
+    std::stringstream ss(FLAGS_entry_addresses);
+    for (std::string addr; std::getline(ss, addr, ',');) {
+      entries.push_back(std::stoull(addr, nullptr, 16));
+    }
+  } else {
+    uint8_t byte = 0;
+    if (image.TryReadExecutableByte(image.EntryPoint(), &byte)) {
+      entries.push_back(image.EntryPoint());
+    }
+    for (const auto &[addr, name] : image.Symbols()) {
+      if (image.TryReadExecutableByte(addr, &byte)) {
+        entries.push_back(addr);
+      }
+    }
+  }
+
+  std::sort(entries.begin(), entries.end());
+  entries.erase(std::unique(entries.begin(), entries.end()), entries.end());
+  return entries;
+}
+
+// Start the worker process of `shard`, with its standard output redirected
+// into a pipe.
+static bool SpawnWorker(const std::string &exe, Shard &shard) {
+  std::ofstream entries_file(ShardPath(shard.index, ".entries"));
+  for (auto entry : shard.entries) {
+    entries_file << std::hex << entry << '\n';
+  }
+  entries_file.close();
+  if (!entries_file) {
+    LOG(ERROR) << "Could not write the entries of shard " << shard.index;
+    return false;
+  }
+
+  int fds[2] = {-1, -1};
+  if (pipe(fds)) {
+    LOG(ERROR) << "Could not create a pipe for shard " << shard.index << ": "
+               << strerror(errno);
+    return false;
+  }
+  fcntl(fds[0], F_SETFD, FD_CLOEXEC);
+
+  std::vector<std::string> args = {exe,
+                                   "--binary=" + FLAGS_binary,
+                                   "--os=" + FLAGS_os,
+                                   "--arch=" + FLAGS_arch,
+                                   "--work_dir=" + FLAGS_work_dir,
+                                   "--shard=" + std::to_string(shard.index)};
+  if (FLAGS_infer_attributes) {
+    args.push_back("--infer_attributes");
+  }
+  std::vector<char *> argv;
+  for (auto &arg : args) {
+    argv.push_back(arg.data());
+  }
+  argv.push_back(nullptr);
+
+  posix_spawn_file_actions_t actions;
+  posix_spawn_file_actions_init(&actions);
+  posix_spawn_file_actions_adddup2(&actions, fds[1], STDOUT_FILENO);
+  posix_spawn_file_actions_addclose(&actions, fds[1]);
+
+  const auto err = posix_spawn(&(shard.pid), exe.c_str(), &actions, nullptr,
+                               argv.data(), environ);
+  posix_spawn_file_actions_destroy(&actions);
+  close(fds[1]);
+
+  if (err) {
+    LOG(ERROR) << "Could not start the worker of shard " << shard.index
+               << ": " << strerror(err);
+    close(fds[0]);
+    return false;
+  }
+
+  shard.output_fd = fds[0];
+  return true;
+}
+
+// Wait for the worker process of `shard` to exit, and parse its report.
+static bool WaitForWorker(Shard &shard) {
+  char buf[4096];
+  for (;;) {
+    const auto size = read(shard.output_fd, buf, sizeof(buf));
+    if (0 < size) {
+      shard.output.append(buf, static_cast<size_t>(size));
+    } else if (!size || errno != EINTR) {
+      break;
+    }
+  }
+  close(shard.output_fd);
+  shard.output_fd = -1;
+
+  int status = 0;
+  while (waitpid(shard.pid, &status, 0) == -1 && errno == EINTR) {
+  }
+
+  if (!WIFEXITED(status) || WEXITSTATUS(status) != EXIT_SUCCESS) {
+    LOG(ERROR) << "Worker of shard " << shard.index << " failed";
+    return false;
+  }
+
+  std::stringstream ss(shard.output);
+  for (std::string kind; ss >> kind;) {
+    if (kind == "trace") {
+      uint64_t addr = 0;
+      std::string name;
+      ss >> std::hex >> addr >> std::dec >> name;
+      shard.traces.emplace_back(addr, std::move(name));
+    } else if (kind == "time") {
+      ss >> shard.load_ms >> shard.lift_ms >> shard.optimize_ms >>
+          shard.store_ms;
+    } else {
+      LOG(ERROR) << "Unexpected output '" << kind << "' from shard "
+                 << shard.index;
+      return false;
+    }
+  }
+  return true;
+}
+
+// Link the bitcode of every shard into `dest_module`, keeping only the first
+// definition of each trace that was lifted by more than one shard. Returns
+// the number of dropped duplicate definitions, or `-1` on failure.
+static int LinkShards(llvm::Module &dest_module,
+                      const std::vector<Shard> &shards) {
+  auto &context = dest_module.getContext();
+  llvm::Linker linker(dest_module);
+  auto num_duplicates = 0;
+
+  for (const auto &shard : shards) {
+    auto module =
+        remill::LoadModuleFromFile(&context, ShardPath(shard.index, ".bc"));
+    if (!module) {
+      LOG(ERROR) << "Could not load the bitcode of shard " << shard.index;
+      return -1;
+    }
+
+    for (auto &func : *module) {
+      if (func.isDeclaration() || !func.hasExternalLinkage()) {
+        continue;
+      }
+      auto dest_func = dest_module.getFunction(func.getName());
+      if (dest_func && !dest_func->isDeclaration()) {
+        func.deleteBody();
+        ++num_duplicates;
+      }
+    }
+
+    if (linker.linkInModule(std::move(module))) {
+      LOG(ERROR) << "Could not link the bitcode of shard " << shard.index;
+      return -1;
+    }
+  }
+
+  return num_duplicates;
+}
+
+// Print the per-shard timing report.
+static void PrintReport(const std::vector<Shard> &shards) {
+  std::cout << std::setw(8) << "shard" << std::setw(10) << "entries"
+            << std::setw(10) << "traces" << std::setw(12) << "load ms"
+            << std::setw(12) << "lift ms" << std::setw(12) << "opt ms"
+            << std::setw(12) << "store ms" << std::endl;
+  for (const auto &shard : shards) {
+    std::cout << std::setw(8) << shard.index << std::setw(10)
+              << shard.entries.size() << std::setw(10) << shard.traces.size()
+              << std::fixed << std::setprecision(1) << std::setw(12)
+              << shard.load_ms << std::setw(12) << shard.lift_ms
+              << std::setw(12) << shard.optimize_ms << std::setw(12)
+              << shard.store_ms << std::endl;
+  }
+}
+
+// Partition the entries across worker processes, wait for them to lift their
+// shards, then merge the shards.
+static int RunCoordinator(const char *argv0,
+                          const remill::ElfImage &image) {
+  static int gAddressInThisExe = 0;
+  const auto exe = llvm::sys::fs::getMainExecutable(
+      argv0, reinterpret_cast<void *>(&gAddressInThisExe));
+
+  const auto entries = GetEntries(image);
+  if (entries.empty()) {
+    std::cerr << "No executable entries to lift in " << FLAGS_binary
+              << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  size_t num_shards = FLAGS_jobs;
+  if (!num_shards) {
+    num_shards = std::thread::hardware_concurrency();
+  }
+  num_shards = std::clamp<size_t>(num_shards, 1u, entries.size());
+
+  auto remove_work_dir = false;
+  if (FLAGS_work_dir.empty()) {
+    llvm::SmallString<128> work_dir;
+    if (auto ec = llvm::sys::fs::createUniqueDirectory("remill-lift",
+                                                       work_dir)) {
+      LOG(ERROR) << "Could not create a work directory: " << ec.message();
+      return EXIT_FAILURE;
+    }
+    FLAGS_work_dir = work_dir.str().str();
+    remove_work_dir = !FLAGS_keep_work_dir;
+  }
+
+  const auto begin = Clock::now();
+
+  std::vector<Shard> shards(num_shards);
+  auto ok = true;
+  for (size_t i = 0; i < num_shards; ++i) {
+    auto &shard = shards[i];
+    shard.index = static_cast<unsigned>(i);
+    const auto first = (i * entries.size()) / num_shards;
+    const auto last = ((i + 1) * entries.size()) / num_shards;
+    shard.entries.assign(entries.begin() + first, entries.begin() + last);
+    if (!SpawnWorker(exe, shard)) {
+      ok = false;
+      shards.resize(i);
+      break;
+    }
+  }
+
+  // Always reap every started worker, even if another one failed.
+  for (auto &shard : shards) {
+    ok = WaitForWorker(shard) && ok;
+  }
+  const auto lifted = Clock::now();
+
+  if (!ok) {
+    LOG(ERROR) << "Not merging shards; see " << FLAGS_work_dir;
+    return EXIT_FAILURE;
+  }
+
+  llvm::LLVMContext context;
+  llvm::Module dest_module("lifted_code", context);
+  const auto num_duplicates = LinkShards(dest_module, shards);
+  if (num_duplicates < 0) {
+    return EXIT_FAILURE;
+  }
+
+  remill::TraceMap traces;
+  for (const auto &shard : shards) {
+    for (const auto &[addr, name] : shard.traces) {
+      if (auto func = dest_module.getFunction(name)) {
+        traces.emplace(addr, func);
+      }
+    }
+  }
+  const auto merged = Clock::now();
+
+  PrintReport(shards);
+  std::cout << "Lifted " << traces.size() << " traces in "
+            << std::fixed << std::setprecision(1)
+            << Millis(lifted - begin).count()
+            << " ms, and merged them in " << Millis(merged - lifted).count()
+            << " ms, dropping " << num_duplicates
+            << " duplicate trace definitions" << std::endl;
+
+  auto ret = EXIT_SUCCESS;
+  if (!FLAGS_ir_out.empty()) {
+    if (!remill::StoreModuleIRToFile(&dest_module, FLAGS_ir_out, true)) {
+      LOG(ERROR) << "Could not save LLVM IR to " << FLAGS_ir_out;
+      ret = EXIT_FAILURE;
+    }
+  }
+  if (!FLAGS_bc_out.empty()) {
+    if (FLAGS_bc_index) {
+      if (!remill::StoreIndexedModuleToFile(&dest_module, traces,
+                                            FLAGS_bc_out, true)) {
+        LOG(ERROR) << "Could not save indexed LLVM bitcode to "
+                   << FLAGS_bc_out;
+        ret = EXIT_FAILURE;
+      }
+    } else if (!remill::StoreModuleToFile(&dest_module, FLAGS_bc_out, true)) {
+      LOG(ERROR) << "Could not save LLVM bitcode to " << FLAGS_bc_out;
+      ret = EXIT_FAILURE;
+    }
+  }
+
+  if (remove_work_dir) {
+    std::error_code ec;
+    std::filesystem::remove_all(FLAGS_work_dir, ec);
+  }
+
+  return ret;
+}
+
+}  // namespace
+
+int main(int argc, char *argv[]) {
+  google::ParseCommandLineFlags(&argc, &argv, true);
+  google::InitGoogleLogging(argv[0]);
+
+  if (FLAGS_binary.empty()) {
+    std::cerr << "Please specify an ELF file to --binary." << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  auto image = remill::ElfImage::Load(FLAGS_binary);
+  if (!image) {
+    std::cerr << "Unable to load ELF file " << FLAGS_binary << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  if (google::GetCommandLineFlagInfoOrDie("arch").is_default) {
+    FLAGS_arch = remill::GetArchName(image->Architecture());
+  }
+
+  if (0 <= FLAGS_shard) {
+    return RunWorker(*image);
+  } else {
+    return RunCoordinator(argv[0], *image);
+  }
+}
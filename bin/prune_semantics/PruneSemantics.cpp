@@ -0,0 +1,183 @@
+/*
+ * Copyright (c) 2026 Trail of Bits, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+#include <llvm/IR/LLVMContext.h>
+#include <llvm/IR/Module.h>
+#include <remill/Arch/Arch.h>
+#include <remill/Arch/Instruction.h>
+#include <remill/Arch/Name.h>
+#include <remill/BC/Optimizer.h>
+#include <remill/BC/Util.h>
+#include <remill/OS/OS.h>
+
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+
+DEFINE_string(os, REMILL_OS,
+              "Operating system name of the code whose semantics are "
+              "needed. Valid OSes: linux, macos, windows, solaris.");
+DEFINE_string(arch, REMILL_ARCH,
+              "Architecture of the code whose semantics are needed. "
+              "Valid architectures: x86, amd64 (with or without "
+              "`_avx` or `_avx512` appended), aarch64, aarch32");
+
+DEFINE_string(isels, "",
+              "Path to a file listing the instruction semantics to keep, "
+              "one per line, as named by `Instruction::function`, e.g. "
+              "`ADD_GPRv_GPRv_64`.");
+
+DEFINE_string(bytes, "",
+              "Hex-encoded code bytes to linearly decode. The semantics of "
+              "every decoded instruction are kept.");
+DEFINE_uint64(address, 0,
+              "Address at which we should assume the bytes passed to "
+              "--bytes are located in virtual memory.");
+
+DEFINE_string(ir_out, "",
+              "Path to file where the pruned semantics LLVM IR should be "
+              "saved.");
+DEFINE_string(bc_out, "",
+              "Path to file where the pruned semantics LLVM bitcode should "
+              "be saved.");
+
+// Read the instruction names listed in `--isels` into `isel_names`. Blank
+// lines and lines starting with `#` are ignored.
+static bool ReadISelNames(std::unordered_set<std::string> &isel_names) {
+  std::ifstream in(FLAGS_isels);
+  if (!in) {
+    std::cerr << "Could not open " << FLAGS_isels << std::endl;
+    return false;
+  }
+
+  std::string line;
+  while (std::getline(in, line)) {
+    const auto begin = line.find_first_not_of(" \t\r");
+    if (begin == std::string::npos || line[begin] == '#') {
+      continue;
+    }
+    const auto end = line.find_last_not_of(" \t\r");
+    isel_names.insert(line.substr(begin, end - begin + 1));
+  }
+  return true;
+}
+
+// Linearly decode the bytes passed to `--bytes`, adding the name of the
+// semantics of each decoded instruction into `isel_names`. Undecodable bytes
+// are skipped one at a time.
+static bool DecodeISelNames(const remill::Arch *arch,
+                            std::unordered_set<std::string> &isel_names) {
+  std::string bytes;
+  for (size_t i = 0; i < FLAGS_bytes.size(); i += 2) {
+    char nibbles[] = {FLAGS_bytes[i], FLAGS_bytes[i + 1], '\0'};
+    char *parsed_to = nullptr;
+    auto byte_val = strtol(nibbles, &parsed_to, 16);
+    if (parsed_to != &(nibbles[2])) {
+      std::cerr << "Invalid hex byte value '" << nibbles
+                << "' specified in --bytes." << std::endl;
+      return false;
+    }
+    bytes.push_back(static_cast<char>(byte_val));
+  }
+
+  const auto max_inst_bytes =
+      arch->MaxInstructionSize(arch->CreateInitialContext());
+
+  remill::Instruction inst;
+  for (size_t offset = 0; offset < bytes.size();) {
+    std::string_view inst_bytes(bytes);
+    inst_bytes = inst_bytes.substr(offset, max_inst_bytes);
+
+    inst.Reset();
+    if (!arch->DecodeInstruction(FLAGS_address + offset, inst_bytes, inst,
+                                 arch->CreateInitialContext()) ||
+        inst.bytes.empty()) {
+      offset += 1;
+      continue;
+    }
+
+    isel_names.insert(inst.function);
+    offset += inst.bytes.size();
+  }
+  return true;
+}
+
+int main(int argc, char *argv[]) {
+  google::ParseCommandLineFlags(&argc, &argv, true);
+  google::InitGoogleLogging(argv[0]);
+
+  if (FLAGS_isels.empty() && FLAGS_bytes.empty()) {
+    std::cerr << "Please specify the instructions to keep with --isels "
+              << "and/or --bytes." << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  if (FLAGS_bytes.size() % 2) {
+    std::cerr << "Please specify an even number of nibbles to --bytes."
+              << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  llvm::LLVMContext context;
+  auto arch = remill::Arch::Get(context, FLAGS_os, FLAGS_arch);
+  if (!arch) {
+    std::cerr << "Unsupported --os/--arch combination." << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  std::unique_ptr<llvm::Module> module(remill::LoadArchSemantics(arch.get()));
+
+  std::unordered_set<std::string> isel_names;
+  if (!FLAGS_isels.empty() && !ReadISelNames(isel_names)) {
+    return EXIT_FAILURE;
+  }
+
+  if (!FLAGS_bytes.empty() && !DecodeISelNames(arch.get(), isel_names)) {
+    return EXIT_FAILURE;
+  }
+
+  const auto num_funcs = module->size();
+  int ret = EXIT_SUCCESS;
+  if (!remill::PruneSemanticsModule(module.get(), isel_names)) {
+    LOG(ERROR) << "Pruned semantics module is not usable for lifting";
+    ret = EXIT_FAILURE;
+  }
+
+  LOG(INFO) << "Kept " << module->size() << " of " << num_funcs
+            << " functions for " << isel_names.size() << " instructions";
+
+  if (!FLAGS_ir_out.empty()) {
+    if (!remill::StoreModuleIRToFile(module.get(), FLAGS_ir_out, true)) {
+      LOG(ERROR) << "Could not save LLVM IR to " << FLAGS_ir_out;
+      ret = EXIT_FAILURE;
+    }
+  }
+  if (!FLAGS_bc_out.empty()) {
+    if (!remill::StoreModuleToFile(module.get(), FLAGS_bc_out, true)) {
+      LOG(ERROR) << "Could not save LLVM bitcode to " << FLAGS_bc_out;
+      ret = EXIT_FAILURE;
+    }
+  }
+
+  return ret;
+}
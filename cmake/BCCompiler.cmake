@@ -47,6 +47,95 @@ endif()
 # utils
 #
 
+# Feature levels of the host processor for which `add_runtime` builds extra
+# semantics variants when `REMILL_BUILD_HOST_TUNED_SEMANTICS` is enabled. The
+# semantics are compiled for the host's target, so the levels depend on the
+# host rather than on the architecture being lifted.
+if("${CMAKE_HOST_SYSTEM_PROCESSOR}" STREQUAL "AMD64" OR "${CMAKE_HOST_SYSTEM_PROCESSOR}" STREQUAL "x86_64")
+  set(REMILL_HOST_TUNED_SEMANTICS_VARIANTS x86-64-v2 x86-64-v3 x86-64-v4)
+elseif("${CMAKE_HOST_SYSTEM_PROCESSOR}" STREQUAL "aarch64")
+  set(REMILL_HOST_TUNED_SEMANTICS_VARIANTS armv8.2-a armv8.5-a)
+else()
+  set(REMILL_HOST_TUNED_SEMANTICS_VARIANTS)
+endif()
+
+# Compile and link the bitcode of the runtime `target_name`, passing the extra
+# flags `variant_flags` when compiling the semantics. This reads the parsed
+# parameters of the calling `add_runtime`.
+function(add_runtime_bitcode target_name variant_flags)
+  foreach(source_file ${source_file_list})
+    get_filename_component(source_file_name "${source_file}" NAME)
+    get_filename_component(absolute_source_file_path "${source_file}" ABSOLUTE)
+    set(absolute_output_file_path "${CMAKE_CURRENT_BINARY_DIR}/${target_name}_${source_file_name}.bc")
+    set(source_variant_flags ${variant_flags})
+
+    get_property(source_file_properties SOURCE "${absolute_source_file_path}" PROPERTY COMPILE_FLAGS)
+    string(REPLACE " " ";" source_file_option_list "${source_file_properties}")
+
+    if(NOT "${dependency_list}" STREQUAL "")
+      set(dependency_list_directive DEPENDS ${dependency_list})
+    endif()
+
+    if(WIN32)
+      # We are actually using two different compilers; the LLVM platform toolset downloaded
+      # from the official LLVM download page and our own version from the cxx-common tarball.
+      #
+      # When the versions do not match, the compilation will fail; we don't really care about
+      # this, as the second compiler is only really used to output BC files.
+      set(additional_windows_settings "-D_ALLOW_COMPILER_AND_STL_VERSION_MISMATCH")
+    endif()
+
+    # The hyper call implementation contains inline assembly for each architecture so we'll need to
+    # cross-compile for the runtime architecture.
+    if(${source_file} STREQUAL ${hyper_call_source})
+      # Some architectures add an explicit target for the host to successfully
+      # compile with 32 bits (like AArch64 to arm), however, we don't want that
+      # to interfere with the hyper call crosscompile
+      list(FILTER bc_flag_list EXCLUDE REGEX "--target=.*")
+      set(target_decl "-target" "${arch}-none-eabi")
+      unset(source_variant_flags)
+    elseif(${CMAKE_SYSTEM_NAME} MATCHES "Darwin")
+      set(target_decl "-target" "x86_64-apple-macosx11.0.0")
+    else()
+      unset(target_decl)
+    endif()
+
+
+    add_custom_command(OUTPUT "${absolute_output_file_path}"
+      COMMAND "${CMAKE_BC_COMPILER}" ${include_directory_list} ${additional_windows_settings} ${target_decl}  "-DADDRESS_SIZE_BITS=${address_size}" ${definition_list} ${DEFAULT_BC_COMPILER_FLAGS} ${bc_flag_list} ${source_variant_flags} ${source_file_option_list} -c "${absolute_source_file_path}" -o "${absolute_output_file_path}"
+      MAIN_DEPENDENCY "${absolute_source_file_path}"
+      ${dependency_list_directive}
+      COMMENT "Building BC object ${absolute_output_file_path}"
+    )
+
+    set_property(DIRECTORY APPEND PROPERTY ADDITIONAL_MAKE_CLEAN_FILES "${absolute_output_file_path}")
+    list(APPEND bitcode_file_list "${absolute_output_file_path}")
+  endforeach()
+
+  # We'll be linking together cross-compiled bitcode files with those compiled with the host
+  # machine's target triple, so we're expecting warnings. Suppress warnings to reduce noise.
+  list(APPEND linker_flag_list "--suppress-warnings")
+
+  set(absolute_target_path "${CMAKE_CURRENT_BINARY_DIR}/${target_name}.bc")
+
+  add_custom_command(OUTPUT "${absolute_target_path}"
+    COMMAND "${CMAKE_BC_LINKER}" ${linker_flag_list} ${bitcode_file_list} -o "${absolute_target_path}"
+    DEPENDS ${bitcode_file_list}
+    COMMENT "Linking BC runtime ${absolute_target_path}"
+  )
+
+  set(DIRECTORY APPEND PROPERTY ADDITIONAL_MAKE_CLEAN_FILES "${absolute_target_path}")
+
+  add_custom_target("${target_name}" ALL DEPENDS "${absolute_target_path}")
+  set_property(TARGET "${target_name}" PROPERTY LOCATION "${absolute_target_path}")
+
+  if(REMILL_ENABLE_INSTALL_TARGET)
+    if(DEFINED install_destination)
+      install(FILES "${absolute_target_path}" DESTINATION "${install_destination}")
+    endif()
+  endif()
+endfunction()
+
 # this is the runtime target generator, used in a similar way to add_executable
 set(add_runtime_usage "add_runtime(target_name SOURCES <src1 src2> ADDRESS_SIZE <size> DEFINITIONS <def1 def2> BCFLAGS <bcflag1 bcflag2> LINKERFLAGS <lnkflag1 lnkflag2> INCLUDEDIRECTORIES <path1 path2> INSTALLDESTINATION <path> DEPENDENCIES <dependency1 dependency2>")
 
@@ -154,73 +243,14 @@ function(add_runtime target_name)
   set(hyper_call_source "${REMILL_LIB_DIR}/Arch/Runtime/HyperCall.cpp")
   list(APPEND source_file_list ${hyper_call_source})
 
-  foreach(source_file ${source_file_list})
-    get_filename_component(source_file_name "${source_file}" NAME)
-    get_filename_component(absolute_source_file_path "${source_file}" ABSOLUTE)
-    set(absolute_output_file_path "${CMAKE_CURRENT_BINARY_DIR}/${target_name}_${source_file_name}.bc")
-
-    get_property(source_file_properties SOURCE "${absolute_source_file_path}" PROPERTY COMPILE_FLAGS)
-    string(REPLACE " " ";" source_file_option_list "${source_file_properties}")
-
-    if(NOT "${dependency_list}" STREQUAL "")
-      set(dependency_list_directive DEPENDS ${dependency_list})
-    endif()
+  add_runtime_bitcode("${target_name}" "")
 
-    if(WIN32)
-      # We are actually using two different compilers; the LLVM platform toolset downloaded
-      # from the official LLVM download page and our own version from the cxx-common tarball.
-      #
-      # When the versions do not match, the compilation will fail; we don't really care about
-      # this, as the second compiler is only really used to output BC files.
-      set(additional_windows_settings "-D_ALLOW_COMPILER_AND_STL_VERSION_MISMATCH")
-    endif()
-
-    # The hyper call implementation contains inline assembly for each architecture so we'll need to
-    # cross-compile for the runtime architecture.
-    if(${source_file} STREQUAL ${hyper_call_source})
-      # Some architectures add an explicit target for the host to successfully
-      # compile with 32 bits (like AArch64 to arm), however, we don't want that
-      # to interfere with the hyper call crosscompile
-      list(FILTER bc_flag_list EXCLUDE REGEX "--target=.*")
-      set(target_decl "-target" "${arch}-none-eabi")
-    elseif(${CMAKE_SYSTEM_NAME} MATCHES "Darwin")
-      set(target_decl "-target" "x86_64-apple-macosx11.0.0")
-    else()
-      unset(target_decl)
-    endif()
-
-
-    add_custom_command(OUTPUT "${absolute_output_file_path}"
-      COMMAND "${CMAKE_BC_COMPILER}" ${include_directory_list} ${additional_windows_settings} ${target_decl}  "-DADDRESS_SIZE_BITS=${address_size}" ${definition_list} ${DEFAULT_BC_COMPILER_FLAGS} ${bc_flag_list} ${source_file_option_list} -c "${absolute_source_file_path}" -o "${absolute_output_file_path}"
-      MAIN_DEPENDENCY "${absolute_source_file_path}"
-      ${dependency_list_directive}
-      COMMENT "Building BC object ${absolute_output_file_path}"
-    )
-
-    set_property(DIRECTORY APPEND PROPERTY ADDITIONAL_MAKE_CLEAN_FILES "${absolute_output_file_path}")
-    list(APPEND bitcode_file_list "${absolute_output_file_path}")
-  endforeach()
-
-  # We'll be linking together cross-compiled bitcode files with those compiled with the host
-  # machine's target triple, so we're expecting warnings. Suppress warnings to reduce noise.
-  list(APPEND linker_flag_list "--suppress-warnings")
-
-  set(absolute_target_path "${CMAKE_CURRENT_BINARY_DIR}/${target_name}.bc")
-
-  add_custom_command(OUTPUT "${absolute_target_path}"
-    COMMAND "${CMAKE_BC_LINKER}" ${linker_flag_list} ${bitcode_file_list} -o "${absolute_target_path}"
-    DEPENDS ${bitcode_file_list}
-    COMMENT "Linking BC runtime ${absolute_target_path}"
-  )
-
-  set(DIRECTORY APPEND PROPERTY ADDITIONAL_MAKE_CLEAN_FILES "${absolute_target_path}")
-
-  add_custom_target("${target_name}" ALL DEPENDS "${absolute_target_path}")
-  set_property(TARGET "${target_name}" PROPERTY LOCATION "${absolute_target_path}")
-
-  if(REMILL_ENABLE_INSTALL_TARGET)
-    if(DEFINED install_destination)
-      install(FILES "${absolute_target_path}" DESTINATION "${install_destination}")
-    endif()
+  # Build the same runtime once more for each feature level of the host, so
+  # that `LoadArchSemantics` can pick the best one that the running host
+  # supports, e.g. `amd64_avx.x86-64-v3.bc`.
+  if(REMILL_BUILD_HOST_TUNED_SEMANTICS)
+    foreach(variant ${REMILL_HOST_TUNED_SEMANTICS_VARIANTS})
+      add_runtime_bitcode("${target_name}.${variant}" "-march=${variant}")
+    endforeach()
   endif()
 endfunction()
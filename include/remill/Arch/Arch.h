@@ -367,6 +367,22 @@ class Arch {
   static ArchPtr Build(llvm::LLVMContext *context, OSName os,
                        ArchName arch_name);
 
+  // Build a hybrid architecture that decodes and lifts using the native
+  // decoder for `arch_name`, and falls back on the SLEIGH-backed decoder for
+  // the same machine when the native decoder rejects an instruction, or when
+  // the semantics module has no `ISEL_` for it. Both share the native
+  // architecture's `State` structure and semantics module. Supported values
+  // of `arch_name` are `kArchAMD64`, `kArchX86_AVX512` (whose semantics match
+  // those of `kArchX86_SLEIGH`), and `kArchAArch64LittleEndian`; anything else
+  // returns `nullptr`.
+  //
+  // NOTE: Decoding through the fallback acquires the SLEIGH lock, but
+  //       lifting a SLEIGH-decoded instruction does not; clients lifting
+  //       from several threads should hold `Arch::Lock` of the SLEIGH
+  //       architecture around lifting.
+  static ArchPtr GetHybrid(llvm::LLVMContext *context, OSName os,
+                           ArchName arch_name);
+
   // Get the (approximate) architecture of the system library was built on. This may not
   // include all feature sets.
   static ArchPtr GetHostArch(llvm::LLVMContext &contex);
@@ -0,0 +1,60 @@
+/*
+ * Copyright (c) 2026 Trail of Bits, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include "remill/BC/TraceLifter.h"
+
+namespace remill {
+
+class ElfImage;
+
+// A trace manager that lifts the code of an `ElfImage`, reading instruction
+// bytes straight out of its mapped executable segments, and naming the traces
+// at function symbols after those symbols, e.g. `sub_401000_main`.
+class ElfTraceManager : public TraceManager {
+ public:
+  virtual ~ElfTraceManager(void);
+
+  explicit ElfTraceManager(const ElfImage &image_);
+
+  std::string TraceName(uint64_t addr) override;
+
+  void SetLiftedTraceDefinition(uint64_t addr,
+                                llvm::Function *lifted_func) override;
+
+  llvm::Function *GetLiftedTraceDeclaration(uint64_t addr) override;
+
+  llvm::Function *GetLiftedTraceDefinition(uint64_t addr) override;
+
+  void InvalidateLiftedTraceDefinition(uint64_t addr,
+                                       llvm::Function *lifted_func) override;
+
+  bool TryReadExecutableByte(uint64_t addr, uint8_t *byte) override;
+
+  // Reads the bytes of the segments that aren't writable.
+  bool TryReadReadOnlyByte(uint64_t addr, uint8_t *byte) override;
+
+  const ElfImage &image;
+
+  // The lifted traces, by entry address.
+  TraceMap traces;
+};
+
+}  // namespace remill
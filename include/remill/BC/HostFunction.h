@@ -0,0 +1,92 @@
+/*
+ * Copyright (c) 2026 Trail of Bits, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace llvm {
+class Function;
+}  // namespace llvm
+namespace remill {
+
+class Arch;
+
+// A host implementation of a guest function, e.g. of `memcpy`, to call
+// instead of lifting the guest function. The host function is called as:
+//
+//    Memory *name(Memory *memory, uint64_t *ret, uint64_t arg_0, ...,
+//                 uint64_t arg_n);
+//
+// where `memory` is the memory pointer that the memory intrinsics get, so
+// that the host function can access guest memory the same way that they do,
+// the arguments are the integer arguments of the guest function, and `*ret`
+// receives the guest function's return value. Like the memory intrinsics,
+// the host function returns the memory pointer to use after it.
+//
+// The host function must be defined by the module that the lifted code ends
+// up in, or by the embedder. The X86 and AArch64 semantics define the ones
+// that `HostFunctionMatcher::AddLibC` names (see
+// `lib/Arch/Runtime/HostFunctions.cpp`).
+struct HostFunction {
+  std::string name;
+  unsigned num_args{0};
+};
+
+// Recognizes guest functions that have host implementations, by address, by
+// symbol name, or by the bytes at the start of the function.
+class HostFunctionMatcher {
+ public:
+  void AddAddress(uint64_t addr, HostFunction func);
+  void AddSymbol(std::string symbol, HostFunction func);
+  void AddSignature(std::string bytes, HostFunction func);
+
+  // Recognize the `memcpy`, `memmove`, `memset`, `strlen`, and `strcmp`
+  // symbols, and call `__remill_host_<symbol>` instead of them, which the
+  // X86 and AArch64 semantics define.
+  void AddLibC(void);
+
+  // Return the host implementation of the guest function at `addr` named
+  // `symbol`, if any. `read_byte` reads one executable byte, and is used to
+  // match signatures.
+  const HostFunction *
+  Match(uint64_t addr, std::string_view symbol,
+        const std::function<bool(uint64_t, uint8_t *)> &read_byte) const;
+
+ private:
+  std::unordered_map<uint64_t, HostFunction> by_address;
+  std::unordered_map<std::string, HostFunction> by_symbol;
+  std::vector<std::pair<std::string, HostFunction>> by_signature;
+};
+
+// Define the lifted function `func` as a shim that reads the arguments of
+// `host` according to the default calling convention of `arch`, calls
+// `host`, stores its return value, and returns to the caller with the memory
+// pointer that `host` returned. Returns `false`
+// if `arch` has no known calling convention, or if it passes too few
+// arguments in registers.
+//
+// NOTE: `arch` must have been initialized from the module containing `func`.
+bool DefineHostFunctionShim(const Arch *arch, llvm::Function *func,
+                            const HostFunction &host);
+
+}  // namespace remill
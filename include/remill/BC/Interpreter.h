@@ -0,0 +1,198 @@
+/*
+ * Copyright (c) 2026 Trail of Bits, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+
+namespace llvm {
+class Module;
+}  // namespace llvm
+namespace remill {
+
+class Arch;
+
+// An operand of an instruction, resolved at decode time into offsets and
+// values, so that a handler never needs to look anything up by name.
+//
+// NOTE: The layout of this structure is mirrored by the handlers that
+//       `AddInterpreterHandlers` generates.
+struct InterpreterOperand {
+  enum Kind : uint8_t {
+    kImmediate,
+
+    // A register in the `State` structure, at byte offset `base`.
+    kRegister,
+
+    // One of the `NEXT_PC`, `RETURN_PC`, `MONITOR`, or `BRANCH_TAKEN`
+    // variables of lifted code, at byte offset `base` of `InterpreterLocals`.
+    kLocal,
+
+    // `base + index * scale + imm + segment`, where the registers are read
+    // from the `State` structure, and truncated to `size` bits.
+    kAddress,
+  };
+
+  uint8_t kind;
+
+  // Size, in bytes, of the base, index, and segment base registers. A size of
+  // zero means that there is no such register.
+  uint8_t base_size;
+  uint8_t index_size;
+  uint8_t segment_size;
+
+  // Is `base` an offset into `InterpreterLocals` rather than into `State`?
+  uint8_t base_is_local;
+  uint8_t padding[3];
+
+  // Size, in bits, of the register or of the address.
+  uint32_t size;
+
+  // Byte offsets of the registers.
+  uint32_t base;
+  uint32_t index;
+  uint32_t segment;
+
+  int64_t scale;
+
+  // Immediate value, or address displacement.
+  uint64_t imm;
+};
+
+// A decoded instruction, as seen by its handler. The instruction is
+// immediately followed in memory by its `num_operands` operands. There are
+// no pointers in either structure, so that their layout doesn't depend on the
+// pointer size of the semantics module.
+struct InterpreterInstruction {
+  enum Flags : uint64_t {
+    kAtomicReadModifyWrite = 1,
+  };
+
+  uint64_t pc;
+  uint64_t size;
+  uint64_t flags;
+  uint64_t num_operands;
+};
+
+// The variables that lifted code keeps in a function's `alloca`s, and that
+// semantics functions reach through their operands.
+struct InterpreterLocals {
+  uint64_t next_pc;
+  uint64_t return_pc;
+  uint64_t monitor;
+  uint8_t branch_taken;
+};
+
+// A compiled handler. Handlers have the type:
+//
+//    Memory *handler(State *, Memory *, const InterpreterInstruction *,
+//                    InterpreterLocals *);
+using InterpreterHandler = void *(*) (void *, void *,
+                                      const InterpreterInstruction *,
+                                      InterpreterLocals *);
+
+// Return the name of the handler for the instruction semantics `isel`, i.e.
+// for an `Instruction::function`.
+std::string InterpreterHandlerName(std::string_view isel);
+
+// Define a handler for every instruction semantics function in `module`. A
+// handler calls its semantics function with the operands of an
+// `InterpreterInstruction`, so that the semantics module only needs to be
+// compiled to native code once, e.g. with `OptimizeBareModule` and a JIT or
+// `llc`, rather than once per lifted trace. Returns the number of handlers
+// defined. Semantics functions with operand types that handlers can't
+// produce are skipped, and the interpreter won't interpret instructions that
+// use them.
+unsigned AddInterpreterHandlers(const Arch *arch, llvm::Module *module);
+
+// Why `Interpreter::Run` returned.
+enum class InterpreterExit {
+
+  // The instruction at the returned program counter couldn't be decoded, or
+  // can't be interpreted, and was not executed. The caller should lift it
+  // instead.
+  kUninterpretable,
+
+  // An error instruction (e.g. `ud2`) was executed. The returned program
+  // counter is that of the error instruction.
+  kError,
+
+  // An asynchronous hyper call (e.g. a `syscall`) was executed. The returned
+  // program counter is that of the next instruction to execute once the
+  // caller has handled the hyper call.
+  kAsyncHyperCall,
+
+  // The instruction budget was exhausted.
+  //
+  // NOTE: Only checked between blocks.
+  kMaxInstructions,
+
+  // An instruction faulted, e.g. by accessing guest memory that couldn't be
+  // read or written, or by dividing by zero, and may have been partially
+  // executed. The returned program counter is that of the faulting
+  // instruction.
+  //
+  // NOTE: Only returned by `PcodeInterpreter`.
+  kFault,
+};
+
+// Executes instructions by calling compiled handlers, without lifting or JIT
+// compiling any code. Decoded blocks are cached, along with the handler of
+// each instruction and their resolved operands, and blocks are chained to
+// their most recent successors, so that dispatch usually doesn't go through
+// the block cache.
+//
+// This targets architectures whose instructions are lifted by calling
+// semantics functions, i.e. not those backed by SLEIGH, and doesn't support
+// delay slots or expression operands.
+class Interpreter {
+ public:
+  ~Interpreter(void);
+
+  // `arch` must have been initialized from the semantics module to which
+  // `AddInterpreterHandlers` was applied. `resolve_handler` returns the
+  // address of the compiled handler with the given name, or `nullptr`.
+  // `read_byte` reads one executable byte.
+  Interpreter(
+      const Arch *arch,
+      std::function<InterpreterHandler(const std::string &)> resolve_handler,
+      std::function<bool(uint64_t, uint8_t *)> read_byte);
+
+  // Execute the code starting at `pc` on `state` and `memory`, one block at a
+  // time, until at least `max_instructions` instructions have executed or
+  // something else stops execution. On return, `pc` and the program counter
+  // register of `state` hold the address of the next instruction to execute,
+  // and `memory` holds the latest memory pointer.
+  InterpreterExit Run(void *state, void *&memory, uint64_t &pc,
+                      uint64_t max_instructions);
+
+  // Forget the decoded blocks containing instruction bytes in `[begin, end)`,
+  // e.g. because the code there was modified.
+  void Invalidate(uint64_t begin, uint64_t end);
+
+ private:
+  Interpreter(void) = delete;
+
+  class Impl;
+
+  std::unique_ptr<Impl> impl;
+};
+
+}  // namespace remill
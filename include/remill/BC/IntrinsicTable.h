@@ -17,6 +17,8 @@
 #pragma once
 
 #include <memory>
+#include <string>
+#include <vector>
 
 namespace llvm {
 class ConstantArray;
@@ -33,6 +35,10 @@ class IntrinsicTable {
  public:
   explicit IntrinsicTable(llvm::Module *module);
 
+  // Return the names of the functions that the constructor looks up, but that
+  // are missing from `module`. The constructor fails if any are missing.
+  static std::vector<std::string> FindMissingIntrinsics(llvm::Module *module);
+
   llvm::Function *const error;
 
   // Control-flow.
@@ -29,7 +29,9 @@
 #include <initializer_list>
 #include <map>
 #include <memory>
+#include <optional>
 #include <set>
+#include <string>
 #include <unordered_map>
 #include <unordered_set>
 #include <vector>
@@ -40,12 +42,36 @@ class Function;
 namespace remill {
 
 class Arch;
+class IntrinsicTable;
 
 struct OptimizationGuide {
   bool slp_vectorize;
   bool loop_vectorize;
   bool verify_input;
   bool verify_output;
+
+  // Run `OutlineColdExits` on the optimized traces.
+  bool outline_cold_exits;
+
+  // Run `InferFunctionAttributes` on the module before optimizing it.
+  bool infer_attributes;
+
+  // Run `LowerLinuxSyscalls` on the optimized traces.
+  bool lower_linux_syscalls;
+
+  // Reads a byte of read-only guest memory, e.g. by calling
+  // `TraceManager::TryReadReadOnlyByte`. If set, `FoldReadOnlyMemoryReads` is
+  // run on the optimized traces, and those with folded reads are simplified
+  // again.
+  std::function<bool(uint64_t, uint8_t *)> read_only_memory;
+
+  // The addresses of the traces, which the overloads of `OptimizeModule` that
+  // take maps of traces fill in. `FoldReadOnlyMemoryReads` uses them to fold
+  // program counter relative reads.
+  std::unordered_map<llvm::Function *, uint64_t> trace_addresses;
+
+  // Run `PromoteGuestStack` on the optimized traces.
+  bool promote_guest_stack;
 };
 
 template <typename T>
@@ -82,6 +108,9 @@ inline static void
 OptimizeModule(const remill::Arch *arch, llvm::Module *module,
                const std::unordered_map<K, llvm::Function *> &traces,
                OptimizationGuide guide = {}) {
+  for (const auto &[addr, func] : traces) {
+    guide.trace_addresses.emplace(func, static_cast<uint64_t>(addr));
+  }
   auto trace_it = traces.begin();
   auto trace_func_gen = [&trace_it, &traces](void) -> llvm::Function * {
     if (trace_it != traces.end()) {
@@ -100,6 +129,9 @@ inline static void OptimizeModule(const remill::Arch *arch,
                                   llvm::Module *module,
                                   const std::map<K, llvm::Function *> &traces,
                                   OptimizationGuide guide = {}) {
+  for (const auto &[addr, func] : traces) {
+    guide.trace_addresses.emplace(func, static_cast<uint64_t>(addr));
+  }
   auto trace_it = traces.begin();
   auto trace_func_gen = [&trace_it, &traces](void) -> llvm::Function * {
     if (trace_it != traces.end()) {
@@ -178,4 +210,71 @@ OptimizeBareModule(const std::unique_ptr<llvm::Module> &module,
   return OptimizeBareModule(module.get(), guide);
 }
 
+// Mark the paths in the lifted function `func` that exit to `__remill_error` or
+// `__remill_missing_block` as cold, weighting the branches that lead to them
+// as unlikely, and outline those exits into shared, per-module stubs keyed by
+// the kind of exit and, when it is a constant, the program counter of the
+// exit. Running this after optimization yields one stub per exit PC.
+void OutlineColdExits(const IntrinsicTable &intrinsics, llvm::Function *func);
+
+// Give the asynchronous hyper calls of the system call instructions (e.g.
+// `syscall` or `svc`) in the lifted function `func` a fast path that calls
+// the user-mode Linux system call emulator of `remill/OS/LinuxSyscalls.h`,
+// and falls back to `__remill_async_hyper_call` when it doesn't emulate the
+// system call. When the system call number is a constant, the fast path calls
+// the emulator's entry point for that system call directly, and unemulated
+// system calls are left alone. Only amd64 and AArch64 Linux are supported.
+// Returns the number of hyper calls given a fast path. Running this after
+// optimization finds more constant system call numbers.
+unsigned LowerLinuxSyscalls(const Arch *arch, llvm::Function *func);
+
+// Replace the calls to the scalar memory read intrinsics in the lifted function
+// `func` whose addresses are constant and whose bytes are all read-only, as
+// told by `read_byte`, with the values that they read, in the byte order of
+// the module of `func`. Returns the number of folded reads. If `func` is the
+// trace of the code at `trace_addr`, then its program counter argument is
+// replaced by `trace_addr` and `func` is simplified first, which makes the
+// addresses of program counter relative reads, e.g. of literal pools, or of
+// `mov rax, [rip + x]`, constant.
+unsigned FoldReadOnlyMemoryReads(
+    const IntrinsicTable &intrinsics, llvm::Function *func,
+    const std::function<bool(uint64_t, uint8_t *)> &read_byte,
+    std::optional<uint64_t> trace_addr = std::nullopt);
+
+// Promote the guest stack frame of the lifted function `func` to an `alloca`,
+// rewriting the memory intrinsics that access the stack at constant offsets
+// from the stack pointer into loads and stores of the `alloca`, which are
+// then promoted to registers where possible. The frame is read from guest
+// memory once the stack pointer is loaded, and written back to it before
+// calls that take the `State` structure, e.g. to other traces or to hyper
+// calls, before other guest memory accesses, which can alias it, e.g. through
+// the frame pointer, and before returns. It is read again after the calls and
+// writes. Writes below the stack pointer of bytes that are never read are
+// left alone, so that the frame never reads them. Nothing is promoted unless
+// the stack pointer is loaded once, outside of a loop, and its uses are only
+// offset by constants, compared, used as the address of a scalar memory
+// access, or stored back to the stack pointer, i.e. the address of the frame
+// never escapes. Returns the number of promoted accesses.
+unsigned PromoteGuestStack(const Arch *arch, llvm::Function *func);
+
+// Infer attributes for the lifted functions `traces`, the semantics functions,
+// and the intrinsics in `module`. The `State` pointer arguments of `traces`,
+// of the control-flow intrinsics and of the semantics functions become
+// `nonnull`, `dereferenceable` and `align`ed, and functions are marked
+// `nofree`, `nosync`, `willreturn` and `argmemonly` when their bodies and
+// callees allow it, e.g. semantics functions that only touch `State`. This
+// lets LLVM hoist, sink and eliminate accesses to `State` that it otherwise
+// can't reason about.
+void InferFunctionAttributes(const Arch *arch, llvm::Module *module,
+                             const std::vector<llvm::Function *> &traces = {});
+
+// Shrink the semantics module `module` down to the instruction semantics
+// named in `isel_names` (i.e. `Instruction::function` values, such as those
+// collected by decoding all of a binary), along with the helpers, globals, and
+// intrinsics those semantics use. Returns `false` if the pruned module is
+// missing something that `IntrinsicTable` or the instruction lifter expect to
+// find in a semantics module.
+bool PruneSemanticsModule(llvm::Module *module,
+                          const std::unordered_set<std::string> &isel_names);
+
 }  // namespace remill
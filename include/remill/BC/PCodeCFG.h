@@ -69,6 +69,12 @@ class PcodeCFG {
 
 PcodeCFG CreateCFG(const std::vector<RemillPcodeOp> &linear_ops);
 
+// Simplify the p-code of an instruction before it's lifted, by propagating
+// copies, folding constants, and removing ops whose outputs are never read.
+// `word_size` is the size, in bytes, of an address. Ops are only rewritten or
+// removed within their blocks, so the exits of the blocks stay valid.
+void OptimizePcodeCFG(PcodeCFG &cfg, size_t word_size);
+
 class PcodeCFGBuilder {
  public:
   explicit PcodeCFGBuilder(const std::vector<RemillPcodeOp> &linear_ops);
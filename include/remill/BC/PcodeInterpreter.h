@@ -0,0 +1,92 @@
+/*
+ * Copyright (c) 2026 Trail of Bits, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+
+#include "remill/Arch/Context.h"
+#include "remill/BC/Interpreter.h"
+
+namespace remill {
+
+class Arch;
+
+// Reads or writes the `size` bytes of guest memory at `addr`, in the order
+// in which they are stored in guest memory. Returns `false` if the memory
+// can't be accessed.
+using PcodeMemoryReader =
+    std::function<bool(uint64_t addr, uint8_t *data, size_t size)>;
+using PcodeMemoryWriter =
+    std::function<bool(uint64_t addr, const uint8_t *data, size_t size)>;
+
+// Executes the p-code of instructions of architectures backed by SLEIGH
+// directly on a `State` structure, without lifting or JIT compiling any code.
+// The p-code of each instruction is decoded once, with its varnodes resolved
+// into `State` offsets, scratch slots, and constants, and is cached by
+// address.
+//
+// The p-code ops are executed with their SLEIGH semantics, the program counter
+// register is set up in the same way as by `SleighLifter`, and the temporary
+// and unknown registers of an instruction don't outlive it, so that the
+// interpreter can serve as a reference for the code that `SleighLifter`
+// produces.
+//
+// NOTE: Instructions are all decoded with the same decoding context, by
+//       default the initial one, like `TraceLifter` does. Instructions with
+//       user-defined p-code ops other than equality claims, or with ops or
+//       float sizes that aren't supported, are not interpreted.
+class PcodeInterpreter {
+ public:
+  ~PcodeInterpreter(void);
+
+  // `arch` must be backed by SLEIGH, and must have been initialized from a
+  // semantics module. `read_byte` reads one executable byte, and
+  // `read_memory` and `write_memory` access guest memory.
+  PcodeInterpreter(const Arch *arch,
+                   std::function<bool(uint64_t, uint8_t *)> read_byte,
+                   PcodeMemoryReader read_memory,
+                   PcodeMemoryWriter write_memory);
+
+  // Like the above, but decodes instructions with `context` rather than with
+  // the initial decoding context of `arch`, e.g. to interpret PPC VLE code.
+  PcodeInterpreter(const Arch *arch, DecodingContext context,
+                   std::function<bool(uint64_t, uint8_t *)> read_byte,
+                   PcodeMemoryReader read_memory,
+                   PcodeMemoryWriter write_memory);
+
+  // Execute the code starting at `pc` on `state`, one instruction at a time,
+  // until `max_instructions` instructions have executed or something else
+  // stops execution. On return, `pc` and the program counter register of
+  // `state` hold the address of the next instruction to execute.
+  InterpreterExit Run(void *state, uint64_t &pc, uint64_t max_instructions);
+
+  // Forget the decoded instructions whose bytes overlap `[begin, end)`, e.g.
+  // because the code there was modified.
+  void Invalidate(uint64_t begin, uint64_t end);
+
+ private:
+  PcodeInterpreter(void) = delete;
+
+  class Impl;
+
+  std::unique_ptr<Impl> impl;
+};
+
+}  // namespace remill
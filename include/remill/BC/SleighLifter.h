@@ -21,6 +21,8 @@
 
 #include <mutex>
 #include <sleigh/libsleigh.hh>
+#include <string>
+#include <vector>
 
 #include "remill/Arch/Instruction.h"
 #include "remill/BC/InstructionLifter.h"
@@ -40,6 +42,7 @@ using MaybeBranchTakenVar = std::optional<BranchTakenVar>;
 
 class SleighDecoder;
 class SingleInstructionSleighContext;
+struct RemillPcodeOp;
 }  // namespace sleigh
 
 
@@ -68,6 +71,24 @@ class SleighLifter : public InstructionLifter {
                                const sleigh::MaybeBranchTakenVar &btaken,
                                const ContextValues &context_values);
 
+  // Decode the p-code of `inst`, as it is decoded when lifting `inst` with the
+  // context values `context_values`.
+  std::vector<sleigh::RemillPcodeOp>
+  DecodePcode(const Instruction &inst, const ContextValues &context_values);
+
+  // Return the SLEIGH name of the register varnode `vnode`, or an empty string.
+  std::string GetRegisterName(const VarnodeData &vnode) const;
+
+  // Return the name of the register in the `State` structure that backs the
+  // SLEIGH register `reg_name`, or an empty string if there is none.
+  std::string GetStateRegisterName(std::string reg_name);
+
+  // Return the names of the user-defined p-code ops, indexed by the first
+  // input of `CALLOTHER` ops.
+  std::vector<std::string> GetUserOpNames(void);
+
+  const sleigh::SleighDecoder &GetDecoder(void) const;
+
  private:
   static void SetISelAttributes(llvm::Function *);
 
@@ -121,6 +142,10 @@ class SleighLifterWithState final : public InstructionLifterIntf {
   const ContextValues &GetContextValues() const {
     return context_values;
   }
+
+  const std::shared_ptr<SleighLifter> &GetSleighLifter() const {
+    return lifter;
+  }
 };
 
 }  // namespace remill
@@ -0,0 +1,85 @@
+/*
+ * Copyright (c) 2026 Trail of Bits, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+
+#include "Optimizer.h"
+
+namespace llvm {
+class Function;
+}  // namespace llvm
+namespace remill {
+
+class Arch;
+
+// Re-optimizes hot lifted traces in background threads.
+//
+// Emulators want to run lifted code as soon as it is lifted, which rules out
+// waiting for `OptimizeModule`, but running unoptimized traces is slow. The
+// tiered optimizer lets the embedder start out with unoptimized (tier 0)
+// traces, e.g. those produced by `TraceLifter` and JIT compiled as-is, count
+// how often each of them runs, and swap in fully optimized (tier 1) versions
+// of the hot ones once they are ready.
+//
+// Each worker thread has its own `llvm::LLVMContext`, architecture, and
+// semantics module, and so never touches the module of the embedder. Hot
+// traces are copied out of the embedder's module when they are queued, and
+// the optimized versions are copied back in by `SwapInOptimizedTraces`.
+//
+// NOTE: With the exception of the worker threads, the tiered optimizer is
+//       not thread-safe, and should only be used from the thread that owns
+//       the module containing the traces.
+class TieredOptimizer {
+ public:
+  ~TieredOptimizer(void);
+
+  // Create an optimizer using `num_threads` worker threads. A trace is hot,
+  // and queued for optimization, once it has executed `hot_threshold` times.
+  // Workers build their own copy of `arch`, and optimize using `guide`.
+  TieredOptimizer(const Arch *arch, unsigned num_threads,
+                  uint64_t hot_threshold, OptimizationGuide guide = {});
+
+  // Count one execution of the tier 0 trace `trace` whose entry is `pc`.
+  // Returns `true` if that made the trace hot, and queued it for
+  // optimization.
+  bool RecordExecution(uint64_t pc, llvm::Function *trace);
+
+  // Replace the bodies of the hot traces whose optimized versions are ready
+  // with those optimized versions, then call `callback` on each replaced
+  // trace, e.g. so that the embedder can re-JIT it. Traces are replaced in
+  // place, so calls to them from other traces stay valid. Returns the number
+  // of replaced traces.
+  unsigned SwapInOptimizedTraces(
+      std::function<void(uint64_t, llvm::Function *)> callback = NullCallback);
+
+  // Block until every queued trace has been optimized.
+  void Wait(void);
+
+  static void NullCallback(uint64_t, llvm::Function *);
+
+ private:
+  TieredOptimizer(void) = delete;
+
+  class Impl;
+
+  std::unique_ptr<Impl> impl;
+};
+
+}  // namespace remill
@@ -0,0 +1,97 @@
+/*
+ * Copyright (c) 2026 Trail of Bits, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string_view>
+#include <unordered_map>
+
+namespace llvm {
+class Function;
+class LLVMContext;
+class Module;
+}  // namespace llvm
+namespace remill {
+
+// Name of the module-level named metadata that maps guest program counters
+// to the lifted traces implementing the code at those program counters.
+extern const std::string_view kTraceIndexMetadataName;
+
+// Record a guest PC to lifted trace index into `module`. Functions in `traces`
+// must belong to `module`. Any existing index in `module` is replaced.
+void AddTraceIndex(llvm::Module *module,
+                   const std::unordered_map<uint64_t, llvm::Function *> &traces);
+
+// Read back the trace index stored in `module` by `AddTraceIndex`. Entries
+// whose traces have since been deleted from the module are skipped.
+std::map<uint64_t, llvm::Function *> GetTraceIndex(llvm::Module *module);
+
+// Store `module` into a bitcode file along with an index of `traces`. The
+// bitcode layout written by LLVM already permits lazy loading of function
+// bodies, so the combination lets `LazyTraceModule` load only the traces that
+// a consumer asks for.
+bool StoreIndexedModuleToFile(
+    llvm::Module *module,
+    const std::unordered_map<uint64_t, llvm::Function *> &traces,
+    std::string_view file_name, bool allow_failure = false);
+
+// A module of lifted code whose trace bodies are only parsed from the bitcode
+// file when they are requested.
+class LazyTraceModule {
+ public:
+  ~LazyTraceModule(void);
+
+  // Open a bitcode file written by `StoreIndexedModuleToFile`. Only the
+  // module-level information (globals, declarations, and the trace index) is
+  // parsed here. Returns `nullptr` on failure.
+  static std::unique_ptr<LazyTraceModule>
+  Load(llvm::LLVMContext *context, std::filesystem::path file_name);
+
+  // The lazily loaded module. Trace functions that haven't been materialized
+  // report `isMaterializable()`.
+  llvm::Module *GetModule(void) const;
+
+  // Return the trace for the code at `pc`, parsing its body if needed.
+  // Returns `nullptr` if there is no trace for `pc`, or if the body could not
+  // be materialized.
+  llvm::Function *MaterializeTrace(uint64_t pc);
+
+  // Return the trace for the code at `pc` without materializing its body.
+  llvm::Function *GetTrace(uint64_t pc) const;
+
+  // Apply `cb` to every indexed trace, in program counter order, without
+  // materializing any of them.
+  void ForEachTrace(std::function<void(uint64_t, llvm::Function *)> cb) const;
+
+  // Materialize everything that hasn't yet been loaded.
+  bool MaterializeAll(void);
+
+ private:
+  LazyTraceModule(std::unique_ptr<llvm::Module> module_,
+                  std::map<uint64_t, llvm::Function *> index_);
+
+  LazyTraceModule(void) = delete;
+
+  std::unique_ptr<llvm::Module> module;
+  std::map<uint64_t, llvm::Function *> index;
+};
+
+}  // namespace remill
@@ -18,11 +18,15 @@
 
 #include <remill/BC/Lifter.h>
 
+#include <cstdint>
 #include <functional>
 #include <unordered_map>
+#include <vector>
 
 namespace remill {
 
+struct HostFunction;
+
 using TraceMap = std::unordered_map<uint64_t, llvm::Function *>;
 
 enum class DevirtualizedTargetKind { kTraceLocal, kTraceHead };
@@ -71,6 +75,11 @@ class TraceManager {
   // lifter to support devirtualization, e.g. handling jump tables as
   // `switch` statements, or handling indirect calls through the PLT as
   // direct jumps.
+  //
+  // NOTE: If no targets of an indirect jump are given, then the trace lifter
+  //       tries to read them out of an x86 or amd64 jump table in read-only
+  //       memory (see `TryReadReadOnlyByte`). Unknown targets of indirect
+  //       jumps are still handled by `__remill_jump`.
   virtual void ForEachDevirtualizedTarget(
       const Instruction &inst,
       std::function<void(uint64_t, DevirtualizedTargetKind)> func);
@@ -79,6 +88,42 @@ class TraceManager {
   // at address `addr` is executable and readable, and updates the byte
   // pointed to by `byte` with the read value.
   virtual bool TryReadExecutableByte(uint64_t addr, uint8_t *byte) = 0;
+
+  // Try to read a byte of memory that is never written, e.g. of `.rodata` or
+  // of a literal pool. Returns `true` if the byte at address `addr` is
+  // readable and read-only, and updates the byte pointed to by `byte` with
+  // the read value. Such bytes can be folded into lifted code by
+  // `FoldReadOnlyMemoryReads`, and are searched for jump tables. By default,
+  // no memory is read-only.
+  virtual bool TryReadReadOnlyByte(uint64_t addr, uint8_t *byte);
+
+  // Called when the trace at `addr` has been invalidated by
+  // `TraceLifter::Invalidate`. The body of `lifted_func` has been deleted,
+  // but the function itself is kept alive so that any callers referencing it
+  // remain valid, and it will be re-defined in place when it is re-lifted.
+  //
+  // The derived class is expected to forget `lifted_func` as a definition,
+  // i.e. `GetLiftedTraceDefinition(addr)` must no longer return it.
+  virtual void InvalidateLiftedTraceDefinition(uint64_t addr,
+                                               llvm::Function *lifted_func);
+
+  // Return the host implementation of the function at `addr`, if any, e.g.
+  // as recognized by a `HostFunctionMatcher`. Instead of lifting the code at
+  // `addr`, the trace lifter defines its trace as a shim that calls the host
+  // implementation.
+  virtual const HostFunction *GetHostFunction(uint64_t addr);
+};
+
+// The number of entries in the shadow return stack of lifted code. See
+// `TraceLifter::SetShadowReturnStack`.
+static constexpr unsigned kShadowReturnStackSize = 64u;
+
+// An entry of the shadow return stack of lifted code. Lifted code stores
+// `addr_t`-sized program counters, which fit in `pc`, and pointers to
+// lifted functions in `trace`.
+struct ShadowReturnStackEntry {
+  uint64_t pc;
+  void *trace;
 };
 
 // Implements a recursive decoder that lifts a trace of instructions to bitcode.
@@ -93,12 +138,61 @@ class TraceLifter {
 
   static void NullCallback(uint64_t, llvm::Function *);
 
+  // Enable or disable running `OutlineColdExits` on every lifted trace before
+  // it is handed to the callback and the trace manager. This is disabled by
+  // default.
+  void SetOutlineColdExits(bool enable);
+
+  // Enable or disable lifting direct calls to known traces as plain calls,
+  // which continue at the return address only if the callee returned to it,
+  // and lifting function returns as plain returns to the caller, rather than
+  // as tail-calls to `__remill_function_return`. This lets the optimizer
+  // inline small callees into their callers. This is disabled by default.
+  //
+  // NOTE: Only enable this if the runtime's `__remill_function_return` just
+  //       returns its memory pointer. Every guest call becomes a host call,
+  //       so guest recursion becomes host recursion, and deeply recursive
+  //       guest code can overflow the host stack.
+  void SetGuardedDirectCalls(bool enable);
+
+  // Enable or disable a shadow return stack in lifted code. Function calls
+  // push their return address, along with the trace that starts there, and
+  // then exit the trace. Function returns pop the top entry, and tail-call
+  // its trace directly if it starts at the returned-to address, falling back
+  // on `__remill_function_return` otherwise. The stack is a ring buffer, so
+  // that deep recursion only costs extra calls to `__remill_function_return`.
+  // This is disabled by default, and can't be combined with
+  // `SetGuardedDirectCalls`.
+  //
+  // NOTE: The runtime must link remill's definitions of the thread-local
+  //       variables `__remill_shadow_return_stack` and
+  //       `__remill_shadow_return_stack_top`, and its `__remill_function_call`
+  //       must continue at `PC`.
+  void SetShadowReturnStack(bool enable);
+
   // Lift one or more traces starting from `addr`. Calls `callback` with each
   // lifted trace.
   bool
   Lift(uint64_t addr,
        std::function<void(uint64_t, llvm::Function *)> callback = NullCallback);
 
+  // Returns the entry addresses of the traces lifted by this lifter that
+  // contain at least one instruction byte in the range `[begin, end)`.
+  std::vector<uint64_t> TracesInRange(uint64_t begin, uint64_t end) const;
+
+  // Invalidate every trace lifted by this lifter whose instructions overlap
+  // the range `[begin, end)`, e.g. because the code there was modified or
+  // remapped, then re-lift those traces. Re-lifted traces are defined in
+  // place, so that callers and tail-callers that reference the old trace
+  // functions now reach the new code. Calls `callback` with each re-lifted
+  // trace.
+  //
+  // NOTE: Callers into which an invalidated trace has already been inlined
+  //       (e.g. by `OptimizeModule`) keep their stale copy of the code.
+  bool Invalidate(
+      uint64_t begin, uint64_t end,
+      std::function<void(uint64_t, llvm::Function *)> callback = NullCallback);
+
  private:
   TraceLifter(void) = delete;
 
@@ -108,3 +202,9 @@ class TraceLifter {
 };
 
 }  // namespace remill
+
+// The shadow return stack of lifted code, and the index of its top entry. See
+// `TraceLifter::SetShadowReturnStack`.
+extern "C" thread_local remill::ShadowReturnStackEntry
+    __remill_shadow_return_stack[remill::kShadowReturnStackSize];
+extern "C" thread_local uint32_t __remill_shadow_return_stack_top;
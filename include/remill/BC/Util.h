@@ -175,13 +175,23 @@ std::unique_ptr<llvm::Module>
 LoadModuleFromFile(llvm::LLVMContext *context, std::filesystem::path file_name);
 
 // Loads the semantics for the `arch`-specific machine, i.e. the machine of the
-// code that we want to lift.
+// code that we want to lift. If a variant of the semantics tuned for the
+// running host was built (see `HostSemanticsVariants`), and is next to the
+// generic semantics bitcode file, then the best such variant is loaded, and
+// its functions keep their `target-cpu` and `target-features` attributes,
+// which lifted functions in the module then adopt.
 std::unique_ptr<llvm::Module> LoadArchSemantics(const Arch *arch);
 // `sem_dirs` is forwarded to `FindSemanticsBitcodeFile`.
 std::unique_ptr<llvm::Module>
 LoadArchSemantics(const Arch *arch,
                   const std::vector<std::filesystem::path> &sem_dirs);
 
+// Return the names of the host-tuned semantics variants that the running
+// host can use, best first, e.g. `{"x86-64-v3", "x86-64-v2"}`. The variant
+// `v` of the semantics for `arch` is in the file `arch.v.bc`, and is built
+// when `REMILL_BUILD_HOST_TUNED_SEMANTICS` is enabled.
+std::vector<std::string> HostSemanticsVariants(void);
+
 // Store an LLVM module into a file.
 bool StoreModuleToFile(llvm::Module *module, std::string_view file_name,
                        bool allow_failure = false);
@@ -252,7 +262,8 @@ std::string ModuleName(const std::unique_ptr<llvm::Module> &module);
 unsigned ReplaceAllUsesOfConstant(llvm::Constant *old_c, llvm::Constant *new_c,
                                   llvm::Module *module);
 
-// Move a function from one module into another module.
+// Move a function from one module into another module. The `linkonce_odr` and
+// `weak_odr` functions that it calls are copied along with it.
 void MoveFunctionIntoModule(llvm::Function *func, llvm::Module *dest_module);
 
 // Get an instance of `type` that belongs to `context`.
@@ -0,0 +1,102 @@
+/*
+ * Copyright (c) 2026 Trail of Bits, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <string_view>
+
+#include "remill/Arch/Name.h"
+
+namespace remill {
+
+// A guest address space holding the loadable segments of an ELF file. The
+// address space is one contiguous reservation of host memory, so that guest
+// address `addr` is at host address `HostBase() + addr`, and the segments are
+// mapped from the file rather than copied, with only the zero-filled tails of
+// partially initialized pages being written. Segments that share a host page
+// with another segment are copied instead. Writable segments are mapped
+// privately, so guest writes never reach the file.
+//
+// Supports 32- and 64-bit, little- and big-endian ELF files for x86, amd64,
+// AArch32, AArch64, PPC, and SPARC.
+//
+// NOTE: Relocations are not applied, and no dynamic loader is run, so the
+//       loaded code should be statically linked, or only be lifted.
+class ElfImage {
+ public:
+  ~ElfImage(void);
+
+  // Load the ELF file at `path`, reserving `extra_size` bytes of guest
+  // address space after its last segment for e.g. a stack or a heap, to be
+  // mapped by `MapAnonymous`. Returns `nullptr` on failure.
+  static std::unique_ptr<ElfImage> Load(const std::string &path,
+                                        uint64_t extra_size = 0);
+
+  // The architecture of the ELF file. AArch64 and AArch32 files are always
+  // little-endian.
+  ArchName Architecture(void) const;
+
+  uint64_t EntryPoint(void) const;
+
+  // The range of guest addresses backed by the reservation, including the
+  // extra space.
+  uint64_t BeginAddress(void) const;
+  uint64_t EndAddress(void) const;
+
+  // Return the host address of guest address zero. Runtimes can implement
+  // the memory intrinsics as accesses to `HostBase() + addr`, as long as the
+  // guest only accesses addresses in `[BeginAddress(), EndAddress())`.
+  uint8_t *HostBase(void) const;
+
+  // Return a host pointer to the guest range `[addr, addr + size)`, or
+  // `nullptr` if any of the range isn't mapped, either by a segment or by
+  // `MapAnonymous`. Mappings have host page granularity.
+  void *Translate(uint64_t addr, uint64_t size) const;
+
+  // Map zeroed, writable memory at the guest range `[addr, addr + size)`,
+  // which must be within the reservation and must not overlap a segment.
+  bool MapAnonymous(uint64_t addr, uint64_t size);
+
+  // Try to read a byte of an executable segment.
+  bool TryReadExecutableByte(uint64_t addr, uint8_t *byte) const;
+
+  // Try to read a byte of a segment that isn't writable.
+  //
+  // NOTE: Relocations aren't applied, so the bytes of e.g. relocated
+  //       pointers in a read-only segment of a relocatable file are the ones
+  //       in the file.
+  bool TryReadReadOnlyByte(uint64_t addr, uint8_t *byte) const;
+
+  // Return the name of the function symbol at `addr`, or an empty string.
+  std::string_view SymbolName(uint64_t addr) const;
+
+  // Function symbols, by address. For AArch32, Thumb addresses have their low
+  // bit cleared.
+  const std::map<uint64_t, std::string> &Symbols(void) const;
+
+ private:
+  ElfImage(void);
+
+  class Impl;
+
+  std::unique_ptr<Impl> impl;
+};
+
+}  // namespace remill
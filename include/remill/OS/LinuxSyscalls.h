@@ -0,0 +1,127 @@
+/*
+ * Copyright (c) 2026 Trail of Bits, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string_view>
+
+#include "remill/Arch/Name.h"
+
+namespace remill {
+
+// The Linux system calls that `LinuxSyscallEmulator` forwards to the host,
+// as `X(name, enumerator, amd64 number, AArch64 number)`. Everything else,
+// e.g. `exit`, `mmap`, `brk`, or signal handling, changes the guest's address
+// space or control flow, and is left to the embedder's asynchronous hyper
+// call handler.
+#define REMILL_FOR_EACH_LINUX_SYSCALL(X) \
+  X(read, kRead, 0, 63) \
+  X(write, kWrite, 1, 64) \
+  X(close, kClose, 3, 57) \
+  X(lseek, kLSeek, 8, 62) \
+  X(pread64, kPRead64, 17, 67) \
+  X(pwrite64, kPWrite64, 18, 68) \
+  X(readv, kReadV, 19, 65) \
+  X(writev, kWriteV, 20, 66) \
+  X(getpid, kGetPID, 39, 172) \
+  X(uname, kUname, 63, 160) \
+  X(getuid, kGetUID, 102, 174) \
+  X(getgid, kGetGID, 104, 176) \
+  X(geteuid, kGetEUID, 107, 175) \
+  X(getegid, kGetEGID, 108, 177) \
+  X(gettid, kGetTID, 186, 178) \
+  X(clock_gettime, kClockGetTime, 228, 113) \
+  X(openat, kOpenAt, 257, 56) \
+  X(getrandom, kGetRandom, 318, 278)
+
+enum class LinuxSyscall : uint32_t {
+  kInvalid,
+#define REMILL_LINUX_SYSCALL_ENUMERATOR(name, enumerator, amd64, aarch64) \
+  enumerator,
+  REMILL_FOR_EACH_LINUX_SYSCALL(REMILL_LINUX_SYSCALL_ENUMERATOR)
+#undef REMILL_LINUX_SYSCALL_ENUMERATOR
+};
+
+// Return the system call numbered `number` in the user-mode Linux ABI of
+// `arch_name`, or `LinuxSyscall::kInvalid` if it isn't emulated. Only the
+// amd64 and AArch64 ABIs are supported.
+LinuxSyscall GetLinuxSyscall(ArchName arch_name, uint64_t number);
+
+// Return the name of a system call, e.g. `"openat"`.
+std::string_view GetLinuxSyscallName(LinuxSyscall syscall);
+
+// Translates the guest address range `[addr, addr + size)` into a host
+// pointer, given the memory pointer of lifted code. Returns `nullptr` if the
+// range isn't mapped contiguously into host memory.
+using GuestAddressTranslator =
+    std::function<void *(void *memory, uint64_t addr, uint64_t size)>;
+
+// Emulates the system calls of a user-mode Linux guest by performing the
+// equivalent system calls on the host. Pointer arguments are translated
+// through the guest memory mapping, and structures whose layouts or flags
+// differ between the guest and the host are converted.
+//
+// NOTE: Nothing is emulated unless the host is Linux.
+class LinuxSyscallEmulator {
+ public:
+  LinuxSyscallEmulator(ArchName arch_name_,
+                       GuestAddressTranslator translate_);
+
+  // Emulate `syscall` with the arguments `args`. On success, `ret` holds the
+  // value that the guest expects in its return register, which is `-errno`
+  // if the host system call failed. Returns `false` if the system call
+  // wasn't emulated, and must be handled some other way.
+  bool Emulate(void *memory, LinuxSyscall syscall, const uint64_t *args,
+               uint64_t &ret) const;
+
+  // Emulate the system call numbered `number`.
+  bool Emulate(void *memory, uint64_t number, const uint64_t *args,
+               uint64_t &ret) const;
+
+  const ArchName arch_name;
+
+ private:
+  LinuxSyscallEmulator(void) = delete;
+
+  const GuestAddressTranslator translate;
+};
+
+// Set the emulator used by the `__remill_linux_syscall` functions that
+// `LowerLinuxSyscalls` calls from lifted code. With no emulator, lifted
+// code always falls back to `__remill_async_hyper_call`.
+void SetLinuxSyscallEmulator(const LinuxSyscallEmulator *emulator);
+
+}  // namespace remill
+
+// The entry points of lifted code into the current emulator. Each returns
+// `true` and stores the guest's return value into `ret` if it emulated the
+// system call.
+extern "C" bool __remill_linux_syscall(void *memory, uint64_t number,
+                                       uint64_t *ret, uint64_t arg0,
+                                       uint64_t arg1, uint64_t arg2,
+                                       uint64_t arg3, uint64_t arg4,
+                                       uint64_t arg5);
+
+#define REMILL_DECLARE_LINUX_SYSCALL(name, enumerator, amd64, aarch64) \
+  extern "C" bool __remill_linux_syscall_##name( \
+      void *memory, uint64_t *ret, uint64_t arg0, uint64_t arg1, \
+      uint64_t arg2, uint64_t arg3, uint64_t arg4, uint64_t arg5);
+
+REMILL_FOR_EACH_LINUX_SYSCALL(REMILL_DECLARE_LINUX_SYSCALL)
+
+#undef REMILL_DECLARE_LINUX_SYSCALL
@@ -763,6 +763,17 @@ void Arch::InitializeEmptyLiftedFunction(llvm::Function *func) const {
   ir.CreateStore(state, ir.CreateAlloca(state->getType(), nullptr, "STATE"));
   ir.CreateStore(memory, ir.CreateAlloca(memory->getType(), nullptr, "MEMORY"));
 
+  // Semantics can only be inlined into functions with at least their target
+  // features, so adopt the target of host-tuned semantics, which keep theirs
+  // (see `LoadArchSemantics`).
+  if (auto sems = module->getFunction("__remill_intrinsics")) {
+    for (auto kind : {"target-cpu", "target-features"}) {
+      if (sems->hasFnAttribute(kind)) {
+        func->addFnAttr(sems->getFnAttribute(kind));
+      }
+    }
+  }
+
   FinishLiftedFunctionInitialization(module, func);
   CHECK(BlockHasSpecialVars(func));
 }
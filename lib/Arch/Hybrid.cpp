@@ -0,0 +1,236 @@
+/*
+ * Copyright (c) 2026 Trail of Bits, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <glog/logging.h>
+#include <llvm/ADT/Triple.h>
+#include <llvm/IR/DataLayout.h>
+#include <llvm/IR/Function.h>
+#include <llvm/IR/Module.h>
+
+#include <algorithm>
+#include <memory>
+#include <string>
+
+#include "remill/Arch/Arch.h"
+#include "remill/Arch/Instruction.h"
+#include "remill/Arch/Name.h"
+#include "remill/BC/IntrinsicTable.h"
+
+namespace remill {
+namespace {
+
+// Returns the SLEIGH-backed architecture whose semantics module has the same
+// `State` structure as that of the native architecture `arch_name`.
+static ArchName FallbackArchName(ArchName arch_name) {
+  switch (arch_name) {
+    case kArchAMD64: return kArchAMD64_SLEIGH;
+    case kArchX86_AVX512: return kArchX86_SLEIGH;
+    case kArchAArch64LittleEndian: return kArchAArch64LittleEndian_SLEIGH;
+    default: return kArchInvalid;
+  }
+}
+
+// An architecture that proxies everything to a native architecture, except
+// for decoding, which falls back on a SLEIGH-backed architecture.
+class HybridArch final : public Arch {
+ public:
+  HybridArch(ArchPtr native_, ArchPtr fallback_)
+      : Arch(native_->context, native_->os_name, native_->arch_name),
+        native(std::move(native_)),
+        fallback(std::move(fallback_)) {}
+
+  virtual ~HybridArch(void) = default;
+
+  DecodingContext CreateInitialContext(void) const final {
+    return native->CreateInitialContext();
+  }
+
+  llvm::StructType *StateStructType(void) const final {
+    return native->StateStructType();
+  }
+
+  llvm::PointerType *StatePointerType(void) const final {
+    return native->StatePointerType();
+  }
+
+  llvm::PointerType *MemoryPointerType(void) const final {
+    return native->MemoryPointerType();
+  }
+
+  llvm::FunctionType *LiftedFunctionType(void) const final {
+    return native->LiftedFunctionType();
+  }
+
+  llvm::StructType *RegisterWindowType(void) const final {
+    return native->RegisterWindowType();
+  }
+
+  const IntrinsicTable *GetInstrinsicTable(void) const final {
+    return native->GetInstrinsicTable();
+  }
+
+  unsigned RegMdID(void) const final {
+    return native->RegMdID();
+  }
+
+  void ForEachRegister(std::function<void(const Register *)> cb) const final {
+    native->ForEachRegister(std::move(cb));
+  }
+
+  const Register *RegisterAtStateOffset(uint64_t offset) const final {
+    return native->RegisterAtStateOffset(offset);
+  }
+
+  const Register *RegisterByName(std::string_view name) const final {
+    return native->RegisterByName(name);
+  }
+
+  std::string_view StackPointerRegisterName(void) const final {
+    return native->StackPointerRegisterName();
+  }
+
+  std::string_view ProgramCounterRegisterName(void) const final {
+    return native->ProgramCounterRegisterName();
+  }
+
+  // Both architectures learn about the same `State` structure and intrinsics,
+  // so that the instructions decoded by either one can be lifted into the
+  // same functions.
+  void InitFromSemanticsModule(llvm::Module *module) const final {
+    native->InitFromSemanticsModule(module);
+    fallback->InitFromSemanticsModule(module);
+  }
+
+  OperandLifter::OpLifterPtr
+  DefaultLifter(const remill::IntrinsicTable &intrinsics) const final {
+    return native->DefaultLifter(intrinsics);
+  }
+
+  bool DecodeInstruction(uint64_t address, std::string_view instr_bytes,
+                         Instruction &inst,
+                         DecodingContext context) const final {
+    if (native->DecodeInstruction(address, instr_bytes, inst, context) &&
+        HasSemantics(inst)) {
+      return true;
+    }
+
+    DLOG(INFO) << "Falling back on SLEIGH to decode instruction at "
+               << std::hex << address << std::dec;
+
+    auto lock = Arch::Lock(fallback->arch_name);
+    inst.Reset();
+    return fallback->DecodeInstruction(address, instr_bytes, inst,
+                                       std::move(context));
+  }
+
+  uint64_t MinInstructionAlign(const DecodingContext &context) const final {
+    return native->MinInstructionAlign(context);
+  }
+
+  uint64_t MinInstructionSize(const DecodingContext &context) const final {
+    return native->MinInstructionSize(context);
+  }
+
+  uint64_t MaxInstructionSize(const DecodingContext &context,
+                              bool permit_fuse_idioms) const final {
+    return std::max(native->MaxInstructionSize(context, permit_fuse_idioms),
+                    fallback->MaxInstructionSize(context, permit_fuse_idioms));
+  }
+
+  llvm::CallingConv::ID DefaultCallingConv(void) const final {
+    return native->DefaultCallingConv();
+  }
+
+  llvm::Triple Triple(void) const final {
+    return native->Triple();
+  }
+
+  llvm::DataLayout DataLayout(void) const final {
+    return native->DataLayout();
+  }
+
+  bool MemoryAccessIsLittleEndian(void) const final {
+    return native->MemoryAccessIsLittleEndian();
+  }
+
+  bool MayHaveDelaySlot(const Instruction &inst) const final {
+    return native->MayHaveDelaySlot(inst);
+  }
+
+  bool NextInstructionIsDelayed(const Instruction &inst,
+                                const Instruction &next_inst,
+                                bool branch_taken_path) const final {
+    return native->NextInstructionIsDelayed(inst, next_inst,
+                                            branch_taken_path);
+  }
+
+  // The register tables of `native` and `fallback` were populated when they
+  // were built.
+  void PopulateRegisterTable(void) const final {}
+
+  void FinishLiftedFunctionInitialization(llvm::Module *module,
+                                          llvm::Function *bb_func) const final {
+    native->FinishLiftedFunctionInitialization(module, bb_func);
+  }
+
+  const Register *AddRegister(const char *reg_name, llvm::Type *val_type,
+                              size_t offset,
+                              const char *parent_reg_name) const final {
+    return native->AddRegister(reg_name, val_type, offset, parent_reg_name);
+  }
+
+ private:
+  HybridArch(void) = delete;
+
+  // Returns `true` if the semantics module has an implementation of the
+  // natively decoded `inst`. If no semantics module has been loaded yet, then
+  // we optimistically assume that it will.
+  bool HasSemantics(const Instruction &inst) const {
+    auto intrinsics = native->GetInstrinsicTable();
+    if (!intrinsics) {
+      return true;
+    }
+    auto module = intrinsics->error->getParent();
+    return nullptr != module->getNamedGlobal("ISEL_" + inst.function);
+  }
+
+  const ArchPtr native;
+  const ArchPtr fallback;
+};
+
+}  // namespace
+
+auto Arch::GetHybrid(llvm::LLVMContext *context_, OSName os_name_,
+                     ArchName arch_name_) -> ArchPtr {
+  const auto fallback_name = FallbackArchName(arch_name_);
+  if (kArchInvalid == fallback_name) {
+    LOG(ERROR) << "No SLEIGH fallback for architecture "
+               << GetArchName(arch_name_);
+    return nullptr;
+  }
+
+  auto native = Arch::Build(context_, os_name_, arch_name_);
+  auto fallback = Arch::Build(context_, os_name_, fallback_name);
+  if (!native || !fallback) {
+    return nullptr;
+  }
+
+  DLOG(INFO) << "Using architecture: " << GetArchName(arch_name_)
+             << " with fallback " << GetArchName(fallback_name);
+  return std::make_unique<HybridArch>(std::move(native), std::move(fallback));
+}
+
+}  // namespace remill
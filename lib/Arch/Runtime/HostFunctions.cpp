@@ -0,0 +1,105 @@
+/*
+ * Copyright (c) 2026 Trail of Bits, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "remill/Arch/Runtime/Intrinsics.h"
+
+// Implementations of the C library functions that
+// `HostFunctionMatcher::AddLibC` recognizes. They run on the host in place
+// of the guest's own, and access guest memory through the memory intrinsics,
+// so that they work with whatever memory model the runtime implements.
+//
+// The arguments and return values are those of the guest functions, widened
+// to 64 bits (see `DefineHostFunctionShim`).
+
+extern "C" {
+
+[[gnu::used]] Memory *__remill_host_memcpy(Memory *memory, uint64_t *ret,
+                                           uint64_t dst, uint64_t src,
+                                           uint64_t size) {
+  const auto dst_addr = static_cast<addr_t>(dst);
+  const auto src_addr = static_cast<addr_t>(src);
+  for (addr_t i = 0; i < static_cast<addr_t>(size); ++i) {
+    memory = __remill_write_memory_8(
+        memory, dst_addr + i, __remill_read_memory_8(memory, src_addr + i));
+  }
+  *ret = dst;
+  return memory;
+}
+
+[[gnu::used]] Memory *__remill_host_memmove(Memory *memory, uint64_t *ret,
+                                            uint64_t dst, uint64_t src,
+                                            uint64_t size) {
+  const auto dst_addr = static_cast<addr_t>(dst);
+  const auto src_addr = static_cast<addr_t>(src);
+  const auto num_bytes = static_cast<addr_t>(size);
+
+  // Copy backward if the destination overlaps the end of the source.
+  if (src_addr < dst_addr && dst_addr < src_addr + num_bytes) {
+    for (addr_t i = num_bytes; i > 0; --i) {
+      memory = __remill_write_memory_8(
+          memory, dst_addr + i - 1,
+          __remill_read_memory_8(memory, src_addr + i - 1));
+    }
+  } else {
+    for (addr_t i = 0; i < num_bytes; ++i) {
+      memory = __remill_write_memory_8(
+          memory, dst_addr + i, __remill_read_memory_8(memory, src_addr + i));
+    }
+  }
+  *ret = dst;
+  return memory;
+}
+
+[[gnu::used]] Memory *__remill_host_memset(Memory *memory, uint64_t *ret,
+                                           uint64_t dst, uint64_t val,
+                                           uint64_t size) {
+  const auto dst_addr = static_cast<addr_t>(dst);
+  const auto byte = static_cast<uint8_t>(val);
+  for (addr_t i = 0; i < static_cast<addr_t>(size); ++i) {
+    memory = __remill_write_memory_8(memory, dst_addr + i, byte);
+  }
+  *ret = dst;
+  return memory;
+}
+
+[[gnu::used]] Memory *__remill_host_strlen(Memory *memory, uint64_t *ret,
+                                           uint64_t str) {
+  const auto str_addr = static_cast<addr_t>(str);
+  addr_t len = 0;
+  while (__remill_read_memory_8(memory, str_addr + len)) {
+    ++len;
+  }
+  *ret = len;
+  return memory;
+}
+
+[[gnu::used]] Memory *__remill_host_strcmp(Memory *memory, uint64_t *ret,
+                                           uint64_t lhs, uint64_t rhs) {
+  const auto lhs_addr = static_cast<addr_t>(lhs);
+  const auto rhs_addr = static_cast<addr_t>(rhs);
+  for (addr_t i = 0;; ++i) {
+    const auto l = __remill_read_memory_8(memory, lhs_addr + i);
+    const auto r = __remill_read_memory_8(memory, rhs_addr + i);
+    if (l != r || !l) {
+
+      // The `int` result, sign-extended.
+      *ret = static_cast<uint64_t>(static_cast<int64_t>(int(l) - int(r)));
+      return memory;
+    }
+  }
+}
+
+}  // extern C
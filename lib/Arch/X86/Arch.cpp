@@ -442,7 +442,10 @@ static void DecodeMemory(Instruction &inst, const xed_decoded_inst_t *xedd,
     return XED_REG_DS;
   };
   auto ignore_segment = [&](auto segment_reg) {
-    // On AMD64, only the `FS` and `GS` segments are non-zero.
+    // On AMD64, memory is flat: only the `FS` and `GS` segments are non-zero,
+    // and so only their bases are modeled. Dropping all other segments here,
+    // including explicit overrides, means that the lifted address computation
+    // never mentions them.
     if (Is64Bit(inst.arch_name) && XED_REG_FS != segment_reg &&
         XED_REG_GS != segment_reg) {
       return XED_REG_INVALID;
@@ -522,7 +522,6 @@ void X86ArchBase::FinishLiftedFunctionInitialization(
 
   auto &context = module->getContext();
   auto addr = llvm::Type::getIntNTy(context, address_size);
-  auto zero_addr_val = llvm::Constant::getNullValue(addr);
 
   const auto entry_block = &bb_func->getEntryBlock();
   llvm::IRBuilder<> ir(entry_block);
@@ -533,11 +532,9 @@ void X86ArchBase::FinishLiftedFunctionInitialization(
 
   (void) this->RegisterByName("PC")->AddressOf(state_ptr_arg, ir);
 
-  if (64 == address_size) {
-    ir.CreateStore(zero_addr_val, ir.CreateAlloca(addr, nullptr, "CSBASE"));
-    ir.CreateStore(zero_addr_val, ir.CreateAlloca(addr, nullptr, "SSBASE"));
-    ir.CreateStore(zero_addr_val, ir.CreateAlloca(addr, nullptr, "ESBASE"));
-    ir.CreateStore(zero_addr_val, ir.CreateAlloca(addr, nullptr, "DSBASE"));
-  }
+  // NOTE: No segment base variables are created here. The segment bases are
+  //       registers of the `State` structure (see `PopulateRegisterTable`),
+  //       and on amd64 only `FSBASE` and `GSBASE` exist, because the decoder
+  //       drops every other segment from memory operands.
 }
 }  // namespace remill
\ No newline at end of file
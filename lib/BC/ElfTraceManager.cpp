@@ -0,0 +1,73 @@
+/*
+ * Copyright (c) 2026 Trail of Bits, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "remill/BC/ElfTraceManager.h"
+
+#include <llvm/IR/Function.h>
+
+#include <string>
+
+#include "remill/OS/ElfLoader.h"
+
+namespace remill {
+
+ElfTraceManager::~ElfTraceManager(void) {}
+
+ElfTraceManager::ElfTraceManager(const ElfImage &image_) : image(image_) {}
+
+// Name the trace at `addr` after the function symbol at `addr`, if any. The
+// default name stays as a prefix, so that symbols can't clash with the names
+// of intrinsics or of other functions in the semantics module.
+std::string ElfTraceManager::TraceName(uint64_t addr) {
+  auto name = TraceManager::TraceName(addr);
+  if (auto symbol = image.SymbolName(addr); !symbol.empty()) {
+    name += "_";
+    name += symbol;
+  }
+  return name;
+}
+
+void ElfTraceManager::SetLiftedTraceDefinition(uint64_t addr,
+                                               llvm::Function *lifted_func) {
+  traces[addr] = lifted_func;
+}
+
+llvm::Function *ElfTraceManager::GetLiftedTraceDeclaration(uint64_t addr) {
+  if (auto trace_it = traces.find(addr); trace_it != traces.end()) {
+    return trace_it->second;
+  } else {
+    return nullptr;
+  }
+}
+
+llvm::Function *ElfTraceManager::GetLiftedTraceDefinition(uint64_t addr) {
+  return GetLiftedTraceDeclaration(addr);
+}
+
+void ElfTraceManager::InvalidateLiftedTraceDefinition(uint64_t addr,
+                                                      llvm::Function *) {
+  traces.erase(addr);
+}
+
+bool ElfTraceManager::TryReadExecutableByte(uint64_t addr, uint8_t *byte) {
+  return image.TryReadExecutableByte(addr, byte);
+}
+
+bool ElfTraceManager::TryReadReadOnlyByte(uint64_t addr, uint8_t *byte) {
+  return image.TryReadReadOnlyByte(addr, byte);
+}
+
+}  // namespace remill
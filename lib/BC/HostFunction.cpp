@@ -0,0 +1,243 @@
+/*
+ * Copyright (c) 2026 Trail of Bits, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "remill/BC/HostFunction.h"
+
+#include <glog/logging.h>
+#include <llvm/IR/BasicBlock.h>
+#include <llvm/IR/Constants.h>
+#include <llvm/IR/DerivedTypes.h>
+#include <llvm/IR/Function.h>
+#include <llvm/IR/IRBuilder.h>
+#include <llvm/IR/Instructions.h>
+#include <llvm/IR/Module.h>
+
+#include "remill/Arch/Arch.h"
+#include "remill/BC/ABI.h"
+#include "remill/BC/IntrinsicTable.h"
+#include "remill/BC/Util.h"
+
+namespace remill {
+namespace {
+
+// How the default calling convention of an architecture passes integer
+// arguments, returns integer values, and finds the return address.
+struct CallingConvention {
+
+  // Argument registers. If empty, then arguments are passed on the stack,
+  // right after the return address.
+  std::vector<std::string_view> arg_regs;
+  std::string_view ret_reg;
+
+  // Register holding the return address. If empty, then the return address
+  // is on the top of the stack.
+  std::string_view link_reg;
+};
+
+// Return the default calling convention of `arch`.
+static bool GetCallingConvention(const Arch *arch, CallingConvention &cc) {
+  if (arch->IsAMD64()) {
+    cc.arg_regs = {"RDI", "RSI", "RDX", "RCX", "R8", "R9"};
+    cc.ret_reg = "RAX";
+    return true;
+
+  } else if (arch->IsX86()) {
+    cc.ret_reg = "EAX";
+    return true;
+
+  } else if (arch->IsAArch64()) {
+    cc.arg_regs = {"X0", "X1", "X2", "X3", "X4", "X5", "X6", "X7"};
+    cc.ret_reg = "X0";
+    cc.link_reg = "X30";
+    return true;
+
+  } else {
+    return false;
+  }
+}
+
+}  // namespace
+
+void HostFunctionMatcher::AddAddress(uint64_t addr, HostFunction func) {
+  by_address[addr] = std::move(func);
+}
+
+void HostFunctionMatcher::AddSymbol(std::string symbol, HostFunction func) {
+  by_symbol[std::move(symbol)] = std::move(func);
+}
+
+void HostFunctionMatcher::AddSignature(std::string bytes, HostFunction func) {
+  CHECK(!bytes.empty()) << "Empty host function signature for "
+                        << func.name;
+  by_signature.emplace_back(std::move(bytes), std::move(func));
+}
+
+// Recognize the common string and memory functions of the C library.
+void HostFunctionMatcher::AddLibC(void) {
+  const std::pair<const char *, unsigned> funcs[] = {
+      {"memcpy", 3u}, {"memmove", 3u}, {"memset", 3u},
+      {"strlen", 1u}, {"strcmp", 2u}};
+  for (auto [symbol, num_args] : funcs) {
+    AddSymbol(symbol, {std::string("__remill_host_") + symbol, num_args});
+  }
+}
+
+// Return the host implementation of the guest function at `addr`.
+const HostFunction *HostFunctionMatcher::Match(
+    uint64_t addr, std::string_view symbol,
+    const std::function<bool(uint64_t, uint8_t *)> &read_byte) const {
+  if (auto it = by_address.find(addr); it != by_address.end()) {
+    return &(it->second);
+  }
+
+  if (auto it = by_symbol.find(std::string(symbol)); it != by_symbol.end()) {
+    return &(it->second);
+  }
+
+  std::string bytes;
+  for (const auto &[signature, func] : by_signature) {
+    while (bytes.size() < signature.size()) {
+      uint8_t byte = 0;
+      if (!read_byte(addr + bytes.size(), &byte)) {
+        break;
+      }
+      bytes.push_back(static_cast<char>(byte));
+    }
+    if (bytes.size() >= signature.size() &&
+        !bytes.compare(0, signature.size(), signature)) {
+      return &func;
+    }
+  }
+
+  return nullptr;
+}
+
+// Define the lifted function `func` as a shim that calls `host`.
+bool DefineHostFunctionShim(const Arch *arch, llvm::Function *func,
+                            const HostFunction &host) {
+  CHECK(func->isDeclaration());
+
+  CallingConvention cc;
+  if (!GetCallingConvention(arch, cc)) {
+    LOG(ERROR) << "No calling convention for host function " << host.name;
+    return false;
+  } else if (!cc.arg_regs.empty() && host.num_args > cc.arg_regs.size()) {
+    LOG(ERROR) << "Too many register arguments for host function "
+               << host.name;
+    return false;
+  }
+
+  const auto module = func->getParent();
+  const auto intrinsics = arch->GetInstrinsicTable();
+  CHECK(intrinsics && intrinsics->error->getParent() == module)
+      << "Architecture must be initialized from the module containing "
+      << func->getName().str();
+
+  auto &context = module->getContext();
+  auto i64_type = llvm::Type::getInt64Ty(context);
+  auto word_type = llvm::Type::getIntNTy(context, arch->address_size);
+  const auto word_size = arch->address_size / 8u;
+  auto state = NthArgument(func, kStatePointerArgNum);
+  auto memory = NthArgument(func, kMemoryPointerArgNum);
+
+  llvm::IRBuilder<> ir(llvm::BasicBlock::Create(context, "", func));
+  auto ret_val = ir.CreateAlloca(i64_type, nullptr, "host_ret");
+
+  auto get_reg = [=](std::string_view name) {
+    auto reg = arch->RegisterByName(name);
+    CHECK(reg) << "Missing register " << name << " for host function shim";
+    return reg;
+  };
+
+  // The memory pointer, which the host function replaces.
+  llvm::Value *curr_memory = memory;
+
+  auto read_word = [&](llvm::Value *addr) -> llvm::Value * {
+    llvm::Value *args[] = {curr_memory, addr};
+    return ir.CreateCall(64u == arch->address_size ? intrinsics->read_memory_64
+                                                   : intrinsics->read_memory_32,
+                         args);
+  };
+
+  auto sp_reg = get_reg(arch->StackPointerRegisterName());
+  auto sp_ref = sp_reg->AddressOf(state, ir);
+  auto sp = ir.CreateZExtOrTrunc(ir.CreateLoad(sp_reg->type, sp_ref),
+                                 word_type);
+
+  // Read the arguments, either from registers, or from the stack slots just
+  // above the return address.
+  std::vector<llvm::Value *> args;
+  args.push_back(memory);
+  args.push_back(ret_val);
+  for (auto i = 0u; i < host.num_args; ++i) {
+    llvm::Value *arg = nullptr;
+    if (!cc.arg_regs.empty()) {
+      auto reg = get_reg(cc.arg_regs[i]);
+      arg = ir.CreateLoad(reg->type, reg->AddressOf(state, ir));
+    } else {
+      arg = read_word(
+          ir.CreateAdd(sp, llvm::ConstantInt::get(word_type,
+                                                  (i + 1u) * word_size)));
+    }
+    args.push_back(ir.CreateZExtOrTrunc(arg, i64_type));
+  }
+
+  std::vector<llvm::Type *> param_types(host.num_args + 2u, i64_type);
+  param_types[0] = memory->getType();
+  param_types[1] = ret_val->getType();
+  auto host_func = module->getOrInsertFunction(
+      host.name,
+      llvm::FunctionType::get(memory->getType(), param_types, false));
+  curr_memory = ir.CreateCall(host_func, args);
+
+  auto ret_reg = get_reg(cc.ret_reg);
+  ir.CreateStore(
+      ir.CreateZExtOrTrunc(ir.CreateLoad(i64_type, ret_val), ret_reg->type),
+      ret_reg->AddressOf(state, ir));
+
+  // Return to the caller, like a return instruction would.
+  llvm::Value *ret_addr = nullptr;
+  if (!cc.link_reg.empty()) {
+    auto link_reg = get_reg(cc.link_reg);
+    ret_addr = ir.CreateZExtOrTrunc(
+        ir.CreateLoad(link_reg->type, link_reg->AddressOf(state, ir)),
+        word_type);
+  } else {
+    ret_addr = read_word(sp);
+    ir.CreateStore(
+        ir.CreateZExtOrTrunc(
+            ir.CreateAdd(sp, llvm::ConstantInt::get(word_type, word_size)),
+            sp_reg->type),
+        sp_ref);
+  }
+
+  auto pc_reg = get_reg(arch->ProgramCounterRegisterName());
+  ir.CreateStore(ir.CreateZExtOrTrunc(ret_addr, pc_reg->type),
+                 pc_reg->AddressOf(state, ir));
+
+  llvm::Value *ret_args[kNumBlockArgs];
+  ret_args[kStatePointerArgNum] = state;
+  ret_args[kPCArgNum] = ret_addr;
+  ret_args[kMemoryPointerArgNum] = curr_memory;
+  auto ret = ir.CreateCall(intrinsics->function_return, ret_args);
+  ret->setTailCall(true);
+  ir.CreateRet(ret);
+
+  InitFunctionAttributes(func);
+  return true;
+}
+
+}  // namespace remill
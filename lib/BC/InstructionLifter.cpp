@@ -822,8 +822,13 @@ llvm::Value *InstructionLifter::LiftAddressOperand(Instruction &inst,
 
   llvm::IRBuilder<> ir(block);
 
+  // Don't bother emitting multiplications by one or additions to zero; e.g.
+  // a `[index*1 + disp]` operand becomes a single `add`.
   if (zero != index) {
-    addr = ir.CreateAdd(addr, ir.CreateMul(index, scale));
+    if (1 != arch_addr.scale) {
+      index = ir.CreateMul(index, scale);
+    }
+    addr = zero != addr ? ir.CreateAdd(addr, index) : index;
   }
 
   if (arch_addr.displacement) {
@@ -840,7 +845,7 @@ llvm::Value *InstructionLifter::LiftAddressOperand(Instruction &inst,
 
   // Compute the segmented address.
   if (zero != segment) {
-    addr = ir.CreateAdd(addr, segment);
+    addr = zero != addr ? ir.CreateAdd(addr, segment) : segment;
   }
 
   // Memory address is smaller than the machine word size (e.g. 32-bit address
@@ -0,0 +1,897 @@
+/*
+ * Copyright (c) 2026 Trail of Bits, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "remill/BC/Interpreter.h"
+
+#include <glog/logging.h>
+#include <llvm/IR/BasicBlock.h>
+#include <llvm/IR/Constants.h>
+#include <llvm/IR/DataLayout.h>
+#include <llvm/IR/DerivedTypes.h>
+#include <llvm/IR/Function.h>
+#include <llvm/IR/GlobalVariable.h>
+#include <llvm/IR/IRBuilder.h>
+#include <llvm/IR/Instructions.h>
+#include <llvm/IR/Module.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "remill/Arch/Arch.h"
+#include "remill/Arch/Instruction.h"
+#include "remill/BC/ABI.h"
+#include "remill/BC/IntrinsicTable.h"
+#include "remill/BC/Util.h"
+
+namespace remill {
+namespace {
+
+// The handlers compute field addresses from these layouts.
+static_assert(sizeof(InterpreterOperand) == 40,
+              "Unexpected layout of `InterpreterOperand`");
+static_assert(sizeof(InterpreterInstruction) == 32,
+              "Unexpected layout of `InterpreterInstruction`");
+static_assert(alignof(InterpreterOperand) == 8 &&
+                  alignof(InterpreterInstruction) == 8,
+              "Interpreter records must be word-aligned");
+
+static const char kHandlerPrefix[] = "__remill_interpret_";
+static const char kLoadFunctionName[] = "__remill_interpret_load";
+
+// Maximum number of instructions in a decoded block.
+static constexpr size_t kMaxBlockInstructions = 256;
+
+// Return the semantics function of the instruction selection variable
+// `isel`, if any.
+static llvm::Function *GetSemanticsFunction(llvm::GlobalVariable *isel) {
+  if (!isel || !isel->isConstant() || !isel->hasInitializer()) {
+    return nullptr;
+  }
+  return llvm::dyn_cast<llvm::Function>(
+      isel->getInitializer()->stripPointerCasts());
+}
+
+// LLVM on AArch64 and on amd64 Windows converts things like `RnW<uint64_t>`,
+// which is a struct containing a `uint64_t *`, into a `uintptr_t` when they
+// are being passed as arguments. Return the type that the semantics function
+// really wants.
+static llvm::Type *IntendedArgumentType(llvm::Argument *arg) {
+  for (auto user : arg->users()) {
+    if (auto cast_inst = llvm::dyn_cast<llvm::IntToPtrInst>(user)) {
+      return cast_inst->getType();
+    }
+  }
+  return arg->getType();
+}
+
+// Return `true` if a handler can produce an argument of type `type`.
+static bool IsSupportedArgumentType(llvm::Type *type) {
+  return type->isPointerTy() || type->isIntegerTy() ||
+         type->isFloatingPointTy();
+}
+
+// Return the address `offset` bytes into `base`.
+static llvm::Value *FieldAddress(llvm::IRBuilder<> &ir, llvm::Value *base,
+                                 uint64_t offset) {
+  return ir.CreateConstInBoundsGEP1_64(ir.getInt8Ty(), base, offset);
+}
+
+// Load the `type`-typed field `offset` bytes into `base`.
+static llvm::Value *LoadField(llvm::IRBuilder<> &ir, llvm::Type *type,
+                              llvm::Value *base, uint64_t offset) {
+  return ir.CreateLoad(type, FieldAddress(ir, base, offset));
+}
+
+// Return the function that zero-extends the `size`-byte value at an address
+// to 64 bits. A `size` of zero produces zero, and values that are bigger than
+// eight bytes are truncated, which matches how lifted code passes wide
+// registers to narrower integer operands.
+static llvm::Function *GetLoadFunction(llvm::Module *module) {
+  if (auto func = module->getFunction(kLoadFunctionName)) {
+    return func;
+  }
+
+  auto &context = module->getContext();
+  auto i64_type = llvm::Type::getInt64Ty(context);
+  auto ptr_type = llvm::PointerType::get(context, 0);
+  auto func_type = llvm::FunctionType::get(i64_type, {ptr_type, i64_type},
+                                           false);
+  auto func =
+      llvm::Function::Create(func_type, llvm::GlobalValue::InternalLinkage,
+                             kLoadFunctionName, module);
+  func->addFnAttr(llvm::Attribute::AlwaysInline);
+
+  auto addr = NthArgument(func, 0);
+  auto size = NthArgument(func, 1);
+  auto entry = llvm::BasicBlock::Create(context, "", func);
+  auto wide = llvm::BasicBlock::Create(context, "", func);
+
+  llvm::IRBuilder<> ir(wide);
+  ir.CreateRet(ir.CreateLoad(i64_type, addr));
+
+  ir.SetInsertPoint(entry);
+  auto switch_inst = ir.CreateSwitch(size, wide, 4);
+  for (auto num_bytes : {0u, 1u, 2u, 4u}) {
+    auto block = llvm::BasicBlock::Create(context, "", func);
+    switch_inst->addCase(ir.getInt64(num_bytes), block);
+    ir.SetInsertPoint(block);
+    if (!num_bytes) {
+      ir.CreateRet(ir.getInt64(0));
+    } else {
+      auto val = ir.CreateLoad(ir.getIntNTy(num_bytes * 8u), addr);
+      ir.CreateRet(ir.CreateZExt(val, i64_type));
+    }
+  }
+  return func;
+}
+
+// Builds the handlers of the semantics functions of a module.
+class HandlerBuilder {
+ public:
+  HandlerBuilder(const Arch *arch_, llvm::Module *module_);
+
+  // Define the handler `name` for `sem`. Returns `nullptr` if one of the
+  // arguments of `sem` can't be produced from an `InterpreterOperand`.
+  llvm::Function *Build(llvm::Function *sem, const std::string &name);
+
+ private:
+  HandlerBuilder(void) = delete;
+
+  // Return the value of the argument `arg` of a semantics function, given the
+  // operand at `op`.
+  llvm::Value *LoadOperand(llvm::IRBuilder<> &ir, llvm::Argument *arg,
+                           llvm::Value *op);
+
+  // Return the floating point value of type `type` of the register at
+  // `reg_ptr`, converting it from the type of that register.
+  llvm::Value *LoadFloatOperand(llvm::IRBuilder<> &ir, llvm::Type *type,
+                                llvm::Value *op, llvm::Value *reg_ptr);
+
+  // Call `intrinsic` on `memory` if the instruction is an atomic
+  // read-modify-write, and return the resulting memory pointer.
+  llvm::Value *CallIfAtomic(llvm::IRBuilder<> &ir, llvm::Function *intrinsic,
+                            llvm::Value *is_atomic, llvm::Value *memory);
+
+  const Arch *const arch;
+  llvm::Module *const module;
+  llvm::LLVMContext &context;
+  const IntrinsicTable *const intrinsics;
+  const Register *const pc_reg;
+  llvm::Function *const load_func;
+  llvm::PointerType *const ptr_type;
+  llvm::FunctionType *const handler_type;
+
+  // Arguments of the handler being built.
+  llvm::Value *state{nullptr};
+  llvm::Value *locals{nullptr};
+};
+
+HandlerBuilder::HandlerBuilder(const Arch *arch_, llvm::Module *module_)
+    : arch(arch_),
+      module(module_),
+      context(module->getContext()),
+      intrinsics(arch->GetInstrinsicTable()),
+      pc_reg(arch->RegisterByName(kPCVariableName)),
+      load_func(GetLoadFunction(module)),
+      ptr_type(llvm::PointerType::get(context, 0)),
+      handler_type(llvm::FunctionType::get(
+          ptr_type, {ptr_type, ptr_type, ptr_type, ptr_type}, false)) {
+  CHECK(intrinsics && intrinsics->error->getParent() == module)
+      << "Architecture must be initialized from the semantics module to "
+      << "which interpreter handlers are added";
+  CHECK(pc_reg && pc_reg->type->isIntegerTy())
+      << "Architecture has no integral program counter register";
+}
+
+// Define the handler `name` for `sem`.
+llvm::Function *HandlerBuilder::Build(llvm::Function *sem,
+                                      const std::string &name) {
+  const auto num_params = sem->getFunctionType()->getNumParams();
+  if (num_params < 2) {
+    return nullptr;
+  }
+  for (auto i = 2u; i < num_params; ++i) {
+    if (!IsSupportedArgumentType(IntendedArgumentType(NthArgument(sem, i)))) {
+      return nullptr;
+    }
+  }
+
+  auto func = module->getFunction(name);
+  if (func && !func->isDeclaration()) {
+    return func;  // Another selection of the same instruction.
+  } else if (!func) {
+    func = llvm::Function::Create(
+        handler_type, llvm::GlobalValue::ExternalLinkage, name, module);
+  }
+
+  state = NthArgument(func, 0);
+  auto memory = NthArgument(func, 1);
+  auto inst = NthArgument(func, 2);
+  locals = NthArgument(func, 3);
+
+  llvm::IRBuilder<> ir(llvm::BasicBlock::Create(context, "", func));
+  auto i64_type = ir.getInt64Ty();
+  auto pc = LoadField(ir, i64_type, inst, offsetof(InterpreterInstruction, pc));
+  auto size =
+      LoadField(ir, i64_type, inst, offsetof(InterpreterInstruction, size));
+  auto flags =
+      LoadField(ir, i64_type, inst, offsetof(InterpreterInstruction, flags));
+
+  // `PC = pc; NEXT_PC = pc + size`, as at the start of every lifted
+  // instruction.
+  const auto addr_mask = ~0ull >> (64u - arch->address_size);
+  auto next_pc = ir.CreateAnd(ir.CreateAdd(pc, size), addr_mask);
+  ir.CreateStore(ir.CreateZExtOrTrunc(pc, pc_reg->type),
+                 FieldAddress(ir, state, pc_reg->offset));
+  ir.CreateStore(next_pc, FieldAddress(ir, locals,
+                                       offsetof(InterpreterLocals, next_pc)));
+
+  auto is_atomic = ir.CreateICmpNE(
+      ir.CreateAnd(flags, InterpreterInstruction::kAtomicReadModifyWrite),
+      ir.getInt64(0));
+
+  std::vector<llvm::Value *> args;
+  args.reserve(num_params);
+  args.push_back(CallIfAtomic(ir, intrinsics->atomic_begin, is_atomic, memory));
+  args.push_back(state);
+  for (auto i = 2u; i < num_params; ++i) {
+    auto op = FieldAddress(ir, inst,
+                           sizeof(InterpreterInstruction) +
+                               (i - 2u) * sizeof(InterpreterOperand));
+    args.push_back(LoadOperand(ir, NthArgument(sem, i), op));
+  }
+
+  // Call the function that implements the instruction semantics.
+  auto call = ir.CreateCall(sem, args);
+  call->setCallingConv(sem->getCallingConv());
+  ir.CreateRet(CallIfAtomic(ir, intrinsics->atomic_end, is_atomic, call));
+  return func;
+}
+
+// Call `intrinsic` on `memory` if the instruction is an atomic
+// read-modify-write, and return the resulting memory pointer.
+llvm::Value *HandlerBuilder::CallIfAtomic(llvm::IRBuilder<> &ir,
+                                          llvm::Function *intrinsic,
+                                          llvm::Value *is_atomic,
+                                          llvm::Value *memory) {
+  auto func = ir.GetInsertBlock()->getParent();
+  auto from_block = ir.GetInsertBlock();
+  auto atomic_block = llvm::BasicBlock::Create(context, "", func);
+  auto done_block = llvm::BasicBlock::Create(context, "", func);
+  ir.CreateCondBr(is_atomic, atomic_block, done_block);
+
+  ir.SetInsertPoint(atomic_block);
+  llvm::Value *args[] = {memory};
+  auto atomic_memory = ir.CreateCall(intrinsic, args);
+  ir.CreateBr(done_block);
+
+  ir.SetInsertPoint(done_block);
+  auto phi = ir.CreatePHI(memory->getType(), 2);
+  phi->addIncoming(memory, from_block);
+  phi->addIncoming(atomic_memory, atomic_block);
+  return phi;
+}
+
+// Return the value of the argument `arg` of a semantics function, given the
+// operand at `op`.
+llvm::Value *HandlerBuilder::LoadOperand(llvm::IRBuilder<> &ir,
+                                         llvm::Argument *arg,
+                                         llvm::Value *op) {
+  const auto real_type = arg->getType();
+  const auto type = IntendedArgumentType(arg);
+  auto i8_type = ir.getInt8Ty();
+  auto i32_type = ir.getInt32Ty();
+  auto i64_type = ir.getInt64Ty();
+
+  // Address of the register operand, or of the base register of an address
+  // operand.
+  auto base_is_local = ir.CreateICmpNE(
+      LoadField(ir, i8_type, op, offsetof(InterpreterOperand, base_is_local)),
+      ir.getInt8(0));
+  auto base_ptr = ir.CreateInBoundsGEP(
+      i8_type, ir.CreateSelect(base_is_local, locals, state),
+      ir.CreateZExt(
+          LoadField(ir, i32_type, op, offsetof(InterpreterOperand, base)),
+          i64_type));
+
+  if (type->isPointerTy()) {
+    if (real_type->isIntegerTy()) {
+      return ir.CreatePtrToInt(base_ptr, real_type);
+    }
+    return base_ptr;
+
+  } else if (type->isFloatingPointTy()) {
+    return LoadFloatOperand(ir, type, op, base_ptr);
+
+  // Only registers are this wide, and the interpreter checks that they are
+  // exactly as wide as `type`.
+  } else if (type->getIntegerBitWidth() > 64u) {
+    return ir.CreateLoad(type, base_ptr);
+  }
+
+  auto load_sized = [&](llvm::Value *ptr, size_t size_offset) {
+    llvm::Value *args[] = {
+        ptr, ir.CreateZExt(LoadField(ir, i8_type, op, size_offset), i64_type)};
+    return ir.CreateCall(load_func, args);
+  };
+
+  auto load_state_reg = [&](size_t offset_offset, size_t size_offset) {
+    auto ptr = ir.CreateInBoundsGEP(
+        i8_type, state,
+        ir.CreateZExt(LoadField(ir, i32_type, op, offset_offset), i64_type));
+    return load_sized(ptr, size_offset);
+  };
+
+  auto base = load_sized(base_ptr, offsetof(InterpreterOperand, base_size));
+  auto index = load_state_reg(offsetof(InterpreterOperand, index),
+                              offsetof(InterpreterOperand, index_size));
+  auto segment = load_state_reg(offsetof(InterpreterOperand, segment),
+                                offsetof(InterpreterOperand, segment_size));
+  auto scale =
+      LoadField(ir, i64_type, op, offsetof(InterpreterOperand, scale));
+  auto imm = LoadField(ir, i64_type, op, offsetof(InterpreterOperand, imm));
+
+  // `base + index * scale + disp + segment`, truncated to the address size.
+  // The shift is masked so that a 64-bit address keeps all of its bits.
+  auto addr = ir.CreateAdd(
+      ir.CreateAdd(ir.CreateAdd(base, ir.CreateMul(index, scale)), imm),
+      segment);
+  auto addr_size = ir.CreateZExt(
+      LoadField(ir, i32_type, op, offsetof(InterpreterOperand, size)),
+      i64_type);
+  auto addr_mask = ir.CreateLShr(
+      ir.getInt64(~0ull),
+      ir.CreateAnd(ir.CreateSub(ir.getInt64(64), addr_size), 63));
+  addr = ir.CreateAnd(addr, addr_mask);
+
+  auto kind = LoadField(ir, i8_type, op, offsetof(InterpreterOperand, kind));
+  auto val = ir.CreateSelect(
+      ir.CreateICmpEQ(kind, ir.getInt8(InterpreterOperand::kImmediate)), imm,
+      ir.CreateSelect(
+          ir.CreateICmpEQ(kind, ir.getInt8(InterpreterOperand::kAddress)),
+          addr, base));
+
+  return ir.CreateZExtOrTrunc(val, type);
+}
+
+// Return the floating point value of type `type` of the register at
+// `reg_ptr`, converting it from the type of that register. The interpreter
+// checks that the register is a `float`, a `double`, or of type `type`.
+llvm::Value *HandlerBuilder::LoadFloatOperand(llvm::IRBuilder<> &ir,
+                                              llvm::Type *type,
+                                              llvm::Value *op,
+                                              llvm::Value *reg_ptr) {
+  auto func = ir.GetInsertBlock()->getParent();
+  auto same_block = llvm::BasicBlock::Create(context, "", func);
+  auto done_block = llvm::BasicBlock::Create(context, "", func);
+
+  auto reg_size = LoadField(ir, ir.getInt8Ty(), op,
+                            offsetof(InterpreterOperand, base_size));
+  auto switch_inst = ir.CreateSwitch(reg_size, same_block, 2);
+
+  ir.SetInsertPoint(done_block);
+  auto phi = ir.CreatePHI(type, 3);
+
+  for (auto reg_type : {ir.getFloatTy(), ir.getDoubleTy()}) {
+    auto block = llvm::BasicBlock::Create(context, "", func, done_block);
+    switch_inst->addCase(
+        ir.getInt8(static_cast<uint8_t>(reg_type->getPrimitiveSizeInBits() /
+                                        8u)),
+        block);
+    ir.SetInsertPoint(block);
+    phi->addIncoming(ir.CreateFPCast(ir.CreateLoad(reg_type, reg_ptr), type),
+                     block);
+    ir.CreateBr(done_block);
+  }
+
+  ir.SetInsertPoint(same_block);
+  phi->addIncoming(ir.CreateLoad(type, reg_ptr), same_block);
+  ir.CreateBr(done_block);
+
+  ir.SetInsertPoint(done_block);
+  return phi;
+}
+
+// A run of straight-line instructions, ending at a control flow instruction.
+struct DecodedBlock {
+  struct Step {
+    InterpreterHandler handler;
+    const InterpreterInstruction *inst;
+    uint64_t pc;
+  };
+
+  uint64_t pc{0};
+
+  // One past the last instruction byte of this block.
+  uint64_t end_pc{0};
+
+  // Category of the last instruction.
+  Instruction::Category category{Instruction::kCategoryInvalid};
+
+  // Back-to-back `InterpreterInstruction`s and their `InterpreterOperand`s.
+  std::vector<uint64_t> records;
+
+  std::vector<Step> steps;
+
+  // The most recent successors of this block, most recent first, so that
+  // following a branch usually skips the block cache.
+  DecodedBlock *successors[2]{nullptr, nullptr};
+};
+
+// Append `val` to `records`.
+template <typename T>
+static void AppendRecord(std::vector<uint64_t> &records, const T &val) {
+  static_assert(!(sizeof(T) % sizeof(uint64_t)),
+                "Interpreter records must be a whole number of words");
+  const auto offset = records.size();
+  records.resize(offset + sizeof(T) / sizeof(uint64_t));
+  memcpy(&(records[offset]), &val, sizeof(T));
+}
+
+}  // namespace
+
+// Return the name of the handler for the instruction semantics `isel`.
+std::string InterpreterHandlerName(std::string_view isel) {
+  std::string name(kHandlerPrefix);
+  name.append(isel.data(), isel.size());
+  return name;
+}
+
+// Define a handler for every instruction semantics function in `module`.
+unsigned AddInterpreterHandlers(const Arch *arch, llvm::Module *module) {
+  std::vector<std::pair<std::string, llvm::Function *>> isels;
+  for (auto &global : module->globals()) {
+    const auto name = global.getName();
+    if (!name.startswith("ISEL_")) {
+      continue;
+    }
+    if (auto sem = GetSemanticsFunction(&global)) {
+      isels.emplace_back(name.substr(5).str(), sem);
+    }
+  }
+
+  HandlerBuilder builder(arch, module);
+  auto num_handlers = 0u;
+  for (const auto &[isel, sem] : isels) {
+    if (builder.Build(sem, InterpreterHandlerName(isel))) {
+      ++num_handlers;
+    } else {
+      DLOG(WARNING) << "Can't build an interpreter handler for " << isel;
+    }
+  }
+  return num_handlers;
+}
+
+class Interpreter::Impl {
+ public:
+  Impl(const Arch *arch_,
+       std::function<InterpreterHandler(const std::string &)> resolve_handler_,
+       std::function<bool(uint64_t, uint8_t *)> read_byte_);
+
+  // Return the cached block at `pc`, decoding it if need be.
+  DecodedBlock *GetOrDecodeBlock(uint64_t pc);
+
+  // Return the block at `pc` that follows `block`, preferably through the
+  // successors of `block`.
+  DecodedBlock *GetNextBlock(DecodedBlock *block, uint64_t pc);
+
+  // Decode the block at `pc`. Returns `nullptr` if not even the first
+  // instruction of the block can be interpreted.
+  std::unique_ptr<DecodedBlock> DecodeBlock(uint64_t pc);
+
+  // Read the bytes of the instruction at `pc` into `inst_bytes`.
+  bool ReadInstructionBytes(uint64_t pc);
+
+  // Append the records of `inst` to `block`.
+  bool EncodeInstruction(const Instruction &inst, DecodedBlock &block);
+
+  // Encode the operand `op` of `inst`, which is passed to `arg`.
+  bool EncodeOperand(const Instruction &inst, const Operand &op,
+                     llvm::Argument *arg, InterpreterOperand &enc);
+
+  // Encode the location of the register `name`.
+  bool EncodeRegister(const std::string &name, uint32_t &offset,
+                      uint8_t &size, uint8_t &is_local);
+
+  // Return the compiled handler for the semantics `isel`.
+  InterpreterHandler GetHandler(const std::string &isel);
+
+  // Store `pc` into the program counter register of `state`.
+  void StoreProgramCounter(void *state, uint64_t pc) const;
+
+  const Arch *const arch;
+  llvm::Module *const semantics;
+  const std::function<InterpreterHandler(const std::string &)>
+      resolve_handler;
+  const std::function<bool(uint64_t, uint8_t *)> read_byte;
+  const uint64_t addr_mask;
+  const uint64_t max_inst_bytes;
+  const Register *const pc_reg;
+
+  std::string inst_bytes;
+
+  // Compiled handlers, by semantics function. Handlers that can't be
+  // resolved are cached as `nullptr`.
+  std::unordered_map<std::string, InterpreterHandler> handlers;
+
+  std::unordered_map<uint64_t, std::unique_ptr<DecodedBlock>> blocks;
+};
+
+Interpreter::Impl::Impl(
+    const Arch *arch_,
+    std::function<InterpreterHandler(const std::string &)> resolve_handler_,
+    std::function<bool(uint64_t, uint8_t *)> read_byte_)
+    : arch(arch_),
+      semantics(arch->GetInstrinsicTable()
+                    ? arch->GetInstrinsicTable()->error->getParent()
+                    : nullptr),
+      resolve_handler(std::move(resolve_handler_)),
+      read_byte(std::move(read_byte_)),
+      addr_mask(~0ull >> (64u - arch->address_size)),
+      max_inst_bytes(
+          arch->MaxInstructionSize(arch->CreateInitialContext(), true)),
+      pc_reg(arch->RegisterByName(kPCVariableName)) {
+  CHECK(semantics)
+      << "Architecture must be initialized from a semantics module before "
+      << "it can be interpreted";
+  CHECK(pc_reg) << "Architecture has no program counter register";
+}
+
+// Read the bytes of the instruction at `pc` into `inst_bytes`.
+bool Interpreter::Impl::ReadInstructionBytes(uint64_t pc) {
+  inst_bytes.clear();
+  for (uint64_t i = 0; i < max_inst_bytes; ++i) {
+    const auto byte_addr = (pc + i) & addr_mask;
+    if (byte_addr < pc) {
+      break;  // 32- or 64-bit address overflow.
+    }
+    uint8_t byte = 0;
+    if (!read_byte(byte_addr, &byte)) {
+      break;
+    }
+    inst_bytes.push_back(static_cast<char>(byte));
+  }
+  return !inst_bytes.empty();
+}
+
+// Return the compiled handler for the semantics `isel`.
+InterpreterHandler Interpreter::Impl::GetHandler(const std::string &isel) {
+  auto [it, added] = handlers.emplace(isel, nullptr);
+  if (added) {
+    it->second = resolve_handler(InterpreterHandlerName(isel));
+  }
+  return it->second;
+}
+
+// Encode the location of the register `name`.
+bool Interpreter::Impl::EncodeRegister(const std::string &name,
+                                       uint32_t &offset, uint8_t &size,
+                                       uint8_t &is_local) {
+  is_local = 1;
+  if (name == kNextPCVariableName) {
+    offset = offsetof(InterpreterLocals, next_pc);
+    size = static_cast<uint8_t>(arch->address_size / 8u);
+  } else if (name == kReturnPCVariableName) {
+    offset = offsetof(InterpreterLocals, return_pc);
+    size = static_cast<uint8_t>(arch->address_size / 8u);
+  } else if (name == "MONITOR") {
+    offset = offsetof(InterpreterLocals, monitor);
+    size = static_cast<uint8_t>(arch->address_size / 8u);
+  } else if (name == kBranchTakenVariableName) {
+    offset = offsetof(InterpreterLocals, branch_taken);
+    size = 1u;
+
+  } else if (auto reg = arch->RegisterByName(name)) {
+    is_local = 0;
+    offset = static_cast<uint32_t>(reg->offset);
+    size = static_cast<uint8_t>(reg->size);
+
+  } else {
+    return false;
+  }
+  return true;
+}
+
+// Encode the operand `op` of `inst`, which is passed to `arg`.
+bool Interpreter::Impl::EncodeOperand(const Instruction &inst,
+                                      const Operand &op, llvm::Argument *arg,
+                                      InterpreterOperand &enc) {
+  const auto type = IntendedArgumentType(arg);
+  const auto is_narrow_int =
+      type->isIntegerTy() && type->getIntegerBitWidth() <= 64u;
+
+  switch (op.type) {
+    case Operand::kTypeImmediate:
+      if (!is_narrow_int) {
+        return false;
+      }
+      enc.kind = InterpreterOperand::kImmediate;
+      enc.size = 64u;
+      enc.imm = op.imm.val;
+      return true;
+
+    case Operand::kTypeRegister: {
+      if (op.size != op.reg.size ||
+          !EncodeRegister(op.reg.name, enc.base, enc.base_size,
+                          enc.base_is_local)) {
+        return false;
+      }
+      enc.kind = enc.base_is_local ? InterpreterOperand::kLocal
+                                   : InterpreterOperand::kRegister;
+      enc.size = static_cast<uint32_t>(op.reg.size);
+
+      if (type->isPointerTy() || is_narrow_int) {
+        return true;
+
+      } else if (type->isIntegerTy()) {
+        return !enc.base_is_local &&
+               enc.base_size * 8u == type->getIntegerBitWidth();
+
+      // The handler converts from `float` and `double` registers, and
+      // otherwise expects the register to be of the argument's type.
+      } else if (type->isFloatingPointTy()) {
+        auto reg = arch->RegisterByName(op.reg.name);
+        return reg && reg->type->isFloatingPointTy() &&
+               (4u == reg->size || 8u == reg->size || reg->type == type);
+      }
+      return false;
+    }
+
+    case Operand::kTypeAddress: {
+      if (!is_narrow_int) {
+        return false;
+      }
+      enc.kind = InterpreterOperand::kAddress;
+      enc.size = static_cast<uint32_t>(
+          std::min<uint64_t>(op.addr.address_size ? op.addr.address_size
+                                                  : arch->address_size,
+                             arch->address_size));
+      enc.scale = op.addr.scale;
+      enc.imm = static_cast<uint64_t>(op.addr.displacement);
+
+      // The base register may be `NEXT_PC`, e.g. for PC-relative addresses.
+      if (!op.addr.base_reg.name.empty() &&
+          !EncodeRegister(op.addr.base_reg.name, enc.base, enc.base_size,
+                          enc.base_is_local)) {
+        return false;
+      }
+
+      uint8_t is_local = 0;
+      if (!op.addr.index_reg.name.empty() &&
+          (!EncodeRegister(op.addr.index_reg.name, enc.index, enc.index_size,
+                           is_local) ||
+           is_local)) {
+        return false;
+      }
+
+      // Like lifted code, treat unknown segment base registers as zero.
+      if (auto reg = arch->RegisterByName(op.addr.segment_base_reg.name)) {
+        enc.segment = static_cast<uint32_t>(reg->offset);
+        enc.segment_size = static_cast<uint8_t>(reg->size);
+      }
+      return true;
+    }
+
+    default:
+      DLOG(WARNING) << "Can't interpret operand " << op.Serialize()
+                    << " of instruction at " << std::hex << inst.pc
+                    << std::dec;
+      return false;
+  }
+}
+
+// Append the records of `inst` to `block`.
+bool Interpreter::Impl::EncodeInstruction(const Instruction &inst,
+                                          DecodedBlock &block) {
+  if (arch->MayHaveDelaySlot(inst)) {
+    return false;
+  }
+
+  auto sem = GetSemanticsFunction(
+      semantics->getNamedGlobal("ISEL_" + inst.function));
+  if (!sem || sem->arg_size() != inst.operands.size() + 2u) {
+    return false;
+  }
+
+  auto handler = GetHandler(inst.function);
+  if (!handler) {
+    return false;
+  }
+
+  std::vector<InterpreterOperand> operands(inst.operands.size());
+  for (size_t i = 0; i < operands.size(); ++i) {
+    operands[i] = {};
+    if (!EncodeOperand(inst, inst.operands[i],
+                       NthArgument(sem, i + 2u), operands[i])) {
+      return false;
+    }
+  }
+
+  InterpreterInstruction record = {};
+  record.pc = inst.pc;
+  record.size = inst.bytes.size();
+  record.flags = inst.is_atomic_read_modify_write
+                     ? InterpreterInstruction::kAtomicReadModifyWrite
+                     : 0u;
+  record.num_operands = operands.size();
+
+  // Remember the offset of the record for now, and turn it into a pointer
+  // once `records` is done growing.
+  const auto offset = block.records.size();
+  AppendRecord(block.records, record);
+  for (const auto &enc : operands) {
+    AppendRecord(block.records, enc);
+  }
+  block.steps.push_back({handler,
+                         reinterpret_cast<const InterpreterInstruction *>(
+                             static_cast<uintptr_t>(offset)),
+                         inst.pc});
+  return true;
+}
+
+// Decode the block at `pc`.
+std::unique_ptr<DecodedBlock> Interpreter::Impl::DecodeBlock(uint64_t pc) {
+  auto block = std::make_unique<DecodedBlock>();
+  block->pc = pc;
+  block->end_pc = pc;
+
+  Instruction inst;
+  while (block->steps.size() < kMaxBlockInstructions) {
+    if (!ReadInstructionBytes(pc)) {
+      break;
+    }
+
+    inst.Reset();
+    if (!arch->DecodeInstruction(pc, inst_bytes, inst,
+                                 arch->CreateInitialContext()) ||
+        !inst.IsValid() || !EncodeInstruction(inst, *block)) {
+      DLOG(INFO) << "Can't interpret instruction at " << std::hex << pc
+                 << std::dec;
+      break;
+    }
+
+    block->end_pc = std::max(block->end_pc, pc + inst.bytes.size());
+    block->category = inst.category;
+    pc = (pc + inst.bytes.size()) & addr_mask;
+    if (inst.IsControlFlow() || inst.IsError()) {
+      break;
+    }
+  }
+
+  if (block->steps.empty()) {
+    return nullptr;
+  }
+
+  for (auto &step : block->steps) {
+    const auto offset = reinterpret_cast<uintptr_t>(step.inst);
+    step.inst = reinterpret_cast<const InterpreterInstruction *>(
+        &(block->records[offset]));
+  }
+  return block;
+}
+
+// Return the cached block at `pc`, decoding it if need be.
+DecodedBlock *Interpreter::Impl::GetOrDecodeBlock(uint64_t pc) {
+  auto block_it = blocks.find(pc);
+  if (block_it != blocks.end()) {
+    return block_it->second.get();
+  }
+
+  auto block = DecodeBlock(pc);
+  if (!block) {
+    return nullptr;
+  }
+  auto decoded_block = block.get();
+  blocks.emplace(pc, std::move(block));
+  return decoded_block;
+}
+
+// Return the block at `pc` that follows `block`.
+DecodedBlock *Interpreter::Impl::GetNextBlock(DecodedBlock *block,
+                                              uint64_t pc) {
+  auto &successors = block->successors;
+  if (successors[0] && successors[0]->pc == pc) {
+    return successors[0];
+  } else if (successors[1] && successors[1]->pc == pc) {
+    std::swap(successors[0], successors[1]);
+    return successors[0];
+  }
+
+  auto next_block = GetOrDecodeBlock(pc);
+  if (next_block) {
+    successors[1] = successors[0];
+    successors[0] = next_block;
+  }
+  return next_block;
+}
+
+// Store `pc` into the program counter register of `state`.
+//
+// NOTE: Assumes a little-endian host, like the `State` structure does.
+void Interpreter::Impl::StoreProgramCounter(void *state, uint64_t pc) const {
+  memcpy(static_cast<uint8_t *>(state) + pc_reg->offset, &pc,
+         std::min<uint64_t>(pc_reg->size, sizeof(pc)));
+}
+
+Interpreter::~Interpreter(void) {}
+
+Interpreter::Interpreter(
+    const Arch *arch,
+    std::function<InterpreterHandler(const std::string &)> resolve_handler,
+    std::function<bool(uint64_t, uint8_t *)> read_byte)
+    : impl(new Impl(arch, std::move(resolve_handler), std::move(read_byte))) {}
+
+// Execute the code starting at `pc` on `state` and `memory`.
+InterpreterExit Interpreter::Run(void *state, void *&memory, uint64_t &pc,
+                                 uint64_t max_instructions) {
+  InterpreterLocals locals = {};
+  uint64_t num_executed = 0;
+  InterpreterExit exit = InterpreterExit::kUninterpretable;
+
+  for (auto block = impl->GetOrDecodeBlock(pc);
+       block; block = impl->GetNextBlock(block, pc)) {
+    if (num_executed >= max_instructions) {
+      exit = InterpreterExit::kMaxInstructions;
+      break;
+    }
+
+    for (const auto &step : block->steps) {
+      memory = step.handler(state, memory, step.inst, &locals);
+    }
+    num_executed += block->steps.size();
+
+    if (Instruction::kCategoryError == block->category) {
+      pc = block->steps.back().pc;
+      exit = InterpreterExit::kError;
+      break;
+    }
+
+    pc = locals.next_pc & impl->addr_mask;
+    if (Instruction::kCategoryAsyncHyperCall == block->category ||
+        (Instruction::kCategoryConditionalAsyncHyperCall == block->category &&
+         locals.branch_taken)) {
+      exit = InterpreterExit::kAsyncHyperCall;
+      break;
+    }
+  }
+
+  impl->StoreProgramCounter(state, pc);
+  return exit;
+}
+
+// Forget the decoded blocks containing instruction bytes in `[begin, end)`.
+void Interpreter::Invalidate(uint64_t begin, uint64_t end) {
+  for (auto it = impl->blocks.begin(); it != impl->blocks.end();) {
+    const auto &block = it->second;
+    if (block->pc < end && begin < block->end_pc) {
+      it = impl->blocks.erase(it);
+    } else {
+      ++it;
+    }
+  }
+
+  // Surviving blocks may have been chained to forgotten ones.
+  for (auto &[pc, block] : impl->blocks) {
+    block->successors[0] = nullptr;
+    block->successors[1] = nullptr;
+  }
+}
+
+}  // namespace remill
@@ -22,6 +22,7 @@
 #include <llvm/IR/Instructions.h>
 #include <llvm/IR/Module.h>
 
+#include <string>
 #include <vector>
 
 #include "remill/BC/Util.h"
@@ -73,86 +74,103 @@ static llvm::Function *SetMemoryReadNone(llvm::Function *func) {
   return func;
 }
 
+// Find a pure intrinsic that doesn't touch the memory passed to it.
+static llvm::Function *FindReadNoneIntrinsic(llvm::Module *module,
+                                             const char *name) {
+  return SetMemoryReadNone(FindPureIntrinsic(module, name));
+}
+
+// Every member of `IntrinsicTable` that names an intrinsic, in declaration
+// order, along with how the constructor finds `__remill_<member>`.
+#define REMILL_FOR_EACH_INTRINSIC(V) \
+  V(error, FindIntrinsic) \
+\
+  /* Control-flow. */ \
+  V(function_call, FindIntrinsic) \
+  V(function_return, FindIntrinsic) \
+  V(jump, FindIntrinsic) \
+  V(missing_block, FindIntrinsic) \
+\
+  /* OS interaction. */ \
+  V(sync_hyper_call, FindIntrinsic) \
+  V(async_hyper_call, FindIntrinsic) \
+\
+  /* Memory access. */ \
+  V(read_memory_8, FindReadNoneIntrinsic) \
+  V(read_memory_16, FindReadNoneIntrinsic) \
+  V(read_memory_32, FindReadNoneIntrinsic) \
+  V(read_memory_64, FindReadNoneIntrinsic) \
+  V(write_memory_8, FindPureIntrinsic) \
+  V(write_memory_16, FindPureIntrinsic) \
+  V(write_memory_32, FindPureIntrinsic) \
+  V(write_memory_64, FindPureIntrinsic) \
+  V(read_memory_f32, FindReadNoneIntrinsic) \
+  V(read_memory_f64, FindReadNoneIntrinsic) \
+  V(read_memory_f80, FindReadNoneIntrinsic) \
+  V(read_memory_f128, FindReadNoneIntrinsic) \
+  V(write_memory_f32, FindPureIntrinsic) \
+  V(write_memory_f64, FindPureIntrinsic) \
+  V(write_memory_f80, FindPureIntrinsic) \
+  V(write_memory_f128, FindPureIntrinsic) \
+\
+  /* Memory barriers. */ \
+  V(barrier_load_load, FindPureIntrinsic) \
+  V(barrier_load_store, FindPureIntrinsic) \
+  V(barrier_store_load, FindPureIntrinsic) \
+  V(barrier_store_store, FindPureIntrinsic) \
+  V(atomic_begin, FindReadNoneIntrinsic) \
+  V(atomic_end, FindReadNoneIntrinsic) \
+  V(delay_slot_begin, FindPureIntrinsic) \
+  V(delay_slot_end, FindPureIntrinsic) \
+\
+  /* Optimization enablers. */ \
+  V(undefined_8, FindPureIntrinsic) \
+  V(undefined_16, FindPureIntrinsic) \
+  V(undefined_32, FindPureIntrinsic) \
+  V(undefined_64, FindPureIntrinsic) \
+  V(undefined_f32, FindPureIntrinsic) \
+  V(undefined_f64, FindPureIntrinsic) \
+  V(undefined_f80, FindPureIntrinsic) \
+\
+  /* Flag computations. */ \
+  V(flag_computation_zero, FindPureIntrinsic) \
+  V(flag_computation_sign, FindPureIntrinsic) \
+  V(flag_computation_overflow, FindPureIntrinsic) \
+  V(flag_computation_carry, FindPureIntrinsic) \
+\
+  /* Compares. */ \
+  V(compare_sle, FindPureIntrinsic) \
+  V(compare_sgt, FindPureIntrinsic) \
+  V(compare_eq, FindPureIntrinsic) \
+  V(compare_neq, FindPureIntrinsic)
+
+#define REMILL_INTRINSIC_NAME(member, find) "__remill_" #member,
+
+// Every function looked up by the `IntrinsicTable` constructor.
+static const char *const kIntrinsicNames[] = {
+    REMILL_FOR_EACH_INTRINSIC(REMILL_INTRINSIC_NAME) "__remill_intrinsics",
+};
+
+#undef REMILL_INTRINSIC_NAME
+
 }  // namespace
 
+std::vector<std::string>
+IntrinsicTable::FindMissingIntrinsics(llvm::Module *module) {
+  std::vector<std::string> missing;
+  for (auto name : kIntrinsicNames) {
+    if (!FindFunction(module, name)) {
+      missing.emplace_back(name);
+    }
+  }
+  return missing;
+}
+
+#define REMILL_FIND_INTRINSIC(member, find) \
+  member(find(module, "__remill_" #member)),
+
 IntrinsicTable::IntrinsicTable(llvm::Module *module)
-    : error(FindIntrinsic(module, "__remill_error")),
-
-      // Control-flow.
-      function_call(FindIntrinsic(module, "__remill_function_call")),
-      function_return(FindIntrinsic(module, "__remill_function_return")),
-      jump(FindIntrinsic(module, "__remill_jump")),
-      missing_block(FindIntrinsic(module, "__remill_missing_block")),
-
-      // OS interaction.
-      sync_hyper_call(FindIntrinsic(module, "__remill_sync_hyper_call")),
-      async_hyper_call(FindIntrinsic(module, "__remill_async_hyper_call")),
-
-      // Memory access.
-      read_memory_8(SetMemoryReadNone(FindPureIntrinsic(module, "__remill_read_memory_8"))),
-      read_memory_16(SetMemoryReadNone(FindPureIntrinsic(module, "__remill_read_memory_16"))),
-      read_memory_32(SetMemoryReadNone(FindPureIntrinsic(module, "__remill_read_memory_32"))),
-      read_memory_64(SetMemoryReadNone(FindPureIntrinsic(module, "__remill_read_memory_64"))),
-
-      write_memory_8(FindPureIntrinsic(module, "__remill_write_memory_8")),
-      write_memory_16(FindPureIntrinsic(module, "__remill_write_memory_16")),
-      write_memory_32(FindPureIntrinsic(module, "__remill_write_memory_32")),
-      write_memory_64(FindPureIntrinsic(module, "__remill_write_memory_64")),
-
-      read_memory_f32(SetMemoryReadNone(FindPureIntrinsic(module, "__remill_read_memory_f32"))),
-      read_memory_f64(SetMemoryReadNone(FindPureIntrinsic(module, "__remill_read_memory_f64"))),
-      read_memory_f80(SetMemoryReadNone(FindPureIntrinsic(module, "__remill_read_memory_f80"))),
-      read_memory_f128(SetMemoryReadNone(FindPureIntrinsic(module, "__remill_read_memory_f128"))),
-
-      write_memory_f32(FindPureIntrinsic(module, "__remill_write_memory_f32")),
-      write_memory_f64(FindPureIntrinsic(module, "__remill_write_memory_f64")),
-      write_memory_f80(FindPureIntrinsic(module, "__remill_write_memory_f80")),
-      write_memory_f128(
-          FindPureIntrinsic(module, "__remill_write_memory_f128")),
-
-      // Memory barriers.
-      barrier_load_load(
-          FindPureIntrinsic(module, "__remill_barrier_load_load")),
-      barrier_load_store(
-          FindPureIntrinsic(module, "__remill_barrier_load_store")),
-      barrier_store_load(
-          FindPureIntrinsic(module, "__remill_barrier_store_load")),
-      barrier_store_store(
-          FindPureIntrinsic(module, "__remill_barrier_store_store")),
-      atomic_begin(SetMemoryReadNone(FindPureIntrinsic(module, "__remill_atomic_begin"))),
-      atomic_end(SetMemoryReadNone(FindPureIntrinsic(module, "__remill_atomic_end"))),
-      delay_slot_begin(FindPureIntrinsic(module, "__remill_delay_slot_begin")),
-      delay_slot_end(FindPureIntrinsic(module, "__remill_delay_slot_end")),
-
-      //      // Optimization guides.
-      //      //
-      //      // Note:  NOT pure! This is a total hack: we call an unpure function
-      //      //        within a pure one so that it is not optimized out!
-      //      defer_inlining(FindIntrinsic(module, "__remill_defer_inlining")),
-
-      // Optimization enablers.
-      undefined_8(FindPureIntrinsic(module, "__remill_undefined_8")),
-      undefined_16(FindPureIntrinsic(module, "__remill_undefined_16")),
-      undefined_32(FindPureIntrinsic(module, "__remill_undefined_32")),
-      undefined_64(FindPureIntrinsic(module, "__remill_undefined_64")),
-      undefined_f32(FindPureIntrinsic(module, "__remill_undefined_f32")),
-      undefined_f64(FindPureIntrinsic(module, "__remill_undefined_f64")),
-      undefined_f80(FindPureIntrinsic(module, "__remill_undefined_f80")),
-
-      // Flag computations
-      flag_computation_zero(
-          FindPureIntrinsic(module, "__remill_flag_computation_zero")),
-      flag_computation_sign(
-          FindPureIntrinsic(module, "__remill_flag_computation_sign")),
-      flag_computation_overflow(
-          FindPureIntrinsic(module, "__remill_flag_computation_overflow")),
-      flag_computation_carry(
-          FindPureIntrinsic(module, "__remill_flag_computation_carry")),
-      // compares
-      compare_sle(FindPureIntrinsic(module, "__remill_compare_sle")),
-      compare_sgt(FindPureIntrinsic(module, "__remill_compare_sgt")),
-      compare_eq(FindPureIntrinsic(module, "__remill_compare_eq")),
-      compare_neq(FindPureIntrinsic(module, "__remill_compare_neq")),
+    : REMILL_FOR_EACH_INTRINSIC(REMILL_FIND_INTRINSIC)
 
       lifted_function_type(error->getFunctionType()),
       state_ptr_type(llvm::dyn_cast<llvm::PointerType>(
@@ -162,10 +180,12 @@ IntrinsicTable::IntrinsicTable(llvm::Module *module)
       mem_ptr_type(llvm::dyn_cast<llvm::PointerType>(
           lifted_function_type->getParamType(kMemoryPointerArgNum))) {
 
-
   // Make sure to set the correct attributes on this to make sure that
   // it's never optimized away.
   (void) FindIntrinsic(module, "__remill_intrinsics");
 }
 
+#undef REMILL_FIND_INTRINSIC
+#undef REMILL_FOR_EACH_INTRINSIC
+
 }  // namespace remill
@@ -17,11 +17,17 @@
 #include "remill/BC/Optimizer.h"
 
 #include <glog/logging.h>
+#include <llvm/ADT/STLExtras.h>
+#include <llvm/ADT/SmallVector.h>
 #include <llvm/ADT/Triple.h>
+#include <llvm/Analysis/CFG.h>
 #include <llvm/Analysis/TargetLibraryInfo.h>
+#include <llvm/Analysis/ValueTracking.h>
+#include <llvm/IR/CFG.h>
 #include <llvm/IR/Constants.h>
 #include <llvm/IR/DataLayout.h>
 #include <llvm/IR/DebugInfo.h>
+#include <llvm/IR/Dominators.h>
 #include <llvm/IR/IRBuilder.h>
 #include <llvm/IR/InstIterator.h>
 #include <llvm/IR/LLVMContext.h>
@@ -33,20 +39,62 @@
 #include <llvm/Transforms/IPO.h>
 #include <llvm/Transforms/IPO/PassManagerBuilder.h>
 #include <llvm/Transforms/Scalar.h>
+#include <llvm/Transforms/Scalar/GVN.h>
 #include <llvm/Transforms/Utils/Cloning.h>
 #include <llvm/Transforms/Utils/Local.h>
+#include <llvm/Transforms/Utils/ModuleUtils.h>
 #include <llvm/Transforms/Utils/ValueMapper.h>
 
+#include <algorithm>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
 #include "remill/Arch/Arch.h"
+#include "remill/Arch/Runtime/HyperCall.h"
+#include "remill/BC/ABI.h"
+#include "remill/BC/IntrinsicTable.h"
 #include "remill/BC/Util.h"
 #include "remill/BC/Version.h"
+#include "remill/OS/LinuxSyscalls.h"
+#include "remill/OS/OS.h"
 
 namespace remill {
 
+namespace {
+
+// Forward and eliminate redundant loads and stores of `State`, and promote
+// `alloca`s to registers, in `func`.
+static void SimplifyLiftedFunction(llvm::Function *func) {
+  llvm::legacy::FunctionPassManager func_manager(func->getParent());
+  func_manager.add(llvm::createSROAPass());
+  func_manager.add(llvm::createEarlyCSEPass(true));
+  func_manager.add(llvm::createGVNPass());
+  func_manager.add(llvm::createDeadCodeEliminationPass());
+  func_manager.doInitialization();
+  func_manager.run(*func);
+  func_manager.doFinalization();
+}
+
+}  // namespace
+
 void OptimizeModule(const remill::Arch *arch, llvm::Module *module,
                     std::function<llvm::Function *(void)> generator,
                     OptimizationGuide guide) {
 
+  std::vector<llvm::Function *> traces;
+  for (llvm::Function *func = nullptr; (func = generator());) {
+    traces.push_back(func);
+  }
+
+  if (guide.infer_attributes) {
+    InferFunctionAttributes(arch, module, traces);
+  }
+
   llvm::legacy::FunctionPassManager func_manager(module);
   llvm::legacy::PassManager module_manager;
 
@@ -76,12 +124,45 @@ void OptimizeModule(const remill::Arch *arch, llvm::Module *module,
   builder.populateFunctionPassManager(func_manager);
   builder.populateModulePassManager(module_manager);
   func_manager.doInitialization();
-  llvm::Function *func = nullptr;
-  while (nullptr != (func = generator())) {
-    func_manager.run(*func);
+  for (auto trace : traces) {
+    func_manager.run(*trace);
   }
   func_manager.doFinalization();
   module_manager.run(*module);
+
+  // Folding reads of read-only memory exposes more constants, so simplify the
+  // traces with folded reads again.
+  if (guide.read_only_memory) {
+    for (auto trace : traces) {
+      std::optional<uint64_t> trace_addr;
+      if (auto addr_it = guide.trace_addresses.find(trace);
+          addr_it != guide.trace_addresses.end()) {
+        trace_addr = addr_it->second;
+      }
+      if (FoldReadOnlyMemoryReads(*arch->GetInstrinsicTable(), trace,
+                                  guide.read_only_memory, trace_addr)) {
+        SimplifyLiftedFunction(trace);
+      }
+    }
+  }
+
+  if (guide.promote_guest_stack) {
+    for (auto trace : traces) {
+      PromoteGuestStack(arch, trace);
+    }
+  }
+
+  if (guide.lower_linux_syscalls) {
+    for (auto trace : traces) {
+      LowerLinuxSyscalls(arch, trace);
+    }
+  }
+
+  if (guide.outline_cold_exits) {
+    for (auto trace : traces) {
+      OutlineColdExits(*arch->GetInstrinsicTable(), trace);
+    }
+  }
 }
 
 // Optimize a normal module. This might not contain special Remill-specific
@@ -123,4 +204,1371 @@ void OptimizeBareModule(llvm::Module *module, OptimizationGuide guide) {
   module_manager.run(*module);
 }
 
+namespace {
+
+// Branch weights given to hot and cold successors. These match the weights
+// that LLVM uses for `__builtin_expect`.
+static constexpr uint32_t kHotBranchWeight = 2000u;
+static constexpr uint32_t kColdBranchWeight = 1u;
+
+// Returns the call to `__remill_error` or `__remill_missing_block` whose
+// result is returned by `block`, if any.
+static llvm::CallInst *GetColdExitCall(const IntrinsicTable &intrinsics,
+                                       llvm::BasicBlock *block) {
+  auto ret = llvm::dyn_cast<llvm::ReturnInst>(block->getTerminator());
+  if (!ret) {
+    return nullptr;
+  }
+
+  auto call = llvm::dyn_cast_or_null<llvm::CallInst>(ret->getReturnValue());
+  if (!call || call->getParent() != block) {
+    return nullptr;
+  }
+
+  auto callee = call->getCalledFunction();
+  if (callee == intrinsics.error || callee == intrinsics.missing_block) {
+    return call;
+  }
+
+  return nullptr;
+}
+
+// Get or create the stub that exits to `intrinsic`. If `pc` is non-null then
+// the stub is specific to that program counter, otherwise the stub forwards
+// whatever program counter it is given.
+static llvm::Function *GetOrCreateColdExitStub(llvm::Module *module,
+                                               llvm::Function *intrinsic,
+                                               llvm::ConstantInt *pc) {
+  std::stringstream ss;
+  ss << intrinsic->getName().str() << "_cold";
+  if (pc) {
+    ss << "_" << std::hex << pc->getZExtValue();
+  }
+  const auto stub_name = ss.str();
+
+  if (auto stub = module->getFunction(stub_name)) {
+    return stub;
+  }
+
+  auto stub = llvm::Function::Create(intrinsic->getFunctionType(),
+                                     llvm::GlobalValue::LinkOnceODRLinkage,
+                                     stub_name, module);
+  stub->addFnAttr(llvm::Attribute::Cold);
+  stub->addFnAttr(llvm::Attribute::NoInline);
+  stub->addFnAttr(llvm::Attribute::MinSize);
+  stub->addFnAttr(llvm::Attribute::OptimizeForSize);
+
+  std::vector<llvm::Value *> args;
+  for (auto &arg : stub->args()) {
+    args.push_back(&arg);
+  }
+  if (pc) {
+    args[kPCArgNum] = pc;
+  }
+
+  llvm::IRBuilder<> ir(
+      llvm::BasicBlock::Create(module->getContext(), "", stub));
+  auto call = ir.CreateCall(intrinsic, args);
+  call->setTailCall(true);
+  ir.CreateRet(call);
+  return stub;
+}
+
+}  // namespace
+
+// Mark the paths in `func` that exit to `__remill_error` or
+// `__remill_missing_block` as cold, and outline those exits into shared
+// stubs.
+void OutlineColdExits(const IntrinsicTable &intrinsics, llvm::Function *func) {
+  if (func->isDeclaration()) {
+    return;
+  }
+
+  auto module = func->getParent();
+  std::unordered_set<llvm::BasicBlock *> cold_blocks;
+
+  for (auto &block : *func) {
+    auto call = GetColdExitCall(intrinsics, &block);
+    if (!call) {
+      continue;
+    }
+
+    cold_blocks.insert(&block);
+    auto pc = llvm::dyn_cast<llvm::ConstantInt>(call->getArgOperand(kPCArgNum));
+    auto stub = GetOrCreateColdExitStub(module, call->getCalledFunction(), pc);
+    call->setCalledFunction(stub);
+    call->addFnAttr(llvm::Attribute::Cold);
+  }
+
+  if (cold_blocks.empty()) {
+    return;
+  }
+
+  // A block is also cold if every one of its successors is cold, e.g. the
+  // blocks that store back `NEXT_PC` before branching to an exit.
+  for (auto changed = true; changed;) {
+    changed = false;
+    for (auto &block : *func) {
+      auto term = block.getTerminator();
+      if (!term || !term->getNumSuccessors() || cold_blocks.count(&block)) {
+        continue;
+      }
+      auto all_cold = true;
+      for (auto succ : llvm::successors(&block)) {
+        all_cold = all_cold && cold_blocks.count(succ);
+      }
+      if (all_cold) {
+        cold_blocks.insert(&block);
+        changed = true;
+      }
+    }
+  }
+
+  // Weight the edges from hot blocks into cold blocks as unlikely.
+  llvm::MDBuilder mdb(func->getContext());
+  for (auto &block : *func) {
+    auto term = block.getTerminator();
+    if (!term || cold_blocks.count(&block) || term->getNumSuccessors() < 2 ||
+        !(llvm::isa<llvm::BranchInst>(term) ||
+          llvm::isa<llvm::SwitchInst>(term))) {
+      continue;
+    }
+
+    std::vector<uint32_t> weights;
+    auto any_cold = false;
+    for (auto succ : llvm::successors(&block)) {
+      if (cold_blocks.count(succ)) {
+        weights.push_back(kColdBranchWeight);
+        any_cold = true;
+      } else {
+        weights.push_back(kHotBranchWeight);
+      }
+    }
+
+    if (any_cold) {
+      term->setMetadata(llvm::LLVMContext::MD_prof,
+                        mdb.createBranchWeights(weights));
+    }
+  }
+}
+
+namespace {
+
+// Where the user-mode Linux ABI of an architecture passes the number,
+// arguments, and return value of a system call, along with the kind of
+// asynchronous hyper call that its system call instruction makes.
+struct LinuxSyscallABI {
+  std::string_view number_reg;
+  std::string_view arg_regs[6];
+  std::string_view ret_reg;
+  AsyncHyperCall::Name hyper_call;
+};
+
+static const LinuxSyscallABI *GetLinuxSyscallABI(const Arch *arch) {
+  static const LinuxSyscallABI kAMD64ABI = {
+      "RAX",
+      {"RDI", "RSI", "RDX", "R10", "R8", "R9"},
+      "RAX",
+      AsyncHyperCall::kX86SysCall};
+
+  static const LinuxSyscallABI kAArch64ABI = {
+      "X8",
+      {"X0", "X1", "X2", "X3", "X4", "X5"},
+      "X0",
+      AsyncHyperCall::kAArch64SupervisorCall};
+
+  if (kOSLinux != arch->os_name) {
+    return nullptr;
+  } else if (arch->IsAMD64()) {
+    return &kAMD64ABI;
+  } else if (arch->IsAArch64()) {
+    return &kAArch64ABI;
+  } else {
+    return nullptr;
+  }
+}
+
+// Is `call` the synchronous hyper call of the x86 `syscall` instruction? The
+// runtime isn't expected to change the system call number in it.
+static bool IsSysCallSyncHyperCall(const IntrinsicTable &intrinsics,
+                                   llvm::CallInst *call) {
+  if (call->getCalledFunction() != intrinsics.sync_hyper_call) {
+    return false;
+  }
+  auto kind = llvm::dyn_cast<llvm::ConstantInt>(call->getArgOperand(2));
+  return kind && SyncHyperCall::kX86SysCall == kind->getZExtValue();
+}
+
+// Return the constant last stored into the `size`-byte field at byte offset
+// `offset` of `state` before `inst`, looking backward through the block of
+// `inst` and its unique predecessors. Returns `nullptr` if the stored value
+// isn't a constant, or if anything in between might have changed the field.
+static llvm::ConstantInt *
+FindStoredConstant(const IntrinsicTable &intrinsics, llvm::Instruction *inst,
+                   llvm::Value *state, uint64_t offset, uint64_t size) {
+  const auto &dl = inst->getModule()->getDataLayout();
+  auto block = inst->getParent();
+  auto it = inst->getIterator();
+
+  for (auto num_blocks = 0u; block && num_blocks < 8u; ++num_blocks) {
+    while (it != block->begin()) {
+      auto &prev = *--it;
+      auto store = llvm::dyn_cast<llvm::StoreInst>(&prev);
+      if (!store) {
+        if (!prev.mayWriteToMemory()) {
+          continue;
+        }
+        auto call = llvm::dyn_cast<llvm::CallInst>(&prev);
+        if (call && IsSysCallSyncHyperCall(intrinsics, call)) {
+          continue;
+        }
+        return nullptr;
+      }
+
+      int64_t store_offset = 0;
+      auto base = llvm::GetPointerBaseWithConstantOffset(
+          store->getPointerOperand(), store_offset, dl);
+
+      // Stores to the stack can't change `State`.
+      if (base != state) {
+        if (llvm::isa<llvm::AllocaInst>(base)) {
+          continue;
+        }
+        return nullptr;
+      }
+
+      const auto store_size =
+          dl.getTypeStoreSize(store->getValueOperand()->getType());
+      const auto begin = static_cast<uint64_t>(store_offset);
+      if (begin + store_size <= offset || offset + size <= begin) {
+        continue;
+      } else if (begin == offset && store_size == size) {
+        return llvm::dyn_cast<llvm::ConstantInt>(store->getValueOperand());
+      } else {
+        return nullptr;
+      }
+    }
+
+    block = block->getSinglePredecessor();
+    if (block) {
+      it = block->end();
+    }
+  }
+  return nullptr;
+}
+
+// Return the program counter that the code after the hyper call `call`
+// expects the program counter register `pc_reg` of `state` to hold once the
+// hyper call returns, i.e. the constant that the trace lifter compares it
+// against. Returns `nullptr` if there is no such comparison.
+static llvm::ConstantInt *FindReturnProgramCounter(llvm::CallInst *call,
+                                                   llvm::Value *state,
+                                                   const Register *pc_reg) {
+  const auto &dl = call->getModule()->getDataLayout();
+  const auto end = call->getParent()->end();
+  for (auto it = std::next(call->getIterator()); it != end; ++it) {
+    auto cmp = llvm::dyn_cast<llvm::ICmpInst>(&*it);
+    if (!cmp || !cmp->isEquality()) {
+      continue;
+    }
+    for (auto i = 0u; i < 2u; ++i) {
+      auto load = llvm::dyn_cast<llvm::LoadInst>(cmp->getOperand(i));
+      auto ret_pc = llvm::dyn_cast<llvm::ConstantInt>(cmp->getOperand(1u - i));
+      if (!load || !ret_pc) {
+        continue;
+      }
+      int64_t offset = 0;
+      auto base = llvm::GetPointerBaseWithConstantOffset(
+          load->getPointerOperand(), offset, dl);
+      if (base == state && static_cast<uint64_t>(offset) == pc_reg->offset) {
+        return ret_pc;
+      }
+    }
+  }
+  return nullptr;
+}
+
+}  // namespace
+
+// Give the asynchronous hyper calls of system call instructions in `func` a
+// fast path that calls the emulator of `remill/OS/LinuxSyscalls.h`.
+unsigned LowerLinuxSyscalls(const Arch *arch, llvm::Function *func) {
+  const auto abi = GetLinuxSyscallABI(arch);
+  if (!abi || func->isDeclaration()) {
+    return 0u;
+  }
+
+  const auto intrinsics = arch->GetInstrinsicTable();
+  std::vector<llvm::CallInst *> calls;
+  for (auto &inst : llvm::instructions(func)) {
+    if (auto call = llvm::dyn_cast<llvm::CallInst>(&inst);
+        call && call->getCalledFunction() == intrinsics->async_hyper_call) {
+      calls.push_back(call);
+    }
+  }
+
+  if (calls.empty()) {
+    return 0u;
+  }
+
+  auto module = func->getParent();
+  auto &context = module->getContext();
+  auto i32_type = llvm::Type::getInt32Ty(context);
+  auto i64_type = llvm::Type::getInt64Ty(context);
+  auto bool_type = llvm::Type::getInt1Ty(context);
+  auto ptr_type = llvm::PointerType::get(context, 0);
+
+  auto get_reg = [=](std::string_view name) {
+    auto reg = arch->RegisterByName(name);
+    CHECK(reg) << "Missing register " << name << " for system calls";
+    return reg;
+  };
+
+  const auto number_reg = get_reg(abi->number_reg);
+  const auto ret_reg = get_reg(abi->ret_reg);
+  const auto pc_reg = get_reg(kPCVariableName);
+
+  // The emulator's entry points, which return whether or not they emulated
+  // the system call.
+  auto declare = [=](const std::string &name, bool takes_number) {
+    std::vector<llvm::Type *> param_types(9u, i64_type);
+    param_types[0] = ptr_type;
+    param_types[2] = ptr_type;
+    if (!takes_number) {
+      param_types.erase(param_types.begin() + 1);
+    }
+    auto callee = module->getOrInsertFunction(
+        name, llvm::FunctionType::get(bool_type, param_types, false));
+    if (auto decl = llvm::dyn_cast<llvm::Function>(callee.getCallee())) {
+      decl->addRetAttr(llvm::Attribute::ZExt);
+    }
+    return callee;
+  };
+
+  llvm::Value *ret_slot = nullptr;
+  auto num_lowered = 0u;
+
+  for (auto call : calls) {
+    auto state = call->getArgOperand(kStatePointerArgNum);
+    auto memory = call->getArgOperand(kMemoryPointerArgNum);
+
+    // Other asynchronous hyper calls, e.g. of `int 0x80`, aren't system calls
+    // of this ABI.
+    auto kind = FindStoredConstant(*intrinsics, call, state, 0u,
+                                   sizeof(AsyncHyperCall::Name));
+    if (kind && abi->hyper_call != kind->getZExtValue()) {
+      continue;
+    }
+
+    // The emulator returns to the next instruction, like the embedder's
+    // hyper call handler is expected to, so the fast path has to set the
+    // program counter to it, as the semantics of system call instructions
+    // don't.
+    auto ret_pc = FindReturnProgramCounter(call, state, pc_reg);
+    if (!ret_pc) {
+      continue;
+    }
+
+    // Dispatch directly to the system call when its number is known.
+    auto number = FindStoredConstant(*intrinsics, call, state,
+                                     number_reg->offset, number_reg->size);
+    llvm::FunctionCallee emulate;
+    if (number) {
+      const auto syscall = GetLinuxSyscall(arch->arch_name,
+                                           number->getZExtValue());
+      if (LinuxSyscall::kInvalid == syscall) {
+        continue;
+      }
+      emulate = declare(
+          "__remill_linux_syscall_" + std::string(GetLinuxSyscallName(syscall)),
+          false);
+    } else {
+      emulate = declare("__remill_linux_syscall", true);
+    }
+
+    if (!ret_slot) {
+      llvm::IRBuilder<> ir(&func->getEntryBlock(),
+                           func->getEntryBlock().getFirstInsertionPt());
+      ret_slot = ir.CreateAlloca(i64_type, nullptr, "SYSCALL_RET");
+    }
+
+    auto head_block = call->getParent();
+    auto slow_block = head_block->splitBasicBlock(call);
+    auto cont_block = slow_block->splitBasicBlock(call->getNextNode());
+    auto fast_block = llvm::BasicBlock::Create(context, "", func, slow_block);
+    auto done_block = llvm::BasicBlock::Create(context, "", func, slow_block);
+    head_block->getTerminator()->eraseFromParent();
+
+    // `ArchState::hyper_call` is at the beginning of `State`.
+    llvm::IRBuilder<> ir(head_block);
+    if (kind) {
+      ir.CreateBr(fast_block);
+    } else {
+      auto is_syscall = ir.CreateICmpEQ(
+          ir.CreateLoad(i32_type, state),
+          llvm::ConstantInt::get(i32_type, abi->hyper_call));
+      ir.CreateCondBr(is_syscall, fast_block, slow_block);
+    }
+
+    auto load_reg = [&](const Register *reg) {
+      return ir.CreateZExtOrTrunc(
+          ir.CreateLoad(reg->type, reg->AddressOf(state, ir)), i64_type);
+    };
+
+    ir.SetInsertPoint(fast_block);
+    std::vector<llvm::Value *> args = {memory};
+    if (!number) {
+      args.push_back(load_reg(number_reg));
+    }
+    args.push_back(ret_slot);
+    for (auto arg_reg : abi->arg_regs) {
+      args.push_back(load_reg(get_reg(arg_reg)));
+    }
+    ir.CreateCondBr(ir.CreateCall(emulate, args), done_block, slow_block);
+
+    ir.SetInsertPoint(done_block);
+    ir.CreateStore(
+        ir.CreateZExtOrTrunc(ir.CreateLoad(i64_type, ret_slot), ret_reg->type),
+        ret_reg->AddressOf(state, ir));
+    ir.CreateStore(llvm::ConstantInt::get(pc_reg->type, ret_pc->getZExtValue()),
+                   pc_reg->AddressOf(state, ir));
+    ir.CreateBr(cont_block);
+
+    ir.SetInsertPoint(cont_block, cont_block->begin());
+    auto new_memory = ir.CreatePHI(memory->getType(), 2u);
+    call->replaceAllUsesWith(new_memory);
+    new_memory->addIncoming(memory, done_block);
+    new_memory->addIncoming(call, slow_block);
+    ++num_lowered;
+  }
+
+  return num_lowered;
+}
+
+// Replace the reads of read-only memory at constant addresses in `func` with
+// the values that they read.
+unsigned FoldReadOnlyMemoryReads(
+    const IntrinsicTable &intrinsics, llvm::Function *func,
+    const std::function<bool(uint64_t, uint8_t *)> &read_byte,
+    std::optional<uint64_t> trace_addr) {
+  if (!read_byte || func->isDeclaration()) {
+    return 0u;
+  }
+
+  // The program counter of a trace starts at its own address, so substitute
+  // it, and fold the program counter relative addresses that derive from it.
+  // The lifted code keeps `NEXT_PC` in an `alloca`, and the semantics keep
+  // registers in `State`, so forward those too.
+  if (trace_addr && func->arg_size() == kNumBlockArgs) {
+    auto pc = NthArgument(func, kPCArgNum);
+    pc->replaceAllUsesWith(llvm::ConstantInt::get(pc->getType(), *trace_addr));
+    SimplifyLiftedFunction(func);
+  }
+
+  const llvm::Function *const read_funcs[] = {
+      intrinsics.read_memory_8,   intrinsics.read_memory_16,
+      intrinsics.read_memory_32,  intrinsics.read_memory_64,
+      intrinsics.read_memory_f32, intrinsics.read_memory_f64};
+
+  std::vector<llvm::CallInst *> calls;
+  for (auto &inst : llvm::instructions(func)) {
+    auto call = llvm::dyn_cast<llvm::CallInst>(&inst);
+    if (call && llvm::isa<llvm::ConstantInt>(call->getArgOperand(1)) &&
+        llvm::is_contained(read_funcs, call->getCalledFunction())) {
+      calls.push_back(call);
+    }
+  }
+
+  auto &context = func->getContext();
+  const auto is_little_endian =
+      func->getParent()->getDataLayout().isLittleEndian();
+  auto num_folded = 0u;
+
+  for (auto call : calls) {
+    const auto addr =
+        llvm::cast<llvm::ConstantInt>(call->getArgOperand(1))->getZExtValue();
+    const auto type = call->getType();
+    const auto num_bits = type->getScalarSizeInBits();
+    const auto num_bytes = num_bits / 8u;
+
+    llvm::APInt bits(num_bits, 0u);
+    auto is_read_only = true;
+    for (auto i = 0u; is_read_only && i < num_bytes; ++i) {
+      uint8_t byte = 0u;
+      is_read_only = read_byte(addr + i, &byte);
+      const auto byte_num = is_little_endian ? i : num_bytes - i - 1u;
+      bits.insertBits(llvm::APInt(8u, byte), byte_num * 8u);
+    }
+
+    if (!is_read_only) {
+      continue;
+    }
+
+    llvm::Constant *val = nullptr;
+    if (type->isFloatingPointTy()) {
+      val = llvm::ConstantFP::get(context,
+                                  llvm::APFloat(type->getFltSemantics(), bits));
+    } else {
+      val = llvm::ConstantInt::get(context, bits);
+    }
+
+    call->replaceAllUsesWith(val);
+    call->eraseFromParent();
+    ++num_folded;
+  }
+
+  return num_folded;
+}
+
+namespace {
+
+// The largest guest stack frame that `PromoteGuestStack` promotes, in bytes.
+static constexpr int64_t kMaxPromotedFrameSize = 4096;
+
+// An access of the guest stack by a memory intrinsic, at byte offset `offset`
+// from the stack pointer on entry.
+struct GuestStackAccess {
+  llvm::CallInst *call;
+  int64_t offset;
+  uint64_t size;
+  bool is_write;
+  bool is_promoted;
+};
+
+// Return the index of the memory pointer argument of `call` if it is a call
+// that takes the `State` structure `state`, `0` if it doesn't take `state`,
+// and `-1` if it takes `state` in some unknown way.
+static int GetStateCallMemoryArgNum(const IntrinsicTable &intrinsics,
+                                    llvm::CallInst *call, llvm::Value *state) {
+  if (!llvm::is_contained(call->args(), state)) {
+    return 0;
+  } else if (call->getCalledFunction() == intrinsics.sync_hyper_call) {
+    return 1;
+  } else if (call->arg_size() == kNumBlockArgs &&
+             call->getArgOperand(kStatePointerArgNum) == state) {
+    return kMemoryPointerArgNum;
+  } else {
+    return -1;
+  }
+}
+
+}  // namespace
+
+// Promote the guest stack frame of `func` to an `alloca`.
+unsigned PromoteGuestStack(const Arch *arch, llvm::Function *func) {
+  if (func->isDeclaration() || func->arg_size() != kNumBlockArgs) {
+    return 0u;
+  }
+
+  const auto sp_reg = arch->RegisterByName(arch->StackPointerRegisterName());
+  if (!sp_reg) {
+    return 0u;
+  }
+
+  const auto &intrinsics = *arch->GetInstrinsicTable();
+  const auto state = func->getArg(kStatePointerArgNum);
+  const auto memory = func->getArg(kMemoryPointerArgNum);
+  const auto memory_type = memory->getType();
+  const auto &dl = func->getParent()->getDataLayout();
+  auto &entry_block = func->getEntryBlock();
+
+  SimplifyLiftedFunction(func);
+
+  // Is `ptr` the stack pointer register in `State`?
+  auto is_sp_ref = [&](llvm::Value *ptr, llvm::Type *type, bool &overlaps) {
+    int64_t offset = 0;
+    auto base = llvm::GetPointerBaseWithConstantOffset(ptr, offset, dl);
+    const auto size = dl.getTypeStoreSize(type).getFixedValue();
+    const auto begin = static_cast<uint64_t>(offset);
+    overlaps = base == state && begin < sp_reg->offset + sp_reg->size &&
+               sp_reg->offset < begin + size;
+    return overlaps && begin == sp_reg->offset && size == sp_reg->size;
+  };
+
+  // Find the only load of the stack pointer. It can be in any block, e.g.
+  // in the block of the first instruction rather than in the entry block,
+  // but the frame is read from guest memory right after it, so it must not
+  // be in a loop.
+  llvm::LoadInst *sp_load = nullptr;
+  for (auto &inst : llvm::instructions(func)) {
+    auto load = llvm::dyn_cast<llvm::LoadInst>(&inst);
+    auto overlaps = false;
+    if (!load) {
+      continue;
+    } else if (is_sp_ref(load->getPointerOperand(), load->getType(),
+                         overlaps)) {
+      if (sp_load) {
+        return 0u;
+      }
+      sp_load = load;
+    } else if (overlaps) {
+      return 0u;
+    }
+  }
+
+  if (!sp_load) {
+    return 0u;
+  }
+
+  const auto sp_block = sp_load->getParent();
+  for (auto succ : llvm::successors(sp_block)) {
+    if (llvm::isPotentiallyReachable(succ, sp_block)) {
+      return 0u;
+    }
+  }
+
+  const std::pair<llvm::Function *, llvm::Function *> read_write_funcs[] = {
+      {intrinsics.read_memory_8, intrinsics.write_memory_8},
+      {intrinsics.read_memory_16, intrinsics.write_memory_16},
+      {intrinsics.read_memory_32, intrinsics.write_memory_32},
+      {intrinsics.read_memory_64, intrinsics.write_memory_64},
+      {intrinsics.read_memory_f32, intrinsics.write_memory_f32},
+      {intrinsics.read_memory_f64, intrinsics.write_memory_f64}};
+
+  // Follow the uses of the stack pointer, making sure that the address of
+  // the frame never escapes.
+  std::vector<GuestStackAccess> accesses;
+  std::unordered_map<llvm::Value *, int64_t> sp_offsets = {{sp_load, 0}};
+  std::vector<llvm::Value *> work_list = {sp_load};
+  while (!work_list.empty()) {
+    const auto val = work_list.back();
+    work_list.pop_back();
+    const auto offset = sp_offsets[val];
+
+    for (auto &use : val->uses()) {
+      const auto user = use.getUser();
+      if (auto op = llvm::dyn_cast<llvm::BinaryOperator>(user)) {
+        auto other = op->getOperand(1u - use.getOperandNo());
+        auto disp = llvm::dyn_cast<llvm::ConstantInt>(other);
+        if (!disp) {
+          return 0u;
+        } else if (op->getOpcode() == llvm::Instruction::Add) {
+          sp_offsets[op] = offset + disp->getSExtValue();
+        } else if (op->getOpcode() == llvm::Instruction::Sub &&
+                   !use.getOperandNo()) {
+          sp_offsets[op] = offset - disp->getSExtValue();
+        } else {
+          return 0u;
+        }
+        work_list.push_back(op);
+
+      } else if (auto store = llvm::dyn_cast<llvm::StoreInst>(user)) {
+        auto overlaps = false;
+        if (use.getOperandNo() ||
+            !is_sp_ref(store->getPointerOperand(), val->getType(), overlaps)) {
+          return 0u;
+        }
+
+      } else if (auto call = llvm::dyn_cast<llvm::CallInst>(user)) {
+        const auto callee = call->getCalledFunction();
+        auto found = false;
+        for (auto [read_func, write_func] : read_write_funcs) {
+          if (1u != use.getOperandNo() || found) {
+            break;
+          } else if (callee == read_func || callee == write_func) {
+            const auto is_write = callee == write_func;
+            const auto type = is_write ? call->getArgOperand(2)->getType()
+                                       : call->getType();
+            accesses.push_back({call, offset,
+                                dl.getTypeStoreSize(type).getFixedValue(),
+                                is_write, false});
+            found = true;
+          }
+        }
+        if (!found) {
+          return 0u;
+        }
+
+      } else if (!llvm::isa<llvm::ICmpInst>(user)) {
+        return 0u;
+      }
+    }
+  }
+
+  if (accesses.empty()) {
+    return 0u;
+  }
+
+  auto frame_begin = accesses.front().offset;
+  auto frame_end = frame_begin;
+  for (const auto &access : accesses) {
+    frame_begin = std::min(frame_begin, access.offset);
+    frame_end = std::max(frame_end,
+                         access.offset + static_cast<int64_t>(access.size));
+  }
+
+  if (frame_end - frame_begin > kMaxPromotedFrameSize) {
+    return 0u;
+  }
+
+  // The frame is read from guest memory before it is accessed, and bytes
+  // below the stack pointer may not be there to read, e.g. if they are past
+  // the end of the stack. Only promote the writes below the stack pointer
+  // of bytes that are also read, and leave the rest in guest memory.
+  const auto frame_size = static_cast<size_t>(frame_end - frame_begin);
+  std::vector<bool> is_read(frame_size, false);
+  for (const auto &access : accesses) {
+    if (!access.is_write) {
+      for (auto i = 0u; i < access.size; ++i) {
+        is_read[static_cast<size_t>(access.offset - frame_begin) + i] = true;
+      }
+    }
+  }
+
+  std::vector<bool> is_promoted(frame_size, false);
+  std::unordered_map<llvm::CallInst *, const GuestStackAccess *> access_calls;
+  auto num_promoted = 0u;
+  for (auto &access : accesses) {
+    access_calls.emplace(access.call, &access);
+    access.is_promoted = true;
+    for (auto i = 0u; access.is_write && i < access.size; ++i) {
+      const auto byte_offset = access.offset + static_cast<int64_t>(i);
+      if (byte_offset < 0 &&
+          !is_read[static_cast<size_t>(byte_offset - frame_begin)]) {
+        access.is_promoted = false;
+      }
+    }
+    if (!access.is_promoted) {
+      continue;
+    }
+    for (auto i = 0u; i < access.size; ++i) {
+      is_promoted[static_cast<size_t>(access.offset - frame_begin) + i] = true;
+    }
+    ++num_promoted;
+  }
+
+  if (!num_promoted) {
+    return 0u;
+  }
+
+  // Find the values of the memory pointer, so as to find the calls that
+  // access guest memory.
+  std::unordered_set<llvm::Value *> memory_vals = {memory};
+  work_list = {memory};
+  while (!work_list.empty()) {
+    const auto val = work_list.back();
+    work_list.pop_back();
+    for (auto user : val->users()) {
+      if ((llvm::isa<llvm::PHINode>(user) ||
+           llvm::isa<llvm::SelectInst>(user) ||
+           llvm::isa<llvm::CallInst>(user)) &&
+          user->getType() == memory_type && memory_vals.insert(user).second) {
+        work_list.push_back(user);
+      }
+    }
+  }
+
+  // A call where the frame must be in guest memory, and the byte offsets of
+  // the part of the frame that it can access.
+  struct SyncCall {
+    llvm::CallInst *call;
+    unsigned arg_num;
+    int64_t begin;
+    int64_t end;
+    bool takes_state;
+  };
+
+  // Find the calls where the frame must be in guest memory. Calls that take
+  // `State` can access the frame through the stack pointer, and other guest
+  // memory accesses, e.g. through the frame pointer, can alias it. The frame
+  // only lives in the `alloca` after the stack pointer is loaded, so the
+  // memory pointer from which it is read is the one of the last call before
+  // that which changes guest memory.
+  llvm::DominatorTree dom_tree(*func);
+  std::vector<SyncCall> sync_calls;
+  std::vector<llvm::ReturnInst *> rets;
+  llvm::CallInst *last_memory_def = nullptr;
+  for (auto &inst : llvm::instructions(func)) {
+    if (auto ret = llvm::dyn_cast<llvm::ReturnInst>(&inst)) {
+      if (dom_tree.dominates(sp_load, ret)) {
+        rets.push_back(ret);
+      } else if (llvm::isPotentiallyReachable(sp_load, ret)) {
+        return 0u;
+      }
+      continue;
+    }
+
+    auto call = llvm::dyn_cast<llvm::CallInst>(&inst);
+    if (!call) {
+      continue;
+    }
+
+    const GuestStackAccess *access = nullptr;
+    if (auto access_it = access_calls.find(call);
+        access_it != access_calls.end()) {
+      access = access_it->second;
+      if (access->is_promoted) {
+        continue;
+      }
+    }
+
+    SyncCall sync = {call, 0u, frame_begin, frame_end, false};
+    const auto state_arg_num =
+        GetStateCallMemoryArgNum(intrinsics, call, state);
+    if (0 > state_arg_num) {
+      return 0u;
+    } else if (state_arg_num) {
+      sync.arg_num = static_cast<unsigned>(state_arg_num);
+      sync.takes_state = true;
+    } else {
+      auto arg_it = std::find_if(
+          call->arg_begin(), call->arg_end(),
+          [&](llvm::Value *arg) { return memory_vals.count(arg); });
+      if (arg_it == call->arg_end()) {
+        continue;
+      }
+      sync.arg_num = static_cast<unsigned>(arg_it - call->arg_begin());
+      if (access) {
+        sync.begin = access->offset;
+        sync.end = access->offset + static_cast<int64_t>(access->size);
+      }
+    }
+
+    if (dom_tree.dominates(sp_load, call)) {
+      sync_calls.push_back(sync);
+    } else if (call->getType() != memory_type) {
+      if (llvm::isPotentiallyReachable(sp_load, call)) {
+        return 0u;
+      }
+    } else if (dom_tree.dominates(call, sp_load)) {
+      if (!last_memory_def || dom_tree.dominates(last_memory_def, call)) {
+        last_memory_def = call;
+      }
+    } else {
+      return 0u;
+    }
+  }
+
+  // Split the promoted bytes of the frame into the chunks in which they are
+  // copied between guest memory and the `alloca`, and find out which chunks
+  // are ever written.
+  struct Chunk {
+    int64_t offset;
+    int64_t size;
+    llvm::Function *read_func;
+    llvm::Function *write_func;
+    bool is_written;
+  };
+  std::vector<Chunk> chunks;
+  for (auto offset = frame_begin; offset < frame_end;) {
+    if (!is_promoted[static_cast<size_t>(offset - frame_begin)]) {
+      ++offset;
+      continue;
+    }
+    auto size = std::min<int64_t>(static_cast<int64_t>(sp_reg->size), 8);
+    auto is_covered = [&](void) {
+      for (auto i = offset; i < offset + size; ++i) {
+        if (i >= frame_end ||
+            !is_promoted[static_cast<size_t>(i - frame_begin)]) {
+          return false;
+        }
+      }
+      return true;
+    };
+    while (!is_covered()) {
+      size /= 2;
+    }
+    const auto [read_func, write_func] =
+        read_write_funcs[llvm::Log2_64(static_cast<uint64_t>(size))];
+    auto is_written = false;
+    for (const auto &access : accesses) {
+      const auto access_end = access.offset + static_cast<int64_t>(access.size);
+      if (access.is_promoted && access.is_write &&
+          access.offset < offset + size && offset < access_end) {
+        is_written = true;
+      }
+    }
+    chunks.push_back({offset, size, read_func, write_func, is_written});
+    offset += size;
+  }
+
+  auto &context = func->getContext();
+  const auto i8_type = llvm::Type::getInt8Ty(context);
+  const auto sp_type = sp_load->getType();
+
+  llvm::IRBuilder<> ir(&entry_block, entry_block.getFirstInsertionPt());
+  const auto frame = ir.CreateAlloca(
+      llvm::ArrayType::get(i8_type, static_cast<uint64_t>(frame_size)),
+      nullptr, "GUEST_FRAME");
+  frame->setAlignment(llvm::Align(16));
+
+  auto frame_ptr = [&](int64_t offset, llvm::Type *type) {
+    const auto index = static_cast<uint64_t>(offset - frame_begin);
+    auto ptr = ir.CreateConstInBoundsGEP2_64(frame->getAllocatedType(), frame,
+                                             0u, index);
+    return ir.CreateBitCast(ptr, llvm::PointerType::get(type, 0));
+  };
+
+  auto guest_addr = [&](int64_t offset) {
+    return ir.CreateAdd(sp_load, llvm::ConstantInt::getSigned(sp_type, offset));
+  };
+
+  // Copy the chunks that overlap the byte offsets `[begin, end)` of the
+  // frame in from guest memory.
+  auto copy_in = [&](llvm::Value *mem, int64_t begin, int64_t end) {
+    for (const auto &chunk : chunks) {
+      if (chunk.offset < end && begin < chunk.offset + chunk.size) {
+        auto val =
+            ir.CreateCall(chunk.read_func, {mem, guest_addr(chunk.offset)});
+        ir.CreateAlignedStore(val, frame_ptr(chunk.offset, val->getType()),
+                              llvm::Align(1));
+      }
+    }
+  };
+
+  // Copy the written chunks that overlap the byte offsets `[begin, end)` of
+  // the frame out to guest memory.
+  auto copy_out = [&](llvm::Value *mem, int64_t begin, int64_t end) {
+    for (const auto &chunk : chunks) {
+      if (chunk.is_written && chunk.offset < end &&
+          begin < chunk.offset + chunk.size) {
+        const auto type = chunk.read_func->getReturnType();
+        auto val = ir.CreateAlignedLoad(
+            type, frame_ptr(chunk.offset, type), llvm::Align(1));
+        mem = ir.CreateCall(chunk.write_func,
+                            {mem, guest_addr(chunk.offset), val});
+      }
+    }
+    return mem;
+  };
+
+  // Read the frame from guest memory right after the stack pointer is known.
+  ir.SetInsertPoint(sp_load->getNextNode());
+  copy_in(last_memory_def ? static_cast<llvm::Value *>(last_memory_def)
+                          : memory,
+          frame_begin, frame_end);
+
+  for (const auto &access : accesses) {
+    if (!access.is_promoted) {
+      continue;
+    }
+    ir.SetInsertPoint(access.call);
+    if (access.is_write) {
+      auto val = access.call->getArgOperand(2);
+      ir.CreateAlignedStore(val, frame_ptr(access.offset, val->getType()),
+                            llvm::Align(1));
+      access.call->replaceAllUsesWith(access.call->getArgOperand(0));
+    } else {
+      auto val = ir.CreateAlignedLoad(
+          access.call->getType(),
+          frame_ptr(access.offset, access.call->getType()), llvm::Align(1));
+      access.call->replaceAllUsesWith(val);
+    }
+    access.call->eraseFromParent();
+  }
+
+  // Write the frame back to guest memory before the calls that can access
+  // it, and read it again after those that can change it, unless they are
+  // tail-calls that exit `func`.
+  for (const auto &sync : sync_calls) {
+    const auto call = sync.call;
+    ir.SetInsertPoint(call);
+    call->setArgOperand(
+        sync.arg_num,
+        copy_out(call->getArgOperand(sync.arg_num), sync.begin, sync.end));
+    if (call->getType() != memory_type) {
+      continue;
+    } else if (auto next = call->getNextNode();
+               !sync.takes_state || !llvm::isa<llvm::ReturnInst>(next)) {
+      ir.SetInsertPoint(next);
+      copy_in(call, sync.begin, sync.end);
+    }
+  }
+
+  for (auto ret : rets) {
+    auto prev = ret->getPrevNode();
+    auto call = llvm::dyn_cast_or_null<llvm::CallInst>(prev);
+    if (ret->getReturnValue() &&
+        (!call || !GetStateCallMemoryArgNum(intrinsics, call, state))) {
+      ir.SetInsertPoint(ret);
+      ret->setOperand(0, copy_out(ret->getReturnValue(), frame_begin,
+                                  frame_end));
+    }
+  }
+
+  SimplifyLiftedFunction(func);
+  return num_promoted;
+}
+
+// Shrink the semantics module `module` down to the instruction semantics
+// named in `isel_names`.
+bool PruneSemanticsModule(llvm::Module *module,
+                          const std::unordered_set<std::string> &isel_names) {
+
+  // The instruction lifter always needs these to handle undecodable and
+  // unsupported instructions.
+  std::unordered_set<std::string> kept_isels;
+  for (auto name : {kInvalidInstructionISelName,
+                    kUnsupportedInstructionISelName}) {
+    kept_isels.insert("ISEL_" + std::string(name));
+  }
+
+  for (const auto &name : isel_names) {
+    kept_isels.insert("ISEL_" + name);
+    kept_isels.insert("COND_" + name);
+    if (!module->getNamedGlobal("ISEL_" + name)) {
+      LOG(WARNING) << "No semantics for instruction " << name << " in module "
+                   << ModuleName(module);
+    }
+  }
+
+  std::unordered_set<llvm::GlobalValue *> live;
+  std::unordered_set<llvm::Constant *> seen;
+  std::vector<llvm::GlobalValue *> work_list;
+  std::vector<llvm::Constant *> const_work_list;
+
+  auto mark = [&](llvm::Value *val) {
+    if (auto gv = llvm::dyn_cast<llvm::GlobalValue>(val)) {
+      if (live.insert(gv).second) {
+        work_list.push_back(gv);
+      }
+    } else if (auto c = llvm::dyn_cast<llvm::Constant>(val)) {
+      if (seen.insert(c).second) {
+        const_work_list.push_back(c);
+      }
+    }
+  };
+
+  // The roots are the kept instruction selections, everything that the rest
+  // of Remill looks up by name (`__remill_*` intrinsics, `__remill_state`,
+  // etc.), and anything else that can't be discarded just because it's
+  // unused. The `llvm.used` lists name every `ISEL_` variable, so they are
+  // rebuilt below instead of being treated as roots.
+  for (auto &gv : module->global_values()) {
+    const auto name = gv.getName();
+    if (name == "llvm.used" || name == "llvm.compiler.used") {
+      continue;
+
+    } else if (name.startswith("ISEL_") || name.startswith("COND_")) {
+      if (kept_isels.count(name.str())) {
+        mark(&gv);
+      }
+
+    } else if (name.startswith("__remill_")) {
+      mark(&gv);
+
+    } else if (!gv.isDiscardableIfUnused()) {
+      mark(&gv);
+    }
+  }
+
+  while (!work_list.empty() || !const_work_list.empty()) {
+    if (!const_work_list.empty()) {
+      auto c = const_work_list.back();
+      const_work_list.pop_back();
+      for (auto &op : c->operands()) {
+        mark(op.get());
+      }
+      continue;
+    }
+
+    auto gv = work_list.back();
+    work_list.pop_back();
+    if (auto func = llvm::dyn_cast<llvm::Function>(gv)) {
+      if (func->hasPersonalityFn()) {
+        mark(func->getPersonalityFn());
+      }
+      for (auto &inst : llvm::instructions(func)) {
+        for (auto &op : inst.operands()) {
+          mark(op.get());
+        }
+      }
+    } else if (auto var = llvm::dyn_cast<llvm::GlobalVariable>(gv)) {
+      if (var->hasInitializer()) {
+        mark(var->getInitializer());
+      }
+    } else if (auto alias = llvm::dyn_cast<llvm::GlobalAlias>(gv)) {
+      mark(alias->getAliasee());
+    }
+  }
+
+  // Remember which members of the `llvm.used` lists survive, then drop the
+  // lists so that they don't keep the dead `ISEL_` variables alive.
+  std::vector<llvm::GlobalValue *> used;
+  std::vector<llvm::GlobalValue *> compiler_used;
+  for (auto [used_name, kept_used] :
+       {std::make_pair("llvm.used", &used),
+        std::make_pair("llvm.compiler.used", &compiler_used)}) {
+    auto used_var = module->getNamedGlobal(used_name);
+    if (!used_var) {
+      continue;
+    }
+    if (used_var->hasInitializer()) {
+      for (auto &op : used_var->getInitializer()->operands()) {
+        auto gv = llvm::dyn_cast<llvm::GlobalValue>(
+            op.get()->stripPointerCasts());
+        if (gv && live.count(gv)) {
+          kept_used->push_back(gv);
+        }
+      }
+    }
+    used_var->eraseFromParent();
+  }
+
+  std::vector<llvm::GlobalValue *> dead;
+  for (auto &gv : module->global_values()) {
+    if (!live.count(&gv)) {
+      dead.push_back(&gv);
+    }
+  }
+
+  // Break the references between dead things before deleting any of them.
+  for (auto gv : dead) {
+    if (auto func = llvm::dyn_cast<llvm::Function>(gv)) {
+      func->dropAllReferences();
+    } else if (auto var = llvm::dyn_cast<llvm::GlobalVariable>(gv)) {
+      var->dropAllReferences();
+    } else if (auto alias = llvm::dyn_cast<llvm::GlobalAlias>(gv)) {
+      alias->setAliasee(llvm::UndefValue::get(alias->getType()));
+    }
+  }
+
+  for (auto gv : dead) {
+    if (!gv->use_empty()) {
+      gv->replaceAllUsesWith(llvm::UndefValue::get(gv->getType()));
+    }
+    gv->eraseFromParent();
+  }
+
+  llvm::appendToUsed(*module, used);
+  llvm::appendToCompilerUsed(*module, compiler_used);
+
+  DLOG(INFO) << "Pruned " << dead.size() << " globals from semantics module "
+             << ModuleName(module);
+
+  // Make sure that the pruned module still has what `IntrinsicTable`,
+  // `Arch::InitFromSemanticsModule`, and the instruction lifter need.
+  auto ok = true;
+  for (const auto &name : IntrinsicTable::FindMissingIntrinsics(module)) {
+    LOG(ERROR) << "Semantics module " << ModuleName(module)
+               << " is missing intrinsic " << name;
+    ok = false;
+  }
+
+  if (!module->getGlobalVariable("__remill_state")) {
+    LOG(ERROR) << "Semantics module " << ModuleName(module)
+               << " is missing __remill_state";
+    ok = false;
+  }
+
+  for (auto name : {kInvalidInstructionISelName,
+                    kUnsupportedInstructionISelName}) {
+    if (!module->getNamedGlobal("ISEL_" + std::string(name))) {
+      LOG(ERROR) << "Semantics module " << ModuleName(module)
+                 << " is missing ISEL_" << name;
+      ok = false;
+    }
+  }
+
+  if (auto error = VerifyModuleMsg(module)) {
+    LOG(ERROR) << "Error verifying pruned semantics module "
+               << ModuleName(module) << ": " << *error;
+    ok = false;
+  }
+
+  return ok;
+}
+
+namespace {
+
+// Attributes that `InferFunctionAttributes` tries to prove of a function.
+struct InferredAttributes {
+  bool no_free{true};
+  bool no_sync{true};
+  bool will_return{true};
+  bool arg_mem_only{true};
+};
+
+// Returns `true` if `ptr` points into memory reachable from an argument, or
+// into a local variable, neither of which count against `argmemonly`.
+static bool IsArgumentOrLocalMemory(const llvm::Value *ptr) {
+  auto base = llvm::getUnderlyingObject(ptr, 0u /* No lookup limit. */);
+  return llvm::isa<llvm::Argument>(base) || llvm::isa<llvm::AllocaInst>(base);
+}
+
+// Prove what we can of `func`, given the attributes of its callees.
+static InferredAttributes InferAttributes(llvm::Function &func) {
+  InferredAttributes attrs;
+
+  // Loops might not terminate.
+  llvm::SmallVector<
+      std::pair<const llvm::BasicBlock *, const llvm::BasicBlock *>, 4>
+      back_edges;
+  llvm::FindFunctionBackedges(func, back_edges);
+  attrs.will_return = back_edges.empty() && !func.doesNotReturn();
+
+  for (auto &inst : llvm::instructions(func)) {
+    if (auto call = llvm::dyn_cast<llvm::CallBase>(&inst)) {
+      auto callee = call->getCalledFunction();
+      if (!callee) {
+        return {false, false, false, false};
+      }
+
+      attrs.no_free &= callee->doesNotFreeMemory();
+      attrs.no_sync &= callee->hasNoSync();
+      attrs.will_return &= callee->willReturn();
+
+      if (callee->doesNotAccessMemory()) {
+        continue;
+      } else if (!callee->onlyAccessesArgMemory()) {
+        attrs.arg_mem_only = false;
+        continue;
+      }
+      for (auto &arg : call->args()) {
+        if (arg->getType()->isPointerTy() &&
+            !IsArgumentOrLocalMemory(arg.get())) {
+          attrs.arg_mem_only = false;
+        }
+      }
+      continue;
+    }
+
+    if (inst.isAtomic() || inst.isVolatile()) {
+      attrs.no_sync = false;
+    }
+
+    const llvm::Value *ptr = nullptr;
+    if (auto load_store_ptr = llvm::getLoadStorePointerOperand(&inst)) {
+      ptr = load_store_ptr;
+    } else if (auto rmw = llvm::dyn_cast<llvm::AtomicRMWInst>(&inst)) {
+      ptr = rmw->getPointerOperand();
+    } else if (auto cmpxchg = llvm::dyn_cast<llvm::AtomicCmpXchgInst>(&inst)) {
+      ptr = cmpxchg->getPointerOperand();
+    } else if (inst.mayReadOrWriteMemory() &&
+               !llvm::isa<llvm::FenceInst>(inst)) {
+      attrs.arg_mem_only = false;  // E.g. `va_arg`.
+    }
+
+    if (ptr && !IsArgumentOrLocalMemory(ptr)) {
+      attrs.arg_mem_only = false;
+    }
+  }
+
+  return attrs;
+}
+
+// Add the attributes that hold of the intrinsics by contract. None of them
+// free memory or loop forever, and the memory access, undefined value, flag
+// and comparison intrinsics don't synchronize with other threads, unlike the
+// barriers and atomic regions.
+static void AddIntrinsicAttributes(const IntrinsicTable &intrinsics) {
+  const auto &i = intrinsics;
+  for (auto func :
+       {i.read_memory_8, i.read_memory_16, i.read_memory_32,
+        i.read_memory_64, i.write_memory_8, i.write_memory_16,
+        i.write_memory_32, i.write_memory_64, i.read_memory_f32,
+        i.read_memory_f64, i.read_memory_f80, i.read_memory_f128,
+        i.write_memory_f32, i.write_memory_f64, i.write_memory_f80,
+        i.write_memory_f128, i.undefined_8, i.undefined_16, i.undefined_32,
+        i.undefined_64, i.undefined_f32, i.undefined_f64, i.undefined_f80,
+        i.flag_computation_zero, i.flag_computation_sign,
+        i.flag_computation_overflow, i.flag_computation_carry,
+        i.compare_sle, i.compare_sgt, i.compare_eq, i.compare_neq}) {
+    func->setDoesNotFreeMemory();
+    func->setNoSync();
+    func->setWillReturn();
+  }
+
+  for (auto func :
+       {i.barrier_load_load, i.barrier_load_store, i.barrier_store_load,
+        i.barrier_store_store, i.atomic_begin, i.atomic_end,
+        i.delay_slot_begin, i.delay_slot_end}) {
+    func->setDoesNotFreeMemory();
+    func->setWillReturn();
+  }
+}
+
+// Mark argument `arg_num` of `func` as pointing to a whole `State`.
+static void AddStateArgumentAttributes(llvm::Function *func, unsigned arg_num,
+                                       uint64_t state_size,
+                                       llvm::Align state_align) {
+  if (func->arg_size() <= arg_num ||
+      !NthArgument(func, arg_num)->getType()->isPointerTy()) {
+    return;
+  }
+  func->addParamAttr(arg_num, llvm::Attribute::NonNull);
+  func->addDereferenceableParamAttr(arg_num, state_size);
+  func->addParamAttr(arg_num, llvm::Attribute::getWithAlignment(
+                                  func->getContext(), state_align));
+}
+
+}  // namespace
+
+// Infer attributes for the lifted functions, semantics functions, and
+// intrinsics in `module`.
+void InferFunctionAttributes(const Arch *arch, llvm::Module *module,
+                             const std::vector<llvm::Function *> &traces) {
+  auto &context = module->getContext();
+  const auto &dl = module->getDataLayout();
+  auto state_type = RecontextualizeType(arch->StateStructType(), context);
+  auto lifted_func_type =
+      RecontextualizeType(arch->LiftedFunctionType(), context);
+  const auto state_size = dl.getTypeAllocSize(state_type).getFixedValue();
+  const auto state_align = dl.getABITypeAlign(state_type);
+
+  auto intrinsics = arch->GetInstrinsicTable();
+  if (intrinsics && intrinsics->error->getParent() == module) {
+    AddIntrinsicAttributes(*intrinsics);
+  }
+
+  // Lifted functions, and the control-flow intrinsics that share their type,
+  // are always given a whole `State`, as are semantics functions. Other
+  // functions can have the same type, e.g. `__remill_fetch_and_add_64`, so
+  // only the known ones are annotated.
+  std::vector<llvm::Function *> lifted_funcs(traces.begin(), traces.end());
+  if (intrinsics && intrinsics->error->getParent() == module) {
+    lifted_funcs.insert(
+        lifted_funcs.end(),
+        {intrinsics->error, intrinsics->function_call,
+         intrinsics->function_return, intrinsics->jump,
+         intrinsics->missing_block, intrinsics->async_hyper_call});
+  }
+  for (auto func : lifted_funcs) {
+    if (func->getParent() == module &&
+        func->getFunctionType() == lifted_func_type) {
+      AddStateArgumentAttributes(func, kStatePointerArgNum, state_size,
+                                 state_align);
+    }
+  }
+  for (auto &global : module->globals()) {
+    if (!global.getName().startswith("ISEL_") || !global.hasInitializer()) {
+      continue;
+    }
+    if (auto sem = llvm::dyn_cast<llvm::Function>(
+            global.getInitializer()->stripPointerCasts())) {
+      AddStateArgumentAttributes(sem, 1u, state_size, state_align);
+    }
+  }
+
+  // Attributes only ever get added, so this reaches a fixed point. Recursive
+  // functions never get the attributes that depend on their callees.
+  for (auto changed = true; changed;) {
+    changed = false;
+    for (auto &func : *module) {
+      if (func.isDeclaration()) {
+        continue;
+      }
+
+      const auto attrs = InferAttributes(func);
+      if (attrs.no_free && !func.doesNotFreeMemory()) {
+        func.setDoesNotFreeMemory();
+        changed = true;
+      }
+      if (attrs.no_sync && !func.hasNoSync()) {
+        func.setNoSync();
+        changed = true;
+      }
+      if (attrs.will_return && !func.willReturn()) {
+        func.setWillReturn();
+        changed = true;
+      }
+      if (attrs.arg_mem_only && !func.doesNotAccessMemory() &&
+          !func.onlyAccessesArgMemory()) {
+        func.setOnlyAccessesArgMemory();
+        changed = true;
+      }
+    }
+  }
+}
+
 }  // namespace remill
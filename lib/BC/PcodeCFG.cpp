@@ -1,8 +1,11 @@
 #include <remill/BC/PCodeCFG.h>
 
+#include <llvm/ADT/APInt.h>
+
 #include <algorithm>
 #include <cstddef>
 #include <map>
+#include <optional>
 #include <sleigh/op.hh>
 #include <sleigh/opcodes.hh>
 #include <sleigh/pcoderaw.hh>
@@ -164,5 +167,441 @@ PcodeBlock::PcodeBlock(size_t base_index, std::vector<RemillPcodeOp> ops,
       ops(std::move(ops)),
       block_exit(std::move(block_exit)) {}
 
+namespace {
+
+// Return `true` if `op` only computes its output from its inputs, and is
+// supported by the lifter, so that it can be folded, or removed if its output
+// is never read.
+static bool IsPureOp(OpCode op) {
+  switch (op) {
+    case CPUI_COPY:
+    case CPUI_CAST:
+    case CPUI_INT_EQUAL:
+    case CPUI_INT_NOTEQUAL:
+    case CPUI_INT_SLESS:
+    case CPUI_INT_SLESSEQUAL:
+    case CPUI_INT_LESS:
+    case CPUI_INT_LESSEQUAL:
+    case CPUI_INT_ZEXT:
+    case CPUI_INT_SEXT:
+    case CPUI_INT_ADD:
+    case CPUI_INT_SUB:
+    case CPUI_INT_CARRY:
+    case CPUI_INT_SCARRY:
+    case CPUI_INT_SBORROW:
+    case CPUI_INT_2COMP:
+    case CPUI_INT_NEGATE:
+    case CPUI_INT_XOR:
+    case CPUI_INT_AND:
+    case CPUI_INT_OR:
+    case CPUI_INT_LEFT:
+    case CPUI_INT_RIGHT:
+    case CPUI_INT_SRIGHT:
+    case CPUI_INT_MULT:
+    case CPUI_BOOL_NEGATE:
+    case CPUI_BOOL_XOR:
+    case CPUI_BOOL_AND:
+    case CPUI_BOOL_OR:
+    case CPUI_SUBPIECE:
+    case CPUI_POPCOUNT: return true;
+    default: return false;
+  }
+}
+
+// Return `true` if `op` may transfer control out of its block.
+static bool IsBranchOp(OpCode op) {
+  switch (op) {
+    case CPUI_BRANCH:
+    case CPUI_CBRANCH:
+    case CPUI_BRANCHIND:
+    case CPUI_CALL:
+    case CPUI_CALLIND:
+    case CPUI_RETURN: return true;
+    default: return false;
+  }
+}
+
+static bool IsInSpace(const VarnodeData &vnode, const char *space_name) {
+  return vnode.space->getName() == space_name;
+}
+
+// Return `true` if `vnode` is a temporary or a register, i.e. if its value can
+// only be changed by an op that outputs to it.
+static bool IsRegisterLike(const VarnodeData &vnode) {
+  return IsInSpace(vnode, "unique") || IsInSpace(vnode, "register");
+}
+
+// Return `true` if `a` and `b` may refer to the same storage. The lifter keys
+// temporaries by their offsets, so varnodes at the same offset always do.
+static bool Overlaps(const VarnodeData &a, const VarnodeData &b) {
+  if (a.space != b.space || isVarnodeInConstantSpace(a)) {
+    return false;
+  }
+  return a.offset == b.offset ||
+         (a.offset < b.offset + b.size && b.offset < a.offset + a.size);
+}
+
+// Return `true` if writing `a` overwrites all of `b`.
+static bool Covers(const VarnodeData &a, const VarnodeData &b) {
+  if (a.space != b.space || a.offset > b.offset ||
+      b.offset + b.size > a.offset + a.size) {
+    return false;
+  }
+  return a.offset == b.offset || !IsInSpace(a, "unique");
+}
+
+static bool IsSameVarnode(const VarnodeData &a, const VarnodeData &b) {
+  return a.space == b.space && a.offset == b.offset && a.size == b.size;
+}
+
+// Return `true` if `op` reads a varnode that `vnode` may refer to.
+static bool Reads(const RemillPcodeOp &op, const VarnodeData &vnode) {
+  return std::any_of(
+      op.vars.begin(), op.vars.end(),
+      [&vnode](const VarnodeData &in) { return Overlaps(in, vnode); });
+}
+
+// Return `true` if input `i` of `op` can be replaced by another varnode of
+// the same size. Branch targets, address space IDs, and the sizes of pieces
+// are taken as they are.
+static bool CanReplaceInput(const RemillPcodeOp &op, size_t i) {
+  switch (op.op) {
+    case CPUI_BRANCH:
+    case CPUI_CALL:
+    case CPUI_CBRANCH:
+    case CPUI_LOAD:
+    case CPUI_STORE: return i != 0;
+    case CPUI_SUBPIECE: return i != 1;
+    case CPUI_PTRADD: return i != 2;
+    default: return true;
+  }
+}
+
+// Return `true` if the constant `cst` can replace input `i` of `op`. The
+// lifter only lifts constants as integers of their own size, and it lifts
+// some inputs as addresses or as bytes.
+static bool CanReplaceInputWithConstant(const RemillPcodeOp &op, size_t i,
+                                        const VarnodeData &cst,
+                                        size_t word_size) {
+  switch (op.op) {
+    case CPUI_LOAD:
+    case CPUI_STORE: return i != 1 || cst.size == word_size;
+    case CPUI_PTRADD:
+    case CPUI_PTRSUB: return i != 0 || cst.size == word_size;
+    case CPUI_BOOL_NEGATE:
+    case CPUI_BOOL_AND:
+    case CPUI_BOOL_OR:
+    case CPUI_BOOL_XOR: return cst.size == 1u;
+    default: return true;
+  }
+}
+
+static llvm::APInt ConstantValue(const VarnodeData &cst) {
+  return llvm::APInt(64u, cst.offset).zextOrTrunc(cst.size * 8u);
+}
+
+static llvm::APInt BoolValue(bool val) {
+  return llvm::APInt(8u, val ? 1u : 0u);
+}
+
+// Compute the output of `op`, whose inputs are all constants, in the same
+// way as the code that the lifter produces for it does. Returns `std::nullopt`
+// if the output can't be folded, e.g. because the lifted code would produce
+// a poison value, or if `op` is already a copy.
+static std::optional<llvm::APInt> FoldConstantOp(const RemillPcodeOp &op) {
+  if (!op.outvar || op.outvar->size > 8u || op.vars.empty() ||
+      !IsPureOp(op.op)) {
+    return std::nullopt;
+  }
+  for (const auto &in : op.vars) {
+    if (!isVarnodeInConstantSpace(in) || in.size > 8u) {
+      return std::nullopt;
+    }
+  }
+
+  const auto out_bits = op.outvar->size * 8u;
+  const auto lhs = ConstantValue(op.vars[0]);
+  const auto width = lhs.getBitWidth();
+
+  if (op.vars.size() == 1u) {
+    switch (op.op) {
+      case CPUI_CAST: return lhs;
+      case CPUI_INT_ZEXT: return lhs.zextOrTrunc(out_bits);
+      case CPUI_INT_SEXT: return lhs.sextOrTrunc(out_bits);
+      case CPUI_INT_2COMP: return -lhs;
+      case CPUI_INT_NEGATE: return ~lhs;
+      case CPUI_BOOL_NEGATE:
+        if (width != 8u) {
+          return std::nullopt;
+        }
+        return BoolValue(lhs.isZero());
+      case CPUI_POPCOUNT: return llvm::APInt(out_bits, lhs.countPopulation());
+      default: return std::nullopt;
+    }
+  }
+
+  if (op.vars.size() != 2u) {
+    return std::nullopt;
+  }
+
+  auto rhs = ConstantValue(op.vars[1]);
+  bool overflow = false;
+  switch (op.op) {
+
+    // Shifted by at least the width, shifts produce zero, but only if the
+    // shift amount is non-negative.
+    case CPUI_INT_LEFT:
+    case CPUI_INT_RIGHT:
+      rhs = rhs.zextOrTrunc(width);
+      if (rhs.ult(width)) {
+        const auto amount = static_cast<unsigned>(rhs.getZExtValue());
+        return op.op == CPUI_INT_LEFT ? lhs.shl(amount) : lhs.lshr(amount);
+      } else if (!rhs.isNegative()) {
+        return llvm::APInt(width, 0u);
+      }
+      return std::nullopt;
+
+    case CPUI_INT_SRIGHT:
+      rhs = rhs.zextOrTrunc(width);
+      if (rhs.ult(width)) {
+        return lhs.ashr(static_cast<unsigned>(rhs.getZExtValue()));
+      }
+      return std::nullopt;
+
+    case CPUI_SUBPIECE:
+      if (op.vars[1].offset >= op.vars[0].size) {
+        return std::nullopt;
+      }
+      return lhs.lshr(static_cast<unsigned>(op.vars[1].offset * 8u))
+          .zextOrTrunc(out_bits);
+
+    default: break;
+  }
+
+  // The remaining ops need inputs of the same size.
+  if (rhs.getBitWidth() != width) {
+    return std::nullopt;
+  }
+
+  switch (op.op) {
+    case CPUI_INT_ADD: return lhs + rhs;
+    case CPUI_INT_SUB: return lhs - rhs;
+    case CPUI_INT_MULT: return lhs * rhs;
+    case CPUI_INT_AND: return lhs & rhs;
+    case CPUI_INT_OR: return lhs | rhs;
+    case CPUI_INT_XOR: return lhs ^ rhs;
+    case CPUI_INT_EQUAL: return BoolValue(lhs.eq(rhs));
+    case CPUI_INT_NOTEQUAL: return BoolValue(lhs.ne(rhs));
+    case CPUI_INT_LESS: return BoolValue(lhs.ult(rhs));
+    case CPUI_INT_SLESS: return BoolValue(lhs.slt(rhs));
+    case CPUI_INT_LESSEQUAL: return BoolValue(lhs.ule(rhs));
+    case CPUI_INT_SLESSEQUAL: return BoolValue(lhs.sle(rhs));
+    case CPUI_INT_CARRY:
+      (void) lhs.uadd_ov(rhs, overflow);
+      return BoolValue(overflow);
+    case CPUI_INT_SCARRY:
+      (void) lhs.sadd_ov(rhs, overflow);
+      return BoolValue(overflow);
+    case CPUI_INT_SBORROW:
+      (void) lhs.ssub_ov(rhs, overflow);
+      return BoolValue(overflow);
+    case CPUI_BOOL_AND:
+    case CPUI_BOOL_OR:
+    case CPUI_BOOL_XOR:
+      if (width != 8u) {
+        return std::nullopt;
+      } else if (op.op == CPUI_BOOL_AND) {
+        return lhs & rhs;
+      } else if (op.op == CPUI_BOOL_OR) {
+        return lhs | rhs;
+      } else {
+        return lhs ^ rhs;
+      }
+    default: return std::nullopt;
+  }
+}
+
+// Forget the definitions in `defs` that writing `out` invalidates, i.e. those
+// of varnodes that `out` may overwrite, and those that read them.
+static void InvalidateDefs(std::vector<RemillPcodeOp> &defs,
+                           const VarnodeData &out) {
+  defs.erase(std::remove_if(defs.begin(), defs.end(),
+                            [&out](const RemillPcodeOp &def) {
+                              return Overlaps(*def.outvar, out) ||
+                                     Reads(def, out);
+                            }),
+             defs.end());
+}
+
+// Propagate copies and extensions of temporaries into later ops of `block`,
+// and fold the ops whose inputs become constants. The definitions of
+// temporaries are only tracked within the block.
+static unsigned PropagateAndFold(PcodeBlock &block, size_t word_size) {
+  unsigned num_changed = 0;
+  std::vector<RemillPcodeOp> defs;
+
+  auto find_def = [&defs](const VarnodeData &vnode) -> const RemillPcodeOp * {
+    for (const auto &def : defs) {
+      if (IsSameVarnode(*def.outvar, vnode)) {
+        return &def;
+      }
+    }
+    return nullptr;
+  };
+
+  for (auto &op : block.ops) {
+    for (size_t i = 0; i < op.vars.size(); ++i) {
+      auto &in = op.vars[i];
+      if (!CanReplaceInput(op, i) || !IsInSpace(in, "unique")) {
+        continue;
+      }
+      auto def = find_def(in);
+      if (!def || def->op != CPUI_COPY) {
+        continue;
+      }
+      const auto &src = def->vars[0];
+      if (isVarnodeInConstantSpace(src)
+              ? CanReplaceInputWithConstant(op, i, src, word_size)
+              : IsRegisterLike(src)) {
+        in = src;
+        ++num_changed;
+      }
+    }
+
+    // A piece at offset zero of an extended varnode is a piece of, or is, the
+    // original varnode.
+    if (op.op == CPUI_SUBPIECE && op.outvar && op.vars.size() == 2u &&
+        !op.vars[1].offset && IsInSpace(op.vars[0], "unique")) {
+      auto def = find_def(op.vars[0]);
+      if (def && (def->op == CPUI_INT_ZEXT || def->op == CPUI_INT_SEXT) &&
+          !IsInSpace(def->vars[0], "ram") &&
+          op.outvar->size <= def->vars[0].size) {
+        op.vars[0] = def->vars[0];
+        if (op.outvar->size == def->vars[0].size) {
+          op.op = CPUI_COPY;
+          op.vars.pop_back();
+        }
+        ++num_changed;
+      }
+    }
+
+    if (auto val = FoldConstantOp(op)) {
+      auto cst = op.vars[0];
+      cst.offset = val->zextOrTrunc(op.outvar->size * 8u).getZExtValue();
+      cst.size = op.outvar->size;
+      op.op = CPUI_COPY;
+      op.vars.assign(1u, cst);
+      ++num_changed;
+    }
+
+    // Stores may write to any memory.
+    if (op.op == CPUI_STORE) {
+      defs.erase(std::remove_if(defs.begin(), defs.end(),
+                                [](const RemillPcodeOp &def) {
+                                  return std::any_of(
+                                      def.vars.begin(), def.vars.end(),
+                                      [](const VarnodeData &in) {
+                                        return IsInSpace(in, "ram");
+                                      });
+                                }),
+                 defs.end());
+    }
+
+    if (op.outvar) {
+      InvalidateDefs(defs, *op.outvar);
+      if (IsPureOp(op.op) && IsInSpace(*op.outvar, "unique") &&
+          !Reads(op, *op.outvar)) {
+        defs.push_back(op);
+      }
+    }
+  }
+  return num_changed;
+}
+
+// Remove the pure ops of `cfg` whose outputs are never read. Temporaries that
+// no op reads are dead, and so are the temporaries and registers that are
+// overwritten later in the same block before being read, and before control
+// can leave the block.
+static unsigned RemoveDeadOps(PcodeCFG &cfg) {
+  std::vector<VarnodeData> reads;
+  for (const auto &[index, block] : cfg.blocks) {
+    for (const auto &op : block.ops) {
+      for (const auto &in : op.vars) {
+        if (IsInSpace(in, "unique")) {
+          reads.push_back(in);
+        }
+      }
+    }
+  }
+
+  unsigned num_removed = 0;
+  for (auto &[index, block] : cfg.blocks) {
+    std::vector<VarnodeData> overwritten;
+    std::vector<RemillPcodeOp> live_ops;
+
+    for (auto it = block.ops.rbegin(); it != block.ops.rend(); ++it) {
+      const auto &op = *it;
+      if (op.outvar && IsPureOp(op.op) && IsRegisterLike(*op.outvar)) {
+        const auto &out = *op.outvar;
+        const auto is_unread =
+            IsInSpace(out, "unique") &&
+            std::none_of(reads.begin(), reads.end(),
+                         [&out](const VarnodeData &in) {
+                           return Overlaps(in, out);
+                         });
+        const auto is_overwritten = std::any_of(
+            overwritten.begin(), overwritten.end(),
+            [&out](const VarnodeData &later) { return Covers(later, out); });
+        if (is_unread || is_overwritten) {
+          ++num_removed;
+          continue;
+        }
+      }
+
+      if (IsBranchOp(op.op)) {
+        overwritten.clear();
+      }
+      if (op.outvar && IsRegisterLike(*op.outvar)) {
+        overwritten.push_back(*op.outvar);
+      }
+      overwritten.erase(std::remove_if(overwritten.begin(), overwritten.end(),
+                                       [&op](const VarnodeData &later) {
+                                         return Reads(op, later);
+                                       }),
+                        overwritten.end());
+      live_ops.push_back(op);
+    }
+
+    std::reverse(live_ops.begin(), live_ops.end());
+    block.ops = std::move(live_ops);
+  }
+  return num_removed;
+}
+
+}  // namespace
+
+void OptimizePcodeCFG(PcodeCFG &cfg, size_t word_size) {
+
+  // Equality claims replace constants by value, so constants of instructions
+  // that make them must stay as they are.
+  for (const auto &[index, block] : cfg.blocks) {
+    for (const auto &op : block.ops) {
+      if (op.op == CPUI_CALLOTHER) {
+        return;
+      }
+    }
+  }
+
+  for (auto changed = true; changed;) {
+    unsigned num_changed = 0;
+    for (auto &[index, block] : cfg.blocks) {
+      num_changed += PropagateAndFold(block, word_size);
+    }
+    num_changed += RemoveDeadOps(cfg);
+    changed = num_changed != 0;
+  }
+}
+
+
 }  // namespace sleigh
 }  // namespace remill
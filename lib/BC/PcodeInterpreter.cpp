@@ -0,0 +1,1135 @@
+/*
+ * Copyright (c) 2026 Trail of Bits, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "remill/BC/PcodeInterpreter.h"
+
+#include <glog/logging.h>
+#include <llvm/ADT/APFloat.h>
+#include <llvm/ADT/APInt.h>
+#include <llvm/ADT/APSInt.h>
+#include <llvm/IR/Constants.h>
+#include <llvm/IR/IRBuilder.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "lib/Arch/Sleigh/Arch.h"
+#include "remill/Arch/Arch.h"
+#include "remill/Arch/Context.h"
+#include "remill/Arch/Instruction.h"
+#include "remill/BC/ABI.h"
+#include "remill/BC/SleighLifter.h"
+
+namespace remill {
+namespace {
+
+static const char kEqualityClaimName[] = "claim_eq";
+
+// Where the value of a varnode lives while its instruction executes.
+struct PcodeLocation {
+  enum Kind : uint8_t {
+
+    // `offset` is the value.
+    kConstant,
+
+    // A register in the `State` structure, at byte offset `offset`.
+    kState,
+
+    // A temporary of the instruction, at byte offset `offset` of its scratch
+    // space. While decoding, `offset` is the index of a scratch slot.
+    kScratch,
+
+    // Guest memory at address `offset`.
+    kMemory,
+  };
+
+  Kind kind{kConstant};
+
+  // Size, in bytes, of the value.
+  uint32_t size{0};
+
+  // Index of the location whose value replaces `offset`, because of an
+  // equality claim, or `-1`.
+  int32_t replacement{-1};
+
+  uint64_t offset{0};
+};
+
+// A p-code op, with its varnodes resolved.
+struct PcodeStep {
+  OpCode op;
+
+  // Is this op a no-op, e.g. an equality claim, which was applied while
+  // decoding? No-ops are kept so that relative branches can index the steps.
+  bool is_nop{false};
+  bool has_out{false};
+  PcodeLocation out;
+  std::vector<PcodeLocation> ins;
+};
+
+// The decoded p-code of an instruction.
+struct DecodedPcode {
+  uint64_t pc{0};
+  uint64_t size{0};
+  Instruction::Category category{Instruction::kCategoryInvalid};
+
+  // Value of the program counter register while the instruction executes.
+  uint64_t pc_value{0};
+
+  std::vector<PcodeStep> steps;
+
+  // Locations whose values replace constants.
+  std::vector<PcodeLocation> replacements;
+
+  // Initial contents of the scratch space, i.e. of the temporaries of the
+  // instruction.
+  std::vector<uint8_t> scratch;
+
+  // Most recently executed successors, most recent first.
+  DecodedPcode *successors[2] = {nullptr, nullptr};
+};
+
+// A temporary of an instruction, before it's been given an offset.
+struct ScratchSlot {
+  uint32_t size{0};
+  uint64_t init{0};
+};
+
+// Return the semantics of a float of `size` bytes, or `nullptr`.
+static const llvm::fltSemantics *FloatSemantics(uint64_t size) {
+  switch (size) {
+    case 2: return &llvm::APFloat::IEEEhalf();
+    case 4: return &llvm::APFloat::IEEEsingle();
+    case 8: return &llvm::APFloat::IEEEdouble();
+    case 16: return &llvm::APFloat::IEEEquad();
+    default: return nullptr;
+  }
+}
+
+// Return the value of the `size` little-endian bytes at `bytes`.
+static llvm::APInt FromBytes(const uint8_t *bytes, size_t size) {
+  std::vector<uint64_t> words((size + 7u) / 8u, 0u);
+  for (size_t i = 0; i < size; ++i) {
+    words[i / 8u] |= static_cast<uint64_t>(bytes[i]) << ((i % 8u) * 8u);
+  }
+  return llvm::APInt(static_cast<unsigned>(size * 8u), words);
+}
+
+// Store `val` as `size` little-endian bytes at `bytes`.
+static void ToBytes(const llvm::APInt &val, uint8_t *bytes, size_t size) {
+  const auto ext_val = val.zextOrTrunc(static_cast<unsigned>(size * 8u));
+  const auto words = ext_val.getRawData();
+  for (size_t i = 0; i < size; ++i) {
+    bytes[i] = static_cast<uint8_t>(words[i / 8u] >> ((i % 8u) * 8u));
+  }
+}
+
+// Return the shift amount `amount`, clamped to `width`.
+static unsigned ShiftAmount(const llvm::APInt &amount, unsigned width) {
+  return amount.uge(width) ? width
+                           : static_cast<unsigned>(amount.getZExtValue());
+}
+
+static llvm::APInt BoolValue(bool val) {
+  return llvm::APInt(8u, val ? 1u : 0u);
+}
+
+}  // namespace
+
+class PcodeInterpreter::Impl {
+ public:
+  Impl(const Arch *arch_, DecodingContext context_,
+       std::function<bool(uint64_t, uint8_t *)> read_byte_,
+       PcodeMemoryReader read_memory_, PcodeMemoryWriter write_memory_);
+
+  bool ReadInstructionBytes(uint64_t pc);
+
+  bool ResolveVarnode(const VarnodeData &vnode, bool allow_replacement,
+                      DecodedPcode &decoded, PcodeLocation &loc);
+
+  bool EncodeOp(const sleigh::RemillPcodeOp &op, DecodedPcode &decoded);
+
+  std::unique_ptr<DecodedPcode> DecodeInstruction(uint64_t pc);
+
+  DecodedPcode *GetOrDecodeInstruction(uint64_t pc);
+
+  DecodedPcode *GetNextInstruction(DecodedPcode *decoded, uint64_t pc);
+
+  uint64_t AddressOf(const PcodeLocation &loc);
+
+  bool Read(const PcodeLocation &loc, llvm::APInt &val);
+
+  bool Write(const PcodeLocation &loc, const llvm::APInt &val);
+
+  bool ReadMemory(uint64_t addr, uint32_t size, llvm::APInt &val);
+
+  bool WriteMemory(uint64_t addr, uint32_t size, const llvm::APInt &val);
+
+  bool ExecuteFloatOp(const PcodeStep &step, llvm::APInt &res);
+
+  bool ExecuteOp(const PcodeStep &step, size_t &index, uint64_t &next_pc,
+                 bool &exited);
+
+  bool Execute(const DecodedPcode &decoded, uint64_t &next_pc);
+
+  void StoreProgramCounter(void *state, uint64_t pc) const;
+
+  const Arch *const arch;
+  const DecodingContext context;
+  const std::function<bool(uint64_t, uint8_t *)> read_byte;
+  const PcodeMemoryReader read_memory;
+  const PcodeMemoryWriter write_memory;
+  const uint64_t addr_mask;
+  const uint64_t max_inst_bytes;
+  const Register *const pc_reg;
+  const bool is_little_endian;
+
+  std::string inst_bytes;
+
+  // Names of the user-defined p-code ops. Looking them up is expensive, so
+  // they're only looked up once.
+  std::vector<std::string> user_op_names;
+  bool has_user_op_names{false};
+
+  // Temporaries of the instruction being decoded.
+  std::vector<ScratchSlot> slots;
+  std::map<std::pair<std::string, uint64_t>, size_t> slot_ids;
+  std::map<uint64_t, size_t> claimed_constants;
+  const sleigh::SleighDecoder *decoder{nullptr};
+  SleighLifter *lifter{nullptr};
+  const ContextValues *context_values{nullptr};
+
+  // State of the instruction being executed.
+  uint8_t *state{nullptr};
+  const DecodedPcode *curr{nullptr};
+  std::vector<uint8_t> scratch;
+
+  std::unordered_map<uint64_t, std::unique_ptr<DecodedPcode>> insts;
+};
+
+PcodeInterpreter::Impl::Impl(
+    const Arch *arch_, DecodingContext context_,
+    std::function<bool(uint64_t, uint8_t *)> read_byte_,
+    PcodeMemoryReader read_memory_, PcodeMemoryWriter write_memory_)
+    : arch(arch_),
+      context(std::move(context_)),
+      read_byte(std::move(read_byte_)),
+      read_memory(std::move(read_memory_)),
+      write_memory(std::move(write_memory_)),
+      addr_mask(~0ull >> (64u - arch->address_size)),
+      max_inst_bytes(arch->MaxInstructionSize(context, true)),
+      pc_reg(arch->RegisterByName(kPCVariableName)),
+      is_little_endian(arch->MemoryAccessIsLittleEndian()) {
+  CHECK(arch->GetInstrinsicTable())
+      << "Architecture must be initialized from a semantics module before "
+      << "it can be interpreted";
+  CHECK(pc_reg) << "Architecture has no program counter register";
+}
+
+// Read the bytes of the instruction at `pc` into `inst_bytes`.
+bool PcodeInterpreter::Impl::ReadInstructionBytes(uint64_t pc) {
+  inst_bytes.clear();
+  for (uint64_t i = 0; i < max_inst_bytes; ++i) {
+    const auto byte_addr = (pc + i) & addr_mask;
+    if (byte_addr < pc) {
+      break;  // 32- or 64-bit address overflow.
+    }
+    uint8_t byte = 0;
+    if (!read_byte(byte_addr, &byte)) {
+      break;
+    }
+    inst_bytes.push_back(static_cast<char>(byte));
+  }
+  return !inst_bytes.empty();
+}
+
+// Resolve `vnode` into `loc`, in the same way as `SleighLifter` does, i.e.
+// registers that aren't in the `State` structure become temporaries of the
+// instruction, and decoding context registers are initialized from the
+// context values.
+bool PcodeInterpreter::Impl::ResolveVarnode(const VarnodeData &vnode,
+                                            bool allow_replacement,
+                                            DecodedPcode &decoded,
+                                            PcodeLocation &loc) {
+  if (!vnode.size) {
+    return false;
+  }
+
+  loc = {};
+  loc.size = vnode.size;
+  loc.offset = vnode.offset;
+
+  const auto &space_name = vnode.space->getName();
+  std::pair<std::string, uint64_t> slot_key;
+  uint64_t slot_init = 0;
+
+  if (space_name == "ram" || space_name == "const") {
+    loc.kind = space_name == "ram" ? PcodeLocation::kMemory
+                                   : PcodeLocation::kConstant;
+    if (allow_replacement) {
+      if (auto it = claimed_constants.find(vnode.offset);
+          it != claimed_constants.end()) {
+        loc.replacement = static_cast<int32_t>(it->second);
+      }
+    }
+    return true;
+
+  } else if (space_name == "unique") {
+    slot_key = {space_name, vnode.offset};
+
+  } else if (space_name == "register") {
+    const auto reg_name = lifter->GetRegisterName(vnode);
+    const auto state_reg_name = lifter->GetStateRegisterName(reg_name);
+    if (!state_reg_name.empty()) {
+      auto reg = arch->RegisterByName(state_reg_name);
+      loc.kind = PcodeLocation::kState;
+      loc.offset = reg->offset;
+      return true;
+    }
+
+    const auto &context_regs = decoder->GetContextRegisterMapping();
+    const auto &context_sizes = context_regs.GetSizeMapping();
+    if (auto size_it = context_sizes.find(reg_name);
+        size_it != context_sizes.end()) {
+      slot_key = {reg_name, 0u};
+      const auto &internal_regs = context_regs.GetInternalRegMapping();
+      if (auto reg_it = internal_regs.find(reg_name);
+          reg_it != internal_regs.end()) {
+        if (auto val_it = context_values->find(reg_it->second);
+            val_it != context_values->end()) {
+          slot_init = val_it->second;
+        }
+      }
+      loc.size = std::max<uint32_t>(loc.size,
+                                    static_cast<uint32_t>(size_it->second));
+
+    // Like the lifter, give registers that aren't in the `State` structure
+    // per-instruction storage.
+    } else {
+      slot_key = {space_name, vnode.offset};
+    }
+
+  } else {
+    DLOG(WARNING) << "Can't interpret varnode in space " << space_name;
+    return false;
+  }
+
+  auto [slot_it, added] = slot_ids.emplace(slot_key, slots.size());
+  if (added) {
+    slots.push_back({loc.size, slot_init});
+  }
+  auto &slot = slots[slot_it->second];
+  slot.size = std::max(slot.size, loc.size);
+
+  loc.kind = PcodeLocation::kScratch;
+  loc.offset = slot_it->second;
+  loc.size = vnode.size;
+  return true;
+}
+
+// Resolve the varnodes of `op`, and append it to the steps of `decoded`.
+bool PcodeInterpreter::Impl::EncodeOp(const sleigh::RemillPcodeOp &op,
+                                      DecodedPcode &decoded) {
+  PcodeStep step;
+  step.op = op.op;
+
+  size_t num_ins = 0;
+  bool needs_out = true;
+  bool is_float = false;
+  switch (op.op) {
+
+    // Equality claims replace constants in later ops with the values of
+    // varnodes. Any other user-defined op isn't interpreted.
+    case CPUI_CALLOTHER: {
+      if (op.vars.empty()) {
+        return false;
+      }
+      if (!has_user_op_names) {
+        user_op_names = lifter->GetUserOpNames();
+        has_user_op_names = true;
+      }
+      const auto index = op.vars[0].offset;
+      if (index >= user_op_names.size() ||
+          user_op_names[index] != kEqualityClaimName || op.vars.size() != 3u ||
+          op.vars[1].space->getName() != "const") {
+        DLOG(WARNING) << "Can't interpret user-defined p-code op";
+        return false;
+      }
+
+      PcodeLocation value_loc;
+      if (!ResolveVarnode(op.vars[2], true, decoded, value_loc)) {
+        return false;
+      }
+      if (claimed_constants.emplace(op.vars[1].offset,
+                                    decoded.replacements.size())
+              .second) {
+        decoded.replacements.push_back(value_loc);
+      }
+      step.is_nop = true;
+      decoded.steps.push_back(std::move(step));
+      return true;
+    }
+
+    case CPUI_BRANCH:
+    case CPUI_CALL:
+    case CPUI_BRANCHIND:
+    case CPUI_CALLIND:
+    case CPUI_RETURN:
+      num_ins = 1;
+      needs_out = false;
+      break;
+
+    case CPUI_CBRANCH:
+      num_ins = 2;
+      needs_out = false;
+      break;
+
+    case CPUI_STORE:
+      num_ins = 3;
+      needs_out = false;
+      break;
+
+    case CPUI_COPY:
+    case CPUI_CAST:
+    case CPUI_INT_ZEXT:
+    case CPUI_INT_SEXT:
+    case CPUI_INT_2COMP:
+    case CPUI_INT_NEGATE:
+    case CPUI_BOOL_NEGATE:
+    case CPUI_POPCOUNT: num_ins = 1; break;
+
+    case CPUI_FLOAT_NEG:
+    case CPUI_FLOAT_ABS:
+    case CPUI_FLOAT_SQRT:
+    case CPUI_FLOAT_CEIL:
+    case CPUI_FLOAT_FLOOR:
+    case CPUI_FLOAT_ROUND:
+    case CPUI_FLOAT_NAN:
+    case CPUI_FLOAT_INT2FLOAT:
+    case CPUI_FLOAT_FLOAT2FLOAT:
+    case CPUI_FLOAT_TRUNC:
+      num_ins = 1;
+      is_float = true;
+      break;
+
+    case CPUI_INT_EQUAL:
+    case CPUI_INT_NOTEQUAL:
+    case CPUI_INT_LESS:
+    case CPUI_INT_SLESS:
+    case CPUI_INT_LESSEQUAL:
+    case CPUI_INT_SLESSEQUAL:
+    case CPUI_INT_CARRY:
+    case CPUI_INT_SCARRY:
+    case CPUI_INT_SBORROW:
+    case CPUI_INT_ADD:
+    case CPUI_INT_SUB:
+    case CPUI_INT_MULT:
+    case CPUI_INT_DIV:
+    case CPUI_INT_SDIV:
+    case CPUI_INT_REM:
+    case CPUI_INT_SREM:
+    case CPUI_INT_AND:
+    case CPUI_INT_OR:
+    case CPUI_INT_XOR:
+    case CPUI_INT_LEFT:
+    case CPUI_INT_RIGHT:
+    case CPUI_INT_SRIGHT:
+    case CPUI_BOOL_AND:
+    case CPUI_BOOL_OR:
+    case CPUI_BOOL_XOR:
+    case CPUI_LOAD:
+    case CPUI_PIECE:
+    case CPUI_SUBPIECE: num_ins = 2; break;
+
+    case CPUI_FLOAT_EQUAL:
+    case CPUI_FLOAT_NOTEQUAL:
+    case CPUI_FLOAT_LESS:
+    case CPUI_FLOAT_LESSEQUAL:
+    case CPUI_FLOAT_ADD:
+    case CPUI_FLOAT_SUB:
+    case CPUI_FLOAT_MULT:
+    case CPUI_FLOAT_DIV:
+      num_ins = 2;
+      is_float = true;
+      break;
+
+    case CPUI_PTRADD:
+    case CPUI_PTRSUB: num_ins = op.op == CPUI_PTRADD ? 3 : 2; break;
+
+    default:
+      DLOG(WARNING) << "Can't interpret p-code op " << get_opname(op.op);
+      return false;
+  }
+
+  if (op.vars.size() != num_ins || (needs_out && !op.outvar) ||
+      (op.op == CPUI_PIECE &&
+       op.vars[0].size + op.vars[1].size != op.outvar->size)) {
+    return false;
+  }
+
+  // Float inputs must be of a size with known semantics, and square roots are
+  // computed by the host.
+  if (is_float) {
+    const auto in_size = op.vars[0].size;
+    if (op.op == CPUI_FLOAT_INT2FLOAT) {
+      if (!FloatSemantics(op.outvar->size)) {
+        return false;
+      }
+    } else if (!FloatSemantics(in_size) ||
+               (op.op == CPUI_FLOAT_FLOAT2FLOAT &&
+                !FloatSemantics(op.outvar->size)) ||
+               (op.op == CPUI_FLOAT_SQRT && in_size != 4u && in_size != 8u)) {
+      return false;
+    }
+  }
+
+  // Direct branch targets are either addresses or relative op indices.
+  if (op.op == CPUI_BRANCH || op.op == CPUI_CALL || op.op == CPUI_CBRANCH) {
+    const auto &target_space = op.vars[0].space->getName();
+    if (target_space != "ram" && target_space != "const") {
+      return false;
+    }
+  }
+
+  step.ins.resize(num_ins);
+  for (size_t i = 0; i < num_ins; ++i) {
+
+    // Like the lifter, take the sizes of pieces and pointer elements as they
+    // are.
+    const auto allow_replacement =
+        !(i == 1u && op.op == CPUI_SUBPIECE) &&
+        !(i == 2u && op.op == CPUI_PTRADD);
+    if (!ResolveVarnode(op.vars[i], allow_replacement, decoded,
+                        step.ins[i])) {
+      return false;
+    }
+  }
+
+  if (op.outvar) {
+    if (!ResolveVarnode(*op.outvar, false, decoded, step.out) ||
+        PcodeLocation::kConstant == step.out.kind) {
+      return false;
+    }
+    step.has_out = true;
+  }
+
+  decoded.steps.push_back(std::move(step));
+  return true;
+}
+
+// Decode the instruction at `pc`, and resolve its p-code.
+std::unique_ptr<DecodedPcode>
+PcodeInterpreter::Impl::DecodeInstruction(uint64_t pc) {
+  if (!ReadInstructionBytes(pc)) {
+    return nullptr;
+  }
+
+  Instruction inst;
+  if (!arch->DecodeInstruction(pc, inst_bytes, inst, context) ||
+      !inst.IsValid() || arch->MayHaveDelaySlot(inst) ||
+      Instruction::kCategoryConditionalAsyncHyperCall == inst.category) {
+    DLOG(INFO) << "Can't interpret instruction at " << std::hex << pc
+               << std::dec;
+    return nullptr;
+  }
+
+  auto sleigh_lifter =
+      std::dynamic_pointer_cast<SleighLifterWithState>(inst.GetLifter());
+  CHECK(sleigh_lifter)
+      << "The p-code interpreter only supports architectures backed by SLEIGH";
+
+  lifter = sleigh_lifter->GetSleighLifter().get();
+  decoder = &(lifter->GetDecoder());
+  context_values = &(sleigh_lifter->GetContextValues());
+
+  auto decoded = std::make_unique<DecodedPcode>();
+  decoded->pc = pc;
+  decoded->size = inst.bytes.size();
+  decoded->category = inst.category;
+
+  // Set up the program counter like `SleighLifter` does. Given a constant
+  // program counter, the builder folds the computation into a constant.
+  llvm::IRBuilder<> ir(*arch->context);
+  const auto pc_value = decoder->LiftPcFromCurrPc(
+      ir, llvm::ConstantInt::get(arch->AddressType(), pc), decoded->size,
+      DecodingContext(*context_values));
+  const auto pc_const = llvm::dyn_cast<llvm::ConstantInt>(pc_value);
+  if (!pc_const) {
+    return nullptr;
+  }
+  decoded->pc_value = pc_const->getZExtValue();
+
+  if (inst.IsError()) {
+    return decoded;
+  }
+
+  slots.clear();
+  slot_ids.clear();
+  claimed_constants.clear();
+
+  for (const auto &op : lifter->DecodePcode(inst, *context_values)) {
+    if (!EncodeOp(op, *decoded)) {
+      DLOG(INFO) << "Can't interpret p-code of instruction at " << std::hex
+                 << pc << std::dec;
+      return nullptr;
+    }
+  }
+
+  // Lay out the temporaries, and turn slot indices into offsets.
+  std::vector<uint64_t> slot_offsets;
+  for (const auto &slot : slots) {
+    slot_offsets.push_back(decoded->scratch.size());
+    uint8_t init[sizeof(uint64_t)] = {};
+    ToBytes(llvm::APInt(64u, slot.init), init, sizeof(init));
+    for (uint32_t i = 0; i < slot.size; ++i) {
+      decoded->scratch.push_back(i < sizeof(init) ? init[i] : 0u);
+    }
+  }
+
+  auto fix_offset = [&slot_offsets](PcodeLocation &loc) {
+    if (PcodeLocation::kScratch == loc.kind) {
+      loc.offset = slot_offsets[loc.offset];
+    }
+  };
+  for (auto &loc : decoded->replacements) {
+    fix_offset(loc);
+  }
+  for (auto &step : decoded->steps) {
+    fix_offset(step.out);
+    for (auto &loc : step.ins) {
+      fix_offset(loc);
+    }
+  }
+
+  return decoded;
+}
+
+// Return the cached p-code of the instruction at `pc`, decoding it if need
+// be.
+DecodedPcode *PcodeInterpreter::Impl::GetOrDecodeInstruction(uint64_t pc) {
+  auto inst_it = insts.find(pc);
+  if (inst_it != insts.end()) {
+    return inst_it->second.get();
+  }
+
+  auto decoded = DecodeInstruction(pc);
+  if (!decoded) {
+    return nullptr;
+  }
+  auto decoded_ptr = decoded.get();
+  insts.emplace(pc, std::move(decoded));
+  return decoded_ptr;
+}
+
+// Return the instruction at `pc` that follows `decoded`.
+DecodedPcode *PcodeInterpreter::Impl::GetNextInstruction(DecodedPcode *decoded,
+                                                         uint64_t pc) {
+  auto &successors = decoded->successors;
+  if (successors[0] && successors[0]->pc == pc) {
+    return successors[0];
+  } else if (successors[1] && successors[1]->pc == pc) {
+    std::swap(successors[0], successors[1]);
+    return successors[0];
+  }
+
+  auto next_decoded = GetOrDecodeInstruction(pc);
+  if (next_decoded) {
+    successors[1] = successors[0];
+    successors[0] = next_decoded;
+  }
+  return next_decoded;
+}
+
+// Return the address or constant of `loc`, after equality claims.
+uint64_t PcodeInterpreter::Impl::AddressOf(const PcodeLocation &loc) {
+  if (0 <= loc.replacement) {
+    llvm::APInt val;
+    if (Read(curr->replacements[loc.replacement], val)) {
+      return val.zextOrTrunc(64u).getZExtValue() & addr_mask;
+    }
+  }
+  return loc.offset & addr_mask;
+}
+
+// Read the value of `loc`.
+bool PcodeInterpreter::Impl::Read(const PcodeLocation &loc,
+                                  llvm::APInt &val) {
+  switch (loc.kind) {
+    case PcodeLocation::kConstant:
+      if (0 <= loc.replacement) {
+        if (!Read(curr->replacements[loc.replacement], val)) {
+          return false;
+        }
+        val = val.zextOrTrunc(loc.size * 8u);
+      } else {
+        val = llvm::APInt(64u, loc.offset).zextOrTrunc(loc.size * 8u);
+      }
+      return true;
+
+    // NOTE: Assumes a little-endian host, like the `State` structure does.
+    case PcodeLocation::kState:
+      val = FromBytes(&(state[loc.offset]), loc.size);
+      return true;
+
+    case PcodeLocation::kScratch:
+      val = FromBytes(&(scratch[loc.offset]), loc.size);
+      return true;
+
+    case PcodeLocation::kMemory:
+      return ReadMemory(AddressOf(loc), loc.size, val);
+  }
+  return false;
+}
+
+// Write `val` to `loc`, truncating or zero-extending it to the size of `loc`.
+bool PcodeInterpreter::Impl::Write(const PcodeLocation &loc,
+                                   const llvm::APInt &val) {
+  switch (loc.kind) {
+    case PcodeLocation::kConstant: return false;
+
+    case PcodeLocation::kState:
+      ToBytes(val, &(state[loc.offset]), loc.size);
+      return true;
+
+    case PcodeLocation::kScratch:
+      ToBytes(val, &(scratch[loc.offset]), loc.size);
+      return true;
+
+    case PcodeLocation::kMemory:
+      return WriteMemory(AddressOf(loc), loc.size, val);
+  }
+  return false;
+}
+
+// Read the `size`-byte value at `addr` of guest memory.
+bool PcodeInterpreter::Impl::ReadMemory(uint64_t addr, uint32_t size,
+                                        llvm::APInt &val) {
+  std::vector<uint8_t> bytes(size);
+  if (!read_memory(addr, bytes.data(), size)) {
+    return false;
+  }
+  if (!is_little_endian) {
+    std::reverse(bytes.begin(), bytes.end());
+  }
+  val = FromBytes(bytes.data(), size);
+  return true;
+}
+
+// Write the `size`-byte value `val` to `addr` of guest memory.
+bool PcodeInterpreter::Impl::WriteMemory(uint64_t addr, uint32_t size,
+                                         const llvm::APInt &val) {
+  std::vector<uint8_t> bytes(size);
+  ToBytes(val, bytes.data(), size);
+  if (!is_little_endian) {
+    std::reverse(bytes.begin(), bytes.end());
+  }
+  return write_memory(addr, bytes.data(), size);
+}
+
+// Compute the result of the float op `step` into `res`.
+bool PcodeInterpreter::Impl::ExecuteFloatOp(const PcodeStep &step,
+                                            llvm::APInt &res) {
+  llvm::APInt lhs_bits;
+  if (!Read(step.ins[0], lhs_bits)) {
+    return false;
+  }
+
+  const auto out_size = step.out.size;
+  if (step.op == CPUI_FLOAT_INT2FLOAT) {
+    llvm::APFloat out(*FloatSemantics(out_size));
+    out.convertFromAPInt(lhs_bits, true, llvm::APFloat::rmNearestTiesToEven);
+    res = out.bitcastToAPInt();
+    return true;
+  }
+
+  llvm::APFloat lhs(*FloatSemantics(step.ins[0].size), lhs_bits);
+  switch (step.op) {
+    case CPUI_FLOAT_NEG: lhs.changeSign(); break;
+    case CPUI_FLOAT_ABS: lhs.clearSign(); break;
+    case CPUI_FLOAT_SQRT:
+      if (step.ins[0].size == 4u) {
+        lhs = llvm::APFloat(std::sqrt(lhs.convertToFloat()));
+      } else {
+        lhs = llvm::APFloat(std::sqrt(lhs.convertToDouble()));
+      }
+      break;
+    case CPUI_FLOAT_CEIL:
+      lhs.roundToIntegral(llvm::APFloat::rmTowardPositive);
+      break;
+    case CPUI_FLOAT_FLOOR:
+      lhs.roundToIntegral(llvm::APFloat::rmTowardNegative);
+      break;
+    case CPUI_FLOAT_ROUND:
+      lhs.roundToIntegral(llvm::APFloat::rmNearestTiesToAway);
+      break;
+    case CPUI_FLOAT_NAN: res = BoolValue(lhs.isNaN()); return true;
+    case CPUI_FLOAT_FLOAT2FLOAT: {
+      bool loses_info = false;
+      lhs.convert(*FloatSemantics(out_size),
+                  llvm::APFloat::rmNearestTiesToEven, &loses_info);
+      break;
+    }
+    case CPUI_FLOAT_TRUNC: {
+      llvm::APSInt out(out_size * 8u, false);
+      bool is_exact = false;
+      lhs.convertToInteger(out, llvm::APFloat::rmTowardZero, &is_exact);
+      res = out;
+      return true;
+    }
+    default: {
+      llvm::APInt rhs_bits;
+      if (!Read(step.ins[1], rhs_bits)) {
+        return false;
+      }
+      llvm::APFloat rhs(*FloatSemantics(step.ins[1].size), rhs_bits);
+      const auto cmp = lhs.compare(rhs);
+      switch (step.op) {
+        case CPUI_FLOAT_EQUAL:
+          res = BoolValue(llvm::APFloat::cmpEqual == cmp);
+          return true;
+        case CPUI_FLOAT_NOTEQUAL:
+          res = BoolValue(llvm::APFloat::cmpEqual != cmp);
+          return true;
+        case CPUI_FLOAT_LESS:
+          res = BoolValue(llvm::APFloat::cmpLessThan == cmp);
+          return true;
+        case CPUI_FLOAT_LESSEQUAL:
+          res = BoolValue(llvm::APFloat::cmpLessThan == cmp ||
+                          llvm::APFloat::cmpEqual == cmp);
+          return true;
+        case CPUI_FLOAT_ADD:
+          lhs.add(rhs, llvm::APFloat::rmNearestTiesToEven);
+          break;
+        case CPUI_FLOAT_SUB:
+          lhs.subtract(rhs, llvm::APFloat::rmNearestTiesToEven);
+          break;
+        case CPUI_FLOAT_MULT:
+          lhs.multiply(rhs, llvm::APFloat::rmNearestTiesToEven);
+          break;
+        case CPUI_FLOAT_DIV:
+          lhs.divide(rhs, llvm::APFloat::rmNearestTiesToEven);
+          break;
+        default: return false;
+      }
+      break;
+    }
+  }
+  res = lhs.bitcastToAPInt();
+  return true;
+}
+
+// Execute the op `step`, at index `index` of the current instruction. Updates
+// `index` to that of the next op, or sets `exited` and `next_pc` if control
+// leaves the instruction. Returns `false` if the op faulted.
+bool PcodeInterpreter::Impl::ExecuteOp(const PcodeStep &step, size_t &index,
+                                       uint64_t &next_pc, bool &exited) {
+  if (step.is_nop) {
+    index += 1u;
+    return true;
+  }
+
+  const auto &ins = step.ins;
+  llvm::APInt lhs;
+  llvm::APInt rhs;
+  llvm::APInt res;
+
+  switch (step.op) {
+
+    // Direct branches to constants are relative to the current op.
+    case CPUI_BRANCH:
+    case CPUI_CALL:
+      if (PcodeLocation::kConstant == ins[0].kind) {
+        index += ins[0].offset;
+      } else {
+        next_pc = AddressOf(ins[0]);
+        exited = true;
+      }
+      return true;
+
+    case CPUI_CBRANCH:
+      if (!Read(ins[1], rhs)) {
+        return false;
+      }
+      if (!rhs[0]) {
+        index += 1u;
+      } else if (PcodeLocation::kConstant == ins[0].kind) {
+        index += ins[0].offset;
+      } else {
+        next_pc = AddressOf(ins[0]);
+        exited = true;
+      }
+      return true;
+
+    case CPUI_BRANCHIND:
+    case CPUI_CALLIND:
+    case CPUI_RETURN:
+      if (!Read(ins[0], lhs)) {
+        return false;
+      }
+      next_pc = lhs.zextOrTrunc(64u).getZExtValue() & addr_mask;
+      exited = true;
+      return true;
+
+    case CPUI_LOAD:
+      if (!Read(ins[1], rhs) ||
+          !ReadMemory(rhs.zextOrTrunc(64u).getZExtValue() & addr_mask,
+                      step.out.size, res)) {
+        return false;
+      }
+      break;
+
+    case CPUI_STORE:
+      index += 1u;
+      return Read(ins[1], lhs) && Read(ins[2], rhs) &&
+             WriteMemory(lhs.zextOrTrunc(64u).getZExtValue() & addr_mask,
+                         ins[2].size, rhs);
+
+    case CPUI_FLOAT_NEG:
+    case CPUI_FLOAT_ABS:
+    case CPUI_FLOAT_SQRT:
+    case CPUI_FLOAT_CEIL:
+    case CPUI_FLOAT_FLOOR:
+    case CPUI_FLOAT_ROUND:
+    case CPUI_FLOAT_NAN:
+    case CPUI_FLOAT_INT2FLOAT:
+    case CPUI_FLOAT_FLOAT2FLOAT:
+    case CPUI_FLOAT_TRUNC:
+    case CPUI_FLOAT_EQUAL:
+    case CPUI_FLOAT_NOTEQUAL:
+    case CPUI_FLOAT_LESS:
+    case CPUI_FLOAT_LESSEQUAL:
+    case CPUI_FLOAT_ADD:
+    case CPUI_FLOAT_SUB:
+    case CPUI_FLOAT_MULT:
+    case CPUI_FLOAT_DIV:
+      if (!ExecuteFloatOp(step, res)) {
+        return false;
+      }
+      break;
+
+    default: {
+      if (!Read(ins[0], lhs)) {
+        return false;
+      }
+      if (1u < ins.size() && !Read(ins[1], rhs)) {
+        return false;
+      }
+
+      const auto out_bits = step.out.size * 8u;
+      const auto width = lhs.getBitWidth();
+      bool overflow = false;
+
+      // Shift amounts and pointer offsets may be of any size, but the inputs
+      // of other binary ops are of the same size.
+      if (1u < ins.size() && step.op != CPUI_INT_LEFT &&
+          step.op != CPUI_INT_RIGHT && step.op != CPUI_INT_SRIGHT &&
+          step.op != CPUI_PIECE && step.op != CPUI_SUBPIECE) {
+        rhs = rhs.zextOrTrunc(width);
+      }
+
+      switch (step.op) {
+        case CPUI_COPY:
+        case CPUI_CAST: res = lhs; break;
+        case CPUI_INT_ZEXT: res = lhs.zextOrTrunc(out_bits); break;
+        case CPUI_INT_SEXT: res = lhs.sextOrTrunc(out_bits); break;
+        case CPUI_INT_2COMP: res = -lhs; break;
+        case CPUI_INT_NEGATE: res = ~lhs; break;
+        case CPUI_BOOL_NEGATE: res = BoolValue(lhs.isZero()); break;
+        case CPUI_POPCOUNT:
+          res = llvm::APInt(out_bits, lhs.countPopulation());
+          break;
+        case CPUI_INT_EQUAL: res = BoolValue(lhs.eq(rhs)); break;
+        case CPUI_INT_NOTEQUAL: res = BoolValue(lhs.ne(rhs)); break;
+        case CPUI_INT_LESS: res = BoolValue(lhs.ult(rhs)); break;
+        case CPUI_INT_SLESS: res = BoolValue(lhs.slt(rhs)); break;
+        case CPUI_INT_LESSEQUAL: res = BoolValue(lhs.ule(rhs)); break;
+        case CPUI_INT_SLESSEQUAL: res = BoolValue(lhs.sle(rhs)); break;
+        case CPUI_INT_CARRY:
+          (void) lhs.uadd_ov(rhs, overflow);
+          res = BoolValue(overflow);
+          break;
+        case CPUI_INT_SCARRY:
+          (void) lhs.sadd_ov(rhs, overflow);
+          res = BoolValue(overflow);
+          break;
+        case CPUI_INT_SBORROW:
+          (void) lhs.ssub_ov(rhs, overflow);
+          res = BoolValue(overflow);
+          break;
+        case CPUI_INT_ADD: res = lhs + rhs; break;
+        case CPUI_INT_SUB: res = lhs - rhs; break;
+        case CPUI_INT_MULT: res = lhs * rhs; break;
+        case CPUI_INT_DIV:
+        case CPUI_INT_SDIV:
+        case CPUI_INT_REM:
+        case CPUI_INT_SREM:
+          if (rhs.isZero()) {
+            return false;
+          } else if (step.op == CPUI_INT_DIV) {
+            res = lhs.udiv(rhs);
+          } else if (step.op == CPUI_INT_SDIV) {
+            res = lhs.sdiv(rhs);
+          } else if (step.op == CPUI_INT_REM) {
+            res = lhs.urem(rhs);
+          } else {
+            res = lhs.srem(rhs);
+          }
+          break;
+        case CPUI_INT_AND: res = lhs & rhs; break;
+        case CPUI_INT_OR: res = lhs | rhs; break;
+        case CPUI_INT_XOR: res = lhs ^ rhs; break;
+        case CPUI_INT_LEFT: res = lhs.shl(ShiftAmount(rhs, width)); break;
+        case CPUI_INT_RIGHT: res = lhs.lshr(ShiftAmount(rhs, width)); break;
+        case CPUI_INT_SRIGHT: res = lhs.ashr(ShiftAmount(rhs, width)); break;
+        case CPUI_BOOL_AND: res = BoolValue(lhs[0] && rhs[0]); break;
+        case CPUI_BOOL_OR: res = BoolValue(lhs[0] || rhs[0]); break;
+        case CPUI_BOOL_XOR: res = BoolValue(lhs[0] != rhs[0]); break;
+        case CPUI_PIECE:
+          res = lhs.zext(out_bits).shl(rhs.getBitWidth()) |
+                rhs.zext(out_bits);
+          break;
+        case CPUI_SUBPIECE:
+          res = lhs.lshr(ShiftAmount(
+              llvm::APInt(64u, ins[1].offset * 8u), width));
+          break;
+        case CPUI_PTRADD: {
+          llvm::APInt elem_size;
+          if (!Read(ins[2], elem_size)) {
+            return false;
+          }
+          res = lhs + rhs * elem_size.zextOrTrunc(width);
+          break;
+        }
+        case CPUI_PTRSUB: res = lhs + rhs; break;
+        default: return false;
+      }
+      break;
+    }
+  }
+
+  index += 1u;
+  return Write(step.out, res);
+}
+
+// Execute the p-code of `decoded` on the current state, and compute the
+// address of the next instruction into `next_pc`.
+bool PcodeInterpreter::Impl::Execute(const DecodedPcode &decoded,
+                                     uint64_t &next_pc) {
+  curr = &decoded;
+  scratch = decoded.scratch;
+
+  // Set up the program counter like `SleighLifter` does, with `next_pc`
+  // standing in for `NEXT_PC`.
+  StoreProgramCounter(state, decoded.pc_value);
+  next_pc = (decoded.pc + decoded.size) & addr_mask;
+
+  const auto &steps = decoded.steps;
+  auto exited = false;
+  for (size_t index = 0; !exited && index < steps.size();) {
+    if (!ExecuteOp(steps[index], index, next_pc, exited)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Store `pc` into the program counter register of `state`.
+//
+// NOTE: Assumes a little-endian host, like the `State` structure does.
+void PcodeInterpreter::Impl::StoreProgramCounter(void *state,
+                                                 uint64_t pc) const {
+  memcpy(static_cast<uint8_t *>(state) + pc_reg->offset, &pc,
+         std::min<uint64_t>(pc_reg->size, sizeof(pc)));
+}
+
+PcodeInterpreter::~PcodeInterpreter(void) {}
+
+PcodeInterpreter::PcodeInterpreter(
+    const Arch *arch, std::function<bool(uint64_t, uint8_t *)> read_byte,
+    PcodeMemoryReader read_memory, PcodeMemoryWriter write_memory)
+    : PcodeInterpreter(arch, arch->CreateInitialContext(),
+                       std::move(read_byte), std::move(read_memory),
+                       std::move(write_memory)) {}
+
+PcodeInterpreter::PcodeInterpreter(
+    const Arch *arch, DecodingContext context,
+    std::function<bool(uint64_t, uint8_t *)> read_byte,
+    PcodeMemoryReader read_memory, PcodeMemoryWriter write_memory)
+    : impl(new Impl(arch, std::move(context), std::move(read_byte),
+                    std::move(read_memory), std::move(write_memory))) {}
+
+// Execute the code starting at `pc` on `state`.
+InterpreterExit PcodeInterpreter::Run(void *state, uint64_t &pc,
+                                      uint64_t max_instructions) {
+  uint64_t num_executed = 0;
+  InterpreterExit exit = InterpreterExit::kUninterpretable;
+  impl->state = static_cast<uint8_t *>(state);
+
+  for (auto decoded = impl->GetOrDecodeInstruction(pc);
+       decoded; decoded = impl->GetNextInstruction(decoded, pc)) {
+    if (num_executed >= max_instructions) {
+      exit = InterpreterExit::kMaxInstructions;
+      break;
+    }
+
+    if (Instruction::kCategoryError == decoded->category) {
+      exit = InterpreterExit::kError;
+      break;
+    }
+
+    uint64_t next_pc = 0;
+    if (!impl->Execute(*decoded, next_pc)) {
+      exit = InterpreterExit::kFault;
+      break;
+    }
+    num_executed += 1u;
+
+    pc = next_pc;
+    if (Instruction::kCategoryAsyncHyperCall == decoded->category) {
+      exit = InterpreterExit::kAsyncHyperCall;
+      break;
+    }
+  }
+
+  impl->StoreProgramCounter(state, pc);
+  return exit;
+}
+
+// Forget the decoded instructions whose bytes overlap `[begin, end)`.
+void PcodeInterpreter::Invalidate(uint64_t begin, uint64_t end) {
+  for (auto it = impl->insts.begin(); it != impl->insts.end();) {
+    const auto &decoded = it->second;
+    if (decoded->pc < end && begin < decoded->pc + decoded->size) {
+      it = impl->insts.erase(it);
+    } else {
+      ++it;
+    }
+  }
+
+  // Surviving instructions may have been chained to forgotten ones.
+  for (auto &[pc, decoded] : impl->insts) {
+    decoded->successors[0] = nullptr;
+    decoded->successors[1] = nullptr;
+  }
+}
+
+}  // namespace remill
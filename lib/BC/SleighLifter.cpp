@@ -484,18 +484,8 @@ class SleighLifter::PcodeToLLVMEmitIntoBlock {
 
   std::optional<ParamPtr> LiftNormalRegister(llvm::IRBuilder<> &bldr,
                                              std::string reg_name) {
-    for (auto &c : reg_name) {
-      c = toupper(c);
-    }
-    const auto &remappings =
-        this->insn_lifter_parent.decoder.GetStateRegRemappings();
-
-    if (auto el = remappings.find(reg_name); el != remappings.end()) {
-      DLOG(INFO) << "Remapping to " << el->second;
-      reg_name = el->second;
-    }
-
-    if (this->insn_lifter_parent.ArchHasRegByName(reg_name)) {
+    reg_name = this->insn_lifter_parent.GetStateRegisterName(reg_name);
+    if (!reg_name.empty()) {
       // TODO(Ian): will probably need to adjust the pointer here in certain circumstances
       auto reg_ptr = this->insn_lifter_parent.LoadRegAddress(
           bldr.GetInsertBlock(), this->state_pointer, reg_name);
@@ -1575,12 +1565,12 @@ std::map<OpCode, SleighLifter::PcodeToLLVMEmitIntoBlock::BinaryOperator>
          }},
         {OpCode::CPUI_INT_LESSEQUAL,
          [](llvm::Value *lhs, llvm::Value *rhs, llvm::IRBuilder<> &bldr) {
-           return bldr.CreateZExt(bldr.CreateICmpSLE(lhs, rhs),
+           return bldr.CreateZExt(bldr.CreateICmpULE(lhs, rhs),
                                   llvm::IntegerType::get(bldr.getContext(), 8));
          }},
         {OpCode::CPUI_INT_SLESSEQUAL,
          [](llvm::Value *lhs, llvm::Value *rhs, llvm::IRBuilder<> &bldr) {
-           return bldr.CreateZExt(bldr.CreateICmpULE(lhs, rhs),
+           return bldr.CreateZExt(bldr.CreateICmpSLE(lhs, rhs),
                                   llvm::IntegerType::get(bldr.getContext(), 8));
          }},
         {OpCode::CPUI_INT_CARRY,
@@ -1656,13 +1646,8 @@ SleighLifter::LiftIntoInternalBlockWithSleighState(
     const sleigh::MaybeBranchTakenVar &btaken,
     const ContextValues &context_values) {
 
-  this->sleigh_context->resetContext();
-  this->decoder.InitializeSleighContext(inst.pc, *this->sleigh_context,
-                                        context_values);
-
-  sleigh::PcodeDecoder pcode_record(this->GetEngine());
-  sleigh_context->oneInstruction(inst.pc, pcode_record, inst.bytes);
-  for (const auto &op : pcode_record.ops) {
+  const auto ops = this->DecodePcode(inst, context_values);
+  for (const auto &op : ops) {
     DLOG(INFO) << "Pcodeop: " << DumpPcode(this->GetEngine(), op);
   }
 
@@ -1688,7 +1673,8 @@ SleighLifter::LiftIntoInternalBlockWithSleighState(
   //TODO(Ian): make a safe to use sleighinstruction context that wraps a context with an arch to preform reset reinits
 
 
-  auto cfg = sleigh::CreateCFG(pcode_record.ops);
+  auto cfg = sleigh::CreateCFG(ops);
+  sleigh::OptimizePcodeCFG(cfg, inst.arch->address_size / 8u);
 
 
   SleighLifter::PcodeToLLVMEmitIntoBlock::DecodingContextConstants
@@ -1787,6 +1773,48 @@ LiftStatus SleighLifter::LiftIntoBlockWithSleighState(
   return res.first;
 }
 
+std::vector<sleigh::RemillPcodeOp>
+SleighLifter::DecodePcode(const Instruction &inst,
+                          const ContextValues &context_values) {
+  this->sleigh_context->resetContext();
+  this->decoder.InitializeSleighContext(inst.pc, *this->sleigh_context,
+                                        context_values);
+
+  sleigh::PcodeDecoder pcode_record(this->GetEngine());
+  sleigh_context->oneInstruction(inst.pc, pcode_record, inst.bytes);
+  return std::move(pcode_record.ops);
+}
+
+std::string SleighLifter::GetRegisterName(const VarnodeData &vnode) const {
+  return this->GetEngine().getRegisterName(vnode.space, vnode.offset,
+                                           vnode.size);
+}
+
+std::string SleighLifter::GetStateRegisterName(std::string reg_name) {
+  for (auto &c : reg_name) {
+    c = toupper(c);
+  }
+  const auto &remappings = this->decoder.GetStateRegRemappings();
+
+  if (auto el = remappings.find(reg_name); el != remappings.end()) {
+    DLOG(INFO) << "Remapping to " << el->second;
+    reg_name = el->second;
+  }
+
+  if (!this->ArchHasRegByName(reg_name)) {
+    return {};
+  }
+  return reg_name;
+}
+
+std::vector<std::string> SleighLifter::GetUserOpNames(void) {
+  return this->sleigh_context->getUserOpNames();
+}
+
+const sleigh::SleighDecoder &SleighLifter::GetDecoder(void) const {
+  return this->decoder;
+}
+
 Sleigh &SleighLifter::GetEngine(void) const {
   return this->sleigh_context->GetEngine();
 }
@@ -0,0 +1,257 @@
+/*
+ * Copyright (c) 2026 Trail of Bits, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "remill/BC/TieredOptimizer.h"
+
+#include <glog/logging.h>
+#include <llvm/IR/DerivedTypes.h>
+#include <llvm/IR/Function.h>
+#include <llvm/IR/LLVMContext.h>
+#include <llvm/IR/Module.h>
+
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "remill/Arch/Arch.h"
+#include "remill/Arch/Name.h"
+#include "remill/BC/Util.h"
+
+namespace remill {
+namespace {
+
+// A trace copied into a module of its own `llvm::LLVMContext`, so that it can
+// be handed off between threads.
+struct TraceCopy {
+  uint64_t pc{0};
+  std::unique_ptr<llvm::LLVMContext> context;
+  std::unique_ptr<llvm::Module> module;
+  llvm::Function *func{nullptr};
+};
+
+// Copy the trace `func` for the code at `pc` into a new context.
+static TraceCopy CopyTrace(uint64_t pc, llvm::Function *func) {
+  const auto source_module = func->getParent();
+
+  TraceCopy copy;
+  copy.pc = pc;
+  copy.context = std::make_unique<llvm::LLVMContext>();
+  copy.module = std::make_unique<llvm::Module>(source_module->getName(),
+                                               *copy.context);
+  copy.module->setDataLayout(source_module->getDataLayout());
+  copy.module->setTargetTriple(source_module->getTargetTriple());
+
+  auto func_type = llvm::dyn_cast<llvm::FunctionType>(
+      RecontextualizeType(func->getFunctionType(), *copy.context));
+  copy.func =
+      llvm::Function::Create(func_type, llvm::GlobalValue::ExternalLinkage,
+                             func->getName(), copy.module.get());
+  CloneFunctionInto(func, copy.func);
+  return copy;
+}
+
+}  // namespace
+
+class TieredOptimizer::Impl {
+ public:
+  Impl(const Arch *arch_, unsigned num_threads, uint64_t hot_threshold_,
+       OptimizationGuide guide_);
+
+  ~Impl(void);
+
+  // Main loop of a worker thread.
+  void Work(void);
+
+  // Optimize the trace in `job` within `semantics`, and return a copy of the
+  // optimized trace.
+  TraceCopy Optimize(const Arch *arch, llvm::Module *semantics,
+                     const TraceCopy &job);
+
+  const OSName os_name;
+  const ArchName arch_name;
+  const uint64_t hot_threshold;
+  const OptimizationGuide guide;
+
+  struct TraceInfo {
+    llvm::Function *trace{nullptr};
+    uint64_t num_executions{0};
+    bool queued{false};
+  };
+
+  // Execution counts of the tier 0 traces. Only used by the owning thread.
+  std::unordered_map<uint64_t, TraceInfo> traces;
+
+  // Shared between the owning thread and the workers.
+  std::mutex lock;
+  std::condition_variable jobs_cond;
+  std::condition_variable idle_cond;
+  std::deque<TraceCopy> jobs;
+  std::vector<TraceCopy> results;
+  unsigned num_busy_workers{0};
+  bool stop{false};
+
+  std::vector<std::thread> workers;
+};
+
+TieredOptimizer::Impl::Impl(const Arch *arch_, unsigned num_threads,
+                            uint64_t hot_threshold_, OptimizationGuide guide_)
+    : os_name(arch_->os_name),
+      arch_name(arch_->arch_name),
+      hot_threshold(hot_threshold_),
+      guide(guide_) {
+  CHECK_LT(0u, num_threads) << "Tiered optimizer needs at least one worker";
+  for (auto i = 0u; i < num_threads; ++i) {
+    workers.emplace_back(&Impl::Work, this);
+  }
+}
+
+TieredOptimizer::Impl::~Impl(void) {
+  {
+    std::lock_guard<std::mutex> locker(lock);
+    stop = true;
+  }
+  jobs_cond.notify_all();
+  for (auto &worker : workers) {
+    worker.join();
+  }
+}
+
+// Main loop of a worker thread.
+void TieredOptimizer::Impl::Work(void) {
+  llvm::LLVMContext context;
+  Arch::ArchPtr arch;
+  std::unique_ptr<llvm::Module> semantics;
+  {
+    auto locker = Arch::Lock(arch_name);
+    arch = Arch::Build(&context, os_name, arch_name);
+    CHECK(arch) << "Unable to build architecture " << GetArchName(arch_name);
+    semantics = LoadArchSemantics(arch.get());
+  }
+
+  for (;;) {
+    TraceCopy job;
+    {
+      std::unique_lock<std::mutex> locker(lock);
+      jobs_cond.wait(locker, [this] { return stop || !jobs.empty(); });
+      if (stop) {
+        return;
+      }
+      job = std::move(jobs.front());
+      jobs.pop_front();
+      ++num_busy_workers;
+    }
+
+    auto result = Optimize(arch.get(), semantics.get(), job);
+
+    {
+      std::lock_guard<std::mutex> locker(lock);
+      results.push_back(std::move(result));
+      --num_busy_workers;
+    }
+    idle_cond.notify_all();
+  }
+}
+
+// Optimize the trace in `job` within `semantics`, and return a copy of the
+// optimized trace.
+TraceCopy TieredOptimizer::Impl::Optimize(const Arch *arch,
+                                          llvm::Module *semantics,
+                                          const TraceCopy &job) {
+  DLOG(INFO) << "Optimizing hot trace at address " << std::hex << job.pc
+             << std::dec;
+
+  // An earlier job may have left behind a declaration of this trace, e.g. if
+  // it tail-called this trace.
+  const auto name = job.func->getName().str();
+  auto func = semantics->getFunction(name);
+  if (!func) {
+    func = arch->DeclareLiftedFunction(name, semantics);
+  }
+  CHECK(func->isDeclaration());
+
+  CloneFunctionInto(job.func, func);
+  const std::map<uint64_t, llvm::Function *> traces = {{job.pc, func}};
+  OptimizeModule(arch, semantics, traces, guide);
+  auto result = CopyTrace(job.pc, func);
+
+  // Keep the semantics module from growing from one job to the next.
+  func->deleteBody();
+  return result;
+}
+
+TieredOptimizer::~TieredOptimizer(void) {}
+
+TieredOptimizer::TieredOptimizer(const Arch *arch_, unsigned num_threads,
+                                 uint64_t hot_threshold,
+                                 OptimizationGuide guide)
+    : impl(new Impl(arch_, num_threads, hot_threshold, guide)) {}
+
+void TieredOptimizer::NullCallback(uint64_t, llvm::Function *) {}
+
+// Count one execution of the tier 0 trace `trace` whose entry is `pc`.
+bool TieredOptimizer::RecordExecution(uint64_t pc, llvm::Function *trace) {
+  auto &info = impl->traces[pc];
+  info.trace = trace;
+  if (info.queued || ++info.num_executions < impl->hot_threshold) {
+    return false;
+  }
+
+  info.queued = true;
+  auto job = CopyTrace(pc, trace);
+  {
+    std::lock_guard<std::mutex> locker(impl->lock);
+    impl->jobs.push_back(std::move(job));
+  }
+  impl->jobs_cond.notify_one();
+  return true;
+}
+
+// Replace the bodies of the hot traces whose optimized versions are ready.
+unsigned TieredOptimizer::SwapInOptimizedTraces(
+    std::function<void(uint64_t, llvm::Function *)> callback) {
+  std::vector<TraceCopy> ready;
+  {
+    std::lock_guard<std::mutex> locker(impl->lock);
+    ready.swap(impl->results);
+  }
+
+  auto num_swapped = 0u;
+  for (auto &result : ready) {
+    auto trace = impl->traces[result.pc].trace;
+    CHECK_NOTNULL(trace);
+
+    trace->deleteBody();
+    CloneFunctionInto(result.func, trace);
+    callback(result.pc, trace);
+    ++num_swapped;
+  }
+  return num_swapped;
+}
+
+// Block until every queued trace has been optimized.
+void TieredOptimizer::Wait(void) {
+  std::unique_lock<std::mutex> locker(impl->lock);
+  impl->idle_cond.wait(locker, [this] {
+    return impl->jobs.empty() && !impl->num_busy_workers;
+  });
+}
+
+}  // namespace remill
@@ -0,0 +1,188 @@
+/*
+ * Copyright (c) 2026 Trail of Bits, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "remill/BC/TraceIndex.h"
+
+#include <glog/logging.h>
+#include <llvm/IR/Constants.h>
+#include <llvm/IR/Function.h>
+#include <llvm/IR/LLVMContext.h>
+#include <llvm/IR/Metadata.h>
+#include <llvm/IR/Module.h>
+#include <llvm/IRReader/IRReader.h>
+#include <llvm/Support/Error.h>
+#include <llvm/Support/SourceMgr.h>
+
+#include "remill/BC/Util.h"
+
+namespace remill {
+
+const std::string_view kTraceIndexMetadataName = "remill.trace_index";
+
+// Record a guest PC to lifted trace index into `module`.
+void AddTraceIndex(
+    llvm::Module *module,
+    const std::unordered_map<uint64_t, llvm::Function *> &traces) {
+  llvm::StringRef md_name(kTraceIndexMetadataName.data(),
+                          kTraceIndexMetadataName.size());
+  if (auto old_index = module->getNamedMetadata(md_name)) {
+    module->eraseNamedMetadata(old_index);
+  }
+
+  auto &context = module->getContext();
+  auto i64_type = llvm::Type::getInt64Ty(context);
+  auto index = module->getOrInsertNamedMetadata(md_name);
+
+  // Emit the entries in PC order so that the output is deterministic.
+  std::map<uint64_t, llvm::Function *> sorted_traces(traces.begin(),
+                                                     traces.end());
+  for (auto [pc, func] : sorted_traces) {
+    CHECK_EQ(func->getParent(), module)
+        << "Trace " << func->getName().str() << " for PC " << std::hex << pc
+        << std::dec << " is not in module " << ModuleName(module);
+
+    llvm::Metadata *entry[] = {
+        llvm::ConstantAsMetadata::get(llvm::ConstantInt::get(i64_type, pc)),
+        llvm::ConstantAsMetadata::get(func)};
+    index->addOperand(llvm::MDNode::get(context, entry));
+  }
+}
+
+// Read back the trace index stored in `module` by `AddTraceIndex`.
+std::map<uint64_t, llvm::Function *> GetTraceIndex(llvm::Module *module) {
+  std::map<uint64_t, llvm::Function *> traces;
+  llvm::StringRef md_name(kTraceIndexMetadataName.data(),
+                          kTraceIndexMetadataName.size());
+  auto index = module->getNamedMetadata(md_name);
+  if (!index) {
+    return traces;
+  }
+
+  for (auto entry : index->operands()) {
+    if (entry->getNumOperands() != 2) {
+      LOG(ERROR) << "Malformed entry in trace index of module "
+                 << ModuleName(module);
+      continue;
+    }
+
+    auto pc_md =
+        llvm::dyn_cast_or_null<llvm::ConstantAsMetadata>(entry->getOperand(0));
+    auto func_md =
+        llvm::dyn_cast_or_null<llvm::ConstantAsMetadata>(entry->getOperand(1));
+    if (!pc_md || !func_md) {
+      continue;  // The trace was deleted, e.g. by the optimizer.
+    }
+
+    auto pc = llvm::dyn_cast<llvm::ConstantInt>(pc_md->getValue());
+    auto func = llvm::dyn_cast<llvm::Function>(func_md->getValue());
+    if (pc && func) {
+      traces.emplace(pc->getZExtValue(), func);
+    }
+  }
+
+  return traces;
+}
+
+// Store `module` into a bitcode file along with an index of `traces`.
+bool StoreIndexedModuleToFile(
+    llvm::Module *module,
+    const std::unordered_map<uint64_t, llvm::Function *> &traces,
+    std::string_view file_name, bool allow_failure) {
+  AddTraceIndex(module, traces);
+  return StoreModuleToFile(module, file_name, allow_failure);
+}
+
+LazyTraceModule::LazyTraceModule(std::unique_ptr<llvm::Module> module_,
+                                 std::map<uint64_t, llvm::Function *> index_)
+    : module(std::move(module_)),
+      index(std::move(index_)) {}
+
+LazyTraceModule::~LazyTraceModule(void) {}
+
+std::unique_ptr<LazyTraceModule>
+LazyTraceModule::Load(llvm::LLVMContext *context,
+                      std::filesystem::path file_name) {
+  llvm::SMDiagnostic err;
+  auto module = llvm::getLazyIRFileModule(file_name.string(), err, *context,
+                                          true /* ShouldLazyLoadMetadata */);
+  if (!module) {
+    LOG(ERROR) << "Unable to parse module file " << file_name << ": "
+               << err.getMessage().str();
+    return {};
+  }
+
+  // The trace index is module-level metadata; pull that in, but leave the
+  // function bodies (and their metadata) on disk.
+  if (auto ec = module->materializeMetadata()) {
+    LOG(ERROR) << "Unable to materialize metadata from " << file_name << ": "
+               << llvm::toString(std::move(ec));
+    return {};
+  }
+
+  auto index = GetTraceIndex(module.get());
+  LOG_IF(WARNING, index.empty())
+      << "Module file " << file_name << " does not contain a trace index";
+
+  return std::unique_ptr<LazyTraceModule>(
+      new LazyTraceModule(std::move(module), std::move(index)));
+}
+
+llvm::Module *LazyTraceModule::GetModule(void) const {
+  return module.get();
+}
+
+llvm::Function *LazyTraceModule::GetTrace(uint64_t pc) const {
+  auto trace_it = index.find(pc);
+  if (trace_it == index.end()) {
+    return nullptr;
+  }
+  return trace_it->second;
+}
+
+llvm::Function *LazyTraceModule::MaterializeTrace(uint64_t pc) {
+  auto func = GetTrace(pc);
+  if (!func || !func->isMaterializable()) {
+    return func;
+  }
+
+  if (auto ec = func->materialize()) {
+    LOG(ERROR) << "Unable to materialize trace " << func->getName().str()
+               << " for PC " << std::hex << pc << std::dec << ": "
+               << llvm::toString(std::move(ec));
+    return nullptr;
+  }
+
+  return func;
+}
+
+void LazyTraceModule::ForEachTrace(
+    std::function<void(uint64_t, llvm::Function *)> cb) const {
+  for (auto [pc, func] : index) {
+    cb(pc, func);
+  }
+}
+
+bool LazyTraceModule::MaterializeAll(void) {
+  if (auto ec = module->materializeAll()) {
+    LOG(ERROR) << "Unable to materialize everything from "
+               << ModuleName(module.get()) << ": "
+               << llvm::toString(std::move(ec));
+    return false;
+  }
+  return true;
+}
+
+}  // namespace remill
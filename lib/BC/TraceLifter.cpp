@@ -15,15 +15,25 @@
  */
 
 #include <glog/logging.h>
+#include <llvm/ADT/DenseMap.h>
+#include <llvm/ADT/DenseSet.h>
 #include <llvm/IR/Instructions.h>
 #include <remill/Arch/Instruction.h>
+#include <remill/BC/HostFunction.h>
 #include <remill/BC/IntrinsicTable.h>
+#include <remill/BC/Optimizer.h>
 #include <remill/BC/TraceLifter.h>
 #include <remill/BC/Util.h>
 
+#include <algorithm>
+#include <functional>
 #include <map>
-#include <set>
+#include <optional>
 #include <sstream>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
 
 #include "InstructionLifter.h"
 
@@ -52,6 +62,22 @@ void TraceManager::ForEachDevirtualizedTarget(
   // Must be extended.
 }
 
+// Try to read a byte of read-only memory.
+bool TraceManager::TryReadReadOnlyByte(uint64_t, uint8_t *) {
+  return false;
+}
+
+// Called when the trace at `addr` has been invalidated.
+void TraceManager::InvalidateLiftedTraceDefinition(uint64_t, llvm::Function *) {
+
+  // Must be extended.
+}
+
+// Return the host implementation of the function at `addr`, if any.
+const HostFunction *TraceManager::GetHostFunction(uint64_t) {
+  return nullptr;
+}
+
 // Figure out the name for the trace starting at address `addr`.
 std::string TraceManager::TraceName(uint64_t addr) {
   std::stringstream ss;
@@ -61,7 +87,87 @@ std::string TraceManager::TraceName(uint64_t addr) {
 
 namespace {
 
-using DecoderWorkList = std::set<uint64_t>;  // For ordering.
+// `llvm::DenseMap` and `llvm::DenseSet` reserve these two keys for their own
+// use, so they can't be used as block or work list addresses.
+static bool IsReservedAddress(uint64_t addr) {
+  return addr == llvm::DenseMapInfo<uint64_t>::getEmptyKey() ||
+         addr == llvm::DenseMapInfo<uint64_t>::getTombstoneKey();
+}
+
+// A work list of addresses that are popped in increasing order, so that
+// lifted code is laid out in address order. The order comes from a binary
+// heap, and membership from a flat hash set, so that there is no per-address
+// node allocation on traces with millions of instructions.
+class DecoderWorkList {
+ public:
+  bool empty(void) const {
+    return heap.empty();
+  }
+
+  void clear(void) {
+    heap.clear();
+    queued.clear();
+  }
+
+  // Returns `true` if `addr` is queued and not yet popped.
+  bool Contains(uint64_t addr) const {
+    return !IsReservedAddress(addr) && queued.count(addr);
+  }
+
+  // Queue `addr`, unless it is already queued. Reserved addresses are never
+  // queued, and so are treated like any other address without code.
+  void Insert(uint64_t addr) {
+    if (!IsReservedAddress(addr) && queued.insert(addr).second) {
+      heap.push_back(addr);
+      std::push_heap(heap.begin(), heap.end(), std::greater<uint64_t>());
+    }
+  }
+
+  // Remove and return the smallest queued address.
+  uint64_t Pop(void) {
+    std::pop_heap(heap.begin(), heap.end(), std::greater<uint64_t>());
+    const auto addr = heap.back();
+    heap.pop_back();
+    queued.erase(addr);
+    return addr;
+  }
+
+ private:
+  std::vector<uint64_t> heap;
+  llvm::DenseSet<uint64_t> queued;
+};
+
+// A half-open range `[begin, end)` of instruction bytes.
+using ByteRange = std::pair<uint64_t, uint64_t>;
+
+// The maximum number of instructions that fall through into an indirect jump
+// which are searched for the computation of a jump table target.
+static constexpr size_t kMaxJumpTableSliceSize = 8u;
+
+// The maximum number of entries read out of a recovered jump table.
+static constexpr uint64_t kMaxJumpTableEntries = 1024u;
+
+// The value of a register in the slice of an indirect jump: either unknown, a
+// constant, or `base` plus the (sign- or zero-extended) entry of a table of
+// `entry_size`-byte entries at `table`, indexed by `index_reg`.
+struct JumpTableValue {
+  enum Kind { kUnknown, kConstant, kTableEntry } kind{kUnknown};
+  uint64_t base{0};
+  uint64_t table{0};
+  uint64_t entry_size{0};
+  bool is_signed{false};
+  std::string index_reg;
+};
+
+// Does `inst` continue on to the next instruction in memory?
+static bool FallsThrough(const Instruction &inst) {
+  switch (inst.category) {
+    case Instruction::kCategoryNormal:
+    case Instruction::kCategoryNoOp:
+    case Instruction::kCategoryConditionalBranch: return true;
+    default: return false;
+  }
+}
 
 }  // namespace
 
@@ -69,11 +175,78 @@ class TraceLifter::Impl {
  public:
   Impl(const Arch *arch_, TraceManager *manager_);
 
-  // Lift one or more traces starting from `addr`. Calls `callback` with each
+  // Lift one or more traces starting from `addrs`. Calls `callback` with each
   // lifted trace.
-  bool Lift(uint64_t addr,
+  bool Lift(const std::vector<uint64_t> &addrs,
             std::function<void(uint64_t, llvm::Function *)> callback);
 
+  // Returns the sorted entry addresses of the traces that contain at least
+  // one instruction byte in `[begin, end)`.
+  std::vector<uint64_t> TracesInRange(uint64_t begin, uint64_t end) const;
+
+  // Invalidate and then re-lift the traces overlapping `[begin, end)`.
+  bool Invalidate(uint64_t begin, uint64_t end,
+                  std::function<void(uint64_t, llvm::Function *)> callback);
+
+  // Record that the `size` bytes at `addr` are part of the current trace.
+  void AddCoveredBytes(uint64_t addr, uint64_t size);
+
+  // Merge the byte ranges of the trace at `trace_addr` and add them to the
+  // coverage index.
+  void CommitCoveredBytes(uint64_t trace_addr);
+
+  // Remove the byte ranges of the trace at `trace_addr` from the coverage
+  // index.
+  void ForgetCoveredBytes(uint64_t trace_addr);
+
+  // Declare the function for the trace at `trace_addr`, reusing an existing
+  // declaration of it, e.g. one left behind by `Invalidate`.
+  llvm::Function *DeclareTrace(uint64_t trace_addr);
+
+  // Call the trace `target` from `block`, keeping the memory pointer that it
+  // returns, and return the block in which the caller continues if the callee
+  // returned to `ret_pc`. Otherwise, the caller exits to
+  // `__remill_missing_block` with the program counter that the callee
+  // returned with.
+  llvm::BasicBlock *AddGuardedDirectCall(llvm::BasicBlock *block,
+                                         llvm::Function *target,
+                                         uint64_t ret_pc);
+
+  // Return from `block` to the caller of the trace.
+  void AddReturnToCaller(llvm::BasicBlock *block);
+
+  // Return the thread-local variable `name` of type `type`, declaring it if
+  // it isn't already in `module`.
+  llvm::GlobalVariable *GetOrDeclareThreadLocal(const char *name,
+                                                llvm::Type *type);
+
+  // Return the shadow return stack and the index of its top entry.
+  std::pair<llvm::GlobalVariable *, llvm::GlobalVariable *>
+  GetShadowReturnStack(void);
+
+  // Push `ret_pc` and the trace `ret_trace` onto the shadow return stack.
+  void AddShadowReturnStackPush(llvm::BasicBlock *block, uint64_t ret_pc,
+                                llvm::Function *ret_trace);
+
+  // Pop the shadow return stack, and exit `block` to the popped trace if it
+  // starts at `NEXT_PC`, or to `__remill_function_return` otherwise.
+  void AddShadowReturnStackPop(llvm::BasicBlock *block);
+
+  // Exit `block` with a function call, pushing the return address `ret_pc`
+  // onto the shadow return stack.
+  void AddShadowStackCall(llvm::BasicBlock *block, llvm::Value *target,
+                          uint64_t ret_pc);
+
+  // Return the known targets of the indirect jump `inst`, as told by the
+  // trace manager or, failing that, as read out of a jump table.
+  std::vector<std::pair<uint64_t, DevirtualizedTargetKind>>
+  GetDevirtualizedTargets(void);
+
+  // Recover the targets of the jump table used by the indirect jump `inst`
+  // from the instructions that fall through into it. Only x86 and amd64 jump
+  // tables in read-only memory are recognized.
+  std::vector<uint64_t> RecoverJumpTableTargets(void);
+
   // Reads the bytes of an instruction at `addr` into `state.inst_bytes`.
   bool ReadInstructionBytes(uint64_t addr);
 
@@ -92,6 +265,12 @@ class TraceLifter::Impl {
   llvm::Function *GetLiftedTraceDefinition(uint64_t addr);
 
   llvm::BasicBlock *GetOrCreateBlock(uint64_t block_pc) {
+    if (IsReservedAddress(block_pc)) {
+      auto block = llvm::BasicBlock::Create(context, "", func);
+      AddTerminatingTailCall(block, intrinsics->missing_block, *intrinsics);
+      return block;
+    }
+
     auto &block = blocks[block_pc];
     if (!block) {
       block = llvm::BasicBlock::Create(context, "", func);
@@ -100,35 +279,21 @@ class TraceLifter::Impl {
   }
 
   llvm::BasicBlock *GetOrCreateBranchTakenBlock(void) {
-    inst_work_list.insert(inst.branch_taken_pc);
+    inst_work_list.Insert(inst.branch_taken_pc);
     return GetOrCreateBlock(inst.branch_taken_pc);
   }
 
   llvm::BasicBlock *GetOrCreateBranchNotTakenBlock(void) {
     CHECK(inst.branch_not_taken_pc != 0);
-    inst_work_list.insert(inst.branch_not_taken_pc);
+    inst_work_list.Insert(inst.branch_not_taken_pc);
     return GetOrCreateBlock(inst.branch_not_taken_pc);
   }
 
   llvm::BasicBlock *GetOrCreateNextBlock(void) {
-    inst_work_list.insert(inst.next_pc);
+    inst_work_list.Insert(inst.next_pc);
     return GetOrCreateBlock(inst.next_pc);
   }
 
-  uint64_t PopTraceAddress(void) {
-    auto trace_it = trace_work_list.begin();
-    const auto trace_addr = *trace_it;
-    trace_work_list.erase(trace_it);
-    return trace_addr;
-  }
-
-  uint64_t PopInstructionAddress(void) {
-    auto inst_it = inst_work_list.begin();
-    const auto inst_addr = *inst_it;
-    inst_work_list.erase(inst_it);
-    return inst_addr;
-  }
-
   const Arch *const arch;
   const remill::IntrinsicTable *intrinsics;
   llvm::Type *word_type;
@@ -146,7 +311,37 @@ class TraceLifter::Impl {
   Instruction delayed_inst;
   DecoderWorkList trace_work_list;
   DecoderWorkList inst_work_list;
-  std::map<uint64_t, llvm::BasicBlock *> blocks;
+  llvm::DenseMap<uint64_t, llvm::BasicBlock *> blocks;
+
+  // Instruction bytes of the trace being lifted.
+  std::vector<ByteRange> trace_bytes;
+
+  // The addresses of the most recently decoded instructions, oldest first,
+  // where each one falls through into the next.
+  std::vector<uint64_t> fall_through_insts;
+  uint64_t last_inst_next_pc{0};
+  bool last_inst_falls_through{false};
+
+  // Maps the entry address of each trace lifted into `module` to its function
+  // and to the merged byte ranges of the instructions it contains.
+  std::unordered_map<uint64_t, llvm::Function *> lifted_traces;
+  std::unordered_map<uint64_t, std::vector<ByteRange>> lifted_trace_bytes;
+
+  // Maps the start of each covered byte range to its end and to the entry
+  // address of the trace containing it. `max_covered_size` bounds how far
+  // before a query range we need to look for overlapping ranges.
+  std::multimap<uint64_t, ByteRange> covered_bytes;
+  uint64_t max_covered_size{0};
+
+  // Whether or not to outline the error and missing block exits of traces.
+  bool outline_cold_exits{false};
+
+  // Whether or not to lift direct calls to traces as guarded direct calls, and
+  // returns as plain returns.
+  bool guarded_direct_calls{false};
+
+  // Whether or not to maintain a shadow return stack in lifted code.
+  bool shadow_return_stack{false};
 };
 
 TraceLifter::Impl::Impl(const Arch *arch_, TraceManager *manager_)
@@ -206,6 +401,518 @@ llvm::Function *TraceLifter::Impl::GetLiftedTraceDefinition(uint64_t addr) {
   return extern_func;
 }
 
+// Declare the function for the trace at `trace_addr`, reusing an existing
+// declaration of it.
+llvm::Function *TraceLifter::Impl::DeclareTrace(uint64_t trace_addr) {
+  const auto name = manager.TraceName(trace_addr);
+  auto trace = module->getFunction(name);
+  if (trace && trace->isDeclaration() &&
+      trace->getFunctionType() == arch->LiftedFunctionType()) {
+    return trace;
+  }
+  return arch->DeclareLiftedFunction(name, module);
+}
+
+// Call the trace `target` from `block`, and return the block in which the
+// caller continues if the callee returned to `ret_pc`.
+llvm::BasicBlock *TraceLifter::Impl::AddGuardedDirectCall(
+    llvm::BasicBlock *block, llvm::Function *target, uint64_t ret_pc) {
+  auto call = AddCall(block, target, *intrinsics);
+  llvm::IRBuilder<> ir(block);
+  ir.CreateStore(call, LoadMemoryPointerRef(block));
+
+  const auto returned_block = llvm::BasicBlock::Create(context, "", func);
+  const auto unexpected_block = llvm::BasicBlock::Create(context, "", func);
+  const auto pc = LoadProgramCounter(block, *intrinsics);
+  ir.CreateCondBr(
+      ir.CreateICmpEQ(pc, llvm::ConstantInt::get(intrinsics->pc_type, ret_pc)),
+      returned_block, unexpected_block);
+
+  // `AddTerminatingTailCall` exits with `NEXT_PC`, which still holds the
+  // target of the call.
+  StoreNextProgramCounter(unexpected_block,
+                          LoadProgramCounter(unexpected_block, *intrinsics));
+  AddTerminatingTailCall(unexpected_block, intrinsics->missing_block,
+                         *intrinsics);
+  return returned_block;
+}
+
+// Return from `block` to the caller of the trace, with `PC` holding the
+// return address, like `AddTerminatingTailCall` would.
+void TraceLifter::Impl::AddReturnToCaller(llvm::BasicBlock *block) {
+  StoreProgramCounter(block, LoadNextProgramCounter(block, *intrinsics));
+  llvm::ReturnInst::Create(context, LoadMemoryPointer(block, *intrinsics),
+                           block);
+}
+
+// Return the thread-local variable `name` of type `type`.
+llvm::GlobalVariable *
+TraceLifter::Impl::GetOrDeclareThreadLocal(const char *name, llvm::Type *type) {
+  if (auto var = module->getGlobalVariable(name)) {
+    CHECK_EQ(var->getValueType(), type)
+        << "Variable " << name << " has an unexpected type";
+    return var;
+  }
+  return new llvm::GlobalVariable(
+      *module, type, false, llvm::GlobalValue::ExternalLinkage, nullptr, name,
+      nullptr, llvm::GlobalValue::GeneralDynamicTLSModel);
+}
+
+// Return the shadow return stack, whose entries are pairs of a return address
+// and the trace at that address, and the index of its top entry.
+std::pair<llvm::GlobalVariable *, llvm::GlobalVariable *>
+TraceLifter::Impl::GetShadowReturnStack(void) {
+  const auto entry_type = llvm::StructType::get(
+      context, {intrinsics->pc_type, intrinsics->jump->getType()});
+  const auto stack_type =
+      llvm::ArrayType::get(entry_type, kShadowReturnStackSize);
+  return {GetOrDeclareThreadLocal("__remill_shadow_return_stack", stack_type),
+          GetOrDeclareThreadLocal("__remill_shadow_return_stack_top",
+                                  llvm::Type::getInt32Ty(context))};
+}
+
+// Push `ret_pc` and the trace `ret_trace` onto the shadow return stack.
+void TraceLifter::Impl::AddShadowReturnStackPush(llvm::BasicBlock *block,
+                                                 uint64_t ret_pc,
+                                                 llvm::Function *ret_trace) {
+  const auto [stack, top_ref] = GetShadowReturnStack();
+  const auto stack_type = stack->getValueType();
+  const auto i32_type = top_ref->getValueType();
+
+  llvm::IRBuilder<> ir(block);
+  const auto top = ir.CreateLoad(i32_type, top_ref);
+  llvm::Value *entry_pc_indices[] = {ir.getInt32(0), top, ir.getInt32(0)};
+  llvm::Value *entry_trace_indices[] = {ir.getInt32(0), top, ir.getInt32(1)};
+  ir.CreateStore(llvm::ConstantInt::get(intrinsics->pc_type, ret_pc),
+                 ir.CreateInBoundsGEP(stack_type, stack, entry_pc_indices));
+  ir.CreateStore(ret_trace, ir.CreateInBoundsGEP(stack_type, stack,
+                                                 entry_trace_indices));
+  ir.CreateStore(ir.CreateAnd(ir.CreateAdd(top, ir.getInt32(1)),
+                              ir.getInt32(kShadowReturnStackSize - 1u)),
+                 top_ref);
+}
+
+// Pop the shadow return stack, and exit `block` to the popped trace if it
+// starts at `NEXT_PC`. An empty entry has a null trace, and so never matches.
+void TraceLifter::Impl::AddShadowReturnStackPop(llvm::BasicBlock *block) {
+  const auto [stack, top_ref] = GetShadowReturnStack();
+  const auto stack_type = stack->getValueType();
+  const auto i32_type = top_ref->getValueType();
+  const auto trace_ptr_type = intrinsics->jump->getType();
+
+  const auto next_pc = LoadNextProgramCounter(block, *intrinsics);
+
+  llvm::IRBuilder<> ir(block);
+  const auto top =
+      ir.CreateAnd(ir.CreateSub(ir.CreateLoad(i32_type, top_ref),
+                                ir.getInt32(1)),
+                   ir.getInt32(kShadowReturnStackSize - 1u));
+  ir.CreateStore(top, top_ref);
+
+  llvm::Value *entry_pc_indices[] = {ir.getInt32(0), top, ir.getInt32(0)};
+  llvm::Value *entry_trace_indices[] = {ir.getInt32(0), top, ir.getInt32(1)};
+  const auto entry_pc = ir.CreateLoad(
+      intrinsics->pc_type,
+      ir.CreateInBoundsGEP(stack_type, stack, entry_pc_indices));
+  const auto entry_trace = ir.CreateLoad(
+      trace_ptr_type,
+      ir.CreateInBoundsGEP(stack_type, stack, entry_trace_indices));
+
+  const auto hit_block = llvm::BasicBlock::Create(context, "", func);
+  const auto miss_block = llvm::BasicBlock::Create(context, "", func);
+  ir.CreateCondBr(
+      ir.CreateAnd(ir.CreateICmpEQ(entry_pc, next_pc),
+                   ir.CreateIsNotNull(entry_trace)),
+      hit_block, miss_block);
+
+  AddTerminatingTailCall(hit_block, entry_trace, *intrinsics);
+  AddTerminatingTailCall(miss_block, intrinsics->function_return,
+                         *intrinsics);
+}
+
+// Exit `block` with a call to `target`, which is either a trace or
+// `__remill_function_call`, pushing the return address `ret_pc` and the
+// trace that starts there onto the shadow return stack.
+void TraceLifter::Impl::AddShadowStackCall(llvm::BasicBlock *block,
+                                           llvm::Value *target,
+                                           uint64_t ret_pc) {
+  trace_work_list.Insert(ret_pc);
+  if (auto ret_trace = GetLiftedTraceDeclaration(ret_pc)) {
+    AddShadowReturnStackPush(block, ret_pc, ret_trace);
+  } else if (trace_work_list.Contains(ret_pc)) {
+    AddShadowReturnStackPush(block, ret_pc, DeclareTrace(ret_pc));
+  }
+  AddTerminatingTailCall(block, target, *intrinsics);
+}
+
+// Return the known targets of the indirect jump `inst`.
+std::vector<std::pair<uint64_t, DevirtualizedTargetKind>>
+TraceLifter::Impl::GetDevirtualizedTargets(void) {
+  std::vector<std::pair<uint64_t, DevirtualizedTargetKind>> targets;
+  std::unordered_set<uint64_t> seen;
+  manager.ForEachDevirtualizedTarget(
+      inst, [&](uint64_t target, DevirtualizedTargetKind kind) {
+        target &= addr_mask;
+        if (!IsReservedAddress(target) && seen.insert(target).second) {
+          targets.emplace_back(target, kind);
+        }
+      });
+
+  if (targets.empty()) {
+    for (auto target : RecoverJumpTableTargets()) {
+      if (!IsReservedAddress(target) && seen.insert(target).second) {
+        targets.emplace_back(target, DevirtualizedTargetKind::kTraceLocal);
+      }
+    }
+  }
+  return targets;
+}
+
+// Recover the targets of the jump table used by the indirect jump `inst`.
+//
+// The instructions that fall through into the jump are evaluated forward,
+// tracking which registers hold constants (e.g. from `lea rdx, [rip + T]`)
+// or entries of a table indexed by a register (e.g. from
+// `movsxd rax, dword [rdx + rcx * 4]`, optionally followed by
+// `add rax, rdx`), and which registers were compared against a constant
+// bound (e.g. from `cmp ecx, 5`). Missing a target, or finding too many,
+// only costs a trip through `__remill_jump`, because the lifted jump still
+// falls back on it for unknown targets.
+std::vector<uint64_t> TraceLifter::Impl::RecoverJumpTableTargets(void) {
+  std::vector<uint64_t> targets;
+  if ((!arch->IsX86() && !arch->IsAMD64()) || fall_through_insts.empty() ||
+      fall_through_insts.back() != inst.pc) {
+    return targets;
+  }
+
+  std::unordered_map<std::string, JumpTableValue> values;
+  std::unordered_map<std::string, uint64_t> bounds;
+
+  auto reg_name = [=](const Operand::Register &reg) -> std::string {
+    if (auto arch_reg = arch->RegisterByName(reg.name)) {
+      return arch_reg->EnclosingRegister()->name;
+    }
+    return reg.name;
+  };
+
+  // Evaluate the address of a memory operand, which is either a constant, or
+  // the address of an entry in a table.
+  auto eval_address = [&](const Instruction &slice_inst,
+                          const Operand::Address &addr) -> JumpTableValue {
+    JumpTableValue val;
+    uint64_t base = 0;
+
+    // 32-bit x86 operands always name a segment, e.g. the implicit `DS`, but
+    // only the bases of `FS` and `GS` are non-zero in a flat address space.
+    const auto &seg_name = addr.segment_base_reg.name;
+    if (seg_name == "FSBASE" || seg_name == "GSBASE") {
+      return val;
+    } else if (addr.base_reg.name == "NEXT_PC") {
+      base = slice_inst.next_pc;
+    } else if (!addr.base_reg.name.empty()) {
+      const auto &base_val = values[reg_name(addr.base_reg)];
+      if (base_val.kind != JumpTableValue::kConstant) {
+        return val;
+      }
+      base = base_val.base;
+    }
+
+    base = (base + static_cast<uint64_t>(addr.displacement)) & addr_mask;
+    if (addr.index_reg.name.empty()) {
+      val.kind = JumpTableValue::kConstant;
+      val.base = base;
+    } else {
+      val.kind = JumpTableValue::kTableEntry;
+      val.table = base;
+      val.entry_size = static_cast<uint64_t>(addr.scale);
+      val.index_reg = reg_name(addr.index_reg);
+    }
+    return val;
+  };
+
+  // Evaluate a read from a table, i.e. a memory operand whose entry size is
+  // its scale.
+  auto eval_load = [&](const Instruction &slice_inst, const Operand &op,
+                       bool is_signed) -> JumpTableValue {
+    auto val = eval_address(slice_inst, op.addr);
+    if (val.kind != JumpTableValue::kTableEntry ||
+        val.entry_size * 8u != op.size) {
+      return {};
+    }
+    val.is_signed = is_signed;
+    return val;
+  };
+
+  auto eval_reg = [&](const Operand &op) -> JumpTableValue {
+    if (op.type == Operand::kTypeImmediate) {
+      JumpTableValue val;
+      val.kind = JumpTableValue::kConstant;
+      val.base = op.imm.val & addr_mask;
+      return val;
+    } else if (op.type == Operand::kTypeRegister) {
+      return values[reg_name(op.reg)];
+    } else {
+      return {};
+    }
+  };
+
+  auto starts_with = [](const std::string &str, const char *prefix) {
+    return !str.rfind(prefix, 0);
+  };
+
+  Instruction slice_inst;
+  for (auto i = 0u; i + 1u < fall_through_insts.size(); ++i) {
+    slice_inst.Reset();
+    if (!ReadInstructionBytes(fall_through_insts[i]) ||
+        !arch->DecodeInstruction(fall_through_insts[i], inst_bytes, slice_inst,
+                                 arch->CreateInitialContext())) {
+      return targets;
+    }
+
+    const Operand *dest = nullptr;
+    std::vector<const Operand *> srcs;
+    for (const auto &op : slice_inst.operands) {
+      if (op.action == Operand::kActionWrite &&
+          op.type == Operand::kTypeRegister) {
+        if (op.reg.name != "NEXT_PC" && op.reg.name != "RETURN_PC") {
+          dest = &op;
+        }
+      } else if (op.action == Operand::kActionRead) {
+        srcs.push_back(&op);
+      }
+    }
+
+    const auto &func_name = slice_inst.function;
+    if (starts_with(func_name, "CMP_") && 2u == srcs.size() &&
+        srcs[0]->type == Operand::kTypeRegister &&
+        srcs[1]->type == Operand::kTypeImmediate) {
+      bounds[reg_name(srcs[0]->reg)] = srcs[1]->imm.val;
+      continue;
+    }
+
+    // Conservatively forget about anything written by this instruction.
+    if (!dest) {
+      for (const auto &op : slice_inst.operands) {
+        if (op.action == Operand::kActionWrite &&
+            op.type == Operand::kTypeRegister) {
+          values.erase(reg_name(op.reg));
+          bounds.erase(reg_name(op.reg));
+        }
+      }
+      continue;
+    }
+
+    const auto dest_name = reg_name(dest->reg);
+    JumpTableValue val;
+    std::optional<uint64_t> bound;
+    if (1u == srcs.size() && srcs[0]->type == Operand::kTypeAddress) {
+      if (starts_with(func_name, "LEA_")) {
+        val = eval_address(slice_inst, srcs[0]->addr);
+        if (val.kind != JumpTableValue::kConstant) {
+          val = {};
+        }
+      } else if (starts_with(func_name, "MOVSX")) {
+        val = eval_load(slice_inst, *srcs[0], true);
+      } else if (starts_with(func_name, "MOV_") ||
+                 starts_with(func_name, "MOVZX_")) {
+        val = eval_load(slice_inst, *srcs[0], false);
+      }
+    } else if (1u == srcs.size() && starts_with(func_name, "MOV_")) {
+      val = eval_reg(*srcs[0]);
+
+      // Keep the bound of a copied index, e.g. of `mov ecx, ecx`, which
+      // zero-extends the index after its bounds check.
+      if (srcs[0]->type == Operand::kTypeRegister) {
+        if (auto it = bounds.find(reg_name(srcs[0]->reg)); it != bounds.end()) {
+          bound = it->second;
+        }
+      }
+    } else if (2u == srcs.size() && starts_with(func_name, "ADD_")) {
+      auto lhs = eval_reg(*srcs[0]);
+      auto rhs = eval_reg(*srcs[1]);
+      if (lhs.kind == JumpTableValue::kConstant) {
+        std::swap(lhs, rhs);
+      }
+      if (rhs.kind == JumpTableValue::kConstant &&
+          lhs.kind != JumpTableValue::kUnknown) {
+        val = lhs;
+        val.base = (lhs.base + rhs.base) & addr_mask;
+      }
+    }
+
+    values[dest_name] = val;
+    if (bound) {
+      bounds[dest_name] = *bound;
+    } else {
+      bounds.erase(dest_name);
+    }
+  }
+
+  // Find the table from which the jump reads its target, e.g. with
+  // `jmp rax` or `jmp qword [T + rcx * 8]`.
+  JumpTableValue target;
+  for (const auto &op : inst.operands) {
+    if (op.action != Operand::kActionRead) {
+      continue;
+    } else if (op.type == Operand::kTypeRegister) {
+      target = values[reg_name(op.reg)];
+      break;
+    } else if (op.type == Operand::kTypeAddress && op.addr.IsMemoryAccess()) {
+      target = eval_load(inst, op, false);
+      break;
+    }
+  }
+
+  if (target.kind != JumpTableValue::kTableEntry || !target.entry_size ||
+      target.entry_size > 8u) {
+    return targets;
+  }
+
+  auto num_entries = kMaxJumpTableEntries;
+  if (auto bound_it = bounds.find(target.index_reg);
+      bound_it != bounds.end() && bound_it->second < kMaxJumpTableEntries) {
+    num_entries = bound_it->second + 1u;
+  }
+
+  // Read the entries, in little-endian byte order, until one isn't in
+  // read-only memory or doesn't lead to executable code.
+  const auto entry_bits = target.entry_size * 8u;
+  for (uint64_t i = 0u; i < num_entries; ++i) {
+    const auto entry_addr = target.table + i * target.entry_size;
+    uint64_t entry = 0;
+    for (auto b = 0u; b < target.entry_size; ++b) {
+      uint8_t byte = 0;
+      if (!manager.TryReadReadOnlyByte((entry_addr + b) & addr_mask, &byte)) {
+        return targets;
+      }
+      entry |= static_cast<uint64_t>(byte) << (b * 8u);
+    }
+
+    if (target.is_signed && entry_bits < 64u) {
+      const auto sign_bit = 1ull << (entry_bits - 1u);
+      entry = (entry ^ sign_bit) - sign_bit;
+    }
+
+    const auto target_pc = (target.base + entry) & addr_mask;
+    uint8_t byte = 0;
+    if (!manager.TryReadExecutableByte(target_pc, &byte)) {
+      break;
+    }
+    targets.push_back(target_pc);
+  }
+
+  return targets;
+}
+
+// Record that the `size` bytes at `addr` are part of the current trace.
+void TraceLifter::Impl::AddCoveredBytes(uint64_t addr, uint64_t size) {
+  trace_bytes.emplace_back(addr, addr + std::max<uint64_t>(size, 1u));
+}
+
+// Merge the byte ranges of the trace at `trace_addr` and add them to the
+// coverage index.
+void TraceLifter::Impl::CommitCoveredBytes(uint64_t trace_addr) {
+  std::sort(trace_bytes.begin(), trace_bytes.end());
+
+  auto &ranges = lifted_trace_bytes[trace_addr];
+  ranges.clear();
+  for (auto [begin, end] : trace_bytes) {
+    if (!ranges.empty() && begin <= ranges.back().second) {
+      ranges.back().second = std::max(ranges.back().second, end);
+    } else {
+      ranges.emplace_back(begin, end);
+    }
+  }
+  trace_bytes.clear();
+
+  for (auto [begin, end] : ranges) {
+    covered_bytes.emplace(begin, ByteRange(end, trace_addr));
+    max_covered_size = std::max(max_covered_size, end - begin);
+  }
+}
+
+// Remove the byte ranges of the trace at `trace_addr` from the coverage
+// index.
+void TraceLifter::Impl::ForgetCoveredBytes(uint64_t trace_addr) {
+  auto ranges_it = lifted_trace_bytes.find(trace_addr);
+  if (ranges_it == lifted_trace_bytes.end()) {
+    return;
+  }
+
+  for (auto [begin, end] : ranges_it->second) {
+    auto [it, it_end] = covered_bytes.equal_range(begin);
+    while (it != it_end) {
+      if (it->second == ByteRange(end, trace_addr)) {
+        it = covered_bytes.erase(it);
+      } else {
+        ++it;
+      }
+    }
+  }
+
+  lifted_trace_bytes.erase(ranges_it);
+}
+
+// Returns the entry addresses of the traces that contain at least one
+// instruction byte in `[begin, end)`.
+std::vector<uint64_t> TraceLifter::Impl::TracesInRange(uint64_t begin,
+                                                       uint64_t end) const {
+  std::vector<uint64_t> traces;
+  if (begin >= end) {
+    return traces;
+  }
+
+  // No covered range is larger than `max_covered_size`, so anything starting
+  // before `first` ends before `begin`.
+  const auto first = begin > max_covered_size ? begin - max_covered_size : 0u;
+  for (auto it = covered_bytes.lower_bound(first);
+       it != covered_bytes.end() && it->first < end; ++it) {
+    if (it->second.first > begin) {
+      traces.push_back(it->second.second);
+    }
+  }
+
+  std::sort(traces.begin(), traces.end());
+  traces.erase(std::unique(traces.begin(), traces.end()), traces.end());
+  return traces;
+}
+
+// Invalidate and then re-lift the traces overlapping `[begin, end)`.
+bool TraceLifter::Impl::Invalidate(
+    uint64_t begin, uint64_t end,
+    std::function<void(uint64_t, llvm::Function *)> callback) {
+  const auto traces = TracesInRange(begin, end);
+
+  // Drop all of the bodies before re-lifting anything, so that one re-lifted
+  // trace doesn't tail-call into the stale code of another.
+  for (auto trace_addr : traces) {
+    auto trace = lifted_traces[trace_addr];
+    CHECK(trace && trace->getParent() == module);
+
+    DLOG(INFO) << "Invalidating trace at address " << std::hex << trace_addr
+               << std::dec;
+
+    trace->deleteBody();
+    ForgetCoveredBytes(trace_addr);
+    lifted_traces.erase(trace_addr);
+    manager.InvalidateLiftedTraceDefinition(trace_addr, trace);
+
+    if (auto def = manager.GetLiftedTraceDefinition(trace_addr);
+        def && !def->isDeclaration()) {
+      LOG(ERROR) << "Trace manager did not forget the definition of the trace "
+                 << "at address " << std::hex << trace_addr << std::dec
+                 << " when it was invalidated";
+      return false;
+    }
+  }
+
+  if (traces.empty()) {
+    return true;
+  }
+
+  return Lift(traces, callback);
+}
+
 TraceLifter::~TraceLifter(void) {}
 
 TraceLifter::TraceLifter(const Arch *arch_, TraceManager *manager_)
@@ -213,6 +920,21 @@ TraceLifter::TraceLifter(const Arch *arch_, TraceManager *manager_)
 
 void TraceLifter::NullCallback(uint64_t, llvm::Function *) {}
 
+// Enable or disable outlining of the cold exits of lifted traces.
+void TraceLifter::SetOutlineColdExits(bool enable) {
+  impl->outline_cold_exits = enable;
+}
+
+// Enable or disable lifting direct calls to traces as guarded direct calls.
+void TraceLifter::SetGuardedDirectCalls(bool enable) {
+  impl->guarded_direct_calls = enable;
+}
+
+// Enable or disable maintaining a shadow return stack in lifted code.
+void TraceLifter::SetShadowReturnStack(bool enable) {
+  impl->shadow_return_stack = enable;
+}
+
 // Reads the bytes of an instruction at `addr` into `inst_bytes`.
 bool TraceLifter::Impl::ReadInstructionBytes(uint64_t addr) {
   inst_bytes.clear();
@@ -235,12 +957,30 @@ bool TraceLifter::Impl::ReadInstructionBytes(uint64_t addr) {
 // Lift one or more traces starting from `addr`.
 bool TraceLifter::Lift(
     uint64_t addr, std::function<void(uint64_t, llvm::Function *)> callback) {
-  return impl->Lift(addr, callback);
+  return impl->Lift({addr}, callback);
 }
 
-// Lift one or more traces starting from `addr`.
+// Returns the entry addresses of the traces lifted by this lifter that
+// contain at least one instruction byte in the range `[begin, end)`.
+std::vector<uint64_t> TraceLifter::TracesInRange(uint64_t begin,
+                                                 uint64_t end) const {
+  return impl->TracesInRange(begin, end);
+}
+
+// Invalidate, then re-lift, every trace overlapping `[begin, end)`.
+bool TraceLifter::Invalidate(
+    uint64_t begin, uint64_t end,
+    std::function<void(uint64_t, llvm::Function *)> callback) {
+  return impl->Invalidate(begin, end, callback);
+}
+
+// Lift one or more traces starting from `addrs`.
 bool TraceLifter::Impl::Lift(
-    uint64_t addr, std::function<void(uint64_t, llvm::Function *)> callback) {
+    const std::vector<uint64_t> &addrs,
+    std::function<void(uint64_t, llvm::Function *)> callback) {
+  CHECK(!guarded_direct_calls || !shadow_return_stack)
+      << "Guarded direct calls can't be combined with a shadow return stack";
+
   // Reset the lifting state.
   trace_work_list.clear();
   inst_work_list.clear();
@@ -251,22 +991,26 @@ bool TraceLifter::Impl::Lift(
   block = nullptr;
   inst.Reset();
   delayed_inst.Reset();
+  trace_bytes.clear();
 
   // Get a trace head that the manager knows about, or that we
   // will eventually tell the trace manager about.
   auto get_trace_decl = [=](uint64_t trace_addr) -> llvm::Function * {
     if (auto trace = GetLiftedTraceDeclaration(trace_addr)) {
       return trace;
-    } else if (trace_work_list.count(trace_addr)) {
-      return arch->DeclareLiftedFunction(manager.TraceName(trace_addr), module);
+    } else if (trace_work_list.Contains(trace_addr)) {
+      return DeclareTrace(trace_addr);
     } else {
       return nullptr;
     }
   };
 
-  trace_work_list.insert(addr);
+  for (auto addr : addrs) {
+    trace_work_list.Insert(addr);
+  }
+
   while (!trace_work_list.empty()) {
-    const auto trace_addr = PopTraceAddress();
+    const auto trace_addr = trace_work_list.Pop();
 
     // Already lifted.
     func = GetLiftedTraceDefinition(trace_addr);
@@ -281,11 +1025,19 @@ bool TraceLifter::Impl::Lift(
     blocks.clear();
 
     if (!func || !func->isDeclaration()) {
-      func = arch->DeclareLiftedFunction(manager.TraceName(trace_addr), module);
+      func = DeclareTrace(trace_addr);
     }
 
     CHECK(func->isDeclaration());
 
+    // Call a host implementation of the function instead of lifting it.
+    if (auto host_func = manager.GetHostFunction(trace_addr);
+        host_func && DefineHostFunctionShim(arch, func, *host_func)) {
+      callback(trace_addr, func);
+      manager.SetLiftedTraceDefinition(trace_addr, func);
+      continue;
+    }
+
     // Fill in the function, and make sure the block with all register
     // variables jumps to the block that will contain the first instruction
     // of the trace.
@@ -307,11 +1059,12 @@ bool TraceLifter::Impl::Lift(
     }
 
     CHECK(inst_work_list.empty());
-    inst_work_list.insert(trace_addr);
+    inst_work_list.Insert(trace_addr);
+    last_inst_falls_through = false;
 
     // Decode instructions.
     while (!inst_work_list.empty()) {
-      const auto inst_addr = PopInstructionAddress();
+      const auto inst_addr = inst_work_list.Pop();
 
       block = GetOrCreateBlock(inst_addr);
       switch_inst = nullptr;
@@ -331,8 +1084,10 @@ bool TraceLifter::Impl::Lift(
         }
       }
 
-      // No executable bytes here.
+      // No executable bytes here. Still record the address as covered, so
+      // that mapping code there later invalidates this trace.
       if (!ReadInstructionBytes(inst_addr)) {
+        AddCoveredBytes(inst_addr, 1u);
         AddTerminatingTailCall(block, intrinsics->missing_block, *intrinsics);
         continue;
       }
@@ -342,6 +1097,18 @@ bool TraceLifter::Impl::Lift(
       // TODO(Ian): not passing context around in trace lifter
       std::ignore = arch->DecodeInstruction(inst_addr, inst_bytes, inst,
                                             this->arch->CreateInitialContext());
+      AddCoveredBytes(inst_addr, inst.bytes.size());
+
+      // Remember the instructions that fall through into this one, in case it
+      // is an indirect jump through a jump table.
+      if (!last_inst_falls_through || last_inst_next_pc != inst_addr) {
+        fall_through_insts.clear();
+      } else if (fall_through_insts.size() >= kMaxJumpTableSliceSize) {
+        fall_through_insts.erase(fall_through_insts.begin());
+      }
+      fall_through_insts.push_back(inst_addr);
+      last_inst_falls_through = FallsThrough(inst);
+      last_inst_next_pc = inst.next_pc;
 
       auto lift_status =
           inst.GetLifter()->LiftIntoBlock(inst, block, state_ptr);
@@ -354,10 +1121,13 @@ bool TraceLifter::Impl::Lift(
       auto try_delay = arch->MayHaveDelaySlot(inst);
       if (try_delay) {
         delayed_inst.Reset();
-        if (!ReadInstructionBytes(inst.delayed_pc) ||
-            !arch->DecodeDelayedInstruction(
-                inst.delayed_pc, inst_bytes, delayed_inst,
-                this->arch->CreateInitialContext())) {
+        const auto decoded_delayed_inst =
+            ReadInstructionBytes(inst.delayed_pc) &&
+            arch->DecodeDelayedInstruction(inst.delayed_pc, inst_bytes,
+                                           delayed_inst,
+                                           this->arch->CreateInitialContext());
+        AddCoveredBytes(inst.delayed_pc, delayed_inst.bytes.size());
+        if (!decoded_delayed_inst) {
           LOG(ERROR) << "Couldn't read delayed inst "
                      << delayed_inst.Serialize();
           AddTerminatingTailCall(block, intrinsics->error, *intrinsics);
@@ -405,9 +1175,41 @@ bool TraceLifter::Impl::Lift(
           llvm::BranchInst::Create(GetOrCreateBranchTakenBlock(), block);
           break;
 
+        // Indirect jumps to known targets, e.g. through a jump table, switch
+        // on the target, and fall back on `__remill_jump` for the rest.
         case Instruction::kCategoryIndirectJump: {
           try_add_delay_slot(true, block);
-          AddTerminatingTailCall(block, intrinsics->jump, *intrinsics);
+          const auto targets = GetDevirtualizedTargets();
+          if (targets.empty()) {
+            AddTerminatingTailCall(block, intrinsics->jump, *intrinsics);
+            break;
+          }
+
+          const auto default_block =
+              llvm::BasicBlock::Create(context, "", func);
+          AddTerminatingTailCall(default_block, intrinsics->jump, *intrinsics);
+
+          switch_inst = llvm::SwitchInst::Create(
+              LoadNextProgramCounter(block, *intrinsics), default_block,
+              static_cast<unsigned>(targets.size()), block);
+
+          for (auto [target_pc, kind] : targets) {
+            llvm::BasicBlock *target_block = nullptr;
+            if (kind == DevirtualizedTargetKind::kTraceLocal) {
+              inst_work_list.Insert(target_pc);
+              target_block = GetOrCreateBlock(target_pc);
+            } else {
+              trace_work_list.Insert(target_pc);
+              target_block = llvm::BasicBlock::Create(context, "", func);
+              AddTerminatingTailCall(target_block, get_trace_decl(target_pc),
+                                     *intrinsics);
+            }
+            switch_inst->addCase(
+                llvm::ConstantInt::get(
+                    llvm::cast<llvm::IntegerType>(intrinsics->pc_type),
+                    target_pc),
+                target_block);
+          }
           break;
         }
 
@@ -417,6 +1219,12 @@ bool TraceLifter::Impl::Lift(
 
         case Instruction::kCategoryIndirectFunctionCall: {
           try_add_delay_slot(true, block);
+          if (shadow_return_stack) {
+            AddShadowStackCall(block, intrinsics->function_call,
+                               inst.branch_not_taken_pc);
+            break;
+          }
+
           const auto fall_through_block =
               llvm::BasicBlock::Create(context, "", func);
 
@@ -455,6 +1263,13 @@ bool TraceLifter::Impl::Lift(
           llvm::BranchInst::Create(taken_block, not_taken_block,
                                    LoadBranchTaken(block), block);
 
+          if (shadow_return_stack) {
+            AddShadowStackCall(taken_block, intrinsics->function_call,
+                               inst.branch_not_taken_pc);
+            block = orig_not_taken_block;
+            continue;
+          }
+
           AddCall(taken_block, intrinsics->function_call, *intrinsics);
 
           const auto ret_pc_ref = LoadReturnProgramCounterRef(taken_block);
@@ -478,9 +1293,22 @@ bool TraceLifter::Impl::Lift(
         direct_func_call:
           try_add_delay_slot(true, block);
           if (inst.branch_not_taken_pc != inst.branch_taken_pc) {
-            trace_work_list.insert(inst.branch_taken_pc);
+            trace_work_list.Insert(inst.branch_taken_pc);
             auto target_trace = get_trace_decl(inst.branch_taken_pc);
-            AddCall(block, target_trace, *intrinsics);
+            if (shadow_return_stack) {
+              AddShadowStackCall(block,
+                                 target_trace ? target_trace
+                                              : intrinsics->missing_block,
+                                 inst.branch_not_taken_pc);
+              continue;
+            } else if (!target_trace) {
+              AddCall(block, intrinsics->missing_block, *intrinsics);
+            } else if (guarded_direct_calls) {
+              block = AddGuardedDirectCall(block, target_trace,
+                                           inst.branch_not_taken_pc);
+            } else {
+              AddCall(block, target_trace, *intrinsics);
+            }
           }
 
           const auto ret_pc_ref = LoadReturnProgramCounterRef(block);
@@ -517,11 +1345,26 @@ bool TraceLifter::Impl::Lift(
           llvm::BranchInst::Create(taken_block, not_taken_block,
                                    LoadBranchTaken(block), block);
 
-          trace_work_list.insert(inst.branch_taken_pc);
+          trace_work_list.Insert(inst.branch_taken_pc);
           auto target_trace = get_trace_decl(inst.branch_taken_pc);
-
-          AddCall(taken_block, intrinsics->function_call, *intrinsics);
-          AddCall(taken_block, target_trace, *intrinsics);
+          if (shadow_return_stack) {
+            AddShadowStackCall(taken_block,
+                               target_trace ? target_trace
+                                            : intrinsics->missing_block,
+                               inst.branch_not_taken_pc);
+            block = orig_not_taken_block;
+            continue;
+          } else if (target_trace && guarded_direct_calls) {
+            taken_block = AddGuardedDirectCall(taken_block, target_trace,
+                                               inst.branch_not_taken_pc);
+          } else {
+            if (!target_trace) {
+              target_trace = intrinsics->missing_block;
+            }
+
+            AddCall(taken_block, intrinsics->function_call, *intrinsics);
+            AddCall(taken_block, target_trace, *intrinsics);
+          }
 
           const auto ret_pc_ref = LoadReturnProgramCounterRef(taken_block);
           const auto next_pc_ref = LoadNextProgramCounterRef(taken_block);
@@ -567,8 +1410,14 @@ bool TraceLifter::Impl::Lift(
 
         case Instruction::kCategoryFunctionReturn:
           try_add_delay_slot(true, block);
-          AddTerminatingTailCall(block, intrinsics->function_return,
-                                 *intrinsics);
+          if (guarded_direct_calls) {
+            AddReturnToCaller(block);
+          } else if (shadow_return_stack) {
+            AddShadowReturnStackPop(block);
+          } else {
+            AddTerminatingTailCall(block, intrinsics->function_return,
+                                   *intrinsics);
+          }
           break;
 
         case Instruction::kCategoryConditionalFunctionReturn: {
@@ -592,8 +1441,14 @@ bool TraceLifter::Impl::Lift(
           llvm::BranchInst::Create(taken_block, not_taken_block,
                                    LoadBranchTaken(block), block);
 
-          AddTerminatingTailCall(taken_block, intrinsics->function_return,
-                                 *intrinsics);
+          if (guarded_direct_calls) {
+            AddReturnToCaller(taken_block);
+          } else if (shadow_return_stack) {
+            AddShadowReturnStackPop(taken_block);
+          } else {
+            AddTerminatingTailCall(taken_block, intrinsics->function_return,
+                                   *intrinsics);
+          }
           block = orig_not_taken_block;
           continue;
         }
@@ -659,6 +1514,13 @@ bool TraceLifter::Impl::Lift(
       }
     }
 
+    if (outline_cold_exits) {
+      OutlineColdExits(*intrinsics, func);
+    }
+
+    CommitCoveredBytes(trace_addr);
+    lifted_traces[trace_addr] = func;
+
     callback(trace_addr, func);
     manager.SetLiftedTraceDefinition(trace_addr, func);
   }
@@ -667,3 +1529,7 @@ bool TraceLifter::Impl::Lift(
 }
 
 }  // namespace remill
+
+extern "C" thread_local remill::ShadowReturnStackEntry
+    __remill_shadow_return_stack[remill::kShadowReturnStackSize] = {};
+extern "C" thread_local uint32_t __remill_shadow_return_stack_top = 0u;
@@ -29,6 +29,10 @@
 #  include <unistd.h>
 #endif
 
+#if defined(__aarch64__) && defined(__linux__)
+#  include <sys/auxv.h>
+#endif
+
 #include <llvm/ADT/SmallVector.h>
 #include <llvm/ADT/StringExtras.h>
 #include <llvm/Bitcode/BitcodeWriter.h>
@@ -57,6 +61,12 @@
 #include "remill/BC/Version.h"
 #include "remill/OS/FileSystem.h"
 
+#if LLVM_VERSION_NUMBER < LLVM_VERSION(17, 0)
+#  include <llvm/Support/Host.h>
+#else
+#  include <llvm/TargetParser/Host.h>
+#endif
+
 namespace {
 #ifdef _WIN32
 extern "C" std::uint32_t GetProcessId(std::uint32_t handle);
@@ -412,9 +422,46 @@ LoadArchSemantics(const Arch *arch,
     LOG(FATAL) << "Cannot find path to " << arch_name
                << " semantics bitcode file.";
 
+  // Prefer the best variant of the semantics that is tuned for this host.
+  auto is_tuned = false;
+  for (const auto &variant : HostSemanticsVariants()) {
+    auto variant_path = path->parent_path() /
+                        (std::string(arch_name) + "." + variant + ".bc");
+    if (std::filesystem::exists(variant_path)) {
+      path = std::move(variant_path);
+      is_tuned = true;
+      break;
+    }
+  }
+
   DLOG(INFO) << "Loading " << arch_name << " semantics from file " << *path;
   auto module = LoadModuleFromFile(arch->context, *path);
+
+  // `PrepareModule` removes the target CPU and features that the semantics
+  // were compiled with, but they are the point of a tuned variant, so put
+  // them back. Lifted functions adopt them from `__remill_intrinsics` (see
+  // `Arch::InitializeEmptyLiftedFunction`), so that they can inline the
+  // semantics.
+  std::vector<std::pair<llvm::Function *, llvm::AttributeSet>> target_attrs;
+  if (is_tuned) {
+    for (auto &func : *module) {
+      llvm::AttrBuilder attrs(*arch->context);
+      for (auto kind : {"target-cpu", "target-features"}) {
+        if (func.hasFnAttribute(kind)) {
+          attrs.addAttribute(func.getFnAttribute(kind));
+        }
+      }
+      if (attrs.hasAttributes()) {
+        target_attrs.emplace_back(
+            &func, llvm::AttributeSet::get(*arch->context, attrs));
+      }
+    }
+  }
+
   arch->PrepareModule(module);
+  for (const auto &[func, attrs] : target_attrs) {
+    func->addFnAttrs(llvm::AttrBuilder(*arch->context, attrs));
+  }
   arch->InitFromSemanticsModule(module.get());
   for (auto &func : *module) {
     Annotate<remill::Semantics>(&func);
@@ -422,6 +469,72 @@ LoadArchSemantics(const Arch *arch,
   return module;
 }
 
+// Return the names of the host-tuned semantics variants that the running
+// host can use, best first.
+std::vector<std::string> HostSemanticsVariants(void) {
+  static const std::vector<std::string> variants = [] {
+    std::vector<std::string> supported;
+
+#if defined(__x86_64__) || defined(_M_X64)
+    llvm::StringMap<bool> features;
+    if (!llvm::sys::getHostCPUFeatures(features)) {
+      return supported;
+    }
+
+    auto has_all = [&](std::initializer_list<const char *> names) {
+      for (auto name : names) {
+        if (!features.lookup(name)) {
+          return false;
+        }
+      }
+      return true;
+    };
+
+    // The x86-64 micro-architecture levels.
+    const auto v2 = has_all(
+        {"cx16", "sahf", "popcnt", "sse3", "sse4.1", "sse4.2", "ssse3"});
+    const auto v3 = v2 && has_all({"avx", "avx2", "bmi", "bmi2", "f16c", "fma",
+                                   "lzcnt", "movbe", "xsave"});
+    const auto v4 = v3 && has_all({"avx512f", "avx512bw", "avx512cd",
+                                   "avx512dq", "avx512vl"});
+    if (v4) {
+      supported.push_back("x86-64-v4");
+    }
+    if (v3) {
+      supported.push_back("x86-64-v3");
+    }
+    if (v2) {
+      supported.push_back("x86-64-v2");
+    }
+
+#elif defined(__aarch64__) && defined(__linux__)
+
+    // LLVM doesn't report enough AArch64 features to tell architecture
+    // versions apart, so look at the hardware capabilities instead. `DC CVAP`
+    // is mandatory as of ARMv8.2, and `FRINT*` and the flag manipulation
+    // instructions as of ARMv8.5.
+    static constexpr unsigned long kHWCapAtomics = 1ul << 8;
+    static constexpr unsigned long kHWCapDCPop = 1ul << 16;
+    static constexpr unsigned long kHWCap2FlagM2 = 1ul << 7;
+    static constexpr unsigned long kHWCap2Frint = 1ul << 8;
+    const auto hwcap = getauxval(AT_HWCAP);
+    const auto hwcap2 = getauxval(AT_HWCAP2);
+    const auto v8_2 = (hwcap & kHWCapAtomics) && (hwcap & kHWCapDCPop);
+    const auto v8_5 =
+        v8_2 && (hwcap2 & kHWCap2FlagM2) && (hwcap2 & kHWCap2Frint);
+    if (v8_5) {
+      supported.push_back("armv8.5-a");
+    }
+    if (v8_2) {
+      supported.push_back("armv8.2-a");
+    }
+#endif
+
+    return supported;
+  }();
+  return variants;
+}
+
 std::optional<std::string> VerifyModuleMsg(llvm::Module *module) {
   std::string error;
   llvm::raw_string_ostream error_stream(error);
@@ -846,6 +959,23 @@ static llvm::Function *DeclareFunctionInModule(llvm::Function *func,
   }
 
   moved_func = dest_func;
+
+  // A declaration can't have `linkonce_odr` or `weak_odr` linkage, but every
+  // module is allowed its own copy of such a definition, e.g. the cold exit
+  // stubs of `OutlineColdExits`, so copy over the definition.
+  if (!func->isDeclaration() &&
+      (func->hasLinkOnceODRLinkage() || func->hasWeakODRLinkage())) {
+    auto dest_arg = dest_func->arg_begin();
+    for (auto &arg : func->args()) {
+      dest_arg->setName(arg.getName());
+      value_map[&arg] = &*dest_arg++;
+    }
+
+    TypeMap type_map;
+    MDMap md_map;
+    CloneFunctionInto(func, dest_func, value_map, type_map, md_map);
+  }
+
   return dest_func;
 }
 
@@ -0,0 +1,588 @@
+/*
+ * Copyright (c) 2026 Trail of Bits, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "remill/OS/ElfLoader.h"
+
+#include <glog/logging.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <utility>
+#include <vector>
+
+#ifdef __linux__
+#  include <elf.h>
+#  include <fcntl.h>
+#  include <sys/mman.h>
+#  include <sys/stat.h>
+#  include <unistd.h>
+#endif
+
+namespace remill {
+namespace {
+
+#ifdef __linux__
+
+// Return `val`, byte-swapped if the file's byte order differs from the host's.
+template <typename T>
+static T Fix(T val, bool swap) {
+  if (!swap) {
+    return val;
+  }
+  uint8_t bytes[sizeof(T)];
+  memcpy(bytes, &val, sizeof(T));
+  std::reverse(bytes, bytes + sizeof(T));
+  memcpy(&val, bytes, sizeof(T));
+  return val;
+}
+
+static ArchName GetElfArchName(uint16_t machine, bool big_endian) {
+  switch (machine) {
+    case EM_386: return kArchX86;
+    case EM_X86_64: return kArchAMD64;
+    case EM_AARCH64:
+      return big_endian ? kArchInvalid : kArchAArch64LittleEndian;
+    case EM_ARM: return big_endian ? kArchInvalid : kArchAArch32LittleEndian;
+    case EM_PPC: return kArchPPC;
+    case EM_SPARC:
+    case EM_SPARC32PLUS: return kArchSparc32;
+    case EM_SPARCV9: return kArchSparc64;
+    default: return kArchInvalid;
+  }
+}
+
+#endif  // __linux__
+
+}  // namespace
+
+class ElfImage::Impl {
+ public:
+  ~Impl(void);
+
+  // Map the segments and read the symbols of the ELF file `file`, which is
+  // mapped into memory and open as `fd`.
+  template <typename Ehdr, typename Phdr, typename Shdr, typename Sym>
+  bool Load(int fd, const uint8_t *file, uint64_t file_size, bool big_endian,
+            uint64_t extra_size);
+
+  // Is `[addr, addr + size)` inside of the reservation?
+  bool Contains(uint64_t addr, uint64_t size) const;
+
+  // Is all of `[addr, addr + size)` mapped, by segments or `MapAnonymous`?
+  bool IsMapped(uint64_t addr, uint64_t size) const;
+
+  struct Segment {
+    uint64_t begin;
+    uint64_t end;
+    bool is_executable;
+    bool is_writable;
+  };
+
+  ArchName arch_name{kArchInvalid};
+  uint64_t entry{0};
+  uint64_t page_size{4096};
+
+  // Guest addresses of the reservation.
+  uint64_t begin{0};
+  uint64_t end{0};
+
+  uint8_t *reservation{nullptr};
+  uint8_t *host_base{nullptr};
+
+  std::vector<Segment> segments;
+
+  // Guest page ranges mapped into the reservation.
+  std::vector<std::pair<uint64_t, uint64_t>> mapped;
+  std::map<uint64_t, std::string> symbols;
+};
+
+ElfImage::Impl::~Impl(void) {
+#ifdef __linux__
+  if (reservation) {
+    munmap(reservation, end - begin);
+  }
+#endif
+}
+
+// Is `[addr, addr + size)` inside of the reservation?
+bool ElfImage::Impl::Contains(uint64_t addr, uint64_t size) const {
+  return addr >= begin && addr + size >= addr && addr + size <= end;
+}
+
+// Is all of `[addr, addr + size)` mapped, by segments or `MapAnonymous`?
+bool ElfImage::Impl::IsMapped(uint64_t addr, uint64_t size) const {
+  if (!Contains(addr, size)) {
+    return false;
+  }
+
+  // The mapped ranges can abut, so walk from one into the next.
+  const auto range_end = addr + size;
+  for (auto covered = true; covered && addr < range_end;) {
+    covered = false;
+    for (const auto &[page_begin, page_end] : mapped) {
+      if (page_begin <= addr && addr < page_end) {
+        addr = page_end;
+        covered = true;
+      }
+    }
+  }
+  return addr >= range_end;
+}
+
+#ifdef __linux__
+
+// Map the segments and read the symbols of the ELF file `file`.
+template <typename Ehdr, typename Phdr, typename Shdr, typename Sym>
+bool ElfImage::Impl::Load(int fd, const uint8_t *file, uint64_t file_size,
+                          bool big_endian, uint64_t extra_size) {
+  const auto swap = big_endian != (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__);
+  auto in_file = [=](uint64_t offset, uint64_t size) {
+    return offset <= file_size && size <= file_size - offset;
+  };
+
+  if (!in_file(0, sizeof(Ehdr))) {
+    LOG(ERROR) << "Truncated ELF header";
+    return false;
+  }
+
+  Ehdr ehdr;
+  memcpy(&ehdr, file, sizeof(ehdr));
+
+  arch_name = GetElfArchName(Fix(ehdr.e_machine, swap), big_endian);
+  if (kArchInvalid == arch_name) {
+    LOG(ERROR) << "Unsupported ELF machine " << Fix(ehdr.e_machine, swap);
+    return false;
+  }
+
+  entry = Fix(ehdr.e_entry, swap);
+
+  const uint64_t phoff = Fix(ehdr.e_phoff, swap);
+  const uint64_t phnum = Fix(ehdr.e_phnum, swap);
+  const uint64_t phentsize = Fix(ehdr.e_phentsize, swap);
+  if (phentsize < sizeof(Phdr) || !in_file(phoff, phnum * phentsize)) {
+    LOG(ERROR) << "Invalid ELF program headers";
+    return false;
+  }
+
+  std::vector<Phdr> loads;
+  for (uint64_t i = 0; i < phnum; ++i) {
+    Phdr phdr;
+    memcpy(&phdr, &(file[phoff + i * phentsize]), sizeof(phdr));
+    if (PT_LOAD == Fix(phdr.p_type, swap) && Fix(phdr.p_memsz, swap)) {
+      loads.push_back(phdr);
+    }
+  }
+
+  if (loads.empty()) {
+    LOG(ERROR) << "ELF file has no loadable segments";
+    return false;
+  }
+
+  auto page_floor = [=](uint64_t addr) { return addr & ~(page_size - 1u); };
+  auto page_ceil = [=](uint64_t addr) {
+    return (addr + page_size - 1u) & ~(page_size - 1u);
+  };
+
+  // Reserve one range of host memory for every segment plus the extra space,
+  // so that translating a guest address is a single addition.
+  begin = ~0ull;
+  end = 0;
+  for (const auto &phdr : loads) {
+    const uint64_t vaddr = Fix(phdr.p_vaddr, swap);
+    begin = std::min(begin, page_floor(vaddr));
+    end = std::max(end, page_ceil(vaddr + Fix(phdr.p_memsz, swap)));
+  }
+  end += page_ceil(extra_size);
+
+  auto mem = mmap(nullptr, end - begin, PROT_NONE,
+                  MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+  if (MAP_FAILED == mem) {
+    LOG(ERROR) << "Unable to reserve " << (end - begin)
+               << " bytes of guest address space";
+    end = begin;
+    return false;
+  }
+
+  reservation = static_cast<uint8_t *>(mem);
+  host_base = reinterpret_cast<uint8_t *>(
+      reinterpret_cast<uintptr_t>(reservation) - begin);
+
+  // The host pages spanned by each segment.
+  std::vector<std::pair<uint64_t, uint64_t>> pages;
+  for (const auto &phdr : loads) {
+    const uint64_t vaddr = Fix(phdr.p_vaddr, swap);
+    const uint64_t mem_bytes = std::max<uint64_t>(Fix(phdr.p_memsz, swap),
+                                                  Fix(phdr.p_filesz, swap));
+    pages.emplace_back(page_floor(vaddr), page_ceil(vaddr + mem_bytes));
+  }
+
+  // Return the protection of the host page at `page`, which is the union of
+  // the protections of the segments that share it.
+  auto page_prot = [&](uint64_t page) {
+    auto prot = PROT_READ;
+    for (size_t i = 0; i < loads.size(); ++i) {
+      if (pages[i].first <= page && page < pages[i].second &&
+          (Fix(loads[i].p_flags, swap) & PF_W)) {
+        prot |= PROT_WRITE;
+      }
+    }
+    return prot;
+  };
+
+  // Segments can share a host page, e.g. when the file is aligned to a
+  // smaller page size than the host's, or is linked with
+  // `-z noseparate-code`. Mapping the file over a shared page would replace
+  // the other segment's part of it, so the segments sharing a page are all
+  // copied into anonymous pages instead, which are mapped before anything is
+  // copied into them.
+  std::vector<bool> is_copied(loads.size(), false);
+  for (size_t i = 0; i < loads.size(); ++i) {
+    const uint64_t vaddr = Fix(loads[i].p_vaddr, swap);
+    const uint64_t offset = Fix(loads[i].p_offset, swap);
+    const uint64_t file_bytes = Fix(loads[i].p_filesz, swap);
+    if (!in_file(offset, file_bytes)) {
+      LOG(ERROR) << "Segment at " << std::hex << vaddr << std::dec
+                 << " extends past the end of the file";
+      return false;
+    }
+
+    // Map the file directly when its offset and address are congruent
+    // modulo the page size, which they are for any conventionally linked
+    // file; otherwise, fall back to copying the segment.
+    is_copied[i] = (vaddr % page_size) != (offset % page_size);
+    for (size_t j = 0; j < loads.size(); ++j) {
+      if (i != j && pages[i].first < pages[j].second &&
+          pages[j].first < pages[i].second) {
+        is_copied[i] = true;
+      }
+    }
+
+    if (is_copied[i]) {
+      mem = mmap(&(host_base[pages[i].first]),
+                 pages[i].second - pages[i].first, PROT_READ | PROT_WRITE,
+                 MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED, -1, 0);
+      if (MAP_FAILED == mem) {
+        LOG(ERROR) << "Unable to map segment at " << std::hex << vaddr
+                   << std::dec;
+        return false;
+      }
+    }
+  }
+
+  for (size_t i = 0; i < loads.size(); ++i) {
+    const auto &phdr = loads[i];
+    const uint64_t vaddr = Fix(phdr.p_vaddr, swap);
+    const uint64_t offset = Fix(phdr.p_offset, swap);
+    const uint64_t file_bytes = Fix(phdr.p_filesz, swap);
+    const uint64_t mem_bytes = std::max<uint64_t>(Fix(phdr.p_memsz, swap),
+                                                  file_bytes);
+    const auto flags = Fix(phdr.p_flags, swap);
+    const auto prot = PROT_READ | ((flags & PF_W) ? PROT_WRITE : 0);
+    const auto map_begin = pages[i].first;
+    const auto file_end = page_ceil(vaddr + file_bytes);
+
+    mapped.emplace_back(map_begin, pages[i].second);
+    segments.push_back(
+        {vaddr, vaddr + mem_bytes, !!(flags & PF_X), !!(flags & PF_W)});
+
+    // The anonymous pages of copied segments are already zeroed.
+    if (is_copied[i]) {
+      memcpy(&(host_base[vaddr]), &(file[offset]), file_bytes);
+      continue;
+    }
+
+    if (file_bytes) {
+      mem = mmap(&(host_base[map_begin]), file_end - map_begin,
+                 PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED, fd,
+                 static_cast<off_t>(page_floor(offset)));
+      if (MAP_FAILED == mem) {
+        LOG(ERROR) << "Unable to map segment at " << std::hex << vaddr
+                   << std::dec;
+        return false;
+      }
+
+      // Zero the rest of the last file page that belongs to the
+      // zero-initialized part of the segment. Only this page is copied.
+      if (mem_bytes > file_bytes) {
+        const auto zero_end = std::min(file_end, vaddr + mem_bytes);
+        memset(&(host_base[vaddr + file_bytes]), 0,
+               zero_end - (vaddr + file_bytes));
+      }
+
+      mprotect(&(host_base[map_begin]), file_end - map_begin, prot);
+    }
+
+    // Map the remaining zero-initialized pages, e.g. of `.bss`.
+    const auto anon_begin = file_bytes ? file_end : map_begin;
+    const auto anon_end = pages[i].second;
+    if (anon_end > anon_begin) {
+      mem = mmap(&(host_base[anon_begin]), anon_end - anon_begin, prot,
+                 MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED, -1, 0);
+      if (MAP_FAILED == mem) {
+        LOG(ERROR) << "Unable to map zero-initialized memory at " << std::hex
+                   << anon_begin << std::dec;
+        return false;
+      }
+    }
+  }
+
+  // Protect the copied segments now that nothing more is copied into them.
+  // Only their first and last pages can be shared.
+  for (size_t i = 0; i < loads.size(); ++i) {
+    if (!is_copied[i]) {
+      continue;
+    }
+    const auto prot =
+        PROT_READ | ((Fix(loads[i].p_flags, swap) & PF_W) ? PROT_WRITE : 0);
+    mprotect(&(host_base[pages[i].first]), pages[i].second - pages[i].first,
+             prot);
+    for (auto page : {pages[i].first, pages[i].second - page_size}) {
+      mprotect(&(host_base[page]), page_size, page_prot(page));
+    }
+  }
+
+  // Read the function symbols, if the section headers are present. Symbols
+  // from `.symtab` take precedence over those from `.dynsym`.
+  const uint64_t shoff = Fix(ehdr.e_shoff, swap);
+  const uint64_t shnum = Fix(ehdr.e_shnum, swap);
+  const uint64_t shentsize = Fix(ehdr.e_shentsize, swap);
+  if (!shoff || shentsize < sizeof(Shdr) ||
+      !in_file(shoff, shnum * shentsize)) {
+    return true;
+  }
+
+  auto get_shdr = [=](uint64_t i) {
+    Shdr shdr;
+    memcpy(&shdr, &(file[shoff + i * shentsize]), sizeof(shdr));
+    return shdr;
+  };
+
+  for (auto type : {SHT_SYMTAB, SHT_DYNSYM}) {
+    for (uint64_t i = 0; i < shnum; ++i) {
+      const auto shdr = get_shdr(i);
+      const uint64_t link = Fix(shdr.sh_link, swap);
+      if (static_cast<uint32_t>(type) != Fix(shdr.sh_type, swap) ||
+          link >= shnum) {
+        continue;
+      }
+
+      const auto strtab = get_shdr(link);
+      const uint64_t str_offset = Fix(strtab.sh_offset, swap);
+      const uint64_t str_size = Fix(strtab.sh_size, swap);
+      const uint64_t sym_offset = Fix(shdr.sh_offset, swap);
+      const uint64_t sym_size = Fix(shdr.sh_size, swap);
+      const uint64_t sym_entsize =
+          std::max<uint64_t>(Fix(shdr.sh_entsize, swap), sizeof(Sym));
+      if (!in_file(str_offset, str_size) || !in_file(sym_offset, sym_size)) {
+        continue;
+      }
+
+      for (uint64_t j = 0; j + sizeof(Sym) <= sym_size; j += sym_entsize) {
+        Sym sym;
+        memcpy(&sym, &(file[sym_offset + j]), sizeof(sym));
+        uint64_t value = Fix(sym.st_value, swap);
+        const uint64_t name = Fix(sym.st_name, swap);
+        if (STT_FUNC != ELF64_ST_TYPE(sym.st_info) || !value ||
+            SHN_UNDEF == Fix(sym.st_shndx, swap) || name >= str_size) {
+          continue;
+        }
+
+        if (kArchAArch32LittleEndian == arch_name) {
+          value &= ~1ull;
+        }
+
+        const auto str = reinterpret_cast<const char *>(
+            &(file[str_offset + name]));
+        symbols.emplace(value, std::string(str, strnlen(str, str_size - name)));
+      }
+    }
+  }
+
+  return true;
+}
+
+#endif  // __linux__
+
+ElfImage::ElfImage(void) : impl(new Impl) {}
+
+ElfImage::~ElfImage(void) {}
+
+// Load the ELF file at `path`.
+std::unique_ptr<ElfImage> ElfImage::Load(const std::string &path,
+                                         uint64_t extra_size) {
+#ifndef __linux__
+  LOG(ERROR) << "Loading ELF files is only supported on Linux hosts; "
+             << "cannot load " << path << " with " << extra_size
+             << " extra bytes";
+  return nullptr;
+#else
+  const auto fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (-1 == fd) {
+    LOG(ERROR) << "Unable to open ELF file " << path << ": "
+               << strerror(errno);
+    return nullptr;
+  }
+
+  struct stat info = {};
+  if (-1 == fstat(fd, &info) || info.st_size < EI_NIDENT) {
+    LOG(ERROR) << "Unable to read ELF file " << path;
+    close(fd);
+    return nullptr;
+  }
+
+  const auto file_size = static_cast<uint64_t>(info.st_size);
+  auto file_mem = mmap(nullptr, file_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  if (MAP_FAILED == file_mem) {
+    LOG(ERROR) << "Unable to map ELF file " << path << ": "
+               << strerror(errno);
+    close(fd);
+    return nullptr;
+  }
+
+  const auto file = static_cast<const uint8_t *>(file_mem);
+  std::unique_ptr<ElfImage> image(new ElfImage);
+  image->impl->page_size = static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+
+  auto loaded = false;
+  if (memcmp(file, ELFMAG, SELFMAG)) {
+    LOG(ERROR) << path << " is not an ELF file";
+
+  } else if (ELFDATA2LSB != file[EI_DATA] && ELFDATA2MSB != file[EI_DATA]) {
+    LOG(ERROR) << "Invalid byte order in ELF file " << path;
+
+  } else if (ELFCLASS32 == file[EI_CLASS]) {
+    loaded = image->impl->Load<Elf32_Ehdr, Elf32_Phdr, Elf32_Shdr, Elf32_Sym>(
+        fd, file, file_size, ELFDATA2MSB == file[EI_DATA], extra_size);
+
+  } else if (ELFCLASS64 == file[EI_CLASS]) {
+    loaded = image->impl->Load<Elf64_Ehdr, Elf64_Phdr, Elf64_Shdr, Elf64_Sym>(
+        fd, file, file_size, ELFDATA2MSB == file[EI_DATA], extra_size);
+
+  } else {
+    LOG(ERROR) << "Invalid class in ELF file " << path;
+  }
+
+  // The segments stay mapped after the file is closed.
+  munmap(file_mem, file_size);
+  close(fd);
+
+  if (!loaded) {
+    LOG(ERROR) << "Unable to load ELF file " << path;
+    return nullptr;
+  }
+
+  return image;
+#endif  // __linux__
+}
+
+ArchName ElfImage::Architecture(void) const {
+  return impl->arch_name;
+}
+
+uint64_t ElfImage::EntryPoint(void) const {
+  return impl->entry;
+}
+
+uint64_t ElfImage::BeginAddress(void) const {
+  return impl->begin;
+}
+
+uint64_t ElfImage::EndAddress(void) const {
+  return impl->end;
+}
+
+uint8_t *ElfImage::HostBase(void) const {
+  return impl->host_base;
+}
+
+// Return a host pointer to the guest range `[addr, addr + size)`.
+void *ElfImage::Translate(uint64_t addr, uint64_t size) const {
+  if (!impl->IsMapped(addr, size)) {
+    return nullptr;
+  }
+  return &(impl->host_base[addr]);
+}
+
+// Map zeroed, writable memory at the guest range `[addr, addr + size)`.
+bool ElfImage::MapAnonymous(uint64_t addr, uint64_t size) {
+#ifndef __linux__
+  return false;
+#else
+  const auto page_size = impl->page_size;
+  const auto map_begin = addr & ~(page_size - 1u);
+  const auto map_end = (addr + size + page_size - 1u) & ~(page_size - 1u);
+  if (!size || !impl->Contains(map_begin, map_end - map_begin)) {
+    LOG(ERROR) << "Cannot map " << size << " bytes at " << std::hex << addr
+               << std::dec << " outside of the guest address space";
+    return false;
+  }
+
+  for (const auto &seg : impl->segments) {
+    if (map_begin < ((seg.end + page_size - 1u) & ~(page_size - 1u)) &&
+        (seg.begin & ~(page_size - 1u)) < map_end) {
+      LOG(ERROR) << "Cannot map " << size << " bytes at " << std::hex << addr
+                 << " over the segment at " << seg.begin << std::dec;
+      return false;
+    }
+  }
+
+  auto mem = mmap(&(impl->host_base[map_begin]), map_end - map_begin,
+                  PROT_READ | PROT_WRITE,
+                  MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED, -1, 0);
+  if (MAP_FAILED == mem) {
+    return false;
+  }
+  impl->mapped.emplace_back(map_begin, map_end);
+  return true;
+#endif  // __linux__
+}
+
+// Try to read a byte of an executable segment.
+bool ElfImage::TryReadExecutableByte(uint64_t addr, uint8_t *byte) const {
+  for (const auto &seg : impl->segments) {
+    if (seg.is_executable && seg.begin <= addr && addr < seg.end) {
+      *byte = impl->host_base[addr];
+      return true;
+    }
+  }
+  return false;
+}
+
+// Try to read a byte of a segment that isn't writable.
+bool ElfImage::TryReadReadOnlyByte(uint64_t addr, uint8_t *byte) const {
+  for (const auto &seg : impl->segments) {
+    if (!seg.is_writable && seg.begin <= addr && addr < seg.end) {
+      *byte = impl->host_base[addr];
+      return true;
+    }
+  }
+  return false;
+}
+
+// Return the name of the function symbol at `addr`.
+std::string_view ElfImage::SymbolName(uint64_t addr) const {
+  if (auto it = impl->symbols.find(addr); it != impl->symbols.end()) {
+    return it->second;
+  }
+  return {};
+}
+
+const std::map<uint64_t, std::string> &ElfImage::Symbols(void) const {
+  return impl->symbols;
+}
+
+}  // namespace remill
@@ -0,0 +1,427 @@
+/*
+ * Copyright (c) 2026 Trail of Bits, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "remill/OS/LinuxSyscalls.h"
+
+#include <glog/logging.h>
+
+#include <atomic>
+#include <cerrno>
+#include <climits>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#ifdef __linux__
+#  include <fcntl.h>
+#  include <sys/syscall.h>
+#  include <sys/uio.h>
+#  include <sys/utsname.h>
+#  include <time.h>
+#  include <unistd.h>
+#endif
+
+namespace remill {
+namespace {
+
+enum class GuestABI {
+  kUnsupported,
+  kAMD64,
+  kAArch64,
+};
+
+static GuestABI GetGuestABI(ArchName arch_name) {
+  switch (arch_name) {
+    case kArchAMD64:
+    case kArchAMD64_AVX:
+    case kArchAMD64_AVX512:
+    case kArchAMD64_SLEIGH: return GuestABI::kAMD64;
+    case kArchAArch64LittleEndian:
+    case kArchAArch64LittleEndian_SLEIGH: return GuestABI::kAArch64;
+    default: return GuestABI::kUnsupported;
+  }
+}
+
+// The emulator used by the entry points of lifted code.
+static std::atomic<const LinuxSyscallEmulator *> gEmulator{nullptr};
+
+#ifdef __linux__
+
+static constexpr uint64_t kGuestPageSize = 4096;
+
+// Size of a guest `struct iovec` on a 64-bit guest.
+static constexpr uint64_t kGuestIOVecSize = 16;
+
+// Size of each field of a guest `struct utsname`.
+static constexpr size_t kGuestUtsNameFieldSize = 65;
+
+// The `openat` flags whose values differ between the amd64 and AArch64 ABIs.
+// All other flags have the same values.
+struct OpenFlags {
+  uint64_t directory;
+  uint64_t no_follow;
+  uint64_t direct;
+  uint64_t large_file;
+};
+
+static constexpr OpenFlags kAMD64OpenFlags = {0200000, 0400000, 040000, 0};
+static constexpr OpenFlags kAArch64OpenFlags = {040000, 0100000, 0200000,
+                                                0400000};
+
+// Return the host `openat` flags equivalent to the guest flags `flags`.
+static int TranslateOpenFlags(GuestABI abi, uint64_t flags) {
+  const auto &guest =
+      GuestABI::kAArch64 == abi ? kAArch64OpenFlags : kAMD64OpenFlags;
+  const auto differing =
+      guest.directory | guest.no_follow | guest.direct | guest.large_file;
+
+  auto host_flags = static_cast<int>(flags & ~differing);
+  if (flags & guest.directory) {
+    host_flags |= O_DIRECTORY;
+  }
+  if (flags & guest.no_follow) {
+    host_flags |= O_NOFOLLOW;
+  }
+  if (flags & guest.direct) {
+    host_flags |= O_DIRECT;
+  }
+  if (flags & guest.large_file) {
+    host_flags |= O_LARGEFILE;
+  }
+  return host_flags;
+}
+
+// Return the guest's view of the result `res` of a host system call.
+static uint64_t Result(int64_t res) {
+  if (-1 == res) {
+    return static_cast<uint64_t>(-static_cast<int64_t>(errno));
+  } else {
+    return static_cast<uint64_t>(res);
+  }
+}
+
+static uint64_t Error(int err) {
+  return static_cast<uint64_t>(-static_cast<int64_t>(err));
+}
+
+#endif  // __linux__
+
+}  // namespace
+
+// Return the system call numbered `number` in the user-mode Linux ABI of
+// `arch_name`.
+LinuxSyscall GetLinuxSyscall(ArchName arch_name, uint64_t number) {
+  switch (GetGuestABI(arch_name)) {
+    case GuestABI::kAMD64:
+      switch (number) {
+#define REMILL_AMD64_CASE(name, enumerator, amd64, aarch64) \
+  case amd64: return LinuxSyscall::enumerator;
+        REMILL_FOR_EACH_LINUX_SYSCALL(REMILL_AMD64_CASE)
+#undef REMILL_AMD64_CASE
+        default: return LinuxSyscall::kInvalid;
+      }
+
+    case GuestABI::kAArch64:
+      switch (number) {
+#define REMILL_AARCH64_CASE(name, enumerator, amd64, aarch64) \
+  case aarch64: return LinuxSyscall::enumerator;
+        REMILL_FOR_EACH_LINUX_SYSCALL(REMILL_AARCH64_CASE)
+#undef REMILL_AARCH64_CASE
+        default: return LinuxSyscall::kInvalid;
+      }
+
+    default: return LinuxSyscall::kInvalid;
+  }
+}
+
+// Return the name of a system call.
+std::string_view GetLinuxSyscallName(LinuxSyscall syscall) {
+  switch (syscall) {
+#define REMILL_NAME_CASE(name, enumerator, amd64, aarch64) \
+  case LinuxSyscall::enumerator: return #name;
+    REMILL_FOR_EACH_LINUX_SYSCALL(REMILL_NAME_CASE)
+#undef REMILL_NAME_CASE
+    default: return "invalid";
+  }
+}
+
+LinuxSyscallEmulator::LinuxSyscallEmulator(ArchName arch_name_,
+                                           GuestAddressTranslator translate_)
+    : arch_name(arch_name_),
+      translate(std::move(translate_)) {
+  LOG_IF(ERROR, GuestABI::kUnsupported == GetGuestABI(arch_name))
+      << "No user-mode Linux system call ABI for architecture number "
+      << static_cast<uint32_t>(arch_name);
+}
+
+// Emulate the system call numbered `number`.
+bool LinuxSyscallEmulator::Emulate(void *memory, uint64_t number,
+                                   const uint64_t *args, uint64_t &ret) const {
+  const auto syscall = GetLinuxSyscall(arch_name, number);
+  if (LinuxSyscall::kInvalid == syscall) {
+    return false;
+  }
+  return Emulate(memory, syscall, args, ret);
+}
+
+// Emulate `syscall` with the arguments `args`.
+bool LinuxSyscallEmulator::Emulate(void *memory, LinuxSyscall syscall,
+                                   const uint64_t *args, uint64_t &ret) const {
+#ifndef __linux__
+  (void) memory;
+  (void) syscall;
+  (void) args;
+  (void) ret;
+  return false;
+#else
+  const auto abi = GetGuestABI(arch_name);
+  if (GuestABI::kUnsupported == abi) {
+    return false;
+  }
+
+  // Translate `[addr, addr + size)` into `ptr`. Empty ranges translate to
+  // `nullptr`, so that e.g. zero-sized reads behave like on the host.
+  auto translate_range = [=](uint64_t addr, uint64_t size,
+                             void *&ptr) -> bool {
+    if (!size) {
+      ptr = nullptr;
+      return true;
+    } else if (addr + size < addr) {
+      return false;
+    }
+    ptr = translate(memory, addr, size);
+    return nullptr != ptr;
+  };
+
+  // Copy the NUL-terminated guest path at `addr` into `path`, one page at a
+  // time so that it may span discontiguous host mappings.
+  auto read_path = [=](uint64_t addr, std::string &path) -> int {
+    path.clear();
+    while (path.size() < PATH_MAX) {
+      const auto size = kGuestPageSize - (addr % kGuestPageSize);
+      auto chunk = static_cast<const char *>(translate(memory, addr, size));
+      if (!chunk) {
+        return EFAULT;
+      }
+      const auto len = strnlen(chunk, size);
+      path.append(chunk, len);
+      if (len < size) {
+        return 0;
+      }
+      addr += size;
+    }
+    return ENAMETOOLONG;
+  };
+
+  const auto fd = static_cast<int>(args[0]);
+  void *buf = nullptr;
+
+  switch (syscall) {
+    case LinuxSyscall::kRead:
+      if (!translate_range(args[1], args[2], buf)) {
+        ret = Error(EFAULT);
+      } else {
+        ret = Result(::read(fd, buf, args[2]));
+      }
+      return true;
+
+    case LinuxSyscall::kWrite:
+      if (!translate_range(args[1], args[2], buf)) {
+        ret = Error(EFAULT);
+      } else {
+        ret = Result(::write(fd, buf, args[2]));
+      }
+      return true;
+
+    case LinuxSyscall::kPRead64:
+      if (!translate_range(args[1], args[2], buf)) {
+        ret = Error(EFAULT);
+      } else {
+        ret = Result(
+            ::pread(fd, buf, args[2], static_cast<off_t>(args[3])));
+      }
+      return true;
+
+    case LinuxSyscall::kPWrite64:
+      if (!translate_range(args[1], args[2], buf)) {
+        ret = Error(EFAULT);
+      } else {
+        ret = Result(
+            ::pwrite(fd, buf, args[2], static_cast<off_t>(args[3])));
+      }
+      return true;
+
+    case LinuxSyscall::kReadV:
+    case LinuxSyscall::kWriteV: {
+      const auto count = args[2];
+      if (count > IOV_MAX) {
+        ret = Error(EINVAL);
+        return true;
+      }
+
+      if (!translate_range(args[1], count * kGuestIOVecSize, buf)) {
+        ret = Error(EFAULT);
+        return true;
+      }
+
+      // Both guest ABIs have 64-bit, little-endian `struct iovec`s, whose
+      // base addresses are guest addresses.
+      std::vector<struct iovec> iov(count);
+      const auto guest_iov = static_cast<const uint8_t *>(buf);
+      for (uint64_t i = 0; i < count; ++i) {
+        uint64_t base = 0;
+        uint64_t len = 0;
+        memcpy(&base, &(guest_iov[i * kGuestIOVecSize]), 8);
+        memcpy(&len, &(guest_iov[i * kGuestIOVecSize + 8]), 8);
+        if (!translate_range(base, len, iov[i].iov_base)) {
+          ret = Error(EFAULT);
+          return true;
+        }
+        iov[i].iov_len = len;
+      }
+
+      const auto iov_count = static_cast<int>(count);
+      if (LinuxSyscall::kReadV == syscall) {
+        ret = Result(::readv(fd, iov.data(), iov_count));
+      } else {
+        ret = Result(::writev(fd, iov.data(), iov_count));
+      }
+      return true;
+    }
+
+    case LinuxSyscall::kOpenAt: {
+      std::string path;
+      if (auto err = read_path(args[1], path)) {
+        ret = Error(err);
+      } else {
+        ret = Result(::openat(fd, path.c_str(),
+                              TranslateOpenFlags(abi, args[2]),
+                              static_cast<mode_t>(args[3])));
+      }
+      return true;
+    }
+
+    case LinuxSyscall::kClose: ret = Result(::close(fd)); return true;
+
+    case LinuxSyscall::kLSeek:
+      ret = Result(::lseek(fd, static_cast<off_t>(args[1]),
+                           static_cast<int>(args[2])));
+      return true;
+
+    case LinuxSyscall::kGetPID: ret = Result(::getpid()); return true;
+    case LinuxSyscall::kGetTID:
+      ret = Result(::syscall(SYS_gettid));
+      return true;
+    case LinuxSyscall::kGetUID: ret = Result(::getuid()); return true;
+    case LinuxSyscall::kGetEUID: ret = Result(::geteuid()); return true;
+    case LinuxSyscall::kGetGID: ret = Result(::getgid()); return true;
+    case LinuxSyscall::kGetEGID: ret = Result(::getegid()); return true;
+
+    // Report the guest's machine rather than the host's, so that programs
+    // that check it see the architecture that they were built for.
+    case LinuxSyscall::kUname: {
+      struct utsname host_uts = {};
+      if (-1 == ::uname(&host_uts)) {
+        ret = Result(-1);
+        return true;
+      }
+
+      char guest_uts[6][kGuestUtsNameFieldSize] = {};
+      const char *fields[6] = {host_uts.sysname,
+                               host_uts.nodename,
+                               host_uts.release,
+                               host_uts.version,
+                               GuestABI::kAArch64 == abi ? "aarch64"
+                                                         : "x86_64",
+                               host_uts.domainname};
+      for (auto i = 0u; i < 6u; ++i) {
+        strncpy(guest_uts[i], fields[i], kGuestUtsNameFieldSize - 1u);
+      }
+
+      if (!translate_range(args[0], sizeof(guest_uts), buf)) {
+        ret = Error(EFAULT);
+      } else {
+        memcpy(buf, guest_uts, sizeof(guest_uts));
+        ret = 0;
+      }
+      return true;
+    }
+
+    // Both guest ABIs have a 64-bit `tv_sec` and `tv_nsec`.
+    case LinuxSyscall::kClockGetTime: {
+      struct timespec ts = {};
+      if (-1 == ::clock_gettime(static_cast<clockid_t>(args[0]), &ts)) {
+        ret = Result(-1);
+      } else if (!translate_range(args[1], 16, buf)) {
+        ret = Error(EFAULT);
+      } else {
+        const int64_t guest_ts[2] = {static_cast<int64_t>(ts.tv_sec),
+                                     static_cast<int64_t>(ts.tv_nsec)};
+        memcpy(buf, guest_ts, sizeof(guest_ts));
+        ret = 0;
+      }
+      return true;
+    }
+
+    case LinuxSyscall::kGetRandom:
+#  ifdef SYS_getrandom
+      if (!translate_range(args[0], args[1], buf)) {
+        ret = Error(EFAULT);
+      } else {
+        ret = Result(::syscall(SYS_getrandom, buf, args[1],
+                               static_cast<unsigned>(args[2])));
+      }
+      return true;
+#  else
+      return false;
+#  endif
+
+    default: return false;
+  }
+#endif  // __linux__
+}
+
+// Set the emulator used by the entry points of lifted code.
+void SetLinuxSyscallEmulator(const LinuxSyscallEmulator *emulator) {
+  gEmulator.store(emulator);
+}
+
+}  // namespace remill
+
+extern "C" bool __remill_linux_syscall(void *memory, uint64_t number,
+                                       uint64_t *ret, uint64_t arg0,
+                                       uint64_t arg1, uint64_t arg2,
+                                       uint64_t arg3, uint64_t arg4,
+                                       uint64_t arg5) {
+  const uint64_t args[] = {arg0, arg1, arg2, arg3, arg4, arg5};
+  auto emulator = remill::gEmulator.load(std::memory_order_relaxed);
+  return emulator && emulator->Emulate(memory, number, args, *ret);
+}
+
+#define REMILL_DEFINE_LINUX_SYSCALL(name, enumerator, amd64, aarch64) \
+  extern "C" bool __remill_linux_syscall_##name( \
+      void *memory, uint64_t *ret, uint64_t arg0, uint64_t arg1, \
+      uint64_t arg2, uint64_t arg3, uint64_t arg4, uint64_t arg5) { \
+    const uint64_t args[] = {arg0, arg1, arg2, arg3, arg4, arg5}; \
+    auto emulator = remill::gEmulator.load(std::memory_order_relaxed); \
+    return emulator && \
+           emulator->Emulate(memory, remill::LinuxSyscall::enumerator, args, \
+                             *ret); \
+  }
+
+REMILL_FOR_EACH_LINUX_SYSCALL(REMILL_DEFINE_LINUX_SYSCALL)
+
+#undef REMILL_DEFINE_LINUX_SYSCALL
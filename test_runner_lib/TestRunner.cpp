@@ -20,6 +20,7 @@
 #include <llvm/ExecutionEngine/GenericValue.h>
 #include <llvm/ExecutionEngine/Interpreter.h>
 #include <llvm/ExecutionEngine/MCJIT.h>
+#include <llvm/IR/InstIterator.h>
 #include <llvm/IR/Instructions.h>
 #include <llvm/IR/Verifier.h>
 #include <llvm/Passes/PassBuilder.h>
@@ -34,11 +35,16 @@
 #include <remill/BC/InstructionLifter.h>
 #include <remill/BC/IntrinsicTable.h>
 #include <remill/BC/Lifter.h>
+#include <remill/BC/Optimizer.h>
+#include <remill/BC/PcodeInterpreter.h>
 #include <remill/BC/SleighLifter.h>
 #include <remill/BC/Util.h>
 #include <test_runner/TestRunner.h>
 
 #include <random>
+#include <unordered_set>
+#include <utility>
+#include <vector>
 
 
 namespace test_runner {
@@ -56,6 +62,39 @@ uint8_t random_boolean_flag(random_bytes_engine &rbe) {
   return gen(rbe);
 }
 
+// Execute the instruction `bytes` at `addr` on `state` with
+// `remill::PcodeInterpreter`.
+remill::InterpreterExit
+InterpretInstruction(const remill::Arch *arch,
+                     const remill::DecodingContext &context,
+                     std::string_view bytes, uint64_t addr, void *state,
+                     MemoryHandler *handler) {
+  remill::PcodeInterpreter interpreter(
+      arch, context,
+      [=](uint64_t byte_addr, uint8_t *byte) {
+        if (byte_addr < addr || byte_addr - addr >= bytes.size()) {
+          return false;
+        }
+        *byte = static_cast<uint8_t>(bytes[byte_addr - addr]);
+        return true;
+      },
+      [=](uint64_t mem_addr, uint8_t *data, size_t size) {
+        for (size_t i = 0; i < size; ++i) {
+          data[i] = handler->read_byte(mem_addr + i);
+        }
+        return true;
+      },
+      [=](uint64_t mem_addr, const uint8_t *data, size_t size) {
+        for (size_t i = 0; i < size; ++i) {
+          handler->WriteMemory<uint8_t>(mem_addr + i, data[i]);
+        }
+        return true;
+      });
+
+  auto pc = addr;
+  return interpreter.Run(state, pc, 1u);
+}
+
 void *MissingFunctionStub(const std::string &name) {
   if (auto res = llvm::sys::DynamicLibrary::SearchForAddressOfSymbol(name)) {
     return res;
@@ -279,6 +318,54 @@ LiftingTester::LiftInstructionFunction(std::string_view fname,
                                  this->arch->CreateInitialContext());
 }
 
+LiftedBatch LiftingTester::LiftInstructionFunctions(
+    const std::vector<LiftRequest> &requests) {
+  LiftedBatch batch;
+  batch.module = std::make_unique<llvm::Module>(
+      "", this->semantics_module->getContext());
+  batch.functions.reserve(requests.size());
+
+  std::vector<llvm::Function *> lifted_funcs;
+  lifted_funcs.reserve(requests.size());
+  for (const auto &req : requests) {
+    auto maybe_func = this->LiftInstructionFunction(req.fname, req.bytes,
+                                                    req.address, req.context);
+    if (maybe_func.has_value()) {
+      lifted_funcs.push_back(maybe_func->first);
+    }
+    batch.functions.push_back(std::move(maybe_func));
+  }
+
+  if (lifted_funcs.empty()) {
+    return batch;
+  }
+
+  // Optimize a copy of the semantics module so that the intrinsics and
+  // semantics not used by the lifted functions aren't carried along.
+  auto cloned = llvm::CloneModule(*this->semantics_module);
+  remill::OptimizeBareModule(cloned);
+
+  std::unordered_map<llvm::Function *, llvm::Function *> new_funcs;
+  for (auto func : lifted_funcs) {
+    new_funcs.emplace(
+        func, CopyFunctionIntoNewModule(batch.module.get(), func, cloned));
+  }
+
+  for (auto &maybe_func : batch.functions) {
+    if (maybe_func.has_value()) {
+      maybe_func->first = new_funcs[maybe_func->first];
+    }
+  }
+
+  // The batch module has its own copies, so don't grow the semantics module
+  // across batches.
+  for (auto func : lifted_funcs) {
+    func->eraseFromParent();
+  }
+
+  return batch;
+}
+
 const remill::Arch::ArchPtr &LiftingTester::GetArch() const {
   return this->arch;
 }
@@ -304,8 +391,42 @@ CopyFunctionIntoNewModule(llvm::Module *target, const llvm::Function *old_func,
   auto new_f = llvm::Function::Create(old_func->getFunctionType(),
                                       old_func->getLinkage(),
                                       old_func->getName(), target);
-  remill::CloneFunctionInto(old_module->getFunction(old_func->getName()),
-                            new_f);
+
+  // Create the functions defined in `old_module` that the copied code calls,
+  // directly or not, before cloning any bodies, so that internal callees are
+  // found by name rather than declared.
+  std::vector<std::pair<llvm::Function *, llvm::Function *>> to_clone;
+  std::unordered_set<llvm::Function *> created = {new_f};
+  to_clone.emplace_back(old_module->getFunction(old_func->getName()), new_f);
+  for (auto i = 0u; i < to_clone.size(); ++i) {
+    for (auto &inst : llvm::instructions(to_clone[i].first)) {
+      for (auto &op : inst.operands()) {
+        auto callee =
+            llvm::dyn_cast<llvm::Function>(op.get()->stripPointerCasts());
+        if (!callee || callee->isDeclaration()) {
+          continue;
+        }
+
+        auto new_callee = target->getFunction(callee->getName());
+        if (!new_callee) {
+          new_callee = llvm::Function::Create(callee->getFunctionType(),
+                                              callee->getLinkage(),
+                                              callee->getName(), target);
+        } else if (!new_callee->isDeclaration() ||
+                   created.count(new_callee)) {
+          continue;
+        }
+
+        created.insert(new_callee);
+        to_clone.emplace_back(callee, new_callee);
+      }
+    }
+  }
+
+  for (auto [old_f, copy_f] : to_clone) {
+    remill::CloneFunctionInto(old_f, copy_f);
+  }
+
   return new_f;
 }
 
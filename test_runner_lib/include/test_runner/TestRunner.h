@@ -28,12 +28,19 @@
 #include <llvm/Support/TargetSelect.h>
 #include <llvm/Transforms/Utils/Cloning.h>
 #include <remill/Arch/Arch.h>
+#include <remill/Arch/Context.h>
+#include <remill/BC/Interpreter.h>
 #include <remill/BC/Util.h>
 
+#include <cstring>
+#include <memory>
+#include <optional>
 #include <random>
 #include <sstream>
 #include <string>
+#include <string_view>
 #include <unordered_map>
+#include <vector>
 
 namespace test_runner {
 
@@ -94,6 +101,9 @@ void MemoryHandler::WriteMemory(uint64_t addr, T value) {
 
 void StubOutFlagComputationInstrinsics(llvm::Module *mod,
                                        llvm::ExecutionEngine &exec_engine);
+
+// Copy the function of `old_module` named like `old_func` into `target`, along
+// with the functions defined in `old_module` that it calls, directly or not.
 llvm::Function *
 CopyFunctionIntoNewModule(llvm::Module *target, const llvm::Function *old_func,
                           const std::unique_ptr<llvm::Module> &old_module);
@@ -169,9 +179,70 @@ void RandomizeState(T &state, random_bytes_engine &rbe) {
 
 uint8_t random_boolean_flag(random_bytes_engine &rbe);
 
+// Execute the instruction `bytes` at `addr` on `state` with
+// `remill::PcodeInterpreter`, decoding it with `context`, and accessing memory
+// through `handler`.
+remill::InterpreterExit
+InterpretInstruction(const remill::Arch *arch,
+                     const remill::DecodingContext &context,
+                     std::string_view bytes, uint64_t addr, void *state,
+                     MemoryHandler *handler);
+
+// Check that interpreting the instruction `bytes` at `addr` from `state` and
+// `memory` has the same effects as running its lifted code did, i.e. leads
+// to `lifted_state` and `lifted_memory`. `memory` should hold the bytes that
+// the lifted code read without them having been initialized.
+template <typename T>
+void CheckInterpretedInstruction(const remill::Arch *arch,
+                                 const remill::DecodingContext &context,
+                                 std::string_view bytes, uint64_t addr,
+                                 T state, MemoryHandler &memory,
+                                 const T &lifted_state,
+                                 const MemoryHandler &lifted_memory) {
+  const auto exit =
+      InterpretInstruction(arch, context, bytes, addr, &state, &memory);
+  CHECK(exit == remill::InterpreterExit::kUninterpretable ||
+        exit == remill::InterpreterExit::kMaxInstructions)
+      << "Unexpected exit from the p-code interpreter at " << std::hex << addr;
+
+  uint8_t interpreted_bytes[sizeof(T)];
+  uint8_t lifted_bytes[sizeof(T)];
+  std::memcpy(interpreted_bytes, &state, sizeof(T));
+  std::memcpy(lifted_bytes, &lifted_state, sizeof(T));
+  for (size_t i = 0; i < sizeof(T); ++i) {
+    CHECK_EQ(static_cast<unsigned>(interpreted_bytes[i]),
+             static_cast<unsigned>(lifted_bytes[i]))
+        << "Interpreted and lifted states differ at offset " << i;
+  }
+
+  CHECK(memory.GetMemory() == lifted_memory.GetMemory())
+      << "Interpreted and lifted memory differ: " << memory.DumpState()
+      << " vs. " << lifted_memory.DumpState();
+}
+
 
 enum TypeId { MEMORY = 0, STATE = 1 };
 
+// A single instruction to lift with `LiftingTester::LiftInstructionFunctions`.
+struct LiftRequest {
+  std::string fname;
+  std::string bytes;
+  uint64_t address;
+  remill::DecodingContext context;
+};
+
+// The functions produced by `LiftingTester::LiftInstructionFunctions`.
+struct LiftedBatch {
+
+  // Module holding the optimized lifted functions, and only what they use.
+  std::unique_ptr<llvm::Module> module;
+
+  // One entry per lift request, in request order. An entry is empty if its
+  // instruction could not be decoded or lifted.
+  std::vector<std::optional<std::pair<llvm::Function *, remill::Instruction>>>
+      functions;
+};
+
 class LiftingTester {
  private:
   std::shared_ptr<llvm::Module> semantics_module;
@@ -198,6 +269,13 @@ class LiftingTester {
   LiftInstructionFunction(std::string_view fname, std::string_view bytes,
                           uint64_t address, const remill::DecodingContext &ctx);
 
+  // Lifts every instruction in `requests` into its own function. The
+  // semantics module is cloned and optimized once for the whole batch rather
+  // than once per instruction, and the functions are moved into a single new
+  // module, so that they can all be JIT compiled at once.
+  LiftedBatch
+  LiftInstructionFunctions(const std::vector<LiftRequest> &requests);
+
   const remill::Arch::ArchPtr &GetArch() const;
 };
 }  // namespace test_runner
@@ -34,6 +34,7 @@
 #include "remill/Arch/Arch.h"
 #include "remill/Arch/Instruction.h"
 #include "remill/Arch/Name.h"
+#include "remill/BC/Interpreter.h"
 #include "remill/BC/IntrinsicTable.h"
 #include "remill/BC/Lifter.h"
 #include "remill/BC/Util.h"
@@ -145,6 +146,10 @@ extern "C" int main(int argc, char *argv[]) {
     lifted_trace->setName(ss.str());
   }
 
+  // Compile the interpreter handlers in as well, so that the test cases can
+  // also be run with `remill::Interpreter` (see `--interpret`).
+  remill::AddInterpreterHandlers(arch.get(), module.get());
+
   DLOG(INFO) << "Serializing bitcode to " << FLAGS_bc_out;
   auto host_arch =
       remill::Arch::Build(&context, os_name, remill::GetArchName(REMILL_ARCH));
@@ -20,29 +20,55 @@
 #include <gflags/gflags.h>
 #include <glog/logging.h>
 #include <gtest/gtest.h>
+#include <llvm/IR/LLVMContext.h>
+#include <llvm/IR/Module.h>
 #include <setjmp.h>
 #include <signal.h>
 #include <ucontext.h>
 
 #include <cfenv>
+#include <algorithm>
+#include <chrono>
 #include <cmath>
 #include <cstdint>
 #include <cstdlib>
 #include <cstring>
+#include <iomanip>
 #include <iostream>
 #include <limits>
 #include <map>
+#include <memory>
 #include <string>
 #include <type_traits>
 #include <vector>
 
 #include "remill/Arch/AArch64/Runtime/State.h"
+#include "remill/Arch/Arch.h"
+#include "remill/Arch/Name.h"
 #include "remill/Arch/Runtime/Runtime.h"
+#include "remill/BC/Interpreter.h"
+#include "remill/BC/Util.h"
+#include "remill/OS/OS.h"
 #include "tests/AArch64/Test.h"
 
 DECLARE_string(arch);
 DECLARE_string(os);
 
+DEFINE_bool(benchmark, false,
+            "Instead of checking that the lifted test cases behave like the "
+            "native ones, time both, and report how much slower the lifted "
+            "code is for each category of tests.");
+
+DEFINE_uint64(benchmark_iterations, 1000,
+              "Number of times to run each input of each test case when "
+              "benchmarking.");
+
+DEFINE_bool(interpret, false,
+            "Run the test cases with `remill::Interpreter`, using the "
+            "interpreter handlers compiled into this program, instead of "
+            "their lifted traces. Test cases with instructions that can't be "
+            "interpreted fall back to their lifted traces.");
+
 namespace {
 
 // SIGSTKSZ is no longer constant in glibc 2.34+
@@ -588,6 +614,16 @@ typedef Memory *(LiftedFunc) (State &, addr_t, Memory *);
 static std::map<uint64_t, LiftedFunc *> gTranslatedFuncs;
 
 static std::vector<const test::TestInfo *> gTests;
+
+// Interpreter used instead of the lifted traces with `--interpret`.
+static remill::Interpreter *gInterpreter = nullptr;
+
+// Test case being interpreted. Only its bytes are readable by the interpreter,
+// so that it stops at the end of the test case.
+static const test::TestInfo *gInterpretedTest = nullptr;
+
+// Upper bound on the number of instructions interpreted for one test case.
+static constexpr uint64_t kMaxInterpretedInstructions = 1u << 20u;
 }  // namespace
 
 class InstrTest : public ::testing::TestWithParam<const test::TestInfo *> {};
@@ -602,6 +638,41 @@ inline static bool operator!=(const T &a, const T &b) {
   return !!memcmp(&a, &b, sizeof(a));
 }
 
+// Run the test case `info` on `state` with the interpreter, starting at the
+// program counter of `state`. Returns `false`, with `state` and the stack as
+// they were, if the interpreter stopped before the end of the test case
+// because it can't interpret some instruction.
+static bool InterpretTestCase(const test::TestInfo *info, State *state) {
+  std::aligned_storage<sizeof(State), alignof(State)>::type initial_state;
+  memcpy(&initial_state, state, sizeof(initial_state));
+
+  gInterpretedTest = info;
+  uint64_t pc = state->gpr.pc.aword;
+  void *memory = nullptr;
+  switch (gInterpreter->Run(state, memory, pc, kMaxInterpretedInstructions)) {
+
+    // Like `__remill_error`.
+    case remill::InterpreterExit::kError:
+      siglongjmp(gJmpBuf, 0);
+
+    case remill::InterpreterExit::kUninterpretable:
+      if (pc == info->test_end) {
+        return true;
+      }
+      DLOG(INFO) << "Can't interpret " << info->test_name << " at " << std::hex
+                 << pc << std::dec;
+      memcpy(state, &initial_state, sizeof(initial_state));
+      memcpy(&gLiftedStack, &gRandomStack, sizeof(gLiftedStack));
+      std::fesetenv(FE_DFL_ENV);
+      return false;
+
+    default:
+      ADD_FAILURE() << "Unexpected exit from the interpreter in "
+                    << info->test_name << " at " << std::hex << pc << std::dec;
+      return true;
+  }
+}
+
 static void RunWithFlags(const test::TestInfo *info, NZCV flags,
                          std::string desc, uint64_t arg1, uint64_t arg2,
                          uint64_t arg3) {
@@ -653,7 +724,9 @@ static void RunWithFlags(const test::TestInfo *info, NZCV flags,
   if (!sigsetjmp(gJmpBuf, true)) {
     std::fesetenv(FE_DFL_ENV);
     gInNativeTest = false;
-    (void) lifted_func(*lifted_state, lifted_state->gpr.pc.aword, nullptr);
+    if (!FLAGS_interpret || !InterpretTestCase(info, lifted_state)) {
+      (void) lifted_func(*lifted_state, lifted_state->gpr.pc.aword, nullptr);
+    }
   } else {
     EXPECT_TRUE(native_test_faulted);
   }
@@ -799,6 +872,205 @@ std::string NameTest(const testing::TestParamInfo<InstrTest::ParamType> &test) {
 INSTANTIATE_TEST_SUITE_P(GeneralInstrTest, InstrTest, testing::ValuesIn(gTests),
                          NameTest);
 
+// Time spent running the native and lifted versions of some test cases.
+struct BenchmarkTimes {
+  std::chrono::steady_clock::duration native{0};
+  std::chrono::steady_clock::duration lifted{0};
+  unsigned num_tests{0};
+
+  // Sum of the logarithms of the slowdowns of the individual test cases.
+  double log_slowdowns{0};
+};
+
+// Return the category of a test, i.e. the name of the directory containing
+// its source file, e.g. `BINARY` for `tests/AArch64/BINARY/ADD_n_ADDSUB_IMM.S`.
+static std::string TestCategory(const test::TestInfo *info) {
+  std::string path(info->test_file);
+  auto end = path.find_last_of('/');
+  if (!end || end == std::string::npos) {
+    return path;
+  }
+  auto begin = path.find_last_of('/', end - 1);
+  begin = begin == std::string::npos ? 0 : begin + 1;
+  return path.substr(begin, end - begin);
+}
+
+// The number of iterations of a test case that are timed together, so that
+// reading the clock doesn't add to the time of short test cases.
+static constexpr uint64_t kBenchmarkBatchSize = 100u;
+
+// Run `body` `FLAGS_benchmark_iterations` times, in batches of
+// `kBenchmarkBatchSize` iterations that are each timed as a whole, and
+// return the time of the fastest batch, scaled up to all of the iterations.
+// Taking the fastest batch filters out interrupts and the like.
+template <typename T>
+static std::chrono::steady_clock::duration TimeIterations(T body) {
+  using Clock = std::chrono::steady_clock;
+  const auto batch_size =
+      std::min<uint64_t>(FLAGS_benchmark_iterations, kBenchmarkBatchSize);
+  if (!batch_size) {
+    return Clock::duration::zero();
+  }
+
+  auto fastest = Clock::duration::max();
+  for (uint64_t i = 0; i < FLAGS_benchmark_iterations; i += batch_size) {
+    const auto begin = Clock::now();
+    for (uint64_t j = 0; j < batch_size; ++j) {
+      body();
+    }
+    fastest = std::min<Clock::duration>(fastest, Clock::now() - begin);
+  }
+  return fastest * FLAGS_benchmark_iterations / batch_size;
+}
+
+// Time `FLAGS_benchmark_iterations` runs of the native and lifted versions
+// of a test case with one of its inputs. The test case is run with the
+// flags cleared. Returns `false`, and times nothing, if either version
+// faults or uses an unsupported instruction.
+static bool BenchmarkWithArgs(const test::TestInfo *info, uint64_t arg1,
+                              uint64_t arg2, uint64_t arg3,
+                              BenchmarkTimes &times) {
+  if (sigsetjmp(gUnsupportedInstrBuf, true)) {
+    return false;
+  }
+
+  // Recovering from a fault is orders of magnitude slower than running the
+  // test case, so faulting test cases aren't timed at all.
+  if (sigsetjmp(gJmpBuf, true)) {
+    return false;
+  }
+
+  gTestToRun = info->test_begin;
+  gStackSwitcher = &(gLiftedStack._redzone2[0]);
+
+  // The resetting of the stack and of the flags is timed along with the test
+  // case, and is part of the overhead measured with the empty test case.
+  gInNativeTest = true;
+  const auto native_time = TimeIterations([=] {
+    memcpy(&gLiftedStack, &gRandomStack, sizeof(gLiftedStack));
+    asm("msr nzcv, %0" : : "r"(0UL));
+    InvokeTestCase(arg1, arg2, arg3);
+  });
+
+  // `InvokeTestCase` saves the state before the native test case into
+  // `gLiftedState`, which is where every lifted run starts from.
+  std::aligned_storage<sizeof(State), alignof(State)>::type initial_state;
+  memcpy(&initial_state, &gLiftedState, sizeof(initial_state));
+
+  auto lifted_state = reinterpret_cast<State *>(&gLiftedState);
+  auto lifted_func = gTranslatedFuncs[info->test_begin];
+
+  // Includes the additional injected `adrp` and `add`.
+  const auto pc = static_cast<addr_t>(info->test_begin + 4 + 4);
+
+  gInNativeTest = false;
+  const auto lifted_time = TimeIterations([&] {
+    memcpy(&gLiftedStack, &gRandomStack, sizeof(gLiftedStack));
+    memcpy(&gLiftedState, &initial_state, sizeof(gLiftedState));
+    lifted_state->gpr.pc.aword = pc;
+    std::fesetenv(FE_DFL_ENV);
+    (void) lifted_func(*lifted_state, pc, nullptr);
+  });
+
+  times.native += native_time;
+  times.lifted += lifted_time;
+  return true;
+}
+
+// Print one row of the benchmark report.
+static void PrintBenchmarkTimes(const std::string &name,
+                                const BenchmarkTimes &times) {
+  using Millis = std::chrono::duration<double, std::milli>;
+  const auto native_ms = Millis(times.native).count();
+  const auto lifted_ms = Millis(times.lifted).count();
+  std::cout << std::left << std::setw(12) << name << std::right
+            << std::setw(8) << times.num_tests << std::fixed
+            << std::setprecision(3) << std::setw(14) << native_ms
+            << std::setw(14) << lifted_ms << std::setprecision(2)
+            << std::setw(11) << (lifted_ms / native_ms) << 'x'
+            << std::setw(11)
+            << std::exp(times.log_slowdowns / times.num_tests) << 'x'
+            << std::endl;
+}
+
+// Benchmark every input of every test case, and report the slowdown of the
+// lifted code relative to the native code for each category of tests, and
+// overall. The slowdown is reported both as the ratio of the total times,
+// which is dominated by the slowest test cases, and as the geometric mean of
+// the slowdowns of the individual test cases. The overhead of the test
+// harness is excluded from both.
+static int RunBenchmarks(void) {
+  std::map<std::string, BenchmarkTimes> categories;
+  BenchmarkTimes total;
+
+  // The empty test case only runs the test harness, e.g. saving and restoring
+  // the machine state, and its times are subtracted from the times of every
+  // other test case.
+  const test::TestInfo *empty_test = nullptr;
+  for (auto info : gTests) {
+    if (!strcmp(info->test_name, "EMPTY_1")) {
+      empty_test = info;
+    }
+  }
+
+  BenchmarkTimes overhead;
+  if (!empty_test || !BenchmarkWithArgs(empty_test, 0, 0, 0, overhead)) {
+    LOG(ERROR) << "Could not benchmark the empty test case";
+    return EXIT_FAILURE;
+  }
+
+  for (auto info : gTests) {
+    if (info == empty_test) {
+      continue;
+    }
+
+    BenchmarkTimes times;
+    auto timed = false;
+    for (auto args = info->args_begin; args < info->args_end;
+         args += info->num_args) {
+      BenchmarkTimes run;
+      if (BenchmarkWithArgs(info, args[0], args[1], args[2], run)) {
+        times.native += std::max(run.native - overhead.native,
+                                 decltype(run.native)::zero());
+        times.lifted += std::max(run.lifted - overhead.lifted,
+                                 decltype(run.lifted)::zero());
+        timed = true;
+      }
+    }
+
+    if (!timed || !times.native.count() || !times.lifted.count()) {
+      LOG(WARNING) << "Could not benchmark " << info->test_name;
+      continue;
+    }
+
+    const auto log_slowdown =
+        std::log(std::chrono::duration<double>(times.lifted) /
+                 std::chrono::duration<double>(times.native));
+
+    for (auto agg : {&(categories[TestCategory(info)]), &total}) {
+      agg->native += times.native;
+      agg->lifted += times.lifted;
+      agg->num_tests += 1;
+      agg->log_slowdowns += log_slowdown;
+    }
+  }
+
+  std::cout << std::left << std::setw(12) << "CATEGORY" << std::right
+            << std::setw(8) << "TESTS" << std::setw(14) << "NATIVE (ms)"
+            << std::setw(14) << "LIFTED (ms)" << std::setw(12) << "SLOWDOWN"
+            << std::setw(12) << "GEOMEAN" << std::endl;
+
+  for (const auto &[category, times] : categories) {
+    PrintBenchmarkTimes(category, times);
+  }
+
+  if (total.num_tests) {
+    PrintBenchmarkTimes("TOTAL", total);
+  }
+
+  return 0;
+}
+
 // Recover from a signal.
 static void RecoverFromError(int sig_num, siginfo_t *, void *context_) {
   if (gInNativeTest) {
@@ -949,8 +1221,41 @@ int main(int argc, char **argv) {
     b = static_cast<uint8_t>(random());
   }
 
+  // Build the interpreter over the handlers compiled into this program. Its
+  // architecture comes from the same semantics as those handlers.
+  llvm::LLVMContext context;
+  remill::Arch::ArchPtr arch;
+  std::unique_ptr<llvm::Module> semantics;
+  std::unique_ptr<remill::Interpreter> interpreter;
+  if (FLAGS_interpret) {
+    arch = remill::Arch::Build(&context, remill::GetOSName(REMILL_OS),
+                               remill::kArchAArch64LittleEndian);
+    semantics = remill::LoadArchSemantics(arch.get());
+    interpreter = std::make_unique<remill::Interpreter>(
+        arch.get(),
+        [this_exe](const std::string &name) {
+          auto sym_handler = dlsym(this_exe, name.c_str());
+          if (!sym_handler) {
+            sym_handler = dlsym(this_exe, ("_" + name).c_str());
+          }
+          return reinterpret_cast<remill::InterpreterHandler>(sym_handler);
+        },
+        [](uint64_t addr, uint8_t *byte) {
+          if (addr < gInterpretedTest->test_begin ||
+              addr >= gInterpretedTest->test_end) {
+            return false;
+          }
+          *byte = *reinterpret_cast<const uint8_t *>(addr);
+          return true;
+        });
+    gInterpreter = interpreter.get();
+  }
+
   testing::InitGoogleTest(&argc, argv);
 
   SetupSignals();
+  if (FLAGS_benchmark) {
+    return RunBenchmarks();
+  }
   return RUN_ALL_TESTS();
 }
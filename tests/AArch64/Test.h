@@ -31,6 +31,10 @@ struct alignas(128) TestInfo {
   const uint64_t *const args_end;
   const uint64_t num_args;
   const char *isel_name;
+
+  // Path of the assembly file defining the test. The name of its directory
+  // is the test's category, e.g. `BINARY`.
+  const char *test_file;
 } __attribute__((packed));
 
 extern "C" {
@@ -0,0 +1,103 @@
+/*
+ * Copyright (c) 2026 Trail of Bits, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <gtest/gtest.h>
+#include <llvm/IR/Function.h>
+#include <llvm/IR/LLVMContext.h>
+#include <llvm/IR/Module.h>
+
+#include <cstdint>
+
+#include "remill/Arch/Arch.h"
+#include "remill/Arch/Name.h"
+#include "remill/BC/ABI.h"
+#include "remill/BC/IntrinsicTable.h"
+#include "remill/BC/Optimizer.h"
+#include "remill/BC/Util.h"
+#include "remill/OS/OS.h"
+
+namespace {
+
+// Return the size of the `State` structure of `arch` in `module`.
+static uint64_t StateSize(const remill::Arch *arch, llvm::Module *module) {
+  return module->getDataLayout()
+      .getTypeAllocSize(remill::RecontextualizeType(arch->StateStructType(),
+                                                    module->getContext()))
+      .getFixedValue();
+}
+
+}  // namespace
+
+TEST(InferFunctionAttributes, AArch64Semantics) {
+  llvm::LLVMContext context;
+  auto arch = remill::Arch::Build(&context, remill::OSName::kOSLinux,
+                                  remill::ArchName::kArchAArch64LittleEndian);
+  auto sems = remill::LoadArchSemantics(arch.get());
+  remill::InferFunctionAttributes(arch.get(), sems.get());
+
+  auto isel = sems->getGlobalVariable("ISEL_ADD_64_ADDSUB_IMM");
+  ASSERT_TRUE(isel && isel->hasInitializer());
+  auto sem = llvm::dyn_cast<llvm::Function>(
+      isel->getInitializer()->stripPointerCasts());
+  ASSERT_TRUE(sem && !sem->isDeclaration());
+
+  // `ADD` only writes its destination register in the `State`, and neither
+  // loops nor calls anything that could free or synchronize.
+  EXPECT_TRUE(sem->doesNotFreeMemory());
+  EXPECT_TRUE(sem->hasNoSync());
+  EXPECT_TRUE(sem->willReturn());
+  EXPECT_TRUE(sem->onlyAccessesArgMemory());
+  EXPECT_TRUE(sem->hasParamAttribute(1u, llvm::Attribute::NonNull));
+  EXPECT_EQ(sem->getParamDereferenceableBytes(1u),
+            StateSize(arch.get(), sems.get()));
+}
+
+// Only the traces and the control-flow intrinsics are known to be given a
+// whole `State`. Other intrinsics of the same type, such as the atomic memory
+// intrinsics, take a `Memory` pointer in that position, which can be null.
+TEST(InferFunctionAttributes, AArch64OnlyTracesAndControlFlow) {
+  llvm::LLVMContext context;
+  auto arch = remill::Arch::Build(&context, remill::OSName::kOSLinux,
+                                  remill::ArchName::kArchAArch64LittleEndian);
+  auto sems = remill::LoadArchSemantics(arch.get());
+  auto trace = arch->DefineLiftedFunction("trace", sems.get());
+  auto other = arch->DeclareLiftedFunction("other", sems.get());
+  remill::InferFunctionAttributes(arch.get(), sems.get(), {trace});
+
+  const auto state_size = StateSize(arch.get(), sems.get());
+  auto intrinsics = arch->GetInstrinsicTable();
+  ASSERT_NE(intrinsics, nullptr);
+  for (auto func : {trace, intrinsics->function_call,
+                    intrinsics->function_return, intrinsics->jump,
+                    intrinsics->missing_block, intrinsics->error}) {
+    EXPECT_TRUE(func->hasParamAttribute(remill::kStatePointerArgNum,
+                                        llvm::Attribute::NonNull))
+        << func->getName().str();
+    EXPECT_EQ(func->getParamDereferenceableBytes(remill::kStatePointerArgNum),
+              state_size)
+        << func->getName().str();
+  }
+
+  auto fetch_and_add = sems->getFunction("__remill_fetch_and_add_64");
+  ASSERT_NE(fetch_and_add, nullptr);
+  ASSERT_EQ(fetch_and_add->getFunctionType(), trace->getFunctionType());
+  EXPECT_FALSE(fetch_and_add->hasParamAttribute(0u, llvm::Attribute::NonNull));
+  EXPECT_EQ(fetch_and_add->getParamDereferenceableBytes(0u), 0u);
+
+  EXPECT_FALSE(other->hasParamAttribute(remill::kStatePointerArgNum,
+                                        llvm::Attribute::NonNull));
+}
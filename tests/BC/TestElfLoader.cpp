@@ -0,0 +1,276 @@
+/*
+ * Copyright (c) 2026 Trail of Bits, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+#include <llvm/IR/Function.h>
+#include <llvm/IR/LLVMContext.h>
+#include <llvm/IR/Module.h>
+
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+#ifdef __linux__
+#  include <elf.h>
+#  include <stdlib.h>
+#  include <unistd.h>
+#endif
+
+#include "remill/Arch/Arch.h"
+#include "remill/Arch/Name.h"
+#include "remill/BC/ElfTraceManager.h"
+#include "remill/BC/TraceLifter.h"
+#include "remill/BC/Util.h"
+#include "remill/OS/ElfLoader.h"
+#include "remill/OS/OS.h"
+
+#ifdef __linux__
+
+namespace {
+
+// Guest address of the first segment of the test ELF file.
+static constexpr uint64_t kBase = 0x1000000u;
+
+// Offset of `main` from `kBase`.
+static constexpr uint64_t kMainOffset = 0x200u;
+
+// A small amd64 ELF file in a temporary file, with the segments and symbols
+// below, in terms of the host page size `P`:
+//
+//    * A read-only and executable segment at `kBase`, with the headers and
+//      `main`, i.e. `mov eax, 1; ret`.
+//    * A writable segment at `kBase + 2P`, with `0x100` bytes from the file
+//      and `2P` more zero-initialized bytes. The rest of its file page isn't
+//      zero, to check that it is zeroed when it's mapped.
+//    * A read-only segment at `kBase + 5P`, and a writable one right after
+//      it on the same page, which have to be copied rather than mapped.
+//    * The function symbol `main`, and an object and an undefined function
+//      symbol, which aren't function symbols of the file.
+class TestElfFile {
+ public:
+  explicit TestElfFile(uint64_t page_size_) : page_size(page_size_) {
+    const auto P = page_size;
+    std::vector<uint8_t> file(2 * P + 0x300 + 3 * sizeof(Elf64_Shdr), 0);
+
+    Elf64_Ehdr ehdr = {};
+    memcpy(ehdr.e_ident, ELFMAG, SELFMAG);
+    ehdr.e_ident[EI_CLASS] = ELFCLASS64;
+    ehdr.e_ident[EI_DATA] = __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+                                ? ELFDATA2MSB
+                                : ELFDATA2LSB;
+    ehdr.e_ident[EI_VERSION] = EV_CURRENT;
+    ehdr.e_type = ET_EXEC;
+    ehdr.e_machine = EM_X86_64;
+    ehdr.e_version = EV_CURRENT;
+    ehdr.e_entry = kBase + kMainOffset;
+    ehdr.e_phoff = sizeof(Elf64_Ehdr);
+    ehdr.e_shoff = 2 * P + 0x300;
+    ehdr.e_ehsize = sizeof(Elf64_Ehdr);
+    ehdr.e_phentsize = sizeof(Elf64_Phdr);
+    ehdr.e_phnum = 4;
+    ehdr.e_shentsize = sizeof(Elf64_Shdr);
+    ehdr.e_shnum = 3;
+    memcpy(&(file[0]), &ehdr, sizeof(ehdr));
+
+    const Elf64_Phdr phdrs[] = {
+        {PT_LOAD, PF_R | PF_X, 0, kBase, kBase, 0x300, 0x300, P},
+        {PT_LOAD, PF_R | PF_W, P, kBase + 2 * P, kBase + 2 * P, 0x100,
+         2 * P + 0x100, P},
+        {PT_LOAD, PF_R, 2 * P, kBase + 5 * P, kBase + 5 * P, 0x80, 0x80, P},
+        {PT_LOAD, PF_R | PF_W, 2 * P + 0x80, kBase + 5 * P + 0x80,
+         kBase + 5 * P + 0x80, 0x80, 0x100, P},
+    };
+    memcpy(&(file[ehdr.e_phoff]), phdrs, sizeof(phdrs));
+
+    // mov eax, 1; ret
+    const uint8_t main_bytes[] = {0xb8, 0x01, 0x00, 0x00, 0x00, 0xc3};
+    memcpy(&(file[kMainOffset]), main_bytes, sizeof(main_bytes));
+
+    memset(&(file[P]), 0xaa, 0x100);
+    memset(&(file[P + 0x100]), 0xee, 0x100);
+    memset(&(file[2 * P]), 0x11, 0x80);
+    memset(&(file[2 * P + 0x80]), 0x22, 0x80);
+
+    const char strtab[] = "\0main\0data\0puts";
+    memcpy(&(file[2 * P + 0x100]), strtab, sizeof(strtab));
+
+    const Elf64_Sym syms[] = {
+        {},
+        {1, ELF64_ST_INFO(STB_GLOBAL, STT_FUNC), 0, SHN_ABS,
+         kBase + kMainOffset, 6},
+        {6, ELF64_ST_INFO(STB_GLOBAL, STT_OBJECT), 0, SHN_ABS,
+         kBase + 2 * P, 0x100},
+        {11, ELF64_ST_INFO(STB_GLOBAL, STT_FUNC), 0, SHN_UNDEF, 0, 0},
+    };
+    memcpy(&(file[2 * P + 0x200]), syms, sizeof(syms));
+
+    Elf64_Shdr shdrs[3] = {};
+    shdrs[1].sh_type = SHT_SYMTAB;
+    shdrs[1].sh_offset = 2 * P + 0x200;
+    shdrs[1].sh_size = sizeof(syms);
+    shdrs[1].sh_link = 2;
+    shdrs[1].sh_entsize = sizeof(Elf64_Sym);
+    shdrs[2].sh_type = SHT_STRTAB;
+    shdrs[2].sh_offset = 2 * P + 0x100;
+    shdrs[2].sh_size = sizeof(strtab);
+    memcpy(&(file[ehdr.e_shoff]), shdrs, sizeof(shdrs));
+
+    path = testing::TempDir() + "remill_elf_XXXXXX";
+    const auto fd = mkstemp(path.data());
+    CHECK_NE(fd, -1) << "Unable to create " << path;
+    const auto written = write(fd, file.data(), file.size());
+    close(fd);
+    CHECK_EQ(written, static_cast<ssize_t>(file.size()));
+  }
+
+  ~TestElfFile(void) {
+    unlink(path.c_str());
+  }
+
+  const uint64_t page_size;
+  std::string path;
+};
+
+}  // namespace
+
+TEST(ElfImage, MapSegments) {
+  const auto P = static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+  TestElfFile elf(P);
+  auto image = remill::ElfImage::Load(elf.path, P);
+  ASSERT_NE(image, nullptr);
+
+  EXPECT_EQ(image->Architecture(), remill::kArchAMD64);
+  EXPECT_EQ(image->EntryPoint(), kBase + kMainOffset);
+
+  // One reservation spans every segment, and the extra page after them.
+  EXPECT_EQ(image->BeginAddress(), kBase);
+  EXPECT_EQ(image->EndAddress(), kBase + 7 * P);
+  const auto host_base = image->HostBase();
+  EXPECT_EQ(image->Translate(kBase + kMainOffset, 6),
+            &(host_base[kBase + kMainOffset]));
+  EXPECT_EQ(host_base[kBase + kMainOffset], 0xb8);
+
+  // The page between the first two segments isn't mapped, and neither is
+  // anything outside of the reservation.
+  EXPECT_EQ(image->Translate(kBase + P, 1), nullptr);
+  EXPECT_EQ(image->Translate(kBase + P - 1, 2), nullptr);
+  EXPECT_EQ(image->Translate(kBase - 1, 1), nullptr);
+  EXPECT_EQ(image->Translate(kBase + 7 * P, 1), nullptr);
+
+  // The writable segment, and its zero-initialized tail, which starts on the
+  // last page of it that comes from the file.
+  ASSERT_NE(image->Translate(kBase + 2 * P, 2 * P + 0x100), nullptr);
+  EXPECT_EQ(host_base[kBase + 2 * P + 0xff], 0xaa);
+  EXPECT_EQ(host_base[kBase + 2 * P + 0x100], 0);
+  EXPECT_EQ(host_base[kBase + 3 * P], 0);
+  host_base[kBase + 4 * P] = 0x33;
+  EXPECT_EQ(host_base[kBase + 4 * P], 0x33);
+
+  // Mapped ranges that abut are translated as one.
+  EXPECT_NE(image->Translate(kBase + 2 * P, 4 * P), nullptr);
+}
+
+TEST(ElfImage, CopySegmentsSharingAPage) {
+  const auto P = static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+  TestElfFile elf(P);
+  auto image = remill::ElfImage::Load(elf.path);
+  ASSERT_NE(image, nullptr);
+  EXPECT_EQ(image->EndAddress(), kBase + 6 * P);
+
+  // Both segments on the shared page keep their bytes, and only the bytes
+  // from the file are copied.
+  const auto host_base = image->HostBase();
+  const auto page = kBase + 5 * P;
+  ASSERT_NE(image->Translate(page, 0x180), nullptr);
+  EXPECT_EQ(host_base[page], 0x11);
+  EXPECT_EQ(host_base[page + 0x7f], 0x11);
+  EXPECT_EQ(host_base[page + 0x80], 0x22);
+  EXPECT_EQ(host_base[page + 0xff], 0x22);
+  EXPECT_EQ(host_base[page + 0x100], 0);
+
+  // The shared page is writable, because one of its segments is.
+  host_base[page + 0x100] = 0x44;
+  EXPECT_EQ(host_base[page + 0x100], 0x44);
+
+  uint8_t byte = 0;
+  EXPECT_TRUE(image->TryReadReadOnlyByte(page, &byte));
+  EXPECT_EQ(byte, 0x11);
+  EXPECT_FALSE(image->TryReadReadOnlyByte(page + 0x80, &byte));
+  EXPECT_FALSE(image->TryReadExecutableByte(page, &byte));
+  EXPECT_TRUE(image->TryReadExecutableByte(kBase + kMainOffset, &byte));
+  EXPECT_EQ(byte, 0xb8);
+}
+
+TEST(ElfImage, MapAnonymous) {
+  const auto P = static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+  TestElfFile elf(P);
+  auto image = remill::ElfImage::Load(elf.path, 2 * P);
+  ASSERT_NE(image, nullptr);
+
+  EXPECT_EQ(image->Translate(kBase + 6 * P, 1), nullptr);
+  EXPECT_TRUE(image->MapAnonymous(kBase + 6 * P + 8, 16));
+  auto mem = static_cast<uint8_t *>(image->Translate(kBase + 6 * P, P));
+  ASSERT_NE(mem, nullptr);
+  EXPECT_EQ(mem[8], 0);
+
+  // Not over a segment, nor outside of the reservation.
+  EXPECT_FALSE(image->MapAnonymous(kBase + 5 * P, 16));
+  EXPECT_FALSE(image->MapAnonymous(kBase + 8 * P, 16));
+}
+
+TEST(ElfImage, Symbols) {
+  const auto P = static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+  TestElfFile elf(P);
+  auto image = remill::ElfImage::Load(elf.path);
+  ASSERT_NE(image, nullptr);
+
+  // Only the defined function symbols are read.
+  EXPECT_EQ(image->SymbolName(kBase + kMainOffset), "main");
+  EXPECT_EQ(image->SymbolName(kBase + 2 * P), "");
+  EXPECT_EQ(image->Symbols().size(), 1u);
+}
+
+TEST(ElfTraceManager, LiftSymbol) {
+  const auto P = static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+  TestElfFile elf(P);
+  auto image = remill::ElfImage::Load(elf.path);
+  ASSERT_NE(image, nullptr);
+
+  llvm::LLVMContext context;
+  auto arch = remill::Arch::Build(&context, remill::kOSLinux,
+                                  image->Architecture());
+  auto module = remill::LoadArchSemantics(arch.get());
+
+  remill::ElfTraceManager manager(*image);
+  EXPECT_EQ(manager.TraceName(kBase + kMainOffset), "sub_1000200_main");
+  EXPECT_EQ(manager.TraceName(kBase + kMainOffset + 5), "sub_1000205");
+
+  remill::TraceLifter lifter(arch.get(), manager);
+  ASSERT_TRUE(lifter.Lift(kBase + kMainOffset));
+  auto trace = manager.GetLiftedTraceDefinition(kBase + kMainOffset);
+  ASSERT_TRUE(trace && !trace->isDeclaration());
+  EXPECT_EQ(trace->getName().str(), "sub_1000200_main");
+  EXPECT_EQ(trace->getParent(), module.get());
+
+  manager.InvalidateLiftedTraceDefinition(kBase + kMainOffset, trace);
+  EXPECT_EQ(manager.GetLiftedTraceDefinition(kBase + kMainOffset), nullptr);
+}
+
+#endif  // __linux__
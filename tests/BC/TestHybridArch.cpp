@@ -0,0 +1,71 @@
+/*
+ * Copyright (c) 2026 Trail of Bits, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <gtest/gtest.h>
+#include <llvm/IR/LLVMContext.h>
+#include <llvm/IR/Module.h>
+
+#include <string_view>
+
+#include "remill/Arch/Arch.h"
+#include "remill/Arch/Instruction.h"
+#include "remill/Arch/Name.h"
+#include "remill/BC/Optimizer.h"
+#include "remill/BC/Util.h"
+#include "remill/OS/OS.h"
+
+using namespace std::string_view_literals;
+
+// Instructions with native semantics are decoded natively, and the rest are
+// decoded by SLEIGH.
+TEST(HybridArch, AArch64FallsBackOnSleigh) {
+  llvm::LLVMContext context;
+  auto arch =
+      remill::Arch::GetHybrid(&context, remill::OSName::kOSLinux,
+                              remill::ArchName::kArchAArch64LittleEndian);
+  ASSERT_NE(arch, nullptr);
+  EXPECT_EQ(arch->arch_name, remill::ArchName::kArchAArch64LittleEndian);
+
+  // Leave native semantics for `ADD`, but not for `SUB`.
+  auto sems = remill::LoadArchSemantics(arch.get());
+  ASSERT_TRUE(
+      remill::PruneSemanticsModule(sems.get(), {"ADD_64_ADDSUB_IMM"}));
+
+  // add x0, x1, #1
+  remill::Instruction add;
+  ASSERT_TRUE(arch->DecodeInstruction(0x1000, "\x20\x04\x00\x91"sv, add,
+                                      arch->CreateInitialContext()));
+  EXPECT_EQ(add.arch_name, remill::ArchName::kArchAArch64LittleEndian);
+  EXPECT_EQ(add.function, "ADD_64_ADDSUB_IMM");
+
+  // sub x0, x1, #1
+  remill::Instruction sub;
+  ASSERT_TRUE(arch->DecodeInstruction(0x1004, "\x20\x04\x00\xd1"sv, sub,
+                                      arch->CreateInitialContext()));
+  EXPECT_EQ(sub.arch_name,
+            remill::ArchName::kArchAArch64LittleEndian_SLEIGH);
+  EXPECT_TRUE(sub.IsValid());
+  EXPECT_NE(sub.GetLifter(), nullptr);
+}
+
+// There is no SLEIGH fallback for the other architectures.
+TEST(HybridArch, SPARC32HasNoFallback) {
+  llvm::LLVMContext context;
+  EXPECT_EQ(remill::Arch::GetHybrid(&context, remill::OSName::kOSLinux,
+                                    remill::ArchName::kArchSparc32),
+            nullptr);
+}
@@ -0,0 +1,146 @@
+/*
+ * Copyright (c) 2026 Trail of Bits, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <gtest/gtest.h>
+#include <llvm/IR/Constants.h>
+#include <llvm/IR/Function.h>
+#include <llvm/IR/IRBuilder.h>
+#include <llvm/IR/Instructions.h>
+#include <llvm/IR/LLVMContext.h>
+#include <llvm/IR/Module.h>
+#include <llvm/IR/Verifier.h>
+#include <llvm/Support/raw_ostream.h>
+
+#include <string>
+#include <unordered_set>
+
+#include "remill/Arch/Arch.h"
+#include "remill/Arch/Name.h"
+#include "remill/BC/ABI.h"
+#include "remill/BC/IntrinsicTable.h"
+#include "remill/BC/Optimizer.h"
+#include "remill/BC/Util.h"
+#include "remill/OS/OS.h"
+
+// The stubs that `OutlineColdExits` creates are copied along with the traces
+// that call them, so that the module of the moved traces is complete.
+TEST(OutlineColdExits, AArch64MoveIntoModule) {
+  llvm::LLVMContext context;
+  auto arch = remill::Arch::Build(&context, remill::OSName::kOSLinux,
+                                  remill::ArchName::kArchAArch64LittleEndian);
+  auto sems = remill::LoadArchSemantics(arch.get());
+  auto intrinsics = arch->GetInstrinsicTable();
+  ASSERT_NE(intrinsics, nullptr);
+
+  // Exit to `__remill_error` at a known program counter, or otherwise to
+  // `__remill_missing_block` at whatever program counter the trace is given.
+  auto trace = arch->DefineLiftedFunction("trace", sems.get());
+  auto state = remill::NthArgument(trace, remill::kStatePointerArgNum);
+  auto pc = remill::NthArgument(trace, remill::kPCArgNum);
+  auto memory = remill::NthArgument(trace, remill::kMemoryPointerArgNum);
+  auto error_pc = llvm::ConstantInt::get(pc->getType(), 0x1000);
+  auto error_block = llvm::BasicBlock::Create(context, "", trace);
+  auto missing_block = llvm::BasicBlock::Create(context, "", trace);
+
+  llvm::IRBuilder<> ir(&trace->getEntryBlock());
+  ir.CreateCondBr(ir.CreateICmpEQ(pc, error_pc), error_block, missing_block);
+  ir.SetInsertPoint(error_block);
+  ir.CreateRet(ir.CreateCall(intrinsics->error, {state, error_pc, memory}));
+  ir.SetInsertPoint(missing_block);
+  ir.CreateRet(
+      ir.CreateCall(intrinsics->missing_block, {state, pc, memory}));
+
+  remill::OutlineColdExits(*intrinsics, trace);
+  auto error_stub = sems->getFunction("__remill_error_cold_1000");
+  auto missing_stub = sems->getFunction("__remill_missing_block_cold");
+  ASSERT_TRUE(error_stub && !error_stub->isDeclaration());
+  ASSERT_TRUE(missing_stub && !missing_stub->isDeclaration());
+
+  llvm::Module dest_module("lifted_code", context);
+  arch->PrepareModuleDataLayout(&dest_module);
+  remill::MoveFunctionIntoModule(trace, &dest_module);
+
+  std::string error;
+  llvm::raw_string_ostream os(error);
+  EXPECT_FALSE(llvm::verifyModule(dest_module, &os)) << os.str();
+
+  for (auto name :
+       {"__remill_error_cold_1000", "__remill_missing_block_cold"}) {
+    auto stub = dest_module.getFunction(name);
+    ASSERT_NE(stub, nullptr) << name;
+    EXPECT_FALSE(stub->isDeclaration()) << name;
+  }
+
+  // The stubs still call the intrinsics, which stay declarations.
+  auto error_intrinsic = dest_module.getFunction("__remill_error");
+  ASSERT_NE(error_intrinsic, nullptr);
+  EXPECT_TRUE(error_intrinsic->isDeclaration());
+}
+
+// Pruning keeps the named instruction selections and conditions, the
+// instructions that the lifter always needs, and the intrinsics, and drops
+// everything else.
+TEST(PruneSemanticsModule, AArch64KeepsNamedSemantics) {
+  llvm::LLVMContext context;
+  auto arch = remill::Arch::Build(&context, remill::OSName::kOSLinux,
+                                  remill::ArchName::kArchAArch64LittleEndian);
+  auto sems = remill::LoadArchSemantics(arch.get());
+
+  auto sub_isel = sems->getGlobalVariable("ISEL_SUB_64_ADDSUB_IMM");
+  ASSERT_TRUE(sub_isel && sub_isel->hasInitializer());
+  auto sub_sem = llvm::dyn_cast<llvm::Function>(
+      sub_isel->getInitializer()->stripPointerCasts());
+  ASSERT_NE(sub_sem, nullptr);
+  const auto sub_sem_name = sub_sem->getName().str();
+
+  auto helper = llvm::Function::Create(
+      llvm::FunctionType::get(llvm::Type::getVoidTy(context), false),
+      llvm::GlobalValue::InternalLinkage, "unused_helper", sems.get());
+  llvm::ReturnInst::Create(context,
+                           llvm::BasicBlock::Create(context, "", helper));
+
+  ASSERT_TRUE(remill::PruneSemanticsModule(
+      sems.get(), {"ADD_64_ADDSUB_IMM", "GE"}));
+
+  std::unordered_set<std::string> kept = {
+      "ISEL_ADD_64_ADDSUB_IMM", "COND_GE",
+      "ISEL_" + std::string(remill::kInvalidInstructionISelName),
+      "ISEL_" + std::string(remill::kUnsupportedInstructionISelName)};
+  for (const auto &name : kept) {
+    EXPECT_NE(sems->getNamedValue(name), nullptr) << name;
+  }
+
+  for (auto &gv : sems->global_values()) {
+    const auto name = gv.getName();
+    if (name.startswith("ISEL_") || name.startswith("COND_")) {
+      EXPECT_TRUE(kept.count(name.str())) << name.str();
+    }
+  }
+
+  EXPECT_EQ(sems->getNamedValue("ISEL_SUB_64_ADDSUB_IMM"), nullptr);
+  EXPECT_EQ(sems->getNamedValue("COND_LT"), nullptr);
+  EXPECT_EQ(sems->getFunction(sub_sem_name), nullptr);
+  EXPECT_EQ(sems->getFunction("unused_helper"), nullptr);
+
+  EXPECT_TRUE(remill::IntrinsicTable::FindMissingIntrinsics(sems.get())
+                  .empty());
+  EXPECT_NE(sems->getGlobalVariable("__remill_state"), nullptr);
+
+  std::string error;
+  llvm::raw_string_ostream os(error);
+  EXPECT_FALSE(llvm::verifyModule(*sems, &os)) << os.str();
+}
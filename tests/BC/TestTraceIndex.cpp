@@ -0,0 +1,98 @@
+/*
+ * Copyright (c) 2026 Trail of Bits, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <gtest/gtest.h>
+#include <llvm/IR/Function.h>
+#include <llvm/IR/LLVMContext.h>
+#include <llvm/IR/Module.h>
+#include <llvm/IR/Verifier.h>
+#include <llvm/Support/raw_ostream.h>
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "remill/Arch/Name.h"
+#include "remill/BC/Optimizer.h"
+#include "remill/BC/TraceIndex.h"
+#include "remill/BC/TraceLifter.h"
+#include "remill/BC/Util.h"
+#include "tests/BC/TraceTest.h"
+
+using namespace std::string_view_literals;
+
+// Only the requested trace is parsed out of an indexed bitcode file, and it
+// verifies on its own.
+TEST(LazyTraceModule, AArch64MaterializeOneTrace) {
+  test::TraceTest test(remill::kArchAArch64LittleEndian);
+
+  // mov x0, #0x1234; ret
+  test.manager.AddCode(0x1000, "\x80\x46\x82\xd2\xc0\x03\x5f\xd6"sv);
+
+  // mov x0, #0x5678; ret
+  test.manager.AddCode(0x2000, "\x00\xcf\x8a\xd2\xc0\x03\x5f\xd6"sv);
+
+  remill::TraceLifter lifter(test.arch.get(), test.manager);
+  ASSERT_TRUE(lifter.Lift(0x1000));
+  ASSERT_TRUE(lifter.Lift(0x2000));
+
+  std::unordered_map<uint64_t, llvm::Function *> traces(
+      test.manager.traces.begin(), test.manager.traces.end());
+  remill::OptimizeModule(test.arch.get(), test.module.get(), traces);
+
+  llvm::Module dest_module("lifted_code", test.context);
+  test.arch->PrepareModuleDataLayout(&dest_module);
+  for (auto [pc, trace] : traces) {
+    remill::MoveFunctionIntoModule(trace, &dest_module);
+  }
+
+  const std::filesystem::path path =
+      testing::TempDir() + "remill_lazy_trace.bc";
+  ASSERT_TRUE(remill::StoreIndexedModuleToFile(&dest_module, traces,
+                                               path.string()));
+
+  llvm::LLVMContext context;
+  auto lazy = remill::LazyTraceModule::Load(&context, path);
+  std::filesystem::remove(path);
+  ASSERT_NE(lazy, nullptr);
+
+  std::vector<uint64_t> pcs;
+  lazy->ForEachTrace([&pcs](uint64_t pc, llvm::Function *trace) {
+    EXPECT_TRUE(trace->isMaterializable());
+    pcs.push_back(pc);
+  });
+  EXPECT_EQ(pcs, (std::vector<uint64_t>{0x1000, 0x2000}));
+  EXPECT_EQ(lazy->MaterializeTrace(0x3000), nullptr);
+
+  auto first = lazy->MaterializeTrace(0x1000);
+  ASSERT_NE(first, nullptr);
+  EXPECT_EQ(first, lazy->GetTrace(0x1000));
+  EXPECT_FALSE(first->isMaterializable());
+  EXPECT_FALSE(first->isDeclaration());
+  EXPECT_TRUE(lazy->GetTrace(0x2000)->isMaterializable());
+
+  std::string error;
+  llvm::raw_string_ostream os(error);
+  EXPECT_FALSE(llvm::verifyFunction(*first, &os)) << os.str();
+
+  ASSERT_TRUE(lazy->MaterializeAll());
+  EXPECT_FALSE(lazy->GetTrace(0x2000)->isMaterializable());
+  EXPECT_FALSE(llvm::verifyModule(*lazy->GetModule(), &os)) << os.str();
+}
@@ -0,0 +1,101 @@
+/*
+ * Copyright (c) 2026 Trail of Bits, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <gtest/gtest.h>
+#include <llvm/IR/Constants.h>
+#include <llvm/IR/Function.h>
+#include <llvm/IR/InstIterator.h>
+
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+#include "remill/Arch/Name.h"
+#include "remill/BC/TraceLifter.h"
+#include "tests/BC/TraceTest.h"
+
+using namespace std::string_view_literals;
+
+namespace {
+
+// Return `true` if an instruction of `func` uses the constant `val`.
+static bool UsesConstant(llvm::Function *func, uint64_t val) {
+  for (auto &inst : llvm::instructions(func)) {
+    for (auto &op : inst.operands()) {
+      if (auto ci = llvm::dyn_cast<llvm::ConstantInt>(op.get());
+          ci && ci->getBitWidth() <= 64u && ci->getZExtValue() == val) {
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+}  // namespace
+
+// Writing into the code of one trace only re-lifts that trace, in place.
+TEST(TraceLifter, AArch64InvalidateOneTrace) {
+  test::TraceTest test(remill::kArchAArch64LittleEndian);
+
+  // mov x0, #0x1234; ret
+  test.manager.AddCode(0x1000, "\x80\x46\x82\xd2\xc0\x03\x5f\xd6"sv);
+  test.manager.AddCode(0x2000, "\x80\x46\x82\xd2\xc0\x03\x5f\xd6"sv);
+
+  remill::TraceLifter lifter(test.arch.get(), test.manager);
+  ASSERT_TRUE(lifter.Lift(0x1000));
+  ASSERT_TRUE(lifter.Lift(0x2000));
+
+  auto first = test.manager.GetLiftedTraceDefinition(0x1000);
+  auto second = test.manager.GetLiftedTraceDefinition(0x2000);
+  ASSERT_TRUE(first && !first->isDeclaration());
+  ASSERT_TRUE(second && !second->isDeclaration());
+  EXPECT_TRUE(UsesConstant(first, 0x1234));
+  auto second_entry = &(second->getEntryBlock());
+
+  using Heads = std::vector<uint64_t>;
+  EXPECT_EQ(lifter.TracesInRange(0x1000, 0x1001), Heads{0x1000});
+  EXPECT_EQ(lifter.TracesInRange(0x1007, 0x1008), Heads{0x1000});
+  EXPECT_EQ(lifter.TracesInRange(0x1008, 0x2000), Heads{});
+  EXPECT_EQ(lifter.TracesInRange(0x0, 0x3000), (Heads{0x1000, 0x2000}));
+  EXPECT_EQ(lifter.TracesInRange(0x2004, 0x2004), Heads{});
+
+  // Nothing was lifted from here.
+  Heads relifted;
+  auto record = [&relifted](uint64_t addr, llvm::Function *) {
+    relifted.push_back(addr);
+  };
+  EXPECT_TRUE(lifter.Invalidate(0x3000, 0x3004, record));
+  EXPECT_TRUE(relifted.empty());
+
+  // mov x0, #0x5678
+  test.manager.AddCode(0x1000, "\x00\xcf\x8a\xd2"sv);
+  EXPECT_TRUE(lifter.Invalidate(0x1000, 0x1004, record));
+  EXPECT_EQ(relifted, Heads{0x1000});
+
+  // The first trace is re-defined in place, and the second isn't touched.
+  EXPECT_EQ(test.manager.GetLiftedTraceDefinition(0x1000), first);
+  EXPECT_FALSE(first->isDeclaration());
+  EXPECT_TRUE(UsesConstant(first, 0x5678));
+  EXPECT_FALSE(UsesConstant(first, 0x1234));
+  EXPECT_EQ(test.manager.GetLiftedTraceDefinition(0x2000), second);
+  EXPECT_EQ(&(second->getEntryBlock()), second_entry);
+  EXPECT_TRUE(UsesConstant(second, 0x1234));
+
+  // The bytes of the re-lifted trace are covered again.
+  EXPECT_EQ(lifter.TracesInRange(0x1000, 0x1004), Heads{0x1000});
+  EXPECT_EQ(lifter.TracesInRange(0x0, 0x3000), (Heads{0x1000, 0x2000}));
+}
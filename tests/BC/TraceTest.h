@@ -0,0 +1,159 @@
+/*
+ * Copyright (c) 2026 Trail of Bits, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <gtest/gtest.h>
+#include <llvm/IR/Function.h>
+#include <llvm/IR/InstIterator.h>
+#include <llvm/IR/Instructions.h>
+#include <llvm/IR/LLVMContext.h>
+#include <llvm/IR/Module.h>
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "remill/Arch/Arch.h"
+#include "remill/Arch/Name.h"
+#include "remill/BC/HostFunction.h"
+#include "remill/BC/TraceLifter.h"
+#include "remill/BC/Util.h"
+#include "remill/OS/OS.h"
+
+// Helpers of the tests that lift whole traces and check their IR.
+
+namespace test {
+
+// Serves the code, read-only data and symbols of a test, and keeps the
+// lifted traces.
+class TestTraceManager : public remill::TraceManager {
+ public:
+  virtual ~TestTraceManager(void) = default;
+
+  void SetLiftedTraceDefinition(uint64_t addr,
+                                llvm::Function *lifted_func) override {
+    traces[addr] = lifted_func;
+  }
+
+  llvm::Function *GetLiftedTraceDeclaration(uint64_t addr) override {
+    auto trace_it = traces.find(addr);
+    if (trace_it != traces.end()) {
+      return trace_it->second;
+    } else {
+      return nullptr;
+    }
+  }
+
+  llvm::Function *GetLiftedTraceDefinition(uint64_t addr) override {
+    return GetLiftedTraceDeclaration(addr);
+  }
+
+  void InvalidateLiftedTraceDefinition(uint64_t addr,
+                                       llvm::Function *) override {
+    traces.erase(addr);
+  }
+
+  bool TryReadExecutableByte(uint64_t addr, uint8_t *byte) override {
+    return TryRead(code, addr, byte);
+  }
+
+  bool TryReadReadOnlyByte(uint64_t addr, uint8_t *byte) override {
+    return TryRead(read_only, addr, byte);
+  }
+
+  const remill::HostFunction *GetHostFunction(uint64_t addr) override {
+    auto symbol_it = symbols.find(addr);
+    return host_functions.Match(
+        addr, symbol_it != symbols.end() ? symbol_it->second : "",
+        [this](uint64_t byte_addr, uint8_t *byte) {
+          return TryReadExecutableByte(byte_addr, byte);
+        });
+  }
+
+  void AddCode(uint64_t addr, std::string_view bytes) {
+    Add(code, addr, bytes);
+  }
+
+  void AddReadOnly(uint64_t addr, std::string_view bytes) {
+    Add(read_only, addr, bytes);
+  }
+
+ private:
+  static bool TryRead(const std::unordered_map<uint64_t, uint8_t> &memory,
+                      uint64_t addr, uint8_t *byte) {
+    auto byte_it = memory.find(addr);
+    if (byte_it != memory.end()) {
+      *byte = byte_it->second;
+      return true;
+    } else {
+      return false;
+    }
+  }
+
+  static void Add(std::unordered_map<uint64_t, uint8_t> &memory,
+                  uint64_t addr, std::string_view bytes) {
+    for (auto byte : bytes) {
+      memory[addr++] = static_cast<uint8_t>(byte);
+    }
+  }
+
+ public:
+  std::unordered_map<uint64_t, uint8_t> code;
+  std::unordered_map<uint64_t, uint8_t> read_only;
+  std::unordered_map<uint64_t, std::string> symbols;
+  std::map<uint64_t, llvm::Function *> traces;
+  remill::HostFunctionMatcher host_functions;
+};
+
+// Lifts the code of a test into the semantics module of `arch_name`.
+class TraceTest {
+ public:
+  explicit TraceTest(remill::ArchName arch_name)
+      : arch(remill::Arch::Build(&context, remill::kOSLinux, arch_name)),
+        module(remill::LoadArchSemantics(arch.get())) {}
+
+  // Lift the trace at `addr`, along with the traces it reaches.
+  llvm::Function *Lift(uint64_t addr) {
+    remill::TraceLifter lifter(arch.get(), manager);
+    EXPECT_TRUE(lifter.Lift(addr));
+    return manager.GetLiftedTraceDefinition(addr);
+  }
+
+  llvm::LLVMContext context;
+  remill::Arch::ArchPtr arch;
+  std::unique_ptr<llvm::Module> module;
+  TestTraceManager manager;
+};
+
+// Return the calls in `func` to `callee`.
+inline std::vector<llvm::CallInst *> CallsTo(llvm::Function *func,
+                                             llvm::Function *callee) {
+  std::vector<llvm::CallInst *> calls;
+  for (auto &inst : llvm::instructions(func)) {
+    if (auto call = llvm::dyn_cast<llvm::CallInst>(&inst);
+        call && call->getCalledFunction() == callee) {
+      calls.push_back(call);
+    }
+  }
+  return calls;
+}
+
+}  // namespace test
@@ -27,6 +27,7 @@
 #include <test_runner/TestRunner.h>
 
 #include <unordered_map>
+#include <vector>
 
 namespace {
 
@@ -190,27 +191,48 @@ class TestSpecRunner {
 
   void RunTestSpec(const TestOutputSpec<S> &test,
                    const remill::DecodingContext &dec_ctx) {
-    std::stringstream ss;
-    ss << "test_disas_func_" << this->tst_ctr++;
-
-    auto maybe_func = lifter.LiftInstructionFunction(
-        ss.str(), test.target_bytes, test.addr, dec_ctx);
+    RunTestSpecs({test}, dec_ctx);
+  }
 
-    CHECK(maybe_func.has_value());
-    auto lifted_func = maybe_func->first;
+  // Lift the instructions of all of `tests` at once, then run the tests one
+  // after the other.
+  void RunTestSpecs(const std::vector<TestOutputSpec<S>> &tests,
+                    const remill::DecodingContext &dec_ctx) {
+    std::vector<test_runner::LiftRequest> requests;
+    for (const auto &test : tests) {
+      std::stringstream ss;
+      ss << "test_disas_func_" << this->tst_ctr++;
+      requests.push_back({ss.str(), test.target_bytes, test.addr, dec_ctx});
+    }
 
-    // Copy lifted function into new module to optimize out intrinsics that aren't used in the lifted function
-    auto new_mod = llvm::CloneModule(*lifted_func->getParent());
-    remill::OptimizeBareModule(new_mod.get());
+    // The semantics module is cloned and optimized once for the whole batch,
+    // which also drops the intrinsics that the lifted functions don't use.
+    auto batch = lifter.LiftInstructionFunctions(requests);
+    for (auto i = 0u; i < tests.size(); ++i) {
+      const auto &maybe_func = batch.functions[i];
+      CHECK(maybe_func.has_value());
+      RunLiftedTestSpec(tests[i], maybe_func->first, maybe_func->second,
+                        batch.module, dec_ctx);
+    }
+  }
 
+ private:
+  void RunLiftedTestSpec(const TestOutputSpec<S> &test,
+                         llvm::Function *lifted_func,
+                         const remill::Instruction &insn,
+                         const std::unique_ptr<llvm::Module> &batch_module,
+                         const remill::DecodingContext &dec_ctx) {
+
+    // Run each test out of its own module, so that only its own function is
+    // JIT compiled.
     auto just_func_mod =
-        std::make_unique<llvm::Module>("", new_mod->getContext());
+        std::make_unique<llvm::Module>("", batch_module->getContext());
 
     auto new_func = test_runner::CopyFunctionIntoNewModule(
-        just_func_mod.get(), lifted_func, new_mod);
+        just_func_mod.get(), lifted_func, batch_module);
     S st = {};
 
-    test.CheckLiftedInstruction(maybe_func->second);
+    test.CheckLiftedInstruction(insn);
     test_runner::RandomizeState(st, this->rbe);
 
     test.SetupTestPreconditions(st);
@@ -220,6 +242,7 @@ class TestSpecRunner {
       prec(*mem_hand);
     }
 
+    const auto initial_st = st;
     test_runner::ExecuteLiftedFunction<S, uint64_t>(
         new_func, test.target_bytes.length(), &st, mem_hand.get(),
         [](S *st) { return st->pc.qword; });
@@ -228,6 +251,17 @@ class TestSpecRunner {
     test.CheckResultingState(st);
 
     test.CheckResultingMemory(*mem_hand);
+
+    // The p-code interpreter must agree with the lifted code, given the same
+    // values for the memory that the lifted code read.
+    test_runner::MemoryHandler interpreted_mem(
+        this->endian, mem_hand->GetUninitializedReads());
+    for (const auto &prec : test.GetMemoryPrecs()) {
+      prec(interpreted_mem);
+    }
+    test_runner::CheckInterpretedInstruction(
+        lifter.GetArch().get(), dec_ctx, test.target_bytes, test.addr,
+        initial_st, interpreted_mem, st, *mem_hand);
   }
 };
 
@@ -736,6 +770,46 @@ TEST(PPCVLELifts, PPCVLERotateLeftWordImmediateAndMask) {
   runner.RunTestSpec(spec, kVLEContext);
 }
 
+// The p-code of these instructions is simplified before it's lifted, which
+// must keep the bits of a register that an instruction doesn't replace, and
+// the flags that are read after they are overwritten.
+TEST(PPCVLELifts, PPCVLESimplifiedPcode) {
+  llvm::LLVMContext curr_context;
+
+  // e_rlwimi r6, r5, 8, 16, 23, which only replaces bits 8 to 15 of r6.
+  std::string rlwimi_data("\x74\xa6\x44\x2e", 4);
+  TestOutputSpec<PPCState> rlwimi_spec(
+      0x12, rlwimi_data, remill::Instruction::Category::kCategoryNormal,
+      {{"pc", uint64_t(0x12)},
+       {"r5", uint64_t(0xab)},
+       {"r6", uint64_t(0x11223344)}},
+      {{"pc", uint64_t(0x12 + 4)},
+       {"r5", uint64_t(0xab)},
+       {"r6", uint64_t(0x1122ab44)}},
+      reg_to_accessor);
+
+  // addo. r5, r4, r3, which sets the summary overflow flag, and then copies
+  // it into cr0 along with the (negative) sign of the sum.
+  std::string addo_data("\x7c\xa4\x1e\x15", 4);
+  TestOutputSpec<PPCState> addo_spec(
+      0x12, addo_data, remill::Instruction::Category::kCategoryNormal,
+      {{"r4", uint64_t(5000000000000000000)},
+       {"r3", uint64_t(5000000000000000000)},
+       {"cr0", uint8_t(0)},
+       {"xer_ov", uint8_t(0x0)},
+       {"xer_so", uint8_t(0x0)},
+       {"pc", uint64_t(0x12)}},
+      {{"r5", uint64_t(0x8ac7230489e80000)},
+       {"cr0", uint8_t(0b1001)},
+       {"xer_ov", uint8_t(0x1)},
+       {"xer_so", uint8_t(0x1)},
+       {"pc", uint64_t(0x16)}},
+      reg_to_accessor);
+
+  TestSpecRunner<PPCState> runner(curr_context);
+  runner.RunTestSpecs({rlwimi_spec, addo_spec}, kVLEContext);
+}
+
 // Convert Floating-Point Double-Precision from Signed Integer
 TEST(PPCVLELifts, PPCVLEConvertDoubleFromSignedInteger) {
   llvm::LLVMContext curr_context;
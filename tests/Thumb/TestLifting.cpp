@@ -59,12 +59,25 @@ const static std::unordered_map<
          [](AArch32State &st) -> test_runner::RegisterValueRef {
            return &st.gpr.r13.dword;
          }},
+        {"r0",
+         [](AArch32State &st) -> test_runner::RegisterValueRef {
+           return &st.gpr.r0.dword;
+         }},
         {"r1",
          [](AArch32State &st) -> test_runner::RegisterValueRef {
            return &st.gpr.r1.dword;
          }},
+        {"n", [](AArch32State &st) -> test_runner::RegisterValueRef {
+           return &st.sr.n;
+         }},
         {"z", [](AArch32State &st) -> test_runner::RegisterValueRef {
            return &st.sr.z;
+         }},
+        {"c", [](AArch32State &st) -> test_runner::RegisterValueRef {
+           return &st.sr.c;
+         }},
+        {"v", [](AArch32State &st) -> test_runner::RegisterValueRef {
+           return &st.sr.v;
          }}};
 
 
@@ -210,28 +223,46 @@ class TestSpecRunner {
                    : llvm::support::endianness::big) {}
 
   void RunTestSpec(const TestOutputSpec &test) {
-    std::stringstream ss;
-    ss << "test_disas_func_" << this->tst_ctr++;
-
-    auto maybe_func =
-        lifter.LiftInstructionFunction(ss.str(), test.target_bytes, test.addr);
+    RunTestSpecs({test});
+  }
 
+  // Lift the instructions of all of `tests` at once, then run the tests one
+  // after the other.
+  void RunTestSpecs(const std::vector<TestOutputSpec> &tests) {
+    std::vector<test_runner::LiftRequest> requests;
+    for (const auto &test : tests) {
+      std::stringstream ss;
+      ss << "test_disas_func_" << this->tst_ctr++;
+      requests.push_back({ss.str(), test.target_bytes, test.addr,
+                          lifter.GetArch()->CreateInitialContext()});
+    }
 
-    CHECK(maybe_func.has_value());
-    auto lifted_func = maybe_func->first;
+    auto batch = lifter.LiftInstructionFunctions(requests);
+    for (auto i = 0u; i < tests.size(); ++i) {
+      const auto &maybe_func = batch.functions[i];
+      CHECK(maybe_func.has_value());
+      RunLiftedTestSpec(tests[i], maybe_func->first, maybe_func->second,
+                        batch.module);
+    }
+  }
 
-    auto new_mod = llvm::CloneModule(*lifted_func->getParent());
-    remill::OptimizeBareModule(new_mod.get());
+ private:
+  void RunLiftedTestSpec(const TestOutputSpec &test,
+                         llvm::Function *lifted_func,
+                         const remill::Instruction &insn,
+                         const std::unique_ptr<llvm::Module> &batch_module) {
 
+    // Run each test out of its own module, so that only its own function is
+    // JIT compiled.
     auto just_func_mod =
-        std::make_unique<llvm::Module>("", new_mod->getContext());
+        std::make_unique<llvm::Module>("", batch_module->getContext());
 
     auto new_func = test_runner::CopyFunctionIntoNewModule(
-        just_func_mod.get(), lifted_func, new_mod);
+        just_func_mod.get(), lifted_func, batch_module);
     AArch32State st = {};
 
 
-    test.CheckLiftedInstruction(maybe_func->second);
+    test.CheckLiftedInstruction(insn);
     test_runner::RandomizeState(st, this->rbe);
 
     st.sr.z = test_runner::random_boolean_flag(this->rbe);
@@ -247,12 +278,25 @@ class TestSpecRunner {
       prec(*mem_hand);
     }
 
+    const auto initial_st = st;
     test_runner::ExecuteLiftedFunction<AArch32State, uint32_t>(
         new_func, test.target_bytes.length(), &st, mem_hand.get(),
         [](AArch32State *st) { return st->gpr.r15.dword; });
 
     LOG(INFO) << "Pc after execute " << st.gpr.r15.dword;
     test.CheckResultingState(st);
+
+    // The p-code interpreter must agree with the lifted code, given the same
+    // values for the memory that the lifted code read.
+    test_runner::MemoryHandler interpreted_mem(
+        this->endian, mem_hand->GetUninitializedReads());
+    for (const auto &prec : test.GetMemoryPrecs()) {
+      prec(interpreted_mem);
+    }
+    test_runner::CheckInterpretedInstruction(
+        lifter.GetArch().get(), lifter.GetArch()->CreateInitialContext(),
+        test.target_bytes, test.addr, initial_st, interpreted_mem, st,
+        *mem_hand);
   }
 };
 
@@ -309,6 +353,50 @@ TEST(ThumbRandomizedLifts, RelPcTest) {
   runner.RunTestSpec(spec);
 }
 
+// The p-code of these instructions is simplified before it's lifted: the
+// flags are computed into temporaries that are copied into place, so the
+// lifted code must agree with the unsimplified semantics.
+TEST(ThumbRandomizedLifts, SimplifiedFlagTemporaries) {
+
+  // cmp r1, #5, whose difference only lives in a temporary.
+  TestOutputSpec cmp_spec(0x12, std::string("\x05\x29", 2),
+                          remill::Instruction::Category::kCategoryNormal,
+                          {{"r15", uint32_t(0x12)}, {"r1", uint32_t(5)}},
+                          {{"r1", uint32_t(5)},
+                           {"n", uint8_t(0)},
+                           {"z", uint8_t(1)},
+                           {"c", uint8_t(1)},
+                           {"v", uint8_t(0)}});
+
+  // adds r0, r1, #1, which overflows.
+  TestOutputSpec adds_spec(
+      0x12, std::string("\x48\x1c", 2),
+      remill::Instruction::Category::kCategoryNormal,
+      {{"r15", uint32_t(0x12)}, {"r1", uint32_t(0x7fffffff)}},
+      {{"r0", uint32_t(0x80000000)},
+       {"n", uint8_t(1)},
+       {"z", uint8_t(0)},
+       {"c", uint8_t(0)},
+       {"v", uint8_t(1)}});
+
+  // movs r0, #0, which copies the carry and overflow flags back unchanged.
+  TestOutputSpec movs_spec(0x12, std::string("\x00\x20", 2),
+                           remill::Instruction::Category::kCategoryNormal,
+                           {{"r15", uint32_t(0x12)},
+                            {"r0", uint32_t(7)},
+                            {"c", uint8_t(1)},
+                            {"v", uint8_t(1)}},
+                           {{"r0", uint32_t(0)},
+                            {"n", uint8_t(0)},
+                            {"z", uint8_t(1)},
+                            {"c", uint8_t(1)},
+                            {"v", uint8_t(1)}});
+
+  llvm::LLVMContext context;
+  TestSpecRunner runner(context, remill::ArchName::kArchThumb2LittleEndian);
+  runner.RunTestSpecs({cmp_spec, adds_spec, movs_spec});
+}
+
 TEST(RegressionTests, RegressionPreffixSuffixInsn) {
 
   llvm::LLVMContext curr_context;
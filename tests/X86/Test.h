@@ -30,6 +30,10 @@ struct alignas(128) TestInfo {
   const uint64_t *const args_begin;
   const uint64_t *const args_end;
   const uint64_t num_args;
+
+  // Path of the assembly file defining the test. The name of its directory
+  // is the test's category, e.g. `BINARY`.
+  const char *test_file;
   const uint64_t ignored_flags_mask;
 } __attribute__((packed));
 
@@ -0,0 +1,483 @@
+/*
+ * Copyright (c) 2026 Trail of Bits, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+#include <llvm/Analysis/ValueTracking.h>
+#include <llvm/IR/Constants.h>
+#include <llvm/IR/Function.h>
+#include <llvm/IR/InstIterator.h>
+#include <llvm/IR/Instructions.h>
+#include <llvm/IR/LLVMContext.h>
+#include <llvm/IR/Module.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "remill/Arch/Arch.h"
+#include "remill/Arch/Name.h"
+#include "remill/BC/ABI.h"
+#include "remill/BC/HostFunction.h"
+#include "remill/BC/IntrinsicTable.h"
+#include "remill/BC/Optimizer.h"
+#include "remill/BC/TieredOptimizer.h"
+#include "remill/BC/TraceLifter.h"
+#include "remill/BC/Util.h"
+#include "remill/OS/OS.h"
+#include "tests/BC/TraceTest.h"
+
+// Tests of whole lifted traces, which check the IR that the trace lifter and
+// the optimizer produce, rather than running it like the instruction tests.
+
+using namespace std::string_view_literals;
+using test::CallsTo;
+using test::TraceTest;
+
+namespace {
+
+// The trace of a recognized `memcpy` is a shim that calls the runtime's
+// implementation, and returns to the caller with the memory pointer that the
+// implementation returns.
+static void TestHostFunctionShim(remill::ArchName arch_name) {
+  TraceTest test(arch_name);
+  test.manager.symbols[0x2000] = "memcpy";
+  test.manager.host_functions.AddLibC();
+
+  auto shim = test.Lift(0x2000);
+  ASSERT_TRUE(shim && !shim->isDeclaration());
+
+  auto host = test.module->getFunction("__remill_host_memcpy");
+  ASSERT_TRUE(host && !host->isDeclaration());
+
+  auto host_calls = CallsTo(shim, host);
+  ASSERT_EQ(host_calls.size(), 1u);
+  EXPECT_EQ(host_calls[0]->arg_size(), 5u);
+  EXPECT_EQ(host_calls[0]->getArgOperand(0),
+            remill::NthArgument(shim, remill::kMemoryPointerArgNum));
+
+  auto intrinsics = test.arch->GetInstrinsicTable();
+  auto ret_calls = CallsTo(shim, intrinsics->function_return);
+  ASSERT_EQ(ret_calls.size(), 1u);
+  EXPECT_EQ(ret_calls[0]->getArgOperand(remill::kMemoryPointerArgNum),
+            host_calls[0]);
+}
+
+// Return the number of calls in `func` to functions with a body, e.g. to
+// semantics functions that haven't been inlined.
+static unsigned NumCallsToDefinitions(llvm::Function *func) {
+  auto num_calls = 0u;
+  for (auto &inst : llvm::instructions(func)) {
+    if (auto call = llvm::dyn_cast<llvm::CallInst>(&inst)) {
+      if (auto callee = call->getCalledFunction();
+          callee && !callee->isDeclaration()) {
+        ++num_calls;
+      }
+    }
+  }
+  return num_calls;
+}
+
+// Return the stores in `func` of the constant `val`.
+static std::vector<llvm::StoreInst *> StoresOf(llvm::Function *func,
+                                               uint64_t val) {
+  std::vector<llvm::StoreInst *> stores;
+  for (auto &inst : llvm::instructions(func)) {
+    if (auto store = llvm::dyn_cast<llvm::StoreInst>(&inst)) {
+      if (auto ci = llvm::dyn_cast<llvm::ConstantInt>(store->getValueOperand());
+          ci && ci->getBitWidth() == 64u && ci->getZExtValue() == val) {
+        stores.push_back(store);
+      }
+    }
+  }
+  return stores;
+}
+
+// Return the values that `block` stores into the `State` argument of its
+// function at byte offset `offset`.
+static std::vector<llvm::Value *> StoresToState(llvm::BasicBlock *block,
+                                                uint64_t offset) {
+  auto state = remill::NthArgument(block->getParent(),
+                                   remill::kStatePointerArgNum);
+  const auto &dl = block->getModule()->getDataLayout();
+  std::vector<llvm::Value *> vals;
+  for (auto &inst : *block) {
+    if (auto store = llvm::dyn_cast<llvm::StoreInst>(&inst)) {
+      int64_t store_offset = 0;
+      auto base = llvm::GetPointerBaseWithConstantOffset(
+          store->getPointerOperand(), store_offset, dl);
+      if (base == state && static_cast<uint64_t>(store_offset) == offset) {
+        vals.push_back(store->getValueOperand());
+      }
+    }
+  }
+  return vals;
+}
+
+// Return the case values of the `switch`es in `func`, in ascending order.
+static std::vector<uint64_t> SwitchCases(llvm::Function *func) {
+  std::vector<uint64_t> cases;
+  for (auto &inst : llvm::instructions(func)) {
+    if (auto switch_inst = llvm::dyn_cast<llvm::SwitchInst>(&inst)) {
+      for (auto &switch_case : switch_inst->cases()) {
+        cases.push_back(switch_case.getCaseValue()->getZExtValue());
+      }
+    }
+  }
+  std::sort(cases.begin(), cases.end());
+  return cases;
+}
+
+}  // namespace
+
+TEST(JumpTables, AMD64RelativeTable) {
+  TraceTest test(remill::kArchAMD64);
+
+  // lea rdx, [rip + 0xff9]; movsxd rax, dword [rdx + rcx * 4];
+  // add rax, rdx; jmp rax; ret; ret; ret
+  test.manager.AddCode(
+      0x1000,
+      "\x48\x8d\x15\xf9\x0f\x00\x00\x48\x63\x04\x8a\x48\x01\xd0"
+      "\xff\xe0\xc3\xc3\xc3"sv);
+  test.manager.AddReadOnly(0x2000,
+                           "\x10\xf0\xff\xff\x11\xf0\xff\xff"
+                           "\x12\xf0\xff\xff"sv);
+
+  auto trace = test.Lift(0x1000);
+  ASSERT_TRUE(trace && !trace->isDeclaration());
+  EXPECT_EQ(SwitchCases(trace),
+            (std::vector<uint64_t>{0x1010, 0x1011, 0x1012}));
+}
+
+TEST(JumpTables, X86AbsoluteTable) {
+  TraceTest test(remill::kArchX86);
+
+  // jmp dword [ecx * 4 + 0x2000]; ret; ret
+  test.manager.AddCode(0x1000, "\xff\x24\x8d\x00\x20\x00\x00\xc3\xc3"sv);
+  test.manager.AddReadOnly(0x2000, "\x07\x10\x00\x00\x08\x10\x00\x00"sv);
+
+  auto trace = test.Lift(0x1000);
+  ASSERT_TRUE(trace && !trace->isDeclaration());
+  EXPECT_EQ(SwitchCases(trace), (std::vector<uint64_t>{0x1007, 0x1008}));
+}
+
+TEST(ReadOnlyMemory, AMD64FoldRipRelativeRead) {
+  TraceTest test(remill::kArchAMD64);
+
+  // mov rax, [rip + 0xff9]; ret
+  test.manager.AddCode(0x1000, "\x48\x8b\x05\xf9\x0f\x00\x00\xc3"sv);
+  test.manager.AddReadOnly(0x2000, "\x88\x77\x66\x55\x44\x33\x22\x11"sv);
+
+  auto trace = test.Lift(0x1000);
+  ASSERT_TRUE(trace && !trace->isDeclaration());
+
+  remill::OptimizationGuide guide = {};
+  guide.read_only_memory = [&test](uint64_t addr, uint8_t *byte) {
+    return test.manager.TryReadReadOnlyByte(addr, byte);
+  };
+  remill::OptimizeModule(test.arch.get(), test.module.get(),
+                         test.manager.traces, guide);
+
+  // Only the read of the return address by `ret` is left.
+  auto intrinsics = test.arch->GetInstrinsicTable();
+  EXPECT_EQ(CallsTo(trace, intrinsics->read_memory_64).size(), 1u);
+  EXPECT_FALSE(StoresOf(trace, 0x1122334455667788ull).empty());
+}
+
+TEST(GuestStack, AMD64AliasedFrame) {
+  TraceTest test(remill::kArchAMD64);
+
+  // mov [rsp + 8], rax; mov [rsp - 16], rbx; mov [rbp - 8], rcx;
+  // mov rdx, [rsp + 8]; ret
+  test.manager.AddCode(0x1000,
+                       "\x48\x89\x44\x24\x08\x48\x89\x5c\x24\xf0"
+                       "\x48\x89\x4d\xf8\x48\x8b\x54\x24\x08\xc3"sv);
+
+  auto trace = test.Lift(0x1000);
+  ASSERT_TRUE(trace && !trace->isDeclaration());
+  remill::OptimizeModule(test.arch.get(), test.module.get(),
+                         test.manager.traces);
+
+  // The write below the stack pointer isn't promoted, because the trace
+  // never reads it back.
+  EXPECT_EQ(remill::PromoteGuestStack(test.arch.get(), trace), 3u);
+
+  // The write through `rbp` can change the frame, so the frame is written
+  // to guest memory before it, and read back after it.
+  auto intrinsics = test.arch->GetInstrinsicTable();
+  auto is_frame_synced = false;
+  for (auto write : CallsTo(trace, intrinsics->write_memory_64)) {
+    auto prev_write = llvm::dyn_cast<llvm::CallInst>(write->getArgOperand(0));
+    if (!prev_write ||
+        prev_write->getCalledFunction() != intrinsics->write_memory_64) {
+      continue;
+    }
+    for (auto user : write->users()) {
+      auto read = llvm::dyn_cast<llvm::CallInst>(user);
+      if (read && read->getCalledFunction() == intrinsics->read_memory_64) {
+        is_frame_synced = true;
+      }
+    }
+  }
+  EXPECT_TRUE(is_frame_synced);
+}
+
+TEST(TieredOptimizer, AMD64SwapInPlace) {
+  TraceTest test(remill::kArchAMD64);
+
+  // call 0x1010; ret
+  test.manager.AddCode(0x1000, "\xe8\x0b\x00\x00\x00\xc3"sv);
+
+  // mov eax, 1; ret
+  test.manager.AddCode(0x1010, "\xb8\x01\x00\x00\x00\xc3"sv);
+
+  auto caller = test.Lift(0x1000);
+  auto callee = test.manager.GetLiftedTraceDefinition(0x1010);
+  ASSERT_TRUE(caller && !caller->isDeclaration());
+  ASSERT_TRUE(callee && !callee->isDeclaration());
+  ASSERT_EQ(CallsTo(caller, callee).size(), 1u);
+  ASSERT_NE(NumCallsToDefinitions(callee), 0u);
+
+  remill::TieredOptimizer optimizer(test.arch.get(), 1u, 2u);
+  EXPECT_FALSE(optimizer.RecordExecution(0x1010, callee));
+  EXPECT_TRUE(optimizer.RecordExecution(0x1010, callee));
+  EXPECT_FALSE(optimizer.RecordExecution(0x1010, callee));
+  optimizer.Wait();
+
+  std::vector<std::pair<uint64_t, llvm::Function *>> swapped;
+  EXPECT_EQ(optimizer.SwapInOptimizedTraces(
+                [&swapped](uint64_t pc, llvm::Function *trace) {
+                  swapped.emplace_back(pc, trace);
+                }),
+            1u);
+  EXPECT_EQ(swapped, (std::vector<std::pair<uint64_t, llvm::Function *>>{
+                         {0x1010, callee}}));
+
+  // The callee now has the optimized body, with its semantics inlined, and
+  // the caller still calls it.
+  EXPECT_EQ(test.manager.GetLiftedTraceDefinition(0x1010), callee);
+  EXPECT_FALSE(callee->isDeclaration());
+  EXPECT_EQ(NumCallsToDefinitions(callee), 0u);
+  EXPECT_EQ(CallsTo(caller, callee).size(), 1u);
+  EXPECT_FALSE(remill::VerifyModuleMsg(test.module.get()).has_value());
+
+  // Nothing is left to swap in.
+  EXPECT_EQ(optimizer.SwapInOptimizedTraces(), 0u);
+}
+
+TEST(GuardedDirectCalls, AMD64CallAndReturn) {
+  TraceTest test(remill::kArchAMD64);
+
+  // call 0x1010; ret
+  test.manager.AddCode(0x1000, "\xe8\x0b\x00\x00\x00\xc3"sv);
+
+  // mov eax, 1; ret
+  test.manager.AddCode(0x1010, "\xb8\x01\x00\x00\x00\xc3"sv);
+
+  remill::TraceLifter lifter(test.arch.get(), test.manager);
+  lifter.SetGuardedDirectCalls(true);
+  ASSERT_TRUE(lifter.Lift(0x1000));
+
+  auto caller = test.manager.GetLiftedTraceDefinition(0x1000);
+  auto callee = test.manager.GetLiftedTraceDefinition(0x1010);
+  ASSERT_TRUE(caller && !caller->isDeclaration());
+  ASSERT_TRUE(callee && !callee->isDeclaration());
+
+  // The caller calls the callee directly, and only continues if the callee
+  // returned to the instruction after the call.
+  auto calls = CallsTo(caller, callee);
+  ASSERT_EQ(calls.size(), 1u);
+  auto br = llvm::dyn_cast<llvm::BranchInst>(
+      calls[0]->getParent()->getTerminator());
+  ASSERT_TRUE(br && br->isConditional());
+  auto cmp = llvm::dyn_cast<llvm::ICmpInst>(br->getCondition());
+  ASSERT_TRUE(cmp && cmp->isEquality());
+  auto ret_pc = llvm::dyn_cast<llvm::ConstantInt>(cmp->getOperand(1));
+  ASSERT_TRUE(ret_pc);
+  EXPECT_EQ(ret_pc->getZExtValue(), 0x1005u);
+  auto load = llvm::dyn_cast<llvm::LoadInst>(cmp->getOperand(0));
+  ASSERT_TRUE(load);
+  EXPECT_EQ(load->getPointerOperand(),
+            remill::LoadProgramCounterRef(&caller->getEntryBlock()));
+
+  // Otherwise, it exits to `__remill_missing_block`.
+  auto intrinsics = test.arch->GetInstrinsicTable();
+  auto missing_calls = CallsTo(caller, intrinsics->missing_block);
+  ASSERT_EQ(missing_calls.size(), 1u);
+  EXPECT_EQ(missing_calls[0]->getParent(), br->getSuccessor(1));
+
+  // Both `ret`s return to the caller of the trace, rather than calling
+  // `__remill_function_return`.
+  for (auto trace : {caller, callee}) {
+    EXPECT_TRUE(CallsTo(trace, intrinsics->function_return).empty());
+    auto num_rets = 0u;
+    for (auto &block : *trace) {
+      if (auto ret = llvm::dyn_cast<llvm::ReturnInst>(block.getTerminator());
+          ret && !llvm::isa<llvm::CallInst>(ret->getReturnValue())) {
+        ++num_rets;
+      }
+    }
+    EXPECT_EQ(num_rets, 1u);
+  }
+  EXPECT_FALSE(remill::VerifyModuleMsg(test.module.get()).has_value());
+}
+
+TEST(ShadowReturnStack, AMD64PushAndPop) {
+  TraceTest test(remill::kArchAMD64);
+
+  // call 0x1010; ret
+  test.manager.AddCode(0x1000, "\xe8\x0b\x00\x00\x00\xc3"sv);
+
+  // mov eax, 1; ret
+  test.manager.AddCode(0x1010, "\xb8\x01\x00\x00\x00\xc3"sv);
+
+  remill::TraceLifter lifter(test.arch.get(), test.manager);
+  lifter.SetShadowReturnStack(true);
+  ASSERT_TRUE(lifter.Lift(0x1000));
+
+  auto caller = test.manager.GetLiftedTraceDefinition(0x1000);
+  auto callee = test.manager.GetLiftedTraceDefinition(0x1010);
+  auto ret_trace = test.manager.GetLiftedTraceDeclaration(0x1005);
+  ASSERT_TRUE(caller && !caller->isDeclaration());
+  ASSERT_TRUE(callee && !callee->isDeclaration());
+  ASSERT_TRUE(ret_trace);
+
+  auto stack = test.module->getGlobalVariable("__remill_shadow_return_stack");
+  auto top = test.module->getGlobalVariable("__remill_shadow_return_stack_top");
+  ASSERT_TRUE(stack && stack->isThreadLocal() && stack->isDeclaration());
+  ASSERT_TRUE(top && top->isThreadLocal() && top->isDeclaration());
+
+  // remill's definitions of the variables are large enough for the stack of
+  // lifted code.
+  const auto &dl = test.module->getDataLayout();
+  EXPECT_LE(dl.getTypeAllocSize(stack->getValueType()).getFixedValue(),
+            sizeof(__remill_shadow_return_stack));
+  EXPECT_EQ(dl.getTypeAllocSize(top->getValueType()).getFixedValue(),
+            sizeof(__remill_shadow_return_stack_top));
+
+  // The call pushes the return address and the trace that starts there, and
+  // then exits to the callee.
+  std::vector<llvm::Value *> pushed;
+  for (auto &inst : llvm::instructions(caller)) {
+    if (auto store = llvm::dyn_cast<llvm::StoreInst>(&inst);
+        store &&
+        llvm::getUnderlyingObject(store->getPointerOperand()) == stack) {
+      pushed.push_back(store->getValueOperand());
+    }
+  }
+  ASSERT_EQ(pushed.size(), 2u);
+  auto pushed_pc = llvm::dyn_cast<llvm::ConstantInt>(pushed[0]);
+  ASSERT_TRUE(pushed_pc);
+  EXPECT_EQ(pushed_pc->getZExtValue(), 0x1005u);
+  EXPECT_EQ(pushed[1], ret_trace);
+  EXPECT_EQ(CallsTo(caller, callee).size(), 1u);
+
+  // The return pops the stack, and tail-calls the popped trace if it starts
+  // at the return address, or falls back on `__remill_function_return`.
+  auto intrinsics = test.arch->GetInstrinsicTable();
+  auto fallbacks = CallsTo(callee, intrinsics->function_return);
+  ASSERT_EQ(fallbacks.size(), 1u);
+  auto miss_block = fallbacks[0]->getParent();
+  auto pop_block = miss_block->getSinglePredecessor();
+  ASSERT_TRUE(pop_block);
+  auto br = llvm::dyn_cast<llvm::BranchInst>(pop_block->getTerminator());
+  ASSERT_TRUE(br && br->isConditional());
+  EXPECT_EQ(br->getSuccessor(1), miss_block);
+
+  llvm::CallInst *hit_call = nullptr;
+  for (auto &inst : *br->getSuccessor(0)) {
+    if (auto call = llvm::dyn_cast<llvm::CallInst>(&inst)) {
+      hit_call = call;
+    }
+  }
+  ASSERT_TRUE(hit_call);
+  auto popped_trace = llvm::dyn_cast<llvm::LoadInst>(
+      hit_call->getCalledOperand());
+  ASSERT_TRUE(popped_trace);
+  EXPECT_EQ(llvm::getUnderlyingObject(popped_trace->getPointerOperand()),
+            stack);
+  EXPECT_FALSE(remill::VerifyModuleMsg(test.module.get()).has_value());
+}
+
+TEST(LinuxSyscalls, AMD64FastPath) {
+  TraceTest test(remill::kArchAMD64);
+
+  // mov eax, 39; syscall; ret
+  test.manager.AddCode(0x1000, "\xb8\x27\x00\x00\x00\x0f\x05\xc3"sv);
+
+  auto trace = test.Lift(0x1000);
+  ASSERT_TRUE(trace && !trace->isDeclaration());
+
+  remill::OptimizationGuide guide = {};
+  guide.lower_linux_syscalls = true;
+  remill::OptimizeModule(test.arch.get(), test.module.get(),
+                         test.manager.traces, guide);
+
+  // The system call number is a constant, so `getpid` is emulated directly.
+  auto emulate = test.module->getFunction("__remill_linux_syscall_getpid");
+  ASSERT_TRUE(emulate);
+  auto emulate_calls = CallsTo(trace, emulate);
+  ASSERT_EQ(emulate_calls.size(), 1u);
+
+  // When the emulator handles the system call, the fast path skips the hyper
+  // call, and sets the return register and the program counter like the
+  // hyper call handler would.
+  auto br = llvm::dyn_cast<llvm::BranchInst>(
+      emulate_calls[0]->getParent()->getTerminator());
+  ASSERT_TRUE(br && br->isConditional());
+  EXPECT_EQ(br->getCondition(), emulate_calls[0]);
+  auto done_block = br->getSuccessor(0);
+
+  const auto rax = test.arch->RegisterByName("RAX");
+  const auto pc = test.arch->RegisterByName("PC");
+  ASSERT_TRUE(rax && pc);
+  EXPECT_EQ(StoresToState(done_block, rax->offset).size(), 1u);
+
+  auto pc_stores = StoresToState(done_block, pc->offset);
+  ASSERT_EQ(pc_stores.size(), 1u);
+  auto next_pc = llvm::dyn_cast<llvm::ConstantInt>(pc_stores[0]);
+  ASSERT_TRUE(next_pc);
+  EXPECT_EQ(next_pc->getZExtValue(), 0x1007u);
+
+  // The hyper call is only on the slow path.
+  auto intrinsics = test.arch->GetInstrinsicTable();
+  auto hyper_calls = CallsTo(trace, intrinsics->async_hyper_call);
+  ASSERT_EQ(hyper_calls.size(), 1u);
+  EXPECT_EQ(hyper_calls[0]->getParent(), br->getSuccessor(1));
+  EXPECT_FALSE(remill::VerifyModuleMsg(test.module.get()).has_value());
+}
+
+TEST(HostFunctions, AMD64MemcpyShim) {
+  TestHostFunctionShim(remill::kArchAMD64);
+}
+
+TEST(HostFunctions, X86MemcpyShim) {
+  TestHostFunctionShim(remill::kArchX86);
+}
+
+int main(int argc, char **argv) {
+  testing::InitGoogleTest(&argc, argv);
+  google::ParseCommandLineFlags(&argc, &argv, true);
+  google::InitGoogleLogging(argv[0]);
+  return RUN_ALL_TESTS();
+}